@@ -24,6 +24,18 @@ constexpr char kSavedModelAssetsDirectory[] = "assets";
 /// SavedModel assets.extra directory.
 constexpr char kSavedModelAssetsExtraDirectory[] = "assets.extra";
 
+/// File in the SavedModel assets.extra directory listing the checkpoint keys of
+/// the variables in the order in which a warm-up of the model first accessed
+/// them, one per line. Used to order the prefetch of a lazy restore.
+constexpr char kSavedModelVariablesAccessOrderFilename[] =
+    "variables_access_order.txt";
+
+/// File in the SavedModel assets.extra directory holding a TFRecord of
+/// serialized SavedModelWarmupRequests, which are replayed when loading the
+/// SavedModel.
+constexpr char kSavedModelWarmupRequestsFilename[] =
+    "saved_model_warmup_requests";
+
 /// SavedModel assets key for graph collection-def.
 constexpr char kSavedModelAssetsKey[] = "saved_model_assets";
 
@@ -15,22 +15,31 @@ limitations under the License.
 
 #include "tensorflow/cc/saved_model/loader.h"
 
+#include <atomic>
+#include <map>
 #include <unordered_set>
 
 #include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/reader.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf_internal.h"
 #include "tensorflow/core/protobuf/graph_debug_info.pb.h"
+#include "tensorflow/core/protobuf/saved_model_warmup.pb.h"
 #include "tensorflow/core/protobuf/saver.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
 namespace {
@@ -55,9 +64,29 @@ auto* load_latency_by_stage = monitoring::Sampler<2>::New(
     // Scale of 10, power of 1.8 with bucket count 33 (~20 minutes).
     monitoring::Buckets::Exponential(10, 1.8, 33));
 
+auto* warmup_latency = monitoring::Sampler<2>::New(
+    {
+        "/tensorflow/cc/saved_model/warmup_latency",  // metric name
+        "Distribution of wall time spent (in microseconds) replaying each "
+        "warm-up request when loading the model, by signature",
+        "model_path",
+        "signature_name",
+    },
+    // Scale of 10, power of 1.8 with bucket count 33 (~20 minutes).
+    monitoring::Buckets::Exponential(10, 1.8, 33));
+
+// Maximum number of warm-up requests replayed when loading a SavedModel.
+constexpr int kMaxWarmupRequests = 1000;
+
 constexpr char kLoadAttemptFail[] = "fail";
 constexpr char kLoadAttemptSuccess[] = "success";
 
+// Number of threads prefetching the variables of a lazy restore.
+constexpr int kNumVariablePrefetchThreads = 4;
+// Stride, in bytes, at which the prefetch reads the variables: one byte per
+// page is enough to bring each page into memory.
+constexpr size_t kVariablePrefetchStride = 4096;
+
 uint64 GetLatencyMicroseconds(const uint64 start_microseconds) {
   const uint64 end_microseconds = Env::Default()->NowMicros();
   // Avoid clock skew.
@@ -195,11 +224,74 @@ Status GetInitOp(const string& export_dir, const MetaGraphDef& meta_graph_def,
   return Status::OK();
 }
 
+// Reads the variables of a lazy restore from the bundle at "variables_path"
+// in the background, in the order given by GetVariablePrefetchOrder(), until
+// "*cancelled" is set.  As the restored variables alias the same
+// memory-mapped files, this brings their pages into memory before they are
+// first accessed.  Variables that were restored as copies are skipped without
+// reading them.
+void StartVariablePrefetch(const string& export_dir,
+                           const string& variables_path,
+                           std::shared_ptr<std::atomic<bool>> cancelled) {
+  auto keys = std::make_shared<std::vector<string>>();
+  const Status status =
+      internal::GetVariablePrefetchOrder(export_dir, variables_path,
+                                         keys.get());
+  if (!status.ok()) {
+    LOG(WARNING) << "Not prefetching the variables of the SavedModel bundle at "
+                 << export_dir << ": " << status;
+    return;
+  }
+  LOG(INFO) << "Prefetching " << keys->size()
+            << " variables of the SavedModel bundle in the background.";
+  auto next_key = std::make_shared<std::atomic<size_t>>(0);
+  for (int i = 0; i < kNumVariablePrefetchThreads; ++i) {
+    Env::Default()->SchedClosure([variables_path, keys, next_key,
+                                  cancelled]() {
+      BundleReader::Options options;
+      options.use_mmap = true;
+      options.alias_mapped_tensors = true;
+      options.verify_aliased_checksums = false;
+      BundleReader reader(Env::Default(), variables_path, options);
+      if (!reader.status().ok()) return;
+      for (size_t j = (*next_key)++; j < keys->size() && !*cancelled;
+           j = (*next_key)++) {
+        Tensor value;
+        bool aliased;
+        if (!reader.LookupAliased((*keys)[j], &value, &aliased).ok() ||
+            !aliased) {
+          continue;
+        }
+        const StringPiece data = value.tensor_data();
+        volatile char sink = 0;
+        for (size_t offset = 0; offset < data.size();
+             offset += kVariablePrefetchStride) {
+          sink = data[offset];
+        }
+        (void)sink;
+      }
+    });
+  }
+}
+
+// Returns true if "graph_def" has reference variables. A lazy restore cannot
+// keep them backed by the read-only variables files: assigning a restored
+// value to one copies it, as the variable may be updated in place.
+bool HasRefVariables(const GraphDef& graph_def) {
+  for (const NodeDef& node : graph_def.node()) {
+    if (node.op() == "VariableV2" || node.op() == "Variable") {
+      return true;
+    }
+  }
+  return false;
+}
+
 Status RunRestore(const RunOptions& run_options, const string& export_dir,
                   const StringPiece restore_op_name,
                   const StringPiece variable_filename_const_op_name,
                   const std::vector<AssetFileDef>& asset_file_defs,
-                  Session* session) {
+                  bool has_ref_variables, Session* session,
+                  std::shared_ptr<std::atomic<bool>>* prefetch_cancelled) {
   LOG(INFO) << "Restoring SavedModel bundle.";
   // Find path to variables to be restored in export directory.
   const string variables_directory =
@@ -228,8 +320,202 @@ Status RunRestore(const RunOptions& run_options, const string& export_dir,
   AddAssetsTensorsToInputs(export_dir, asset_file_defs, &inputs);
 
   RunMetadata run_metadata;
-  return RunOnce(run_options, inputs, {}, {string(restore_op_name)},
-                 nullptr /* outputs */, &run_metadata, session);
+  TF_RETURN_IF_ERROR(RunOnce(run_options, inputs, {},
+                             {string(restore_op_name)}, nullptr /* outputs */,
+                             &run_metadata, session));
+
+  // A lazy restore leaves the variables backed by the memory-mapped variables
+  // files, so that the model can serve as soon as the restore op has run.
+  bool lazy_restore;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_LAZY",
+                                        /*default_val=*/false, &lazy_restore));
+  if (lazy_restore && has_ref_variables) {
+    // Their variables were read in full when the restore op assigned them,
+    // so prefetching would only read the same pages again.
+    LOG(WARNING) << "TF_CHECKPOINT_RESTORE_LAZY only applies to resource "
+                    "variables. The SavedModel bundle at "
+                 << export_dir << " has reference variables, which were "
+                 << "restored eagerly; its variables are not prefetched.";
+  } else if (lazy_restore) {
+    *prefetch_cancelled = std::make_shared<std::atomic<bool>>(false);
+    StartVariablePrefetch(export_dir, variables_path, *prefetch_cancelled);
+  }
+  return Status::OK();
+}
+
+Status ReadWarmupRequests(const string& path,
+                          std::vector<SavedModelWarmupRequest>* requests) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(path, &file));
+  io::SequentialRecordReader reader(file.get());
+  tstring record;
+  while (true) {
+    const Status status = reader.ReadRecord(&record);
+    if (errors::IsOutOfRange(status)) break;
+    TF_RETURN_IF_ERROR(status);
+    if (requests->size() == kMaxWarmupRequests) {
+      return errors::InvalidArgument("More than ", kMaxWarmupRequests,
+                                     " warm-up requests in ", path);
+    }
+    requests->emplace_back();
+    if (!requests->back().ParseFromString(string(record))) {
+      return errors::DataLoss("Could not parse warm-up request ",
+                              requests->size(), " in ", path);
+    }
+  }
+  return Status::OK();
+}
+
+Status GetWarmupTensorName(const SavedModelWarmupRequest& request,
+                           const string& key, const TensorInfo& tensor_info,
+                           string* name) {
+  if (tensor_info.name().empty()) {
+    return errors::Unimplemented(
+        "Warm-up requests only support dense tensors; the tensor ", key,
+        " of signature ", request.signature_name(), " is not one");
+  }
+  *name = tensor_info.name();
+  return Status::OK();
+}
+
+// Converts "request" into the feeds and fetches of a run of its signature.
+Status GetWarmupRunArgs(const MetaGraphDef& meta_graph_def,
+                        const SavedModelWarmupRequest& request,
+                        std::vector<std::pair<string, Tensor>>* inputs,
+                        std::vector<string>* output_tensor_names) {
+  const auto signature_it =
+      meta_graph_def.signature_def().find(request.signature_name());
+  if (signature_it == meta_graph_def.signature_def().end()) {
+    return errors::InvalidArgument("Warm-up request for unknown signature: ",
+                                   request.signature_name());
+  }
+  const SignatureDef& signature_def = signature_it->second;
+  for (const auto& input : request.inputs()) {
+    const auto input_it = signature_def.inputs().find(input.first);
+    if (input_it == signature_def.inputs().end()) {
+      return errors::InvalidArgument("Warm-up request for signature ",
+                                     request.signature_name(),
+                                     " has unknown input: ", input.first);
+    }
+    string name;
+    TF_RETURN_IF_ERROR(
+        GetWarmupTensorName(request, input.first, input_it->second, &name));
+    Tensor tensor;
+    if (!tensor.FromProto(input.second)) {
+      return errors::InvalidArgument("Warm-up request for signature ",
+                                     request.signature_name(),
+                                     " has an invalid tensor for input: ",
+                                     input.first);
+    }
+    inputs->emplace_back(name, tensor);
+  }
+  if (request.output_keys().empty()) {
+    for (const auto& output : signature_def.outputs()) {
+      string name;
+      TF_RETURN_IF_ERROR(
+          GetWarmupTensorName(request, output.first, output.second, &name));
+      output_tensor_names->push_back(name);
+    }
+  }
+  for (const string& output_key : request.output_keys()) {
+    const auto output_it = signature_def.outputs().find(output_key);
+    if (output_it == signature_def.outputs().end()) {
+      return errors::InvalidArgument("Warm-up request for signature ",
+                                     request.signature_name(),
+                                     " has unknown output: ", output_key);
+    }
+    string name;
+    TF_RETURN_IF_ERROR(
+        GetWarmupTensorName(request, output_key, output_it->second, &name));
+    output_tensor_names->push_back(name);
+  }
+  return Status::OK();
+}
+
+// RunWarmup replays the warm-up requests stored in the assets.extra directory
+// of the SavedModel, if any, so that the session builds and caches the
+// executors of the signatures they run before the model serves its first
+// request. The requests are replayed concurrently, on as many threads as the
+// session has inter-op threads.
+Status RunWarmup(const SessionOptions& session_options,
+                 const RunOptions& run_options, const string& export_dir,
+                 const MetaGraphDef& meta_graph_def, Session* session) {
+  const string warmup_requests_path =
+      io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory,
+                   kSavedModelWarmupRequestsFilename);
+  if (!Env::Default()->FileExists(warmup_requests_path).ok()) {
+    return Status::OK();
+  }
+  std::vector<SavedModelWarmupRequest> requests;
+  TF_RETURN_IF_ERROR(ReadWarmupRequests(warmup_requests_path, &requests));
+  if (requests.empty()) {
+    return Status::OK();
+  }
+  LOG(INFO) << "Replaying " << requests.size()
+            << " warm-up requests on SavedModel bundle at path: "
+            << export_dir;
+
+  struct SignatureWarmupStats {
+    int64 num_requests = 0;
+    uint64 total_microseconds = 0;
+    uint64 max_microseconds = 0;
+  };
+  mutex mu;
+  Status status;
+  std::map<string, SignatureWarmupStats> stats_by_signature;
+  int num_threads = session_options.config.inter_op_parallelism_threads();
+  if (num_threads <= 0) {
+    num_threads = port::MaxParallelism();
+  }
+  num_threads = std::min<int64>(num_threads, requests.size());
+  {
+    thread::ThreadPool pool(Env::Default(), "saved_model_warmup", num_threads);
+    for (const SavedModelWarmupRequest& request : requests) {
+      pool.Schedule([&run_options, &export_dir, &meta_graph_def, session,
+                     &request, &mu, &status, &stats_by_signature]() {
+        {
+          // The load fails anyway once a request has failed, so the
+          // remaining requests are not replayed.
+          mutex_lock l(mu);
+          if (!status.ok()) return;
+        }
+        std::vector<std::pair<string, Tensor>> inputs;
+        std::vector<string> output_tensor_names;
+        const uint64 start_microseconds = Env::Default()->NowMicros();
+        Status run_status = GetWarmupRunArgs(meta_graph_def, request, &inputs,
+                                             &output_tensor_names);
+        if (run_status.ok()) {
+          // Unlike RunOnce(), runs through Session::Run() so that the session
+          // keeps the executors it builds.
+          std::vector<Tensor> outputs;
+          RunMetadata run_metadata;
+          run_status = session->Run(run_options, inputs, output_tensor_names,
+                                    {}, &outputs, &run_metadata);
+        }
+        const uint64 latency = GetLatencyMicroseconds(start_microseconds);
+        mutex_lock l(mu);
+        status.Update(run_status);
+        if (!run_status.ok()) return;
+        warmup_latency->GetCell(export_dir, request.signature_name())
+            ->Add(latency);
+        SignatureWarmupStats& stats =
+            stats_by_signature[request.signature_name()];
+        ++stats.num_requests;
+        stats.total_microseconds += latency;
+        stats.max_microseconds = std::max(stats.max_microseconds, latency);
+      });
+    }
+  }
+  TF_RETURN_IF_ERROR(status);
+  for (const auto& signature_stats : stats_by_signature) {
+    const SignatureWarmupStats& stats = signature_stats.second;
+    LOG(INFO) << "Warm-up of signature " << signature_stats.first << ": "
+              << stats.num_requests << " requests, mean "
+              << stats.total_microseconds / stats.num_requests
+              << " microseconds, max " << stats.max_microseconds
+              << " microseconds.";
+  }
+  return Status::OK();
 }
 
 Status GetAssetFileDefs(const MetaGraphDef& meta_graph_def,
@@ -296,7 +582,9 @@ Status LoadSavedModelInternal(const SessionOptions& session_options,
       RunRestore(run_options, export_dir,
                  bundle->meta_graph_def.saver_def().restore_op_name(),
                  bundle->meta_graph_def.saver_def().filename_tensor_name(),
-                 asset_file_defs, bundle->session.get()));
+                 asset_file_defs,
+                 HasRefVariables(bundle->meta_graph_def.graph_def()),
+                 bundle->session.get(), &bundle->variable_prefetch_cancelled));
   // Record walltime spent in restoring graph from disk, but postpone metric
   // increments until graph init finishes.
   const uint64 restore_graph_walltime =
@@ -314,11 +602,67 @@ Status LoadSavedModelInternal(const SessionOptions& session_options,
   // Record wall time spent in init op.
   load_latency_by_stage->GetCell(export_dir, "init_graph")
       ->Add(GetLatencyMicroseconds(graph_init_start_microseconds));
+
+  const uint64 warmup_start_microseconds = Env::Default()->NowMicros();
+  TF_RETURN_IF_ERROR(RunWarmup(session_options, run_options, export_dir,
+                               bundle->meta_graph_def, bundle->session.get()));
+  // Record wall time spent replaying warm-up requests.
+  load_latency_by_stage->GetCell(export_dir, "warmup")
+      ->Add(GetLatencyMicroseconds(warmup_start_microseconds));
   return Status::OK();
 }
 
 }  // namespace
 
+namespace internal {
+
+// Returns the checkpoint keys of the variables in the bundle at
+// "variables_path" in prefetch order: first those listed in the access order
+// file of the SavedModel, if any, then the rest in bundle order.  Partitioned
+// variables are left out in favor of the keys of their slices.
+Status GetVariablePrefetchOrder(const string& export_dir,
+                                const string& variables_path,
+                                std::vector<string>* keys) {
+  const string access_order_path =
+      io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory,
+                   kSavedModelVariablesAccessOrderFilename);
+  std::vector<string> listed_keys;
+  if (Env::Default()->FileExists(access_order_path).ok()) {
+    string access_order;
+    TF_RETURN_IF_ERROR(
+        ReadFileToString(Env::Default(), access_order_path, &access_order));
+    listed_keys = str_util::Split(access_order, '\n', str_util::SkipEmpty());
+  }
+
+  BundleReader reader(Env::Default(), variables_path);
+  TF_RETURN_IF_ERROR(reader.status());
+  std::unordered_set<string> seen_keys;
+  auto add_key = [&reader, &seen_keys, keys](const string& key) {
+    std::vector<TensorSlice> slices;
+    if (!seen_keys.insert(key).second ||
+        !reader.LookupTensorSlices(key, &slices).ok() || !slices.empty()) {
+      return;
+    }
+    keys->push_back(key);
+  };
+  for (const string& key : listed_keys) {
+    add_key(key);
+  }
+  std::vector<string> bundle_keys;
+  reader.Seek(kHeaderEntryKey);
+  for (reader.Next(); reader.Valid(); reader.Next()) {
+    bundle_keys.emplace_back(reader.key());
+  }
+  // Looking up the slices moves the reader, so the bundle keys are listed
+  // first.
+  for (const string& key : bundle_keys) {
+    add_key(key);
+  }
+  return Status::OK();
+}
+
+}  // namespace internal
+
 SavedModelBundleInterface::~SavedModelBundleInterface() {}
 
 Status LoadSavedModel(const SessionOptions& session_options,
@@ -475,7 +819,8 @@ Status LoadSavedModel(const SessionOptions& session_options,
                                     tags, &legacy_bundle));
   *bundle = SavedModelBundleLite(
       absl::make_unique<LiteSessionWrapper>(std::move(legacy_bundle.session)),
-      std::move(*legacy_bundle.meta_graph_def.mutable_signature_def()));
+      std::move(*legacy_bundle.meta_graph_def.mutable_signature_def()),
+      std::move(legacy_bundle.variable_prefetch_cancelled));
   return Status::OK();
 }
 
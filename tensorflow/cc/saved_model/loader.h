@@ -18,8 +18,11 @@ limitations under the License.
 #ifndef TENSORFLOW_CC_SAVED_MODEL_LOADER_H_
 #define TENSORFLOW_CC_SAVED_MODEL_LOADER_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/protobuf/graph_debug_info.pb.h"
@@ -50,6 +53,9 @@ struct SavedModelBundle : public SavedModelBundleInterface {
   /// A TensorFlow Session does not Close itself on destruction. To avoid
   /// resource leaks, we explicitly call Close on Sessions that we create.
   ~SavedModelBundle() override {
+    if (variable_prefetch_cancelled) {
+      *variable_prefetch_cancelled = true;
+    }
     if (session) {
       session->Close().IgnoreError();
     }
@@ -65,6 +71,9 @@ struct SavedModelBundle : public SavedModelBundleInterface {
   std::unique_ptr<Session> session;
   MetaGraphDef meta_graph_def;
   std::unique_ptr<GraphDebugInfo> debug_info;
+  /// Set when the bundle is destroyed, to stop the background prefetch of
+  /// lazily restored variables, if any.
+  std::shared_ptr<std::atomic<bool>> variable_prefetch_cancelled;
 };
 
 // A version of SavedModelBundle that avoids storing a potentially large
@@ -78,9 +87,22 @@ class SavedModelBundleLite : public SavedModelBundleInterface {
                        protobuf::Map<string, SignatureDef> signatures)
       : session_(std::move(session)), signatures_(std::move(signatures)) {}
 
+  /// Takes over "variable_prefetch_cancelled" from the SavedModelBundle that
+  /// "session" was loaded into.
+  SavedModelBundleLite(
+      std::unique_ptr<Session> session,
+      protobuf::Map<string, SignatureDef> signatures,
+      std::shared_ptr<std::atomic<bool>> variable_prefetch_cancelled)
+      : session_(std::move(session)),
+        signatures_(std::move(signatures)),
+        variable_prefetch_cancelled_(std::move(variable_prefetch_cancelled)) {}
+
   /// A TensorFlow Session does not Close itself on destruction. To avoid
   /// resource leaks, we explicitly call Close on Sessions that we create.
   ~SavedModelBundleLite() override {
+    if (variable_prefetch_cancelled_) {
+      *variable_prefetch_cancelled_ = true;
+    }
     if (session_) {
       session_->Close().IgnoreError();
     }
@@ -94,6 +116,7 @@ class SavedModelBundleLite : public SavedModelBundleInterface {
  private:
   std::unique_ptr<Session> session_;
   protobuf::Map<string, SignatureDef> signatures_;
+  std::shared_ptr<std::atomic<bool>> variable_prefetch_cancelled_;
 };
 
 /// Loads a SavedModel from the specified export directory. The MetaGraphDef
@@ -101,6 +124,22 @@ class SavedModelBundleLite : public SavedModelBundleInterface {
 /// the set of tags used at SavedModel build time. Stores a SavedModel bundle in
 /// *bundle with a session and the requested MetaGraphDef, if found.
 ///
+/// If the environment variable TF_CHECKPOINT_RESTORE_LAZY is set to true, the
+/// resource variables are restored lazily: those whose data is suitably
+/// aligned in the variables files (see TF_CHECKPOINT_SAVE_DATA_ALIGNMENT) are
+/// left backed by the memory-mapped files and read when first accessed, and
+/// are prefetched in the background in the order listed in
+/// assets.extra/variables_access_order.txt, if present, until the bundle is
+/// destroyed. Reference variables
+/// (VariableV2, as in most TF1 models) are always restored eagerly, and the
+/// variables of a bundle that has any are not prefetched.
+///
+/// If the SavedModel has an assets.extra/saved_model_warmup_requests file, a
+/// TFRecord of serialized SavedModelWarmupRequests, each request is replayed
+/// through Session::Run() with the feeds and fetches of its signature before
+/// the load returns, and the replay latency of each signature is logged and
+/// recorded in the /tensorflow/cc/saved_model/warmup_latency metric.
+///
 /// NOTE: Prefer the overload that takes a SavedModelBundleLite* in new code.
 Status LoadSavedModel(const SessionOptions& session_options,
                       const RunOptions& run_options, const string& export_dir,
@@ -126,6 +165,17 @@ Status LoadSavedModel(const SessionOptions& session_options,
 /// no guarantee that it can be loaded.
 bool MaybeSavedModelDirectory(const string& export_dir);
 
+namespace internal {
+
+/// Returns the checkpoint keys of the variables in the bundle at
+/// "variables_path" in the order a lazy restore prefetches them. Exposed for
+/// testing.
+Status GetVariablePrefetchOrder(const string& export_dir,
+                                const string& variables_path,
+                                std::vector<string>* keys);
+
+}  // namespace internal
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CC_SAVED_MODEL_LOADER_H_
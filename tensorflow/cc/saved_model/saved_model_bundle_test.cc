@@ -15,17 +15,25 @@ limitations under the License.
 
 #include "tensorflow/cc/saved_model/loader.h"
 
+#include "tensorflow/cc/ops/resource_variable_ops.h"
+#include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/signature_constants.h"
 #include "tensorflow/cc/saved_model/tag_constants.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/saved_model.pb.h"
+#include "tensorflow/core/protobuf/saved_model_warmup.pb.h"
+#include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
 namespace {
@@ -52,6 +60,117 @@ class LoaderTest : public ::testing::Test {
     return example.SerializeAsString();
   }
 
+  // Copies the SavedModel in `export_dir` to the directory `name` under the
+  // test's temporary directory, and returns the path of the copy.
+  string CopySavedModel(const string& export_dir, const string& name) {
+    const string copy_dir = io::JoinPath(testing::TmpDir(), name);
+    for (const string& filename :
+         {string(kSavedModelFilenamePb), string("assets/foo.txt"),
+          string("variables/variables.index"),
+          string("variables/variables.data-00000-of-00001")}) {
+      const string target = io::JoinPath(copy_dir, filename);
+      TF_CHECK_OK(
+          Env::Default()->RecursivelyCreateDir(string(io::Dirname(target))));
+      TF_CHECK_OK(Env::Default()->CopyFile(
+          io::JoinPath(export_dir, filename), target));
+    }
+    return copy_dir;
+  }
+
+  void WriteWarmupRequests(
+      const string& export_dir,
+      const std::vector<SavedModelWarmupRequest>& requests) {
+    const string directory =
+        io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory);
+    TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(directory));
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewWritableFile(
+        io::JoinPath(directory, kSavedModelWarmupRequestsFilename), &file));
+    io::RecordWriter writer(file.get());
+    for (const SavedModelWarmupRequest& request : requests) {
+      TF_ASSERT_OK(writer.WriteRecord(request.SerializeAsString()));
+    }
+    TF_ASSERT_OK(writer.Close());
+    TF_ASSERT_OK(file->Close());
+  }
+
+  // Writes to `export_dir` a SavedModel with the resource variables "v0", "v1"
+  // and "v2", where "v<i>" holds 1024 floats of value i. The variables are
+  // saved with data aligned for aliasing by a lazy restore.
+  void WriteResourceVariablesSavedModel(const string& export_dir) {
+    Scope scope = Scope::NewRootScope();
+    const std::vector<string> names = {"v0", "v1", "v2"};
+    auto filename = ops::Const(scope.WithOpName("save/Const"),
+                               test::AsScalar<tstring>("unused"));
+    auto tensor_names = ops::Const(
+        scope.WithOpName("save/tensor_names"),
+        test::AsTensor<tstring>({names[0], names[1], names[2]}));
+    auto shape_and_slices =
+        ops::Const(scope.WithOpName("save/shape_and_slices"),
+                   test::AsTensor<tstring>({"", "", ""}));
+    auto restore = ops::RestoreV2(scope.WithOpName("save/RestoreV2"), filename,
+                                  tensor_names, shape_and_slices,
+                                  {DT_FLOAT, DT_FLOAT, DT_FLOAT});
+    std::vector<Output> values;
+    std::vector<Operation> restore_ops;
+    for (int i = 0; i < names.size(); ++i) {
+      auto handle = ops::VarHandleOp(
+          scope.WithOpName(names[i]), DT_FLOAT, TensorShape({1024}),
+          ops::VarHandleOp::SharedName(names[i]));
+      Tensor init_value(DT_FLOAT, TensorShape({1024}));
+      init_value.flat<float>().setConstant(i);
+      ops::AssignVariableOp(scope.WithOpName(names[i] + "/init"), handle,
+                            ops::Const(scope, init_value));
+      values.push_back(ops::ReadVariableOp(scope.WithOpName(names[i] + "/read"),
+                                           handle, DT_FLOAT));
+      restore_ops.push_back(
+          ops::AssignVariableOp(scope.WithOpName(names[i] + "/restore"),
+                                handle, restore.tensors[i])
+              .operation);
+    }
+    ops::SaveV2(scope.WithOpName("save/SaveV2"), filename, tensor_names,
+                shape_and_slices, values);
+    ops::NoOp(scope.WithOpName("save/restore_all")
+                  .WithControlDependencies(restore_ops));
+    SavedModel saved_model;
+    MetaGraphDef* meta_graph_def = saved_model.add_meta_graphs();
+    meta_graph_def->mutable_meta_info_def()->add_tags(kSavedModelTagServe);
+    meta_graph_def->mutable_saver_def()->set_filename_tensor_name(
+        "save/Const:0");
+    meta_graph_def->mutable_saver_def()->set_restore_op_name(
+        "save/restore_all");
+    TF_ASSERT_OK(scope.ToGraphDef(meta_graph_def->mutable_graph_def()));
+
+    TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(
+        io::JoinPath(export_dir, kSavedModelVariablesDirectory)));
+    TF_ASSERT_OK(WriteBinaryProto(
+        Env::Default(), io::JoinPath(export_dir, kSavedModelFilenamePb),
+        saved_model));
+    std::unique_ptr<Session> session(NewSession(SessionOptions()));
+    TF_ASSERT_OK(session->Create(meta_graph_def->graph_def()));
+    TF_ASSERT_OK(session->Run({}, {}, {"v0/init", "v1/init", "v2/init"},
+                              nullptr));
+    const Tensor variables_path = test::AsScalar<tstring>(
+        io::JoinPath(export_dir, kSavedModelVariablesDirectory,
+                     kSavedModelVariablesFilename));
+    setenv("TF_CHECKPOINT_SAVE_DATA_ALIGNMENT", "64", 1 /* overwrite */);
+    const Status status =
+        session->Run({{"save/Const", variables_path}}, {}, {"save/SaveV2"},
+                     nullptr);
+    unsetenv("TF_CHECKPOINT_SAVE_DATA_ALIGNMENT");
+    TF_ASSERT_OK(status);
+    TF_ASSERT_OK(session->Close());
+  }
+
+  SavedModelWarmupRequest MakeRegressWarmupRequest(
+      const string& signature_name) {
+    SavedModelWarmupRequest request;
+    request.set_signature_name(signature_name);
+    test::AsTensor<tstring>({MakeSerializedExample(1)}, TensorShape({1}))
+        .AsProtoField(&(*request.mutable_inputs())[kRegressInputs]);
+    return request;
+  }
+
   void ValidateAssets(const string& export_dir,
                       const SavedModelBundle& bundle) {
     const string asset_directory =
@@ -127,6 +246,105 @@ TEST_F(LoaderTest, TagMatch) {
   CheckSavedModelBundle(export_dir, bundle);
 }
 
+TEST_F(LoaderTest, LazyRestore) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+
+  const string export_dir =
+      io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded);
+  setenv("TF_CHECKPOINT_RESTORE_LAZY", "1", 1 /* overwrite */);
+  const Status status = LoadSavedModel(session_options, run_options,
+                                       export_dir, {kSavedModelTagServe},
+                                       &bundle);
+  unsetenv("TF_CHECKPOINT_RESTORE_LAZY");
+  TF_ASSERT_OK(status);
+  CheckSavedModelBundle(export_dir, bundle);
+}
+
+TEST_F(LoaderTest, LazyRestoreResourceVariables) {
+  const string export_dir =
+      io::JoinPath(testing::TmpDir(), "lazy_restore_resource_variables");
+  WriteResourceVariablesSavedModel(export_dir);
+  const string assets_extra_directory =
+      io::JoinPath(export_dir, kSavedModelAssetsExtraDirectory);
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(assets_extra_directory));
+  TF_ASSERT_OK(WriteStringToFile(
+      Env::Default(),
+      io::JoinPath(assets_extra_directory,
+                   kSavedModelVariablesAccessOrderFilename),
+      "v2\nv0\n"));
+
+  // The variables listed in the access order file are prefetched first.
+  std::vector<string> keys;
+  TF_ASSERT_OK(internal::GetVariablePrefetchOrder(
+      export_dir,
+      io::JoinPath(export_dir, kSavedModelVariablesDirectory,
+                   kSavedModelVariablesFilename),
+      &keys));
+  EXPECT_EQ(keys, std::vector<string>({"v2", "v0", "v1"}));
+
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+  setenv("TF_CHECKPOINT_RESTORE_LAZY", "1", 1 /* overwrite */);
+  const Status status = LoadSavedModel(session_options, run_options,
+                                       export_dir, {kSavedModelTagServe},
+                                       &bundle);
+  unsetenv("TF_CHECKPOINT_RESTORE_LAZY");
+  TF_ASSERT_OK(status);
+
+  // The restored variables alias the memory-mapped variables file.
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(bundle.session->Run(
+      {}, {"v0/read:0", "v1/read:0", "v2/read:0"}, {}, &outputs));
+  ASSERT_EQ(3, outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    Tensor expected(DT_FLOAT, TensorShape({1024}));
+    expected.flat<float>().setConstant(i);
+    test::ExpectTensorEqual<float>(expected, outputs[i]);
+    TensorDescription description;
+    outputs[i].FillDescription(&description);
+    EXPECT_EQ("BundleReaderMappedFile",
+              description.allocation_description().allocator_name());
+  }
+}
+
+TEST_F(LoaderTest, WarmupRequests) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+
+  const string export_dir = CopySavedModel(
+      io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded),
+      "warmup_requests");
+  WriteWarmupRequests(export_dir, std::vector<SavedModelWarmupRequest>(
+                                      10, MakeRegressWarmupRequest(
+                                              "regress_x_to_y")));
+  TF_ASSERT_OK(LoadSavedModel(session_options, run_options, export_dir,
+                              {kSavedModelTagServe}, &bundle));
+  CheckSavedModelBundle(export_dir, bundle);
+}
+
+TEST_F(LoaderTest, InvalidWarmupRequests) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+
+  const string export_dir = CopySavedModel(
+      io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded),
+      "invalid_warmup_requests");
+  WriteWarmupRequests(export_dir,
+                      {MakeRegressWarmupRequest("regress_x_to_y"),
+                       MakeRegressWarmupRequest("unknown_signature")});
+  const Status status = LoadSavedModel(session_options, run_options,
+                                       export_dir, {kSavedModelTagServe},
+                                       &bundle);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_TRUE(absl::StrContains(status.error_message(), "unknown_signature"))
+      << status;
+}
+
 TEST_F(LoaderTest, NoTagMatch) {
   SavedModelBundle bundle;
   RunOptions run_options;
@@ -34,6 +34,14 @@ limitations under the License.
 
 namespace tensorflow {
 
+// A per-thread cache of free chunks, bucketed by rounded size.
+struct BFCAllocator::CacheShard {
+  mutex mu;
+  std::vector<void*> free_chunks[kNumCacheClasses] GUARDED_BY(mu);
+  size_t cached_bytes GUARDED_BY(mu) = 0;
+  int64 num_allocs GUARDED_BY(mu) = 0;
+};
+
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                            bool allow_growth, const string& name,
                            bool garbage_collection)
@@ -209,6 +217,9 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
   if (r != nullptr) {
     return r;
   } else {
+    if (num_cache_shards_ > 0) {
+      FlushFreeChunkCache();
+    }
     static const int64 kMaxMillisToWait = 10000;  // 10 seconds
     r = retry_helper_.AllocateRaw(
         [this, &allocation_attr](size_t a, size_t nb, bool v) {
@@ -226,6 +237,19 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(1) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (num_cache_shards_ > 0 && num_bytes > 0 && timing_counter_ == nullptr &&
+      allocation_attr.freed_by_func == nullptr) {
+    const size_t rounded_bytes = RoundedBytes(num_bytes);
+    if (rounded_bytes <= kMaxCachedChunkSize) {
+      return AllocateCached(rounded_bytes, allocation_attr);
+    }
+  }
+  return AllocateRawUncached(unused_alignment, num_bytes, allocation_attr);
+}
+
+void* BFCAllocator::AllocateRawUncached(
+    size_t unused_alignment, size_t num_bytes,
+    const AllocationAttributes& allocation_attr) {
   if (allocation_attr.no_retry_on_failure) {
     // Return immediately upon the first failure if this is for allocating an
     // optional scratch space.
@@ -236,6 +260,13 @@ void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
     }
     void* result = AllocateRawInternal(unused_alignment, num_bytes,
                                        dump_log_on_failure, freed_by_count);
+    if (result == nullptr && num_cache_shards_ > 0) {
+      // Chunks parked in the per-thread caches may be enough to satisfy the
+      // request once they are coalesced back into the bins.
+      FlushFreeChunkCache();
+      result = AllocateRawInternal(unused_alignment, num_bytes,
+                                   dump_log_on_failure, freed_by_count);
+    }
     if (result == nullptr) {
       static std::atomic<int32> log_counter{0};
       int32 counter_value = log_counter.load(std::memory_order_relaxed);
@@ -547,6 +578,9 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(1) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
+  if (num_cache_shards_ > 0 && ptr != nullptr && MaybeDeallocateCached(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -557,7 +591,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   mutex_lock l(lock_);
+  DeallocateRawLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -988,6 +1025,9 @@ void BFCAllocator::MaybeWriteMemoryMap() {
 }
 
 MemoryDump BFCAllocator::RecordMemoryMap() {
+  if (num_cache_shards_ > 0) {
+    FlushFreeChunkCache();
+  }
   mutex_lock l(lock_);
   return RecordMemoryMapInternal();
 }
@@ -1037,17 +1077,188 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 }
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
+  size_t cached_bytes = 0;
+  int64 cached_allocs = 0;
+  if (num_cache_shards_ > 0) {
+    GetCacheStats(&cached_bytes, &cached_allocs);
+  }
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  stats.num_allocs += cached_allocs;
+  stats.bytes_in_use -= std::min<int64>(stats.bytes_in_use, cached_bytes);
+  return stats;
 }
 
 void BFCAllocator::ClearStats() {
+  for (int i = 0; i < num_cache_shards_; ++i) {
+    mutex_lock l(cache_shards_[i].mu);
+    cache_shards_[i].num_allocs = 0;
+  }
   mutex_lock l(lock_);
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
 }
 
+void BFCAllocator::EnableFreeChunkCache(int num_shards) {
+  CHECK_EQ(num_cache_shards_, 0) << "Free chunk cache already enabled";
+  if (num_shards <= 0) return;
+  VLOG(1) << "Enabling " << num_shards << " free chunk caches for " << Name();
+  cache_shards_.reset(new CacheShard[num_shards]);
+  cache_stripes_.reset(new CacheStripe[kNumCacheStripes]);
+  num_cache_shards_ = num_shards;
+}
+
+BFCAllocator::CacheShard* BFCAllocator::ShardForCurrentThread() {
+  static std::atomic<int> next_thread_index{0};
+  thread_local const int thread_index =
+      next_thread_index.fetch_add(1, std::memory_order_relaxed);
+  return &cache_shards_[thread_index % num_cache_shards_];
+}
+
+void* BFCAllocator::AllocateCached(
+    size_t rounded_bytes, const AllocationAttributes& allocation_attr) {
+  CacheShard* shard = ShardForCurrentThread();
+  const int size_class = CacheClassForSize(rounded_bytes);
+  {
+    mutex_lock l(shard->mu);
+    std::vector<void*>& free_chunks = shard->free_chunks[size_class];
+    if (!free_chunks.empty()) {
+      void* ptr = free_chunks.back();
+      free_chunks.pop_back();
+      shard->cached_bytes -= rounded_bytes;
+      ++shard->num_allocs;
+      return ptr;
+    }
+  }
+
+  // Cache miss: allocate a chunk of exactly the class size so that it can be
+  // recycled for any request in the class, then stock up for the next calls.
+  void* ptr = AllocateRawUncached(kAllocatorAlignment, rounded_bytes,
+                                  allocation_attr);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  {
+    CacheStripe* stripe = StripeFor(ptr);
+    mutex_lock l(stripe->mu);
+    stripe->size_classes[ptr] = size_class;
+  }
+  RefillCacheShard(shard, size_class);
+  return ptr;
+}
+
+void BFCAllocator::RefillCacheShard(CacheShard* shard, int size_class) {
+  const size_t rounded_bytes = CacheClassToSize(size_class);
+  std::vector<void*> ptrs;
+  ptrs.reserve(kCacheRefillBatch);
+  {
+    mutex_lock l(lock_);
+    const BinNum bin_num = BinNumForSize(rounded_bytes);
+    for (int i = 0; i < kCacheRefillBatch; ++i) {
+      void* ptr = FindChunkPtr(bin_num, rounded_bytes, rounded_bytes, 0);
+      if (ptr == nullptr) break;
+      ptrs.push_back(ptr);
+    }
+    // FindChunkPtr counts each chunk as an allocation; the cache counts them
+    // when they are actually handed out.
+    stats_.num_allocs -= ptrs.size();
+  }
+  if (ptrs.empty()) return;
+  for (void* ptr : ptrs) {
+    CacheStripe* stripe = StripeFor(ptr);
+    mutex_lock l(stripe->mu);
+    stripe->size_classes[ptr] = size_class;
+  }
+  mutex_lock l(shard->mu);
+  std::vector<void*>& free_chunks = shard->free_chunks[size_class];
+  free_chunks.insert(free_chunks.end(), ptrs.begin(), ptrs.end());
+  shard->cached_bytes += ptrs.size() * rounded_bytes;
+}
+
+bool BFCAllocator::MaybeDeallocateCached(void* ptr) {
+  int size_class;
+  {
+    CacheStripe* stripe = StripeFor(ptr);
+    mutex_lock l(stripe->mu);
+    auto it = stripe->size_classes.find(ptr);
+    if (it == stripe->size_classes.end()) {
+      return false;
+    }
+    size_class = it->second;
+  }
+
+  const size_t rounded_bytes = CacheClassToSize(size_class);
+  CacheShard* shard = ShardForCurrentThread();
+  std::vector<void*> to_return;
+  {
+    mutex_lock l(shard->mu);
+    std::vector<void*>& free_chunks = shard->free_chunks[size_class];
+    free_chunks.push_back(ptr);
+    shard->cached_bytes += rounded_bytes;
+    if (shard->cached_bytes > kMaxCachedBytesPerShard) {
+      // The shard is over budget: hand everything back to the bins.
+      for (std::vector<void*>& chunks : shard->free_chunks) {
+        to_return.insert(to_return.end(), chunks.begin(), chunks.end());
+        chunks.clear();
+      }
+      shard->cached_bytes = 0;
+    } else if (free_chunks.size() > kMaxCachedChunksPerClass) {
+      // Return the least recently freed half of the class in one batch.
+      const size_t n = free_chunks.size() / 2;
+      to_return.assign(free_chunks.begin(), free_chunks.begin() + n);
+      free_chunks.erase(free_chunks.begin(), free_chunks.begin() + n);
+      shard->cached_bytes -= n * rounded_bytes;
+    }
+  }
+  if (!to_return.empty()) {
+    ReturnCachedChunks(to_return);
+    retry_helper_.NotifyDealloc();
+  }
+  return true;
+}
+
+void BFCAllocator::ReturnCachedChunks(const std::vector<void*>& ptrs) {
+  // Forget the chunks before they go back to the bins, where they may be
+  // handed out again through the uncached path.
+  for (void* ptr : ptrs) {
+    CacheStripe* stripe = StripeFor(ptr);
+    mutex_lock l(stripe->mu);
+    stripe->size_classes.erase(ptr);
+  }
+  mutex_lock l(lock_);
+  for (void* ptr : ptrs) {
+    DeallocateRawLocked(ptr);
+  }
+}
+
+void BFCAllocator::FlushFreeChunkCache() {
+  std::vector<void*> to_return;
+  for (int i = 0; i < num_cache_shards_; ++i) {
+    CacheShard* shard = &cache_shards_[i];
+    mutex_lock l(shard->mu);
+    for (std::vector<void*>& chunks : shard->free_chunks) {
+      to_return.insert(to_return.end(), chunks.begin(), chunks.end());
+      chunks.clear();
+    }
+    shard->cached_bytes = 0;
+  }
+  if (!to_return.empty()) {
+    ReturnCachedChunks(to_return);
+    retry_helper_.NotifyDealloc();
+  }
+}
+
+void BFCAllocator::GetCacheStats(size_t* cached_bytes, int64* num_allocs) {
+  *cached_bytes = 0;
+  *num_allocs = 0;
+  for (int i = 0; i < num_cache_shards_; ++i) {
+    mutex_lock l(cache_shards_[i].mu);
+    *cached_bytes += cache_shards_[i].cached_bytes;
+    *num_allocs += cache_shards_[i].num_allocs;
+  }
+}
+
 std::array<BFCAllocator::BinDebugInfo, BFCAllocator::kNumBins>
 BFCAllocator::get_bin_debug_info() {
   std::array<BinDebugInfo, kNumBins> bin_infos;
@@ -86,19 +86,85 @@ class BFCAllocator : public Allocator {
 
   MemoryDump RecordMemoryMap();
 
+  // Enables per-thread caches of small free chunks in front of the global
+  // bins.  Each calling thread is assigned to one of 'num_shards' caches;
+  // allocations of at most kMaxCachedChunkSize bytes are served from, and
+  // returned to, that cache under its own lock, so that threads only contend
+  // on the allocator-wide lock when a cache is refilled from or drained back
+  // into the bins in batches.
+  //
+  // Chunks held by a cache are counted as in use by the bins but are
+  // subtracted from bytes_in_use in GetStats(), and are returned to the bins
+  // before RecordMemoryMap() runs or before an allocation is allowed to fail.
+  // While a chunk is cached, RequestedSize() reports its rounded size.
+  //
+  // Must be called before the first allocation.  'num_shards' <= 0 leaves the
+  // caches disabled.  Caches are bypassed when a timing counter is set or an
+  // allocation carries a freed_by_func, since those need per-chunk
+  // timestamps.
+  void EnableFreeChunkCache(int num_shards);
+
+  // Returns every chunk held by the per-thread caches to the bins.
+  void FlushFreeChunkCache();
+
  private:
   struct Bin;
+  struct CacheShard;
 
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
                             bool dump_log_on_failure,
                             uint64 freed_before_count);
 
+  void* AllocateRawUncached(size_t alignment, size_t num_bytes,
+                            const AllocationAttributes& allocation_attr);
+
   void* AllocateRawInternalWithRetry(
       size_t alignment, size_t num_bytes,
       const AllocationAttributes& allocation_attr);
 
   void DeallocateRawInternal(void* ptr);
 
+  // Frees the chunk holding 'ptr'.  Does not notify retry_helper_.
+  void DeallocateRawLocked(void* ptr) EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Free chunk cache support; see EnableFreeChunkCache().
+  static const size_t kMaxCachedChunkSize = 64 << 10;
+  static const int kNumCacheClasses = kMaxCachedChunkSize >> 8;
+  static const int kCacheRefillBatch = 8;
+  static const int kMaxCachedChunksPerClass = 64;
+  static const size_t kMaxCachedBytesPerShard = 4 << 20;
+  static const int kNumCacheStripes = 64;
+
+  // Returns the cache size class for 'rounded_bytes', which must be at most
+  // kMaxCachedChunkSize.
+  static int CacheClassForSize(size_t rounded_bytes) {
+    return static_cast<int>(rounded_bytes >> kMinAllocationBits) - 1;
+  }
+  static size_t CacheClassToSize(int size_class) {
+    return static_cast<size_t>(size_class + 1) << kMinAllocationBits;
+  }
+
+  CacheShard* ShardForCurrentThread();
+
+  // Returns a cached chunk of 'rounded_bytes' bytes, taking a batch from the
+  // bins if this thread's cache is empty.  Returns nullptr on failure.
+  void* AllocateCached(size_t rounded_bytes,
+                       const AllocationAttributes& allocation_attr);
+
+  // Returns true and caches 'ptr' if it is managed by the free chunk cache.
+  bool MaybeDeallocateCached(void* ptr);
+
+  // Moves up to kCacheRefillBatch free chunks of 'size_class' from the bins
+  // into 'shard' without growing the allocator.
+  void RefillCacheShard(CacheShard* shard, int size_class);
+
+  // Returns 'ptrs' to the bins under a single acquisition of lock_.
+  void ReturnCachedChunks(const std::vector<void*>& ptrs);
+
+  // Returns the number of bytes held by the per-thread caches and the number
+  // of allocations they have served since the last ClearStats().
+  void GetCacheStats(size_t* cached_bytes, int64* num_allocs);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -539,6 +605,24 @@ class BFCAllocator : public Allocator {
   int64 action_counter_ GUARDED_BY(lock_);
 #endif
 
+  // Per-thread free chunk caches; empty unless EnableFreeChunkCache() was
+  // called.
+  std::unique_ptr<CacheShard[]> cache_shards_;
+  int num_cache_shards_ = 0;
+
+  // Maps each chunk handed out through the caches to its size class.  Lookups
+  // happen on every deallocation, so the map is striped by address.
+  struct CacheStripe {
+    mutex mu;
+    std::unordered_map<const void*, int> size_classes GUARDED_BY(mu);
+  };
+  std::unique_ptr<CacheStripe[]> cache_stripes_;
+  CacheStripe* StripeFor(const void* ptr) {
+    return &cache_stripes_[(reinterpret_cast<std::uintptr_t>(ptr) >>
+                            kMinAllocationBits) %
+                           kNumCacheStripes];
+  }
+
   friend class GPUBFCAllocatorPrivateMethodsTest;
   TF_DISALLOW_COPY_AND_ASSIGN(BFCAllocator);
 };
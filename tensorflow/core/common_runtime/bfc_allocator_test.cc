@@ -0,0 +1,207 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/bfc_memory_map.pb.h"
+
+namespace tensorflow {
+namespace {
+
+BFCAllocator* NewCPUBFCAllocator(size_t total_memory, int cache_shards) {
+  BFCAllocator* a = new BFCAllocator(
+      new BasicCPUAllocator(port::kNUMANoAffinity, {}, {}), total_memory,
+      true /*allow_growth*/, "cpu_bfc");
+  a->EnableFreeChunkCache(cache_shards);
+  return a;
+}
+
+TEST(BFCAllocatorTest, NoDupsWithFreeChunkCache) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, 4));
+  random::PhiloxRandom philox(123, 17);
+  random::SimplePhilox rand(&philox);
+
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 1024; ++i) {
+    size_t bytes = rand.Rand32() % (128 << 10) + 1;
+    void* raw = a->AllocateRaw(1, bytes);
+    CHECK(raw);
+    memset(raw, 0xab, bytes);
+    ptrs.push_back(raw);
+  }
+  std::sort(ptrs.begin(), ptrs.end());
+  for (size_t i = 1; i < ptrs.size(); ++i) {
+    ASSERT_NE(ptrs[i], ptrs[i - 1]);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  EXPECT_EQ(0, a->GetStats()->bytes_in_use);
+}
+
+TEST(BFCAllocatorTest, StatsExcludeCachedChunks) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, 1));
+
+  void* p = a->AllocateRaw(1, 1000);
+  absl::optional<AllocatorStats> stats = a->GetStats();
+  EXPECT_EQ(1, stats->num_allocs);
+  EXPECT_EQ(1024, stats->bytes_in_use);
+
+  a->DeallocateRaw(p);
+  stats = a->GetStats();
+  EXPECT_EQ(1, stats->num_allocs);
+  EXPECT_EQ(0, stats->bytes_in_use);
+
+  // Served from the cache.
+  p = a->AllocateRaw(1, 900);
+  stats = a->GetStats();
+  EXPECT_EQ(2, stats->num_allocs);
+  EXPECT_EQ(1024, stats->bytes_in_use);
+  a->DeallocateRaw(p);
+
+  a->ClearStats();
+  EXPECT_EQ(0, a->GetStats()->num_allocs);
+}
+
+TEST(BFCAllocatorTest, MemoryMapFlushesFreeChunkCache) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, 2));
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 4096));
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+
+  MemoryDump md = a->RecordMemoryMap();
+  for (const MemChunk& chunk : md.chunk()) {
+    EXPECT_FALSE(chunk.in_use());
+  }
+}
+
+TEST(BFCAllocatorTest, CachedChunksDoNotCauseOOM) {
+  // With a 1MiB limit, every byte has to come back out of the cache for the
+  // large allocation to succeed.
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 20, 1));
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 512; ++i) {
+    void* p = a->AllocateRaw(1, 1024);
+    if (p == nullptr) break;
+    ptrs.push_back(p);
+  }
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+
+  void* large = a->AllocateRaw(1, 768 << 10);
+  EXPECT_NE(nullptr, large);
+  a->DeallocateRaw(large);
+}
+
+TEST(BFCAllocatorTest, ConcurrentAllocationsWithFreeChunkCache) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1 << 30, 4));
+  {
+    thread::ThreadPool pool(Env::Default(), "test", 8);
+    for (int t = 0; t < 8; ++t) {
+      pool.Schedule([&a, t]() {
+        random::PhiloxRandom philox(t, 17);
+        random::SimplePhilox rand(&philox);
+        std::vector<std::pair<uint8*, size_t>> live;
+        for (int i = 0; i < 2000; ++i) {
+          if (!live.empty() && rand.Rand32() % 2 == 0) {
+            const size_t j = rand.Rand32() % live.size();
+            uint8* p = live[j].first;
+            for (size_t k = 0; k < live[j].second; ++k) {
+              CHECK_EQ(p[k], static_cast<uint8>(t));
+            }
+            a->DeallocateRaw(p);
+            live[j] = live.back();
+            live.pop_back();
+          } else {
+            const size_t bytes = rand.Rand32() % 8192 + 1;
+            uint8* p = static_cast<uint8*>(a->AllocateRaw(1, bytes));
+            CHECK(p);
+            memset(p, t, bytes);
+            live.emplace_back(p, bytes);
+          }
+        }
+        for (const auto& entry : live) {
+          a->DeallocateRaw(entry.first);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(0, a->GetStats()->bytes_in_use);
+}
+
+static void BM_AllocationThreaded(int iters, int num_threads,
+                                  int cache_shards) {
+  std::unique_ptr<BFCAllocator> a(NewCPUBFCAllocator(1uLL << 32, cache_shards));
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  std::atomic_int_fast32_t count(iters);
+  mutex done_lock;
+  condition_variable done;
+  bool done_flag = false;
+
+  for (int t = 0; t < num_threads; t++) {
+    pool.Schedule([&a, &count, &done_lock, &done, &done_flag, iters]() {
+      // Exercise a few different allocation sizes, keeping a small window of
+      // live allocations as an op's intermediate tensors would.
+      std::vector<int> sizes = {256, 4096, 16384, 512, 1024, 65536, 2048};
+      std::vector<void*> window(4, nullptr);
+      int size_index = 0;
+      for (int i = 0; i < iters; i++) {
+        void*& slot = window[i % window.size()];
+        if (slot != nullptr) a->DeallocateRaw(slot);
+        slot = a->AllocateRaw(1, sizes[size_index++ % sizes.size()]);
+        if (count.fetch_sub(1) == 1) {
+          mutex_lock l(done_lock);
+          done_flag = true;
+          done.notify_all();
+          break;
+        }
+      }
+      for (void* p : window) {
+        if (p != nullptr) a->DeallocateRaw(p);
+      }
+    });
+  }
+  mutex_lock l(done_lock);
+  if (!done_flag) {
+    done.wait(l);
+  }
+}
+BENCHMARK(BM_AllocationThreaded)
+    ->ArgPair(1, 0)
+    ->ArgPair(4, 0)
+    ->ArgPair(16, 0)
+    ->ArgPair(1, 16)
+    ->ArgPair(4, 16)
+    ->ArgPair(16, 16);
+
+}  // namespace
+}  // namespace tensorflow
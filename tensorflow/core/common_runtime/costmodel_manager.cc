@@ -62,8 +62,36 @@ Status CostModelManager::AddToCostGraphDef(const Graph* graph,
     return errors::InvalidArgument("The cost model graph doesn't exist.");
   }
   CostModel* cost_model = it->second;
+  const int first_node = cost_graph->node_size();
   cost_model->AddToCostGraphDef(graph, cost_graph);
+
+  auto dispatch_it = dispatch_costs_.find(graph);
+  if (dispatch_it != dispatch_costs_.end()) {
+    std::unordered_map<int, const NodeDispatchCost*> by_id;
+    for (const NodeDispatchCost& cost : dispatch_it->second) {
+      by_id[cost.node_id] = &cost;
+    }
+    for (int i = first_node; i < cost_graph->node_size(); ++i) {
+      CostGraphDef::Node* cnode = cost_graph->mutable_node(i);
+      const NodeDispatchCost* cost = gtl::FindPtrOrNull(by_id, cnode->id());
+      if (cost != nullptr) {
+        cnode->set_executor_cost_cycles(cost->cost_cycles);
+        cnode->set_executor_run_inline(cost->run_inline);
+      }
+    }
+  }
   return Status::OK();
 }
 
+void CostModelManager::RecordDispatchCosts(
+    const Graph* graph, std::vector<NodeDispatchCost> costs) {
+  mutex_lock l(mu_);
+  dispatch_costs_[graph] = std::move(costs);
+}
+
+void CostModelManager::RemoveDispatchCosts(const Graph* graph) {
+  mutex_lock l(mu_);
+  dispatch_costs_.erase(graph);
+}
+
 }  // namespace tensorflow
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_COSTMODEL_MANAGER_H_
 
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/framework/cost_graph.pb.h"
 #include "tensorflow/core/graph/costmodel.h"
@@ -34,6 +35,16 @@ class CostModelManager {
   typedef std::unordered_map<const Graph*, CostModel*> CostModelMap;
   typedef CostModelMap::iterator CostModelMapIter;
 
+  // The compute cost of a node as measured online by the executor that runs
+  // it, and whether the executor runs the node inline on the thread that
+  // made it ready (possibly batched with other inexpensive nodes) rather
+  // than in a closure of its own.
+  struct NodeDispatchCost {
+    int node_id = -1;
+    uint64 cost_cycles = 0;
+    bool run_inline = false;
+  };
+
   void ExportCostModels(CostModelMap* cost_models) {
     mutex_lock l(mu_);
     *cost_models = cost_models_;
@@ -45,9 +56,19 @@ class CostModelManager {
 
   Status AddToCostGraphDef(const Graph* graph, CostGraphDef* cost_graph);
 
+  // Replaces the dispatch costs of the nodes of `graph`. Executors with
+  // adaptive dispatch publish them periodically.
+  void RecordDispatchCosts(const Graph* graph,
+                           std::vector<NodeDispatchCost> costs);
+
+  // Forgets the dispatch costs of `graph`.
+  void RemoveDispatchCosts(const Graph* graph);
+
  private:
   mutex mu_;
   CostModelMap cost_models_ GUARDED_BY(mu_);
+  std::unordered_map<const Graph*, std::vector<NodeDispatchCost>>
+      dispatch_costs_ GUARDED_BY(mu_);
 };
 
 }  // namespace tensorflow
@@ -15,7 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/direct_session.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -35,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
+#include "tensorflow/core/common_runtime/scheduling_stats_collector.h"
 #include "tensorflow/core/common_runtime/scoped_allocator_mgr.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/function.h"
@@ -598,6 +601,21 @@ Status DirectSession::RunInternal(
     args.stats_collector = run_state.collector.get();
   }
 
+  bool record_scheduling_stats = do_trace;
+  const float scheduling_stats_sample_rate =
+      options_.config.experimental().scheduling_stats_sample_rate();
+  if (!record_scheduling_stats && scheduling_stats_sample_rate > 0) {
+    // Record every (1 / rate)-th step, which is cheaper than drawing a random
+    // number per step and spreads the samples evenly.
+    const int64 record_every =
+        std::max<int64>(1, std::llround(1.0 / scheduling_stats_sample_rate));
+    record_scheduling_stats = (executor_step_count % record_every == 0);
+  }
+  if (record_scheduling_stats) {
+    run_state.scheduling_stats.reset(new SchedulingStatsCollector);
+    args.scheduling_stats = run_state.scheduling_stats.get();
+  }
+
   std::unique_ptr<ProfilerSession> profiler_session;
   if (run_options.trace_level() >= RunOptions::HARDWARE_TRACE) {
     profiler_session = ProfilerSession::Create();
@@ -657,7 +675,8 @@ Status DirectSession::RunInternal(
   if (ShouldUseRunHandlerPool(run_options) &&
       run_options.experimental().use_run_handler_pool()) {
     VLOG(1) << "Using RunHandler to scheduler inter-op closures.";
-    handler = GetOrCreateRunHandlerPool(options_)->Get(step_id);
+    handler = GetOrCreateRunHandlerPool(options_)->Get(
+        step_id, run_options.experimental().run_handler_pool_options());
   }
   auto* handler_ptr = handler.get();
 
@@ -730,6 +749,11 @@ Status DirectSession::RunInternal(
     run_state.collector->Finalize();
   }
 
+  if (run_state.scheduling_stats) {
+    run_state.scheduling_stats->ToProto(
+        run_metadata->mutable_scheduling_stats());
+  }
+
   // Build and return the cost model as instructed.
   if (update_cost_model) {
     // Build the cost model
@@ -1344,6 +1368,22 @@ Status DirectSession::CreateExecutors(
       *r = new IntraProcessRendezvous(device_mgr);
       return Status::OK();
     };
+    params.use_step_arena =
+        options_.config.experimental().use_step_arena_allocator() &&
+        device->device_type() == DEVICE_CPU;
+    params.use_static_memory_plan =
+        options_.config.experimental().use_static_memory_plan() &&
+        device->device_type() == DEVICE_CPU;
+    params.adaptive_dispatch =
+        options_.config.experimental().use_adaptive_dispatch();
+    // The measured costs are keyed by the partition graph, so they are only
+    // recorded if the graph is kept alive alongside the executor.
+    const bool keep_partition_graph =
+        !options_.config.experimental().disable_output_partition_graphs() ||
+        options_.config.graph_options().build_cost_model() > 0;
+    if (keep_partition_graph) {
+      params.cost_model_manager = &cost_model_manager_;
+    }
 
     optimizer.Optimize(lib, options_.env, device, &partition_graph,
                        /*shape_map=*/nullptr);
@@ -1365,8 +1405,7 @@ Status DirectSession::CreateExecutors(
     auto executor_type = options_.config.experimental().executor_type();
     TF_RETURN_IF_ERROR(
         NewExecutor(executor_type, params, *partition_graph, &item->executor));
-    if (!options_.config.experimental().disable_output_partition_graphs() ||
-        options_.config.graph_options().build_cost_model() > 0) {
+    if (keep_partition_graph) {
       item->graph = std::move(partition_graph);
     }
   }
@@ -1614,6 +1653,8 @@ Status DirectSession::CreateGraphs(
   };
   popts.flib_def = &client_graph->graph.flib_def();
   popts.control_flow_added = false;
+  // Each step runs against a fresh IntraProcessRendezvous.
+  popts.assign_rendezvous_slots = true;
 
   std::unordered_map<string, GraphDef> partitions;
   TF_RETURN_IF_ERROR(Partition(popts, &client_graph->graph, &partitions));
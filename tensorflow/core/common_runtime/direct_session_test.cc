@@ -226,6 +226,128 @@ TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_OptimizeForStaticGraph) {
       absl::StrContains(s.error_message(), "optimize_for_static_graph"));
 }
 
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_StepArenaAllocator) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_use_step_arena_allocator(true);
+  auto session = absl::WrapUnique(NewSession(options));
+
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // The Neg output is consumed only by the Identity, so it comes from the
+  // step arena. The Identity forwards that buffer to the fetch, which must
+  // keep it alive after the step's arena reference is dropped.
+  std::vector<Tensor> first_outputs;
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {z_ + ":0", y_ + ":0"}, {}, &outputs));
+    ASSERT_EQ(2, outputs.size());
+    EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+    EXPECT_FLOAT_EQ(5.0, outputs[1].matrix<float>()(0, 0));
+    if (i == 0) first_outputs = outputs;
+  }
+  // Outputs of an earlier step stay valid after later steps have run.
+  EXPECT_FLOAT_EQ(-5.0, first_outputs[0].matrix<float>()(0, 0));
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_StaticMemoryPlan) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_use_static_memory_plan(true);
+  auto session = absl::WrapUnique(NewSession(options));
+
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // The first step records allocation sizes; later steps use the plan.
+  std::vector<std::vector<Tensor>> all_outputs;
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({}, {z_ + ":0"}, {}, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+    all_outputs.push_back(outputs);
+  }
+  for (const auto& outputs : all_outputs) {
+    EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+  }
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_SchedulingStats) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_scheduling_stats_sample_rate(0.5);
+  auto session = absl::WrapUnique(NewSession(options));
+
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // Every other step is recorded, starting with the first one.
+  for (int i = 0; i < 4; ++i) {
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(session->Run(RunOptions(), {}, {z_ + ":0"}, {}, &outputs,
+                              &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+    if (i % 2 == 1) {
+      EXPECT_EQ(0, run_metadata.scheduling_stats_size());
+      continue;
+    }
+    bool found_matmul = false;
+    for (const OpSchedulingStats& stats : run_metadata.scheduling_stats()) {
+      EXPECT_EQ(stats.num_inline() + stats.num_dispatched(),
+                stats.ready_to_start_usecs().num());
+      EXPECT_GT(stats.thread_ids_size(), 0);
+      if (stats.op() == "MatMul") {
+        found_matmul = true;
+        EXPECT_EQ(1, stats.ready_to_start_usecs().num());
+      }
+    }
+    EXPECT_TRUE(found_matmul);
+  }
+  TF_ASSERT_OK(session->Close());
+}
+
+TEST_F(DirectSessionMinusAXTest, RunSimpleNetwork_AdaptiveDispatch) {
+  Initialize({3, 2, -1, 0});
+  SessionOptions options(DefaultSessionOptions());
+  options.config.mutable_experimental()->set_use_adaptive_dispatch(true);
+  options.config.mutable_graph_options()->set_build_cost_model(1);
+  auto session = absl::WrapUnique(NewSession(options));
+
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  // The measured costs are published after the first step.
+  RunMetadata run_metadata;
+  for (int i = 0; i < 3; ++i) {
+    std::vector<Tensor> outputs;
+    run_metadata.Clear();
+    TF_ASSERT_OK(session->Run(RunOptions(), {}, {z_ + ":0"}, {}, &outputs,
+                              &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    EXPECT_FLOAT_EQ(-5.0, outputs[0].matrix<float>()(0, 0));
+  }
+
+  bool found_matmul = false;
+  for (const CostGraphDef::Node& node : run_metadata.cost_graph().node()) {
+    if (node.name() == y_) {
+      found_matmul = true;
+      EXPECT_GT(node.executor_cost_cycles(), 0);
+    } else if (node.name() == x_) {
+      // Constants declare themselves inexpensive and are not measured.
+      EXPECT_EQ(0, node.executor_cost_cycles());
+      EXPECT_TRUE(node.executor_run_inline());
+    }
+  }
+  EXPECT_TRUE(found_matmul);
+  TF_ASSERT_OK(session->Close());
+}
+
 TEST_F(DirectSessionMinusAXTest,
        RunSimpleNetwork_DisableOutputPartitionGraphs) {
   Initialize({3, 2, -1, 0});
@@ -28,6 +28,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
+#include "tensorflow/core/common_runtime/scheduling_stats_collector.h"
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -58,6 +61,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
@@ -148,6 +152,12 @@ struct KernelTimer {
   }
 };
 
+// With adaptive dispatch, the estimated cost of the inexpensive nodes that a
+// thread runs inline after completing a node, and the estimated cost of each
+// batch of inexpensive nodes dispatched to another thread.
+static const uint64 kInlineBatchCycles =
+    4 * OpKernel::kOpIsExpensiveThresholdCycles;
+
 // Compact structure representing a graph node and its associated kernel.
 //
 // Each NodeItem is an element of exactly one GraphView.
@@ -173,10 +183,37 @@ struct NodeItem {
   bool is_initialization_op : 1;  // True iff IsInitializationOp(node)
   bool is_recv_or_switch : 1;     // True iff IsRecv(node) || IsSwitch(node)
   bool is_next_iteration : 1;     // True iff IsNextIteration(node)
+  bool uses_step_arena : 1;       // True iff CanUseStepArena(node) and the
+                                  // executor has a per-step arena or a
+                                  // static memory plan.
+  bool measure_cost : 1;          // True iff the executor uses adaptive
+                                  // dispatch and the kernel does not declare
+                                  // itself inexpensive.
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
 
+  // If measure_cost is true, a decaying average of the cycles the kernel
+  // takes to compute, as measured by KernelTimer.
+  mutable std::atomic<uint64> cost_estimate_cycles{
+      OpKernel::kInitialCostEstimateCycles};
+
+  // Adds a sample to cost_estimate_cycles. As in OpKernel, concurrent updates
+  // may be lost. Unlike there, the first sample replaces the initial
+  // estimate, so that a node that turns out to be inexpensive is run inline
+  // from its second execution on.
+  void UpdateCostEstimate(uint64 elapsed_cycles) const {
+    const uint64 old_estimate =
+        cost_estimate_cycles.load(std::memory_order_relaxed);
+    const uint64 new_estimate =
+        (old_estimate == OpKernel::kInitialCostEstimateCycles)
+            ? elapsed_cycles
+            : (OpKernel::kCostDecay - 1) * old_estimate /
+                      OpKernel::kCostDecay +
+                  elapsed_cycles / OpKernel::kCostDecay;
+    cost_estimate_cycles.store(new_estimate, std::memory_order_relaxed);
+  }
+
   // Cached values of node->num_inputs() and node->num_outputs(), to
   // avoid levels of indirection.
   int num_inputs;
@@ -314,7 +351,20 @@ class GraphView {
 
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : params_(p), gview_() {
+  // If "num_workers" is positive, each step runs its expensive ready nodes
+  // on at most "num_workers" concurrent workers with per-worker work-stealing
+  // ready queues, rather than dispatching one closure per node to the runner.
+  //
+  // If "use_static_plan" is true and the graph has neither control flow nor
+  // asynchronous kernels, the execution order is computed once in
+  // Initialize() and every step runs it level by level, without per-node
+  // pending counts.
+  explicit ExecutorImpl(const LocalExecutorParams& p, int num_workers = 0,
+                        bool use_static_plan = false)
+      : params_(p),
+        gview_(),
+        num_workers_(num_workers),
+        use_static_plan_(use_static_plan) {
     CHECK(p.create_kernel != nullptr);
     CHECK(p.delete_kernel != nullptr);
   }
@@ -329,6 +379,15 @@ class ExecutorImpl : public Executor {
     for (auto fiter : frame_info_) {
       delete fiter.second;
     }
+    if (memory_planner_ != nullptr) {
+      memory_planner_->Unref();
+    }
+    if (step_arena_block_pool_ != nullptr) {
+      step_arena_block_pool_->Unref();
+    }
+    if (dispatch_cost_graph_ != nullptr) {
+      params_.cost_model_manager->RemoveDispatchCosts(dispatch_cost_graph_);
+    }
   }
 
   Status Initialize(const Graph& graph);
@@ -343,6 +402,21 @@ class ExecutorImpl : public Executor {
  private:
   friend class ExecutorState;
 
+  // With adaptive dispatch, the measured costs are recorded in
+  // params_.cost_model_manager every kPublishDispatchCostsEvery steps.
+  static const int64 kPublishDispatchCostsEvery = 100;
+
+  // Returns true if "item" should get a closure of its own rather than run
+  // inline on the thread that made it ready.
+  bool IsExpensive(const NodeItem& item) const {
+    if (!params_.adaptive_dispatch) return item.kernel->IsExpensive();
+    return item.measure_cost &&
+           item.cost_estimate_cycles.load(std::memory_order_relaxed) >
+               OpKernel::kOpIsExpensiveThresholdCycles;
+  }
+
+  void PublishDispatchCosts();
+
   struct ControlFlowInfo {
     gtl::FlatSet<string> unique_frame_names;
     std::vector<string> frame_names;
@@ -378,9 +452,27 @@ class ExecutorImpl : public Executor {
     }
   };
 
+  // A precomputed schedule for a graph without control flow. Every node is
+  // assigned to the level one past its deepest predecessor, so the nodes of
+  // a level only depend on nodes of earlier levels.
+  struct StaticPlan {
+    // All nodes except the sink, ordered by level.
+    std::vector<const NodeItem*> nodes;
+
+    // Level l consists of nodes[level_start[l] .. level_start[l + 1]).
+    std::vector<int> level_start;
+
+    // The ids of the control predecessors of the node with id i are
+    // control_inputs[control_input_start[i] .. control_input_start[i + 1]).
+    std::vector<int> control_input_start;
+    std::vector<int> control_inputs;
+  };
+
   static Status BuildControlFlowInfo(const Graph* graph,
                                      ControlFlowInfo* cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
+  Status BuildStaticPlan(const Graph& graph);
+  void InitializeMemoryPlanner(const Graph& graph);
 
   FrameInfo* EnsureFrameInfo(const string& fname) {
     auto slot = &frame_info_[fname];
@@ -397,6 +489,31 @@ class ExecutorImpl : public Executor {
   // A cached value of params_
   bool device_record_tensor_accesses_ = false;
 
+  // True if at least one node may allocate from the per-step arena.
+  bool any_node_uses_step_arena_ = false;
+
+  // Owned. Set if params_.use_static_memory_plan is true and the graph has no
+  // control flow, i.e. each node runs at most once per step.
+  StaticMemoryPlanner* memory_planner_ = nullptr;
+
+  // Owned. The blocks that the step arenas reuse across steps, if
+  // params_.use_step_arena is true and memory_planner_ is not set.
+  StepArenaBlockPool* step_arena_block_pool_ = nullptr;
+
+  // The graph under which the measured node costs are recorded in
+  // params_.cost_model_manager, or nullptr if they are not recorded.
+  const Graph* dispatch_cost_graph_ = nullptr;
+  std::atomic<int64> num_steps_{0};
+
+  // The maximum number of work-stealing workers per step, or 0 if the
+  // work-stealing mode is disabled.
+  const int num_workers_;
+
+  // True if a static plan was requested, and the plan if the graph admits
+  // one (i.e., it has no control flow).
+  const bool use_static_plan_;
+  std::unique_ptr<StaticPlan> static_plan_;
+
   // Root nodes (with no in edges) that should form the initial ready queue
   std::vector<const NodeItem*> root_nodes_;
 
@@ -620,6 +737,31 @@ void GetMaxPendingCounts(const Node* n, size_t* max_pending,
   *max_dead_count = num_in_edges;
 }
 
+// Returns true if every tensor that "n" produces is consumed within the step,
+// so that its buffers may be carved out of the per-step arena. Stateful nodes
+// and nodes feeding stateful nodes, function return values, or Sends may hand
+// their outputs to something that outlives the step. This is a conservative
+// one-hop check; the arena is reference counted, so a buffer that escapes
+// through a chain of forwarding ops is retained rather than freed under it.
+static bool CanUseStepArena(const Node* n) {
+  if (!n->IsOp() || n->op_def().is_stateful() || n->IsRetval() ||
+      n->IsSend() || IsTransferNode(n)) {
+    return false;
+  }
+  for (int i = 0; i < n->num_outputs(); ++i) {
+    if (IsRefType(n->output_type(i))) return false;
+  }
+  for (const Edge* e : n->out_edges()) {
+    if (e->IsControlEdge()) continue;
+    const Node* dst = e->dst();
+    if (!dst->IsOp() || dst->op_def().is_stateful() || dst->IsRetval() ||
+        dst->IsSend() || IsTransferNode(dst)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Status ExecutorImpl::Initialize(const Graph& graph) {
   gview_.Initialize(&graph);
 
@@ -678,6 +820,14 @@ Status ExecutorImpl::Initialize(const Graph& graph) {
     item->is_initialization_op = IsInitializationOp(n);
     item->is_recv_or_switch = IsRecv(n) || IsSwitch(n);
     item->is_next_iteration = IsNextIteration(n);
+    item->uses_step_arena =
+        (params_.use_step_arena || params_.use_static_memory_plan) &&
+        CanUseStepArena(n);
+    // Kernels that declare themselves inexpensive, or that an executor
+    // sharing them has already found to be, are not measured.
+    item->measure_cost =
+        params_.adaptive_dispatch && item->kernel->IsExpensive();
+    any_node_uses_step_arena_ |= item->uses_step_arena;
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
@@ -706,9 +856,153 @@ Status ExecutorImpl::Initialize(const Graph& graph) {
   // all nodes.
   InitializePending(&graph, cf_info);
 
+  if (params_.adaptive_dispatch && params_.cost_model_manager != nullptr) {
+    dispatch_cost_graph_ = &graph;
+  }
+
+  bool has_control_flow = false;
+  for (const Node* n : graph.nodes()) {
+    if (n->IsControlFlow()) {
+      has_control_flow = true;
+      break;
+    }
+  }
+  if (params_.use_static_memory_plan && any_node_uses_step_arena_) {
+    if (has_control_flow) {
+      VLOG(1) << "Graph has control flow; the executor on "
+              << params_.device->name() << " does not plan its memory";
+    } else {
+      InitializeMemoryPlanner(graph);
+    }
+  }
+  if (params_.use_step_arena && any_node_uses_step_arena_ &&
+      memory_planner_ == nullptr) {
+    step_arena_block_pool_ = new StepArenaBlockPool;
+  }
+
+  if (use_static_plan_) {
+    // A level cannot complete before all of its kernels are done, so an
+    // asynchronous kernel that waits on another executor (e.g. a _Recv whose
+    // peer needs a node of a later level to run first) would deadlock the
+    // plan. Such graphs are scheduled dynamically.
+    const Node* async_node = nullptr;
+    for (const Node* n : graph.nodes()) {
+      if (gview_.node(n->id())->kernel_is_async) {
+        async_node = n;
+        break;
+      }
+    }
+    if (has_control_flow) {
+      VLOG(1) << "Graph has control flow; the executor on "
+              << params_.device->name() << " falls back to dynamic scheduling";
+    } else if (async_node != nullptr) {
+      VLOG(1) << "Graph has asynchronous kernel " << async_node->name()
+              << "; the executor on " << params_.device->name()
+              << " falls back to dynamic scheduling";
+    } else {
+      TF_RETURN_IF_ERROR(BuildStaticPlan(graph));
+    }
+  }
+
   return gview_.SetAllocAttrs(&graph, params_.device);
 }
 
+void ExecutorImpl::InitializeMemoryPlanner(const Graph& graph) {
+  // Time steps are topological levels: a node runs one level after its
+  // latest predecessor. This matches the static-plan schedule and only
+  // approximates the dynamic one, which the planner tolerates by falling
+  // back to the device allocator when a planned slice is still occupied.
+  const int num_node_ids = graph.num_node_ids();
+  std::vector<int> level(num_node_ids, 0);
+  std::vector<int> pending(num_node_ids, 0);
+  std::deque<const Node*> ready;
+  for (const Node* n : graph.nodes()) {
+    pending[n->id()] = n->in_edges().size();
+    if (pending[n->id()] == 0) ready.push_back(n);
+  }
+  while (!ready.empty()) {
+    const Node* n = ready.front();
+    ready.pop_front();
+    for (const Edge* e : n->out_edges()) {
+      const int dst_id = e->dst()->id();
+      level[dst_id] = std::max(level[dst_id], level[n->id()] + 1);
+      if (--pending[dst_id] == 0) ready.push_back(e->dst());
+    }
+  }
+
+  std::vector<int> first_use(num_node_ids, -1);
+  std::vector<int> last_use(num_node_ids, -1);
+  for (const Node* n : graph.nodes()) {
+    const int id = n->id();
+    if (!gview_.node(id)->uses_step_arena) continue;
+    // Temporaries are conservatively assumed to live as long as outputs.
+    first_use[id] = last_use[id] = level[id];
+    for (const Edge* e : n->out_edges()) {
+      if (e->IsControlEdge()) continue;
+      last_use[id] = std::max(last_use[id], level[e->dst()->id()]);
+    }
+  }
+  memory_planner_ = new StaticMemoryPlanner(
+      params_.device->GetAllocator(AllocatorAttributes()), std::move(first_use),
+      std::move(last_use));
+}
+
+Status ExecutorImpl::BuildStaticPlan(const Graph& graph) {
+  auto plan = absl::make_unique<StaticPlan>();
+  const int num_node_ids = graph.num_node_ids();
+
+  std::vector<int> pending(num_node_ids, 0);
+  plan->control_input_start.resize(num_node_ids + 1, 0);
+  std::vector<const Node*> curr_level;
+  for (const Node* n : graph.nodes()) {
+    pending[n->id()] = n->in_edges().size();
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) ++plan->control_input_start[n->id() + 1];
+    }
+    if (n->in_edges().empty()) curr_level.push_back(n);
+  }
+  for (int i = 0; i < num_node_ids; ++i) {
+    plan->control_input_start[i + 1] += plan->control_input_start[i];
+  }
+  plan->control_inputs.resize(plan->control_input_start[num_node_ids]);
+  for (const Node* n : graph.nodes()) {
+    int pos = plan->control_input_start[n->id()];
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge()) plan->control_inputs[pos++] = e->src()->id();
+    }
+  }
+
+  // Kahn's algorithm, one level at a time: a node joins the next level when
+  // its last predecessor is visited.
+  int num_visited = 0;
+  std::vector<const Node*> next_level;
+  while (!curr_level.empty()) {
+    plan->level_start.push_back(plan->nodes.size());
+    for (const Node* n : curr_level) {
+      ++num_visited;
+      const NodeItem* item = gview_.node(n->id());
+      // The sink is never run, as in the dynamic executor.
+      if (!item->is_sink) plan->nodes.push_back(item);
+      for (const Edge* e : n->out_edges()) {
+        if (--pending[e->dst()->id()] == 0) next_level.push_back(e->dst());
+      }
+    }
+    curr_level.swap(next_level);
+    next_level.clear();
+  }
+  plan->level_start.push_back(plan->nodes.size());
+
+  if (num_visited != graph.num_nodes()) {
+    return errors::InvalidArgument(
+        "Cannot build a static execution plan: the graph has a cycle (visited ",
+        num_visited, " of ", graph.num_nodes(), " nodes)");
+  }
+  VLOG(1) << "Built static execution plan with " << plan->nodes.size()
+          << " nodes in " << plan->level_start.size() - 1 << " levels";
+  static_plan_ = std::move(plan);
+  return Status::OK();
+}
+
 // If a Node has been marked to use a ScopedAllocator x for output i, then
 // sc_attr will contain the subsequence (i, x) at an even offset.  This function
 // extracts and transfers that ScopedAllocator id to alloc_attr.  For now, we
@@ -1239,11 +1533,15 @@ class ExecutorState {
 
   // A tagged node: <frame*, iter, node*>.
   struct TaggedNode {
-    const NodeItem* node_item;
+    const NodeItem* node_item = nullptr;
     FrameState* input_frame = nullptr;
     int64 input_iter = -1;
     bool is_dead = false;
+    // The time at which the node became ready. Only set if the step collects
+    // scheduling stats.
+    int64 ready_nsec = 0;
 
+    TaggedNode() {}
     TaggedNode(const NodeItem* node_item, FrameState* in_frame, int64 in_iter,
                bool dead)
         : node_item(node_item),
@@ -1287,6 +1585,21 @@ class ExecutorState {
     int front_index_;
   };
 
+  // A ready node together with the time it was scheduled.
+  struct ScheduledNode {
+    TaggedNode tagged_node;
+    int64 scheduled_nsec = 0;
+  };
+
+  // The ready queue of one worker in work-stealing mode. The worker that
+  // owns the queue pushes and pops at the back, so that the successors of a
+  // node tend to run on the thread that produced their inputs. Idle workers
+  // steal from the front.
+  struct WorkerQueue {
+    mutex mu;
+    std::deque<ScheduledNode> nodes GUARDED_BY(mu);
+  };
+
   struct AsyncState;
 
   const bool vlog_;  // true if VLOG_IS_ON(1). Used to check vlog cheaply.
@@ -1306,6 +1619,7 @@ class ExecutorState {
   // Step-local container.
   ScopedStepContainer* step_container_;
   StepStatsCollectorInterface* const stats_collector_;
+  SchedulingStatsCollector* const scheduling_stats_;
   const tracing::EventCollector* const event_collector_;
   Context context_;
 
@@ -1320,6 +1634,22 @@ class ExecutorState {
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
 
+  // Owned. The arena for short-lived host tensors of this step, or nullptr if
+  // no node of the graph uses it. Tensors that outlive the step hold their own
+  // references to it.
+  StepArenaAllocator* step_arena_ = nullptr;
+
+  // Owned. This step's slice of the executor's static memory plan, if any.
+  // Takes precedence over step_arena_.
+  PlannedStepArena* planned_arena_ = nullptr;
+
+  // Returns the allocator for the step-local tensors of "item", or nullptr.
+  Allocator* StepArenaFor(const NodeItem& item) const {
+    if (!item.uses_step_arena) return nullptr;
+    if (planned_arena_ != nullptr) return planned_arena_->ForNode(item.node_id);
+    return step_arena_;
+  }
+
   // Owned.
 
   // A flag that is set on error after the frame state has been
@@ -1349,6 +1679,23 @@ class ExecutorState {
   // name of the new frame from nodedef.
   gtl::FlatMap<string, FrameState*> outstanding_frames_ GUARDED_BY(mu_);
 
+  // Static plan mode. The number of closures of the current level that have
+  // not finished.
+  std::atomic<int> static_level_pending_{0};
+  // node_dead_[id] is true iff node id was dead in this step. Each element is
+  // written once by its node and read by successors in later levels.
+  std::unique_ptr<bool[]> static_node_dead_;
+
+  // Work-stealing mode. One queue per worker slot; empty if the mode is
+  // disabled.
+  std::vector<WorkerQueue> worker_queues_;
+  mutex worker_mu_;
+  // Ready nodes produced outside of a worker, i.e. the root nodes and the
+  // successors of asynchronous kernels.
+  std::deque<ScheduledNode> injected_nodes_ GUARDED_BY(worker_mu_);
+  // Ids of the worker slots that have no running worker.
+  std::vector<int> idle_workers_ GUARDED_BY(worker_mu_);
+
   // The unique name of a frame.
   inline string MakeFrameName(FrameState* frame, int64 iter_id,
                               const string& name) {
@@ -1368,8 +1715,24 @@ class ExecutorState {
   void CleanupFramesIterations(FrameState* frame, int64 iter,
                                TaggedNodeSeq* ready);
 
-  // Process a ready node in current thread.
-  void Process(TaggedNode node, int64 scheduled_nsec);
+  // Fills in the parts of "params" that are the same for every node in this
+  // step. The input vectors must outlive "params".
+  void InitializeParams(OpKernelContext::Params* params, TensorValueVec* inputs,
+                        DeviceContextVec* input_device_contexts,
+                        AllocatorAttributeVec* input_alloc_attrs);
+
+  // Process a ready node in current thread. "worker_id" is the id of the
+  // work-stealing worker running on the current thread, or -1.
+  void Process(TaggedNode node, int64 scheduled_nsec, int worker_id) {
+    Process(&node, 1, scheduled_nsec, worker_id);
+  }
+
+  // Process a batch of "num_nodes" ready nodes in current thread.
+  void Process(const TaggedNode* nodes, int num_nodes, int64 scheduled_nsec,
+               int worker_id);
+
+  // Runs the synchronous kernel of "item" on "ctx", with tracing if enabled.
+  void ComputeSync(const NodeItem& item, OpKernelContext* ctx);
 
   // Before invoking item->kernel, fills in its "inputs".
   Status PrepareInputs(const NodeItem& item, Entry* first_input,
@@ -1392,12 +1755,63 @@ class ExecutorState {
   // if execution has completed.
   bool NodeDone(const Status& s, const TaggedNodeSeq& ready,
                 NodeExecStatsInterface* stats,
-                TaggedNodeReadyQueue* inline_ready);
+                TaggedNodeReadyQueue* inline_ready, int worker_id);
+
+  // Records the stats of a finished node, taking ownership of "stats". If
+  // "s" is the first error of the step, aborts the step.
+  void FinalizeNode(const Status& s, NodeExecStatsInterface* stats);
+
+  // Static plan mode: runs the levels of impl_->static_plan_ starting at
+  // "level", until a level is still waiting on other threads or the step
+  // is done.
+  void RunStaticLevels(int level);
+
+  // Static plan mode: runs "items", which all belong to the same level, on
+  // the current thread. "inlined" is true if this is the thread that started
+  // the level.
+  void ProcessStatic(const NodeItem* const* items, int num_items,
+                     int64 scheduled_nsec, bool inlined);
+
+  // Static plan mode: propagates the outputs of "item" to the inputs of its
+  // successors. Contents of *outputs are left in an indeterminate state.
+  void PropagateStaticOutputs(const NodeItem& item, EntryVector* outputs);
+
+  // Static plan mode: called when a closure of the current level finishes.
+  // Returns true if the level is now complete.
+  bool StaticWorkDone() {
+    return static_level_pending_.fetch_sub(1) == 1;
+  }
 
   // Schedule all the expensive nodes in 'ready', and put all the inexpensive
-  // nodes in 'ready' into 'inline_ready'.
+  // nodes in 'ready' into 'inline_ready'. In work-stealing mode, expensive
+  // nodes are pushed onto the queue of worker 'worker_id' instead of being
+  // dispatched to the runner.
   void ScheduleReady(const TaggedNodeSeq& ready,
-                     TaggedNodeReadyQueue* inline_ready);
+                     TaggedNodeReadyQueue* inline_ready, int worker_id);
+
+  // Work-stealing mode: adds 'ready' to the injection queue and starts idle
+  // workers to run them.
+  void InjectReady(const TaggedNodeSeq& ready, int64 scheduled_nsec);
+
+  // Work-stealing mode: claims up to 'max_workers' idle worker slots and
+  // appends their ids to '*worker_ids'. Each claimed worker holds a reference
+  // in num_outstanding_ops_, so the step cannot finish while it runs.
+  void ClaimIdleWorkersLocked(int max_workers,
+                              gtl::InlinedVector<int, 8>* worker_ids)
+      EXCLUSIVE_LOCKS_REQUIRED(worker_mu_);
+
+  // Work-stealing mode: starts the workers claimed by
+  // ClaimIdleWorkersLocked() on the runner.
+  void StartWorkers(const gtl::InlinedVector<int, 8>& worker_ids);
+
+  // Work-stealing mode: the body of worker 'worker_id'. Runs nodes from its
+  // own queue, steals from the other workers and drains the injection queue
+  // until there is no ready node left.
+  void RunWorker(int worker_id);
+
+  // Work-stealing mode: pops the next node for worker 'worker_id'. Returns
+  // false, and marks the worker idle, if no ready node is left.
+  bool NextNodeForWorker(int worker_id, ScheduledNode* node);
 
   // For debugging/logging only.
   inline void MaybeMarkCompleted(FrameState* frame, int64 iter,
@@ -1443,6 +1857,7 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       tensor_store_(args.tensor_store),
       step_container_(args.step_container),
       stats_collector_(args.stats_collector),
+      scheduling_stats_(args.scheduling_stats),
       event_collector_(
           tracing::GetEventCollector(tracing::EventCategory::kCompute)),
       context_(ContextKind::kThread),
@@ -1452,7 +1867,8 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
       cancellation_manager_(args.cancellation_manager),
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
-      num_outstanding_ops_(0) {
+      num_outstanding_ops_(0),
+      worker_queues_(impl->num_workers_) {
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = impl_->params_.device;
     user_device_ = RenamedDevice::NewRenamedDevice(
@@ -1472,6 +1888,22 @@ ExecutorState::ExecutorState(const Executor::Args& args, ExecutorImpl* impl)
                             root_frame_->total_input_tensors));
 
   outstanding_frames_.insert({root_frame_->frame_name, root_frame_});
+
+  if (impl_->memory_planner_ != nullptr) {
+    planned_arena_ = impl_->memory_planner_->NewStep();
+  } else if (impl_->params_.use_step_arena &&
+             impl_->any_node_uses_step_arena_) {
+    step_arena_ = new StepArenaAllocator(
+        impl_->params_.device->GetAllocator(AllocatorAttributes()),
+        impl_->step_arena_block_pool_);
+  }
+
+  if (!worker_queues_.empty()) {
+    mutex_lock l(worker_mu_);
+    for (int i = static_cast<int>(worker_queues_.size()) - 1; i >= 0; --i) {
+      idle_workers_.push_back(i);
+    }
+  }
 }
 
 ExecutorState::~ExecutorState() {
@@ -1482,6 +1914,14 @@ ExecutorState::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (step_arena_ != nullptr) {
+    step_arena_->FinishStep();
+    step_arena_->Unref();
+  }
+  if (planned_arena_ != nullptr) {
+    planned_arena_->FinishStep();
+    planned_arena_->Unref();
+  }
 }
 
 Status ExecutorImpl::BuildControlFlowInfo(const Graph* g,
@@ -1579,6 +2019,13 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     return;
   }
 
+  if (impl_->static_plan_ != nullptr) {
+    done_cb_ = std::move(done);
+    static_node_dead_.reset(new bool[impl_->gview_.num_nodes()]());
+    RunStaticLevels(0);
+    return;
+  }
+
   // Initialize the ready queue.
   for (const NodeItem* item : impl_->root_nodes_) {
     DCHECK_EQ(item->num_inputs, 0);
@@ -1595,7 +2042,7 @@ void ExecutorState::RunAsync(Executor::DoneCallback done) {
     }
     done_cb_ = std::move(done);
     // Schedule to run all the ready ops in thread pool.
-    ScheduleReady(ready, nullptr);
+    ScheduleReady(ready, nullptr, -1);
   }
 }
 
@@ -1666,59 +2113,43 @@ bool MightTrace(const NodeItem& item,
       profiler::GetTFTraceMeLevel(item.kernel->IsExpensive()));
 }
 
-void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
-  profiler::TraceMe activity(
-      [&] {
-        int64 id = step_id_;
-        if (step_container_ && step_container_->step_id()) {
-          id = step_container_->step_id();
-        }
-        return absl::StrCat("ExecutorState::Process#id=", id, "#");
-      },
-      2);
-  WithContext wc(context_);
-  TaggedNodeSeq ready;
-  TaggedNodeReadyQueue inline_ready;
-
-  // Parameters passed to OpKernel::Compute.
-  TensorValueVec inputs;
-  DeviceContextVec input_device_contexts;
-  AllocatorAttributeVec input_alloc_attrs;
-
-  OpKernelContext::Params params;
-  params.step_id = step_id_;
+void ExecutorState::InitializeParams(
+    OpKernelContext::Params* params, TensorValueVec* inputs,
+    DeviceContextVec* input_device_contexts,
+    AllocatorAttributeVec* input_alloc_attrs) {
+  params->step_id = step_id_;
   // Override device's threadpool if user provides an intra_op_threadpool
   Device* device = impl_->params_.device;
   if (user_device_) {
-    params.device = user_device_.get();
+    params->device = user_device_.get();
   } else {
-    params.device = device;
-  }
-  params.log_memory = log_memory_;
-  params.record_tensor_accesses = impl_->device_record_tensor_accesses_;
-  params.rendezvous = rendezvous_;
-  params.create_rendezvous = create_rendezvous_;
-  params.collective_executor = collective_executor_;
-  params.session_state = session_state_;
-  params.session_handle = session_handle_;
-  params.session_metadata = session_metadata_;
-  params.tensor_store = tensor_store_;
-  params.cancellation_manager = cancellation_manager_;
-  params.call_frame = call_frame_;
-  params.function_library = impl_->params_.function_library;
-  params.resource_manager = device->resource_manager();
-  params.step_container = step_container_;
-  params.slice_reader_cache = slice_reader_cache_;
-  params.inputs = &inputs;
-  params.input_device_contexts = &input_device_contexts;
-  params.input_alloc_attrs = &input_alloc_attrs;
-  params.runner = &runner_;
-  params.stats_collector = stats_collector_;
-  params.inc_num_deferred_ops_function = [this]() {
+    params->device = device;
+  }
+  params->log_memory = log_memory_;
+  params->record_tensor_accesses = impl_->device_record_tensor_accesses_;
+  params->rendezvous = rendezvous_;
+  params->create_rendezvous = create_rendezvous_;
+  params->collective_executor = collective_executor_;
+  params->session_state = session_state_;
+  params->session_handle = session_handle_;
+  params->session_metadata = session_metadata_;
+  params->tensor_store = tensor_store_;
+  params->cancellation_manager = cancellation_manager_;
+  params->call_frame = call_frame_;
+  params->function_library = impl_->params_.function_library;
+  params->resource_manager = device->resource_manager();
+  params->step_container = step_container_;
+  params->slice_reader_cache = slice_reader_cache_;
+  params->inputs = inputs;
+  params->input_device_contexts = input_device_contexts;
+  params->input_alloc_attrs = input_alloc_attrs;
+  params->runner = &runner_;
+  params->stats_collector = stats_collector_;
+  params->inc_num_deferred_ops_function = [this]() {
     mutex_lock lock(num_deferred_ops_mu_);
     num_deferred_ops_++;
   };
-  params.dec_num_deferred_ops_function = [this]() {
+  params->dec_num_deferred_ops_function = [this]() {
     bool finish_when_deferred_ops_done = false;
     {
       mutex_lock lock(num_deferred_ops_mu_);
@@ -1734,14 +2165,50 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
   };
 
   // Set the device_context for this device, if it exists.
-  params.op_device_context = device_context_;
+  params->op_device_context = device_context_;
+}
+
+void ExecutorState::Process(const TaggedNode* nodes, int num_nodes,
+                            int64 scheduled_nsec, int worker_id) {
+  profiler::TraceMe activity(
+      [&] {
+        int64 id = step_id_;
+        if (step_container_ && step_container_->step_id()) {
+          id = step_container_->step_id();
+        }
+        return absl::StrCat("ExecutorState::Process#id=", id, "#");
+      },
+      2);
+  WithContext wc(context_);
+  TaggedNodeSeq ready;
+  TaggedNodeReadyQueue inline_ready;
+
+  // Parameters passed to OpKernel::Compute.
+  TensorValueVec inputs;
+  DeviceContextVec input_device_contexts;
+  AllocatorAttributeVec input_alloc_attrs;
+
+  OpKernelContext::Params params;
+  InitializeParams(&params, &inputs, &input_device_contexts,
+                   &input_alloc_attrs);
+  Device* device = impl_->params_.device;
 
   Status s;
   NodeExecStatsInterface* stats = nullptr;
 
   EntryVector outputs;
   bool completed = false;
-  inline_ready.push_back(tagged_node);
+  // The first "num_nodes" nodes were dispatched to this thread; the others
+  // are run inline.
+  int num_dispatched = num_nodes;
+  const int32 thread_id =
+      scheduling_stats_ ? Env::Default()->GetCurrentThreadId() : 0;
+  TaggedNode tagged_node;
+  for (int i = 0; i < num_nodes; ++i) {
+    tagged_node = nodes[i];
+    tagged_node.ready_nsec = scheduled_nsec;
+    inline_ready.push_back(tagged_node);
+  }
   while (!inline_ready.empty()) {
     tagged_node = inline_ready.front();
     inline_ready.pop_front();
@@ -1767,6 +2234,13 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
       nodestats::SetScheduled(stats, scheduled_nsec);
       nodestats::SetAllStart(stats);
     }
+    if (scheduling_stats_) {
+      scheduling_stats_->RecordNode(
+          item.kernel->type_string(),
+          nodestats::NowInNsec() - tagged_node.ready_nsec,
+          /*inlined=*/num_dispatched <= 0, thread_id);
+    }
+    --num_dispatched;
 
     if (vlog_) {
       VLOG(1) << "Process node: " << id << " step " << params.step_id << " "
@@ -1800,13 +2274,14 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
         }
         MaybeMarkCompleted(input_frame, input_iter, item);
         // Continue to process the nodes in 'inline_ready'.
-        completed = NodeDone(s, ready, stats, &inline_ready);
+        completed = NodeDone(s, ready, stats, &inline_ready, worker_id);
         continue;
       }
 
       // Set up compute params.
       OpKernel* op_kernel = item.kernel;
       params.op_kernel = op_kernel;
+      params.step_arena_allocator = StepArenaFor(item);
       params.frame_iter = FrameAndIter(input_frame->frame_id, input_iter);
       params.is_input_dead = is_input_dead;
       params.output_attr_array = item.output_attrs();
@@ -1859,7 +2334,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
             device->ConsumeListOfAccessedTensors(state->ctx.op_device_context(),
                                                  accessed);
           }
-          const bool completed = NodeDone(s, ready, stats, nullptr);
+          const bool completed = NodeDone(s, ready, stats, nullptr, -1);
           delete state;
           if (completed) ScheduleFinish();
         };
@@ -1882,36 +2357,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
         // Synchronous computes.
         OpKernelContext ctx(&params, item.num_outputs);
         nodestats::SetOpStart(stats);
-
-        if (TF_PREDICT_FALSE(MightTrace(item, event_collector_))) {
-          const string& op_name = op_kernel->name();
-          int64 id = step_id_;
-          if (step_container_ && step_container_->step_id()) {
-            id = step_container_->step_id();
-          }
-          const string kernel_label = strings::StrCat(
-              op_name, ":", op_kernel->type_string(), "#id=", id,
-              ",device=", device->name(), ",async=false#");
-          tracing::ScopedRegion region(tracing::EventCategory::kCompute,
-                                       op_name);
-          // 'TraceMe' will trace the OpKernel scheduling time.
-          profiler::TraceMe activity(
-              absl::string_view(kernel_label),
-              profiler::GetTFTraceMeLevel(op_kernel->IsExpensive()));
-          // 'ScopedAnnotation' will trace the OpKernel execution time.
-          tracing::ScopedAnnotation annotation(kernel_label);
-          device->Compute(op_kernel, &ctx);
-        } else {
-          // In the common case, avoid creating any tracing objects.
-          if (op_kernel->IsExpensive()) {
-            KernelTimer timer;
-            device->Compute(op_kernel, &ctx);
-            op_kernel->UpdateCostEstimate(timer.ElapsedCycles());
-          } else {
-            device->Compute(op_kernel, &ctx);
-          }
-        }
-
+        ComputeSync(item, &ctx);
         nodestats::SetOpEnd(stats);
         s = ProcessOutputs(item, &ctx, &outputs, stats);
         if (s.ok() && impl_->device_record_tensor_accesses_) {
@@ -1951,7 +2397,7 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
         scheduled_nsec = nodestats::NowInNsec();
       }
       // Postprocess.
-      completed = NodeDone(s, ready, stats, &inline_ready);
+      completed = NodeDone(s, ready, stats, &inline_ready, worker_id);
     }
   }  // while !inline_ready.empty()
 
@@ -1959,6 +2405,42 @@ void ExecutorState::Process(TaggedNode tagged_node, int64 scheduled_nsec) {
   if (completed) ScheduleFinish();
 }
 
+void ExecutorState::ComputeSync(const NodeItem& item, OpKernelContext* ctx) {
+  Device* device = impl_->params_.device;
+  OpKernel* op_kernel = item.kernel;
+  if (TF_PREDICT_FALSE(MightTrace(item, event_collector_))) {
+    const string& op_name = op_kernel->name();
+    int64 id = step_id_;
+    if (step_container_ && step_container_->step_id()) {
+      id = step_container_->step_id();
+    }
+    const string kernel_label =
+        strings::StrCat(op_name, ":", op_kernel->type_string(), "#id=", id,
+                        ",device=", device->name(), ",async=false#");
+    tracing::ScopedRegion region(tracing::EventCategory::kCompute, op_name);
+    // 'TraceMe' will trace the OpKernel scheduling time.
+    profiler::TraceMe activity(
+        absl::string_view(kernel_label),
+        profiler::GetTFTraceMeLevel(op_kernel->IsExpensive()));
+    // 'ScopedAnnotation' will trace the OpKernel execution time.
+    tracing::ScopedAnnotation annotation(kernel_label);
+    device->Compute(op_kernel, ctx);
+  } else {
+    // In the common case, avoid creating any tracing objects.
+    if (item.measure_cost) {
+      KernelTimer timer;
+      device->Compute(op_kernel, ctx);
+      item.UpdateCostEstimate(timer.ElapsedCycles());
+    } else if (op_kernel->IsExpensive()) {
+      KernelTimer timer;
+      device->Compute(op_kernel, ctx);
+      op_kernel->UpdateCostEstimate(timer.ElapsedCycles());
+    } else {
+      device->Compute(op_kernel, ctx);
+    }
+  }
+}
+
 Status ExecutorState::PrepareInputs(const NodeItem& item, Entry* first_input,
                                     TensorValueVec* inputs,
                                     DeviceContextVec* input_device_contexts,
@@ -2264,7 +2746,27 @@ void ExecutorState::PropagateOutputs(const TaggedNode& tagged_node,
 
 bool ExecutorState::NodeDone(const Status& s, const TaggedNodeSeq& ready,
                              NodeExecStatsInterface* stats,
-                             TaggedNodeReadyQueue* inline_ready) {
+                             TaggedNodeReadyQueue* inline_ready,
+                             int worker_id) {
+  FinalizeNode(s, stats);
+
+  bool completed = false;
+  const size_t ready_size = ready.size();
+  if (ready_size == 0 || !s.ok()) {
+    completed = (num_outstanding_ops_.fetch_sub(1) == 1);
+  } else if (ready_size > 1) {
+    num_outstanding_ops_.fetch_add(ready_size - 1, std::memory_order_relaxed);
+  }
+
+  // Schedule the ready nodes in 'ready'.
+  if (s.ok()) {
+    ScheduleReady(ready, inline_ready, worker_id);
+  }
+  return completed;
+}
+
+void ExecutorState::FinalizeNode(const Status& s,
+                                 NodeExecStatsInterface* stats) {
   nodestats::SetAllEnd(stats);
   if (stats) {
     if (stats_collector_) {
@@ -2312,63 +2814,374 @@ bool ExecutorState::NodeDone(const Status& s, const TaggedNodeSeq& ready,
       cancellation_manager_->StartCancel();
     }
   }
-
-  bool completed = false;
-  const size_t ready_size = ready.size();
-  if (ready_size == 0 || !s.ok()) {
-    completed = (num_outstanding_ops_.fetch_sub(1) == 1);
-  } else if (ready_size > 1) {
-    num_outstanding_ops_.fetch_add(ready_size - 1, std::memory_order_relaxed);
-  }
-
-  // Schedule the ready nodes in 'ready'.
-  if (s.ok()) {
-    ScheduleReady(ready, inline_ready);
-  }
-  return completed;
 }
 
 void ExecutorState::ScheduleReady(const TaggedNodeSeq& ready,
-                                  TaggedNodeReadyQueue* inline_ready) {
+                                  TaggedNodeReadyQueue* inline_ready,
+                                  int worker_id) {
   if (ready.empty()) return;
 
   int64 scheduled_nsec = 0;
-  if (stats_collector_) {
+  if (stats_collector_ || scheduling_stats_) {
     scheduled_nsec = nodestats::NowInNsec();
   }
 
   if (inline_ready == nullptr) {
+    if (!worker_queues_.empty()) {
+      InjectReady(ready, scheduled_nsec);
+      return;
+    }
     // Schedule to run all the ready ops in thread pool.
     for (auto& tagged_node : ready) {
-      runner_([=]() { Process(tagged_node, scheduled_nsec); });
+      runner_([=]() { Process(tagged_node, scheduled_nsec, -1); });
     }
     return;
   }
 
+  // In work-stealing mode, expensive nodes that this thread will not run
+  // inline go to the back of its own queue, where idle workers can steal
+  // them.
+  WorkerQueue* worker_queue =
+      (worker_id >= 0) ? &worker_queues_[worker_id] : nullptr;
+  int num_queued = 0;
+  auto dispatch = [this, worker_queue, scheduled_nsec,
+                   &num_queued](const TaggedNode& tagged_node) {
+    if (worker_queue != nullptr) {
+      mutex_lock l(worker_queue->mu);
+      worker_queue->nodes.push_back({tagged_node, scheduled_nsec});
+      ++num_queued;
+    } else {
+      runner_([this, tagged_node, scheduled_nsec]() {
+        Process(tagged_node, scheduled_nsec, -1);
+      });
+    }
+  };
+
+  auto run_inline = [inline_ready, scheduled_nsec](TaggedNode tagged_node) {
+    tagged_node.ready_nsec = scheduled_nsec;
+    inline_ready->push_back(tagged_node);
+  };
+
+  // With adaptive dispatch, this thread runs inexpensive nodes only until
+  // their estimated costs add up to kInlineBatchCycles. The others are
+  // dispatched in batches of about that cost, so that a wide fan-out of
+  // small nodes neither serializes on one thread nor pays for one closure
+  // per node. In work-stealing mode the worker queues already amortize the
+  // closures, so they are queued one by one.
+  const bool batch_inexpensive = impl_->params_.adaptive_dispatch;
+  uint64 inline_cycles = 0;
+  uint64 batch_cycles = 0;
+  TaggedNodeSeq batch;
+  auto dispatch_batch = [this, scheduled_nsec, &batch, &batch_cycles]() {
+    if (batch.size() == 1) {
+      const TaggedNode tagged_node = batch[0];
+      runner_([this, tagged_node, scheduled_nsec]() {
+        Process(tagged_node, scheduled_nsec, -1);
+      });
+    } else {
+      runner_([this, batch, scheduled_nsec]() {
+        Process(batch.data(), batch.size(), scheduled_nsec, -1);
+      });
+    }
+    batch.clear();
+    batch_cycles = 0;
+  };
+
   const TaggedNode* curr_expensive_node = nullptr;
   for (auto& tagged_node : ready) {
     const NodeItem& item = *tagged_node.node_item;
-    if (tagged_node.is_dead || !item.kernel->IsExpensive()) {
-      // Inline this inexpensive node.
-      inline_ready->push_back(tagged_node);
+    if (tagged_node.is_dead || !impl_->IsExpensive(item)) {
+      const uint64 cycles =
+          (tagged_node.is_dead || !item.measure_cost)
+              ? 0
+              : item.cost_estimate_cycles.load(std::memory_order_relaxed);
+      if (!batch_inexpensive || inline_cycles < kInlineBatchCycles) {
+        // Inline this inexpensive node.
+        inline_cycles += cycles;
+        run_inline(tagged_node);
+      } else if (worker_queue != nullptr) {
+        dispatch(tagged_node);
+      } else {
+        batch.push_back(tagged_node);
+        batch_cycles += cycles;
+        if (batch_cycles >= kInlineBatchCycles) dispatch_batch();
+      }
     } else {
       if (curr_expensive_node) {
         // Dispatch to another thread since there is plenty of work to
         // do for this thread.
-        runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                          scheduled_nsec));
+        dispatch(*curr_expensive_node);
       }
       curr_expensive_node = &tagged_node;
     }
   }
+  if (!batch.empty()) dispatch_batch();
   if (curr_expensive_node) {
     if (inline_ready->empty()) {
-      inline_ready->push_back(*curr_expensive_node);
+      run_inline(*curr_expensive_node);
     } else {
       // There are inline nodes to run already. We dispatch this expensive
       // node to other thread.
-      runner_(std::bind(&ExecutorState::Process, this, *curr_expensive_node,
-                        scheduled_nsec));
+      dispatch(*curr_expensive_node);
+    }
+  }
+
+  if (num_queued > 0) {
+    // Wake up idle workers to steal the newly queued nodes. A fan-out
+    // therefore never occupies more than num_workers_ runner closures.
+    gtl::InlinedVector<int, 8> worker_ids;
+    {
+      mutex_lock l(worker_mu_);
+      ClaimIdleWorkersLocked(num_queued, &worker_ids);
+    }
+    StartWorkers(worker_ids);
+  }
+}
+
+void ExecutorState::InjectReady(const TaggedNodeSeq& ready,
+                                int64 scheduled_nsec) {
+  gtl::InlinedVector<int, 8> worker_ids;
+  {
+    mutex_lock l(worker_mu_);
+    for (const TaggedNode& tagged_node : ready) {
+      injected_nodes_.push_back({tagged_node, scheduled_nsec});
+    }
+    ClaimIdleWorkersLocked(ready.size(), &worker_ids);
+  }
+  StartWorkers(worker_ids);
+}
+
+void ExecutorState::ClaimIdleWorkersLocked(
+    int max_workers, gtl::InlinedVector<int, 8>* worker_ids) {
+  while (max_workers > 0 && !idle_workers_.empty()) {
+    worker_ids->push_back(idle_workers_.back());
+    idle_workers_.pop_back();
+    num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+    --max_workers;
+  }
+}
+
+void ExecutorState::StartWorkers(const gtl::InlinedVector<int, 8>& worker_ids) {
+  for (int worker_id : worker_ids) {
+    runner_([this, worker_id]() { RunWorker(worker_id); });
+  }
+}
+
+void ExecutorState::RunWorker(int worker_id) {
+  ScheduledNode next;
+  while (NextNodeForWorker(worker_id, &next)) {
+    Process(next.tagged_node, next.scheduled_nsec, worker_id);
+  }
+  // Drop the reference taken in ClaimIdleWorkersLocked(). While a worker is
+  // running, Process() never completes the step, so the last one out does.
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
+bool ExecutorState::NextNodeForWorker(int worker_id, ScheduledNode* node) {
+  // Nodes are only ever pushed onto a worker's own queue by that worker, so
+  // once it is found empty here it stays empty until this worker pushes
+  // again, and no node can be stranded when the worker retires below.
+  {
+    WorkerQueue* own = &worker_queues_[worker_id];
+    mutex_lock l(own->mu);
+    if (!own->nodes.empty()) {
+      *node = own->nodes.back();
+      own->nodes.pop_back();
+      return true;
+    }
+  }
+  const int num_workers = worker_queues_.size();
+  for (int i = 1; i < num_workers; ++i) {
+    WorkerQueue* victim = &worker_queues_[(worker_id + i) % num_workers];
+    mutex_lock l(victim->mu);
+    if (!victim->nodes.empty()) {
+      *node = victim->nodes.front();
+      victim->nodes.pop_front();
+      return true;
+    }
+  }
+  // Check the injection queue and retire under the same lock, so that
+  // InjectReady() either sees this worker as idle or its nodes are seen here.
+  mutex_lock l(worker_mu_);
+  if (!injected_nodes_.empty()) {
+    *node = injected_nodes_.front();
+    injected_nodes_.pop_front();
+    return true;
+  }
+  idle_workers_.push_back(worker_id);
+  return false;
+}
+
+void ExecutorState::RunStaticLevels(int level) {
+  const ExecutorImpl::StaticPlan& plan = *impl_->static_plan_;
+  const int num_levels = plan.level_start.size() - 1;
+  for (; level < num_levels; ++level) {
+    {
+      mutex_lock l(mu_);
+      if (!status_.ok()) break;
+    }
+    int64 scheduled_nsec = 0;
+    if (stats_collector_ || scheduling_stats_) {
+      scheduled_nsec = nodestats::NowInNsec();
+    }
+
+    // As in ScheduleReady(), expensive nodes each get a closure and the
+    // inexpensive ones run inline on this thread.
+    gtl::InlinedVector<const NodeItem*, 8> inline_items;
+    gtl::InlinedVector<const NodeItem*, 8> expensive_items;
+    for (int i = plan.level_start[level]; i < plan.level_start[level + 1];
+         ++i) {
+      const NodeItem* item = plan.nodes[i];
+      if (impl_->IsExpensive(*item)) {
+        expensive_items.push_back(item);
+      } else {
+        inline_items.push_back(item);
+      }
+    }
+    if (inline_items.empty() && !expensive_items.empty()) {
+      inline_items.push_back(expensive_items.back());
+      expensive_items.pop_back();
+    }
+
+    // One count per closure, plus one for this thread, which holds the level
+    // open until all closures have been dispatched.
+    static_level_pending_.store(expensive_items.size() + 1);
+    for (const NodeItem* item : expensive_items) {
+      runner_([this, item, level, scheduled_nsec]() {
+        ProcessStatic(&item, 1, scheduled_nsec, /*inlined=*/false);
+        if (StaticWorkDone()) RunStaticLevels(level + 1);
+      });
+    }
+    ProcessStatic(inline_items.data(), inline_items.size(), scheduled_nsec,
+                  /*inlined=*/true);
+    if (!StaticWorkDone()) {
+      // The thread that completes this level runs the next one.
+      return;
+    }
+  }
+  ScheduleFinish();
+}
+
+void ExecutorState::ProcessStatic(const NodeItem* const* items, int num_items,
+                                  int64 scheduled_nsec, bool inlined) {
+  WithContext wc(context_);
+  const ExecutorImpl::StaticPlan& plan = *impl_->static_plan_;
+  Device* device = impl_->params_.device;
+
+  // Parameters passed to OpKernel::Compute.
+  TensorValueVec inputs;
+  DeviceContextVec input_device_contexts;
+  AllocatorAttributeVec input_alloc_attrs;
+  OpKernelContext::Params params;
+  InitializeParams(&params, &inputs, &input_device_contexts,
+                   &input_alloc_attrs);
+  params.frame_iter = FrameAndIter(0, 0);
+
+  Entry* input_tensors = GetInputTensors(root_frame_, 0);
+  EntryVector outputs;
+  const int32 thread_id =
+      scheduling_stats_ ? Env::Default()->GetCurrentThreadId() : 0;
+  for (int i = 0; i < num_items; ++i) {
+    const NodeItem& item = *items[i];
+    const int id = item.node_id;
+    Entry* first_input = input_tensors + item.input_start;
+
+    // A node is dead iff one of its data inputs has no value or one of its
+    // control predecessors is dead. All of them ran in earlier levels.
+    bool is_dead = false;
+    if (!item.is_control_trigger) {
+      for (int j = 0; j < item.num_inputs && !is_dead; ++j) {
+        is_dead = !first_input[j].has_value;
+      }
+      for (int j = plan.control_input_start[id];
+           j < plan.control_input_start[id + 1] && !is_dead; ++j) {
+        is_dead = static_node_dead_[plan.control_inputs[j]];
+      }
+    }
+    static_node_dead_[id] = is_dead;
+
+    params.track_allocations = false;
+    NodeExecStatsInterface* stats = nullptr;
+    if (stats_collector_ && !is_dead) {
+      stats = stats_collector_->CreateNodeExecStats(&item.kernel->def());
+      params.track_allocations = stats ? stats->TrackAllocations() : false;
+      nodestats::SetScheduled(stats, scheduled_nsec);
+      nodestats::SetAllStart(stats);
+    }
+    if (scheduling_stats_) {
+      scheduling_stats_->RecordNode(item.kernel->type_string(),
+                                    nodestats::NowInNsec() - scheduled_nsec,
+                                    inlined, thread_id);
+    }
+
+    if (vlog_) {
+      VLOG(1) << "Process node: " << id << " step " << params.step_id << " "
+              << SummarizeNodeDef(item.kernel->def())
+              << (is_dead ? " is dead" : "") << " device: " << device->name();
+    }
+
+    Status s;
+    outputs.clear();
+    TensorReferenceVector accessed_tensors;
+    DeviceContext* device_context = nullptr;
+    // Dead nodes produce no outputs, so their successors see inputs without
+    // values. Transfer nodes still run to propagate the dead bit.
+    if (!is_dead || item.is_transfer_node) {
+      bool is_input_dead = false;
+      s = PrepareInputs(item, first_input, &inputs, &input_device_contexts,
+                        &input_alloc_attrs, &is_input_dead);
+      if (s.ok()) {
+        params.op_kernel = item.kernel;
+        params.step_arena_allocator = StepArenaFor(item);
+        params.is_input_dead = is_input_dead;
+        params.output_attr_array = item.output_attrs();
+        params.forward_from_array = item.forward_from();
+
+        // The plan is only built for graphs without asynchronous kernels.
+        DCHECK(!item.kernel_is_async);
+        OpKernelContext ctx(&params, item.num_outputs);
+        nodestats::SetOpStart(stats);
+        ComputeSync(item, &ctx);
+        nodestats::SetOpEnd(stats);
+        s = ProcessOutputs(item, &ctx, &outputs, stats);
+        if (s.ok() && impl_->device_record_tensor_accesses_) {
+          ctx.retrieve_accessed_tensors(&accessed_tensors);
+          device_context = ctx.op_device_context();
+        }
+        nodestats::SetMemory(stats, &ctx);
+      }
+    }
+
+    // Clears inputs.
+    for (int j = 0; j < item.num_inputs; ++j) {
+      (first_input + j)->ClearVal();
+    }
+    if (s.ok() && !outputs.empty()) {
+      PropagateStaticOutputs(item, &outputs);
+    }
+    if (!accessed_tensors.empty()) {
+      nodestats::SetReferencedTensors(stats, accessed_tensors);
+      device->ConsumeListOfAccessedTensors(device_context, accessed_tensors);
+    }
+    FinalizeNode(s, stats);
+  }
+}
+
+void ExecutorState::PropagateStaticOutputs(const NodeItem& item,
+                                           EntryVector* outputs) {
+  Entry* input_tensors = GetInputTensors(root_frame_, 0);
+  const EdgeInfo* edges = item.output_edge_list();
+  for (size_t out_index = 0; out_index < item.num_output_edges; out_index++) {
+    const EdgeInfo& e = edges[out_index];
+    const int src_slot = e.output_slot;
+    // Control edges are resolved through static_node_dead_.
+    if (src_slot == Graph::kControlSlot) continue;
+    const NodeItem* dst_item = impl_->gview_.node(e.dst_id);
+    const int dst_loc = dst_item->input_start + e.input_slot;
+    if (e.is_last) {
+      input_tensors[dst_loc] = std::move((*outputs)[src_slot]);
+    } else {
+      input_tensors[dst_loc] = (*outputs)[src_slot];
     }
   }
 }
@@ -2914,7 +3727,34 @@ bool ExecutorState::FrameState::CleanupIterations(const GraphView* gview,
   return IsFrameDone();
 }
 
+void ExecutorImpl::PublishDispatchCosts() {
+  std::vector<CostModelManager::NodeDispatchCost> costs;
+  costs.reserve(gview_.num_nodes());
+  for (int id = 0; id < gview_.num_nodes(); ++id) {
+    const NodeItem* item = gview_.node(id);
+    if (item == nullptr) continue;
+    CostModelManager::NodeDispatchCost cost;
+    cost.node_id = id;
+    const uint64 cycles =
+        item->cost_estimate_cycles.load(std::memory_order_relaxed);
+    // Nodes that have not been measured yet report no cost.
+    if (item->measure_cost && cycles != OpKernel::kInitialCostEstimateCycles) {
+      cost.cost_cycles = cycles;
+    }
+    cost.run_inline = !IsExpensive(*item);
+    costs.push_back(cost);
+  }
+  params_.cost_model_manager->RecordDispatchCosts(dispatch_cost_graph_,
+                                                  std::move(costs));
+}
+
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
+  if (dispatch_cost_graph_ != nullptr) {
+    // Publish after the first step, once most nodes have been measured, and
+    // periodically afterwards.
+    const int64 step = num_steps_.fetch_add(1, std::memory_order_relaxed);
+    if (step % kPublishDispatchCostsEvery == 1) PublishDispatchCosts();
+  }
   (new ExecutorState(args, this))->RunAsync(std::move(done));
 }
 
@@ -2966,6 +3806,55 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor: the default executor where each
+// step runs its expensive nodes on at most one worker per schedulable core.
+// Each worker owns a ready queue and idle workers steal from busy ones, so a
+// wide fan-out does not flood the runner with one closure per node.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl = absl::make_unique<ExecutorImpl>(
+          params, std::max(1, port::MaxParallelism()));
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return Status::OK();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
+// Registers the "STATIC_PLAN" executor: for graphs without control flow, the
+// default executor computes a level-by-level schedule once, and runs each
+// step from it with one synchronization per level instead of per-node
+// pending counts. Graphs with control flow or asynchronous kernels (such as
+// _Recv) use dynamic scheduling.
+class StaticPlanExecutorRegistrar {
+ public:
+  StaticPlanExecutorRegistrar() {
+    ExecutorFactory::Register("STATIC_PLAN", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl = absl::make_unique<ExecutorImpl>(
+          params, /*num_workers=*/0, /*use_static_plan=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return Status::OK();
+    }
+  };
+};
+static StaticPlanExecutorRegistrar static_plan_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
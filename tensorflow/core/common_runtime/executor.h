@@ -31,6 +31,8 @@ limitations under the License.
 
 namespace tensorflow {
 
+class CostModelManager;
+class SchedulingStatsCollector;
 class StepStatsCollector;
 
 // Executor runs a graph computation.
@@ -100,6 +102,10 @@ class Executor {
     CollectiveExecutor* collective_executor = nullptr;
     thread::ThreadPoolInterface* user_intra_op_threadpool = nullptr;
 
+    // If set, the ready-to-start latency, dispatch mode and thread of every
+    // node are recorded in `scheduling_stats`.
+    SchedulingStatsCollector* scheduling_stats = nullptr;
+
     // If true, calls Sync() on the device.
     bool sync_on_finish = false;
 
@@ -145,6 +151,26 @@ struct LocalExecutorParams {
   std::function<void(OpKernel*)> delete_kernel;
 
   Executor::RendezvousFactory rendezvous_factory;
+
+  // If true, each step gets a StepArenaAllocator from which nodes whose
+  // outputs cannot escape the step allocate their small host tensors.
+  bool use_step_arena = false;
+
+  // If true and the graph has no control flow, the host memory of nodes that
+  // would use the step arena is planned once, from the sizes observed in the
+  // first step, and later steps hand out slices of one preallocated buffer.
+  bool use_static_memory_plan = false;
+
+  // If true, the executor measures the compute cost of each node online and
+  // uses it instead of OpKernel::IsExpensive() to decide whether a ready node
+  // runs inline, is batched with other inexpensive nodes into one closure,
+  // or gets a closure of its own.
+  bool adaptive_dispatch = false;
+
+  // If set together with `adaptive_dispatch`, the measured costs are
+  // periodically recorded in `cost_model_manager`, keyed by the graph passed
+  // to NewLocalExecutor(), which must outlive the executor. Not owned.
+  CostModelManager* cost_model_manager = nullptr;
 };
 ::tensorflow::Status NewLocalExecutor(const LocalExecutorParams& params,
                                       const Graph& graph, Executor** executor);
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
@@ -27,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
@@ -57,10 +59,23 @@ class ExecutorTest : public ::testing::Test {
   }
 
   // Resets executor_ with a new executor based on a graph 'gdef'.
-  void Create(std::unique_ptr<const Graph> graph) {
-    const int version = graph->versions().producer();
+  void Create(std::unique_ptr<const Graph> graph,
+              const string& executor_type = "",
+              bool adaptive_dispatch = false) {
+    rendez_ = NewLocalRendezvous();
+    delete exec_;
+    exec_ = NewTestExecutor(*graph, executor_type, adaptive_dispatch).release();
+    runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
+  }
+
+  // Returns a new executor for 'graph' on device_ that uses rendez_.
+  std::unique_ptr<Executor> NewTestExecutor(const Graph& graph,
+                                            const string& executor_type,
+                                            bool adaptive_dispatch = false) {
+    const int version = graph.versions().producer();
     LocalExecutorParams params;
     params.device = device_.get();
+    params.adaptive_dispatch = adaptive_dispatch;
     params.create_kernel = [this, version](const NodeDef& ndef,
                                            OpKernel** kernel) {
       return CreateNonCachedKernel(device_.get(), nullptr, ndef, version,
@@ -69,16 +84,15 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
-    rendez_ = NewLocalRendezvous();
     params.rendezvous_factory = [this](const int64, const DeviceMgr*,
                                        Rendezvous** r) {
       *r = rendez_;
       rendez_->Ref();
       return Status::OK();
     };
-    delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
-    runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
+    std::unique_ptr<Executor> exec;
+    TF_CHECK_OK(NewExecutor(executor_type, params, graph, &exec));
+    return exec;
   }
 
   Status Run(Rendezvous* rendez) {
@@ -207,10 +221,11 @@ TEST_F(ExecutorTest, SelfAdd) {
 //     (a + a) + (a + a)
 //     ((a + a) + a) + a
 // are all possibly generated.
-void BuildTree(int N, Graph* g) {
+void BuildTree(int N, Graph* g, bool constant_input = false) {
   CHECK_GT(N, 1);
-  // A single input node "in".
-  auto in = test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
+  // A single input node "in", received from ALICE or set to 1.0.
+  auto in = constant_input ? test::graph::Constant(g, V(1.0))
+                           : test::graph::Recv(g, "a", "float", ALICE, 1, BOB);
   std::vector<Node*> nodes;
   int i = 0;
   // Duplicate "in" N times. Each copies is named as l0, l1, l2, ....
@@ -250,6 +265,125 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWorkStealing) {
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "WORK_STEALING");
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeAdaptiveDispatch) {
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "", /*adaptive_dispatch=*/true);
+  Rendezvous::Args args;
+  // The first step measures the nodes; later ones batch the inexpensive
+  // leaves.
+  for (int iters = 0; iters < 4; ++iters) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeStaticPlan) {
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g), "STATIC_PLAN");
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeConstantInputStaticPlan) {
+  // Unlike the _Recv above, a constant input lets the static plan be used.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get(), /*constant_input=*/true);
+  Create(std::move(g), "STATIC_PLAN");
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, SendRecvPingPongStaticPlan) {
+  // Two partitions exchange tensors in both directions within one step:
+  //   ALICE: x = 1.0 -> BOB; y <- BOB;   z = y + y -> BOB
+  //   BOB:   x <- ALICE;   y = x + x -> ALICE; z <- ALICE -> "out"
+  // ALICE may only finish receiving "y" after it has sent "x", so neither
+  // partition may wait for its _Recv nodes before running independent nodes.
+  auto alice = absl::make_unique<Graph>(OpRegistry::Global());
+  auto x = test::graph::Constant(alice.get(), V(1.0));
+  test::graph::Send(alice.get(), x, "x", ALICE, 1, BOB);
+  auto y = test::graph::Recv(alice.get(), "y", "float", BOB, 1, ALICE);
+  test::graph::Send(alice.get(), test::graph::Add(alice.get(), y, y), "z",
+                    ALICE, 1, BOB);
+  auto bob = absl::make_unique<Graph>(OpRegistry::Global());
+  auto bob_x = test::graph::Recv(bob.get(), "x", "float", ALICE, 1, BOB);
+  test::graph::Send(bob.get(), test::graph::Add(bob.get(), bob_x, bob_x), "y",
+                    BOB, 1, ALICE);
+  auto bob_z = test::graph::Recv(bob.get(), "z", "float", ALICE, 1, BOB);
+  test::graph::Send(bob.get(), bob_z, "out", BOB, 1, ALICE);
+
+  Create(std::move(alice), "STATIC_PLAN");
+  std::unique_ptr<Executor> bob_exec = NewTestExecutor(*bob, "STATIC_PLAN");
+  Rendezvous::Args args;
+  for (int iters = 0; iters < 4; ++iters) {
+    Executor::Args exec_args;
+    exec_args.rendezvous = rendez_;
+    exec_args.runner = runner_;
+    Status alice_status;
+    Status bob_status;
+    Notification alice_done;
+    Notification bob_done;
+    exec_->RunAsync(exec_args, [&alice_status, &alice_done](const Status& s) {
+      alice_status = s;
+      alice_done.Notify();
+    });
+    bob_exec->RunAsync(exec_args, [&bob_status, &bob_done](const Status& s) {
+      bob_status = s;
+      bob_done.Notify();
+    });
+    alice_done.WaitForNotification();
+    bob_done.WaitForNotification();
+    TF_ASSERT_OK(alice_status);
+    TF_ASSERT_OK(bob_status);
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "out"), args,
+                               &out, &is_dead));
+    EXPECT_EQ(4.0, V(out));
+  }
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -324,6 +458,25 @@ TEST_F(ExecutorTest, SimpleSwitchDead) {
   EXPECT_TRUE(is_dead);
 }
 
+TEST_F(ExecutorTest, SimpleSwitchDeadStaticPlan) {
+  // Graphs with control flow fall back to dynamic scheduling.
+  auto g = absl::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g.get(), VB(true));
+  auto tmp = test::graph::Switch(g.get(), in0, in1);
+  test::graph::Send(g.get(), tmp, "c", BOB, 1, ALICE);
+  Create(std::move(g), "STATIC_PLAN");
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             /*is_dead=*/false));
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
 TEST_F(ExecutorTest, Abort) {
   // e = a + b + c + d
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
@@ -470,6 +623,51 @@ BENCHMARK(BM_executor)->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->ArgPair(1024, 1024);
 
+// Create a graph where one root fans out to 'width' chains of 4 Square nodes
+// on small tensors, which then fan back in to a single NoOp. Reports the
+// executor time per node for the given executor type.
+static void BM_FanOut(int iters, int width, const char* executor_type) {
+#ifdef PLATFORM_GOOGLE
+  BenchmarkUseRealTime();
+#endif  // PLATFORM_GOOGLE
+  constexpr int kChainLength = 4;
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor val(DT_FLOAT, TensorShape({256}));
+  val.flat<float>().setConstant(1.0);
+  Node* root = test::graph::Constant(g, val);
+  std::vector<Node*> chain_ends;
+  for (int i = 0; i < width; ++i) {
+    Node* n = root;
+    for (int j = 0; j < kChainLength; ++j) {
+      n = test::graph::Unary(g, "Square", n);
+    }
+    chain_ends.push_back(n);
+  }
+  test::graph::NoOp(g, chain_ends);
+  const int64 num_nodes = 2 + width * kChainLength;
+#ifdef PLATFORM_GOOGLE
+  SetBenchmarkLabel(strings::StrCat("Nodes = ", num_nodes));
+  SetBenchmarkItemsProcessed(num_nodes * static_cast<int64>(iters));
+#endif  // PLATFORM_GOOGLE
+  test::Benchmark("cpu", g, nullptr, nullptr, nullptr, executor_type)
+      .Run(iters);
+}
+
+static void BM_FanOutDefault(int iters, int width) {
+  BM_FanOut(iters, width, "");
+}
+BENCHMARK(BM_FanOutDefault)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_FanOutWorkStealing(int iters, int width) {
+  BM_FanOut(iters, width, "WORK_STEALING");
+}
+BENCHMARK(BM_FanOutWorkStealing)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_FanOutStaticPlan(int iters, int width) {
+  BM_FanOut(iters, width, "STATIC_PLAN");
+}
+BENCHMARK(BM_FanOutStaticPlan)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
 static void BM_FeedInputFetchOutput(int iters) {
   Graph* g = new Graph(OpRegistry::Global());
   // z = x + y: x and y are provided as benchmark inputs.  z is the
@@ -17,9 +17,12 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/local_device.h"
 
+#include <algorithm>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/common_runtime/process_state.h"
 #include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/cpu_feature_guard.h"
@@ -99,13 +102,30 @@ struct LocalDevice::EigenThreadPoolInfo {
     }
     eigen_device_.reset(new Eigen::ThreadPoolDevice(
         threadpool, eigen_worker_threads_.num_threads, eigen_allocator_.get()));
+
+    if (numa_node != port::kNUMANoAffinity) {
+      // Give each NUMA node its own slice of the inter-op threads, pinned to
+      // the node, so that kernels dispatched to a CPU device on this node
+      // run next to the memory they touch.
+      const int32 num_inter_op_threads =
+          std::max(1, NumInterOpThreadsFromSessionOptions(options) /
+                          port::NUMANumNodes());
+      inter_op_workers_.reset(new thread::ThreadPool(
+          options.env, thread_opts,
+          strings::StrCat("numa_", numa_node, "_InterOp"), num_inter_op_threads,
+          !options.config.experimental().disable_thread_spinning(),
+          /*allocator=*/nullptr));
+    }
   }
 
   ~EigenThreadPoolInfo() {
+    inter_op_workers_.reset();
     eigen_device_.reset();
     delete eigen_worker_threads_.workers;
   }
 
+  // Non-null only for NUMA-pinned pools.
+  std::unique_ptr<thread::ThreadPool> inter_op_workers_;
   DeviceBase::CpuWorkerThreads eigen_worker_threads_;
   std::unique_ptr<Eigen::ThreadPoolDevice> eigen_device_;
   std::unique_ptr<EigenAllocator> eigen_allocator_;
@@ -156,6 +176,10 @@ LocalDevice::LocalDevice(const SessionOptions& options,
   }
   set_tensorflow_cpu_worker_threads(&tp_info->eigen_worker_threads_);
   set_eigen_cpu_device(tp_info->eigen_device_.get());
+  if (tp_info->inter_op_workers_ != nullptr &&
+      attributes.device_type() == DEVICE_CPU) {
+    set_tensorflow_device_thread_pool(tp_info->inter_op_workers_.get());
+  }
 }
 
 LocalDevice::~LocalDevice() {}
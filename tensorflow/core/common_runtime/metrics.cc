@@ -48,6 +48,14 @@ auto* graph_run_output_tensor_bytes = monitoring::Sampler<0>::New(
     // Power of 2 with bucket count 14 (256G)
     {monitoring::Buckets::Exponential(1, 4, 14)});
 
+auto* executor_ready_to_start_usecs = monitoring::Sampler<2>::New(
+    {"/tensorflow/core/executor/ready_to_start_usecs",
+     "The time executor nodes of sampled steps spent between becoming ready "
+     "and starting to run, in microseconds.",
+     "op", "dispatch"},
+    // Power of 2 with bucket count 24 (> 8 seconds)
+    {monitoring::Buckets::Exponential(1, 2, 24)});
+
 auto* tf_data_autotune_counter = monitoring::Counter<1>::New(
     "/tensorflow/data/autotune", "tf.data autotuning", "name");
 
@@ -108,6 +116,12 @@ auto* mlir_import_failure_count = monitoring::Counter<0>::New(
 
 }  // namespace
 
+monitoring::SamplerCell* GetExecutorReadyToStartCell(const string& op,
+                                                     bool inlined) {
+  return executor_ready_to_start_usecs->GetCell(
+      op, inlined ? "inline" : "threadpool");
+}
+
 void RecordTFDataAutotune(const string& name) {
   tf_data_autotune_counter->GetCell(name)->IncrementBy(1);
 }
@@ -19,8 +19,18 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
+namespace monitoring {
+class SamplerCell;
+}  // namespace monitoring
+
 namespace metrics {
 
+// Returns the cell of the /tensorflow/core/executor/ready_to_start_usecs
+// sampler for nodes of type `op` that were run inline by the thread that made
+// them ready (`inlined`) or dispatched to the inter-op thread pool.
+monitoring::SamplerCell* GetExecutorReadyToStartCell(const string& op,
+                                                     bool inlined);
+
 // Records that a tf.data.Dataset executed by the program used autotuning.
 //
 // The `name` argument identifies the Dataset type (e.g. "ParallelMap").
@@ -69,6 +69,45 @@ Status AssignAndLog(int assigned_device, Node* node,
   return Status::OK();
 }
 
+// Returns the device index of the data inputs of 'node' if they are all
+// placed on one device that is a candidate for 'node', has the same type as
+// the default choice 'candidates[0]', and sits on a different NUMA node than
+// it.  Returns -1 otherwise.
+//
+// When the host exposes one CPU device per NUMA node, this keeps kernels on
+// the node where their inputs were produced instead of pulling every
+// unconstrained kernel back to node 0.
+int NumaLocalInputDevice(const Node* node,
+                         const std::vector<Device*>& candidates,
+                         const DeviceSet& device_set) {
+  int input_device = -1;
+  const Node* input = nullptr;
+  for (const Edge* e : node->in_edges()) {
+    if (e->IsControlEdge()) continue;
+    if (!e->src()->has_assigned_device_name()) continue;
+    const int index = e->src()->assigned_device_name_index();
+    if (input_device != -1 && index != input_device) return -1;
+    input_device = index;
+    input = e->src();
+  }
+  if (input == nullptr) return -1;
+
+  const Device* default_device = candidates[0];
+  const Device* device =
+      device_set.FindDeviceByName(input->assigned_device_name());
+  if (device == nullptr || device == default_device ||
+      device->device_type() != default_device->device_type() ||
+      device->attributes().locality().numa_node() ==
+          default_device->attributes().locality().numa_node()) {
+    return -1;
+  }
+  if (std::find(candidates.begin(), candidates.end(), device) ==
+      candidates.end()) {
+    return -1;
+  }
+  return input_device;
+}
+
 }  // namespace
 
 Placer::Placer(Graph* graph, const string& function_name,
@@ -178,6 +217,12 @@ Status Placer::Run() {
       }
     }
 
+    // Heuristic C: keep the node on the NUMA node its inputs were placed
+    // on, so that a step's kernels and tensors stay on one socket.
+    if (assigned_device == -1) {
+      assigned_device = NumaLocalInputDevice(node, *devices, *devices_);
+    }
+
     // Provide the default, if necessary.
     if (assigned_device == -1) {
       assigned_device = graph_->InternDeviceName((*devices)[0]->name());
@@ -104,6 +104,15 @@ class FakeDevice : public Device {
     return MakeDevice(name, "FakeCPU");
   }
 
+  static std::unique_ptr<Device> MakeCPUOnNumaNode(const string& name,
+                                                   int numa_node) {
+    DeviceAttributes device_attributes;
+    device_attributes.set_name(name);
+    device_attributes.set_device_type(DeviceType("FakeCPU").type());
+    device_attributes.mutable_locality()->set_numa_node(numa_node);
+    return std::unique_ptr<Device>(new FakeDevice(device_attributes));
+  }
+
   static std::unique_ptr<Device> MakeGPU(const string& name) {
     return MakeDevice(name, "FakeGPU");
   }
@@ -759,6 +768,52 @@ TEST_F(PlacerTest, TestHeuristicGeneratorFollowsSingleConsumer) {
   EXPECT_COLOCATED(g, "assign", "in");
 }
 
+// Heuristic C: with one CPU device per NUMA node, unconstrained consumers
+// stay on the node their input was placed on.
+TEST_F(PlacerTest, TestNumaHeuristicFollowsInputNode) {
+  std::vector<std::unique_ptr<Device>> numa_devices;
+  DeviceSet devices;
+  for (int i = 0; i < 2; ++i) {
+    numa_devices.push_back(FakeDevice::MakeCPUOnNumaNode(
+        strings::StrCat("/job:a/replica:0/task:0/device:FakeCPU:", i), i));
+    devices.AddDevice(numa_devices.back().get());
+  }
+
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    Node* input = ops::SourceOp(
+        "TestInput",
+        b.opts().WithName("in").WithDevice("/device:FakeCPU:1"));
+    Node* relu = ops::UnaryOp("ReluCPU", ops::NodeOut(input, 0),
+                              b.opts().WithName("n1"));
+    ops::UnaryOp("ReluCPU", relu, b.opts().WithName("n2"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  TF_EXPECT_OK(Place(&g, &devices));
+  EXPECT_DEVICE_CONTAINS(g, "in", "/device:FakeCPU:1");
+  EXPECT_COLOCATED(g, "in", "n1");
+  EXPECT_COLOCATED(g, "in", "n2");
+}
+
+// Without NUMA locality the default device is still chosen.
+TEST_F(PlacerTest, TestNumaHeuristicIgnoredOnSameNode) {
+  Graph g(OpRegistry::Global());
+  {  // Scope for temporary variables used to construct g.
+    GraphDefBuilder b(GraphDefBuilder::kFailImmediately);
+    Node* input = ops::SourceOp(
+        "TestInput",
+        b.opts().WithName("in").WithDevice("/device:FakeCPU:1"));
+    ops::UnaryOp("ReluCPU", ops::NodeOut(input, 0), b.opts().WithName("n1"));
+    TF_EXPECT_OK(BuildGraph(b, &g));
+  }
+
+  TF_EXPECT_OK(Place(&g));
+  EXPECT_DEVICE_CONTAINS(g, "in", "/device:FakeCPU:1");
+  EXPECT_DEVICE_CONTAINS(g, "n1", "/device:FakeCPU:0");
+}
+
 TEST_F(PlacerTest, TestIgnoreGeneratorHeuristicIfWrongDevice) {
   Graph g(OpRegistry::Global());
   {  // Scope for temporary variables used to construct g.
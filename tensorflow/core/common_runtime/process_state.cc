@@ -91,9 +91,18 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
       }
       int64 cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
       DCHECK(sub_allocator);
-      allocator =
+      BFCAllocator* bfc_allocator =
           new BFCAllocator(sub_allocator, cpu_mem_limit, true /*allow_growth*/,
                            "bfc_cpu_allocator_for_gpu" /*name*/);
+      // Optionally put per-thread free chunk caches in front of the
+      // allocator to reduce lock contention between inter-op threads.
+      int64 cache_shards = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_CACHE_SHARDS", 0, &cache_shards);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
+      bfc_allocator->EnableFreeChunkCache(static_cast<int>(cache_shards));
+      allocator = bfc_allocator;
       VLOG(2) << "Using BFCAllocator with memory limit of "
               << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator";
     } else if (sub_allocator) {
@@ -57,7 +57,10 @@ class ProcessState : public ProcessStateInterface {
 
   // If NUMA Allocators are desired, call this before calling any
   // Allocator accessor.
-  void EnableNUMA() { numa_enabled_ = true; }
+  void EnableNUMA() {
+    mutex_lock lock(mu_);
+    numa_enabled_ = true;
+  }
 
   // Returns what we know about the memory at ptr.
   // If we know nothing, it's called CPU 0 with no other attributes.
@@ -0,0 +1,73 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/scheduling_stats_collector.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/metrics.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+
+void SchedulingStatsCollector::RecordNode(const string& op,
+                                          int64 ready_to_start_nsec,
+                                          bool inlined, int32 thread_id) {
+  const double usecs = std::max<int64>(ready_to_start_nsec, 0) / 1000.0;
+  mutex_lock l(mu_);
+  OpStats& stats = ops_[op];
+  stats.ready_to_start_usecs.Add(usecs);
+  stats.thread_ids.insert(thread_id);
+  monitoring::SamplerCell** cell;
+  if (inlined) {
+    ++stats.num_inline;
+    cell = &stats.inline_cell;
+  } else {
+    ++stats.num_dispatched;
+    cell = &stats.dispatched_cell;
+  }
+  if (*cell == nullptr) {
+    *cell = metrics::GetExecutorReadyToStartCell(op, inlined);
+  }
+  (*cell)->Add(usecs);
+}
+
+void SchedulingStatsCollector::ToProto(
+    protobuf::RepeatedPtrField<OpSchedulingStats>* stats) const {
+  mutex_lock l(mu_);
+  std::vector<const string*> ops;
+  ops.reserve(ops_.size());
+  for (const auto& it : ops_) {
+    ops.push_back(&it.first);
+  }
+  std::sort(ops.begin(), ops.end(),
+            [](const string* a, const string* b) { return *a < *b; });
+  for (const string* op : ops) {
+    const OpStats& op_stats = ops_.at(*op);
+    OpSchedulingStats* proto = stats->Add();
+    proto->set_op(*op);
+    op_stats.ready_to_start_usecs.EncodeToProto(
+        proto->mutable_ready_to_start_usecs(),
+        /*preserve_zero_buckets=*/false);
+    proto->set_num_inline(op_stats.num_inline);
+    proto->set_num_dispatched(op_stats.num_dispatched);
+    for (int32 thread_id : op_stats.thread_ids) {
+      proto->add_thread_ids(thread_id);
+    }
+  }
+}
+
+}  // namespace tensorflow
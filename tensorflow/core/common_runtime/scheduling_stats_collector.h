@@ -0,0 +1,73 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_SCHEDULING_STATS_COLLECTOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_SCHEDULING_STATS_COLLECTOR_H_
+
+#include <set>
+#include <unordered_map>
+
+#include "tensorflow/core/lib/histogram/histogram.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+class OpSchedulingStats;
+
+namespace monitoring {
+class SamplerCell;
+}  // namespace monitoring
+
+// Aggregates, per op type, how long the nodes of a step waited between
+// becoming ready and starting to run, whether they were run inline by the
+// thread that made them ready or dispatched to the inter-op thread pool, and
+// which threads ran them. Every sample is also exported to the
+// /tensorflow/core/executor/ready_to_start_usecs sampler.
+//
+// This class is thread-safe.
+class SchedulingStatsCollector {
+ public:
+  SchedulingStatsCollector() {}
+
+  // Records that a node of type `op` started running `ready_to_start_nsec`
+  // nanoseconds after it became ready, on thread `thread_id`.
+  void RecordNode(const string& op, int64 ready_to_start_nsec, bool inlined,
+                  int32 thread_id);
+
+  // Appends the aggregated stats to `stats`, one entry per op type in
+  // lexicographic order.
+  void ToProto(protobuf::RepeatedPtrField<OpSchedulingStats>* stats) const;
+
+ private:
+  struct OpStats {
+    histogram::Histogram ready_to_start_usecs;
+    int64 num_inline = 0;
+    int64 num_dispatched = 0;
+    std::set<int32> thread_ids;
+    monitoring::SamplerCell* inline_cell = nullptr;
+    monitoring::SamplerCell* dispatched_cell = nullptr;
+  };
+
+  mutable mutex mu_;
+  std::unordered_map<string, OpStats> ops_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SchedulingStatsCollector);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_SCHEDULING_STATS_COLLECTOR_H_
@@ -0,0 +1,79 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/scheduling_stats_collector.h"
+
+#include "tensorflow/core/common_runtime/metrics.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(SchedulingStatsCollectorTest, AggregatesPerOpType) {
+  SchedulingStatsCollector collector;
+  collector.RecordNode("MatMul", 2000, /*inlined=*/false, 1);
+  collector.RecordNode("Add", 1000, /*inlined=*/true, 2);
+  collector.RecordNode("MatMul", 4000, /*inlined=*/true, 1);
+  collector.RecordNode("MatMul", 6000, /*inlined=*/false, 3);
+
+  protobuf::RepeatedPtrField<OpSchedulingStats> stats;
+  collector.ToProto(&stats);
+  ASSERT_EQ(2, stats.size());
+
+  EXPECT_EQ("Add", stats[0].op());
+  EXPECT_EQ(1, stats[0].num_inline());
+  EXPECT_EQ(0, stats[0].num_dispatched());
+  EXPECT_EQ(1, stats[0].ready_to_start_usecs().num());
+  EXPECT_EQ(1, stats[0].ready_to_start_usecs().min());
+
+  EXPECT_EQ("MatMul", stats[1].op());
+  EXPECT_EQ(1, stats[1].num_inline());
+  EXPECT_EQ(2, stats[1].num_dispatched());
+  EXPECT_EQ(3, stats[1].ready_to_start_usecs().num());
+  EXPECT_EQ(2, stats[1].ready_to_start_usecs().min());
+  EXPECT_EQ(6, stats[1].ready_to_start_usecs().max());
+  EXPECT_EQ(12, stats[1].ready_to_start_usecs().sum());
+  ASSERT_EQ(2, stats[1].thread_ids_size());
+  EXPECT_EQ(1, stats[1].thread_ids(0));
+  EXPECT_EQ(3, stats[1].thread_ids(1));
+}
+
+TEST(SchedulingStatsCollectorTest, ClampsNegativeLatency) {
+  SchedulingStatsCollector collector;
+  collector.RecordNode("NoOp", -5, /*inlined=*/true, 1);
+  protobuf::RepeatedPtrField<OpSchedulingStats> stats;
+  collector.ToProto(&stats);
+  ASSERT_EQ(1, stats.size());
+  EXPECT_EQ(0, stats[0].ready_to_start_usecs().min());
+}
+
+TEST(SchedulingStatsCollectorTest, ExportsToSampler) {
+  const HistogramProto before =
+      metrics::GetExecutorReadyToStartCell("SchedulingStatsTestOp", true)
+          ->value();
+  SchedulingStatsCollector collector;
+  collector.RecordNode("SchedulingStatsTestOp", 3000, /*inlined=*/true, 1);
+  collector.RecordNode("SchedulingStatsTestOp", 3000, /*inlined=*/false, 1);
+  const HistogramProto after =
+      metrics::GetExecutorReadyToStartCell("SchedulingStatsTestOp", true)
+          ->value();
+  EXPECT_EQ(before.num() + 1, after.num());
+  EXPECT_EQ(before.sum() + 3, after.sum());
+}
+
+}  // namespace
+}  // namespace tensorflow
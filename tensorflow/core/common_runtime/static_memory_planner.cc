@@ -0,0 +1,287 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+
+namespace tensorflow {
+
+namespace {
+int64 RoundUp(int64 value, int64 alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+StaticMemoryPlan::StaticMemoryPlan(const std::vector<Buffer>& buffers,
+                                   int64 alignment)
+    : offsets_(buffers.size(), 0),
+      bytes_(buffers.size(), 0),
+      overlapping_(buffers.size()) {
+  const int n = buffers.size();
+  std::vector<int> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&buffers](int a, int b) {
+    if (buffers[a].bytes != buffers[b].bytes) {
+      return buffers[a].bytes > buffers[b].bytes;
+    }
+    return buffers[a].first_use < buffers[b].first_use;
+  });
+
+  std::vector<int> placed;
+  std::vector<int> live;
+  for (int i : order) {
+    const Buffer& buffer = buffers[i];
+    bytes_[i] = buffer.bytes;
+    live.clear();
+    for (int j : placed) {
+      if (buffers[j].first_use <= buffer.last_use &&
+          buffer.first_use <= buffers[j].last_use) {
+        live.push_back(j);
+      }
+    }
+    std::sort(live.begin(), live.end(),
+              [this](int a, int b) { return offsets_[a] < offsets_[b]; });
+    // Take the first gap between simultaneously live buffers that fits.
+    int64 offset = 0;
+    for (int j : live) {
+      if (offset + buffer.bytes <= offsets_[j]) break;
+      offset = std::max(offset, RoundUp(offsets_[j] + bytes_[j], alignment));
+    }
+    offsets_[i] = offset;
+    arena_size_ = std::max(arena_size_, offset + buffer.bytes);
+    placed.push_back(i);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    for (int j = i + 1; j < n; ++j) {
+      if (offsets_[i] < offsets_[j] + bytes_[j] &&
+          offsets_[j] < offsets_[i] + bytes_[i]) {
+        overlapping_[i].push_back(j);
+        overlapping_[j].push_back(i);
+      }
+    }
+  }
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(Allocator* fallback,
+                                         std::vector<int> first_use,
+                                         std::vector<int> last_use)
+    : fallback_(fallback),
+      first_use_(std::move(first_use)),
+      last_use_(std::move(last_use)) {
+  DCHECK_EQ(first_use_.size(), last_use_.size());
+}
+
+struct StaticMemoryPlanner::StepBuffers {
+  explicit StepBuffers(int num_nodes)
+      : node_allocators(new PlannedStepArena::NodeAllocator[num_nodes]) {}
+  ~StepBuffers() {
+    if (slab != nullptr) port::AlignedFree(slab);
+  }
+
+  char* slab = nullptr;
+  std::unique_ptr<PlannedStepArena::NodeAllocator[]> node_allocators;
+  std::vector<bool> live;
+};
+
+StaticMemoryPlanner::~StaticMemoryPlanner() {}
+
+PlannedStepArena* StaticMemoryPlanner::NewStep() {
+  mutex_lock l(mu_);
+  std::unique_ptr<StepBuffers> buffers = TakeStepBuffers();
+  if (plan_ == nullptr) {
+    // Only one step records sizes; steps that run concurrently with it use
+    // the fallback allocator throughout.
+    const bool recording = !recording_started_;
+    recording_started_ = true;
+    return new PlannedStepArena(this, nullptr, std::move(buffers), recording);
+  }
+  return new PlannedStepArena(this, plan_.get(), std::move(buffers), false);
+}
+
+std::unique_ptr<StaticMemoryPlanner::StepBuffers>
+StaticMemoryPlanner::TakeStepBuffers() {
+  std::unique_ptr<StepBuffers> buffers;
+  if (!free_buffers_.empty()) {
+    buffers = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  } else {
+    buffers.reset(new StepBuffers(first_use_.size()));
+  }
+  if (plan_ != nullptr && buffers->slab == nullptr &&
+      plan_->arena_size() > 0) {
+    buffers->slab = static_cast<char*>(port::AlignedMalloc(
+        plan_->arena_size(), Allocator::kAllocatorAlignment));
+  }
+  return buffers;
+}
+
+void StaticMemoryPlanner::ReturnStepBuffers(
+    std::unique_ptr<StepBuffers> buffers) {
+  mutex_lock l(mu_);
+  free_buffers_.push_back(std::move(buffers));
+}
+
+void StaticMemoryPlanner::BuildPlan(
+    const std::vector<std::vector<int64>>& sizes) {
+  const int num_nodes = first_use_.size();
+  mutex_lock l(mu_);
+  if (plan_ != nullptr) return;
+
+  plan_start_.assign(num_nodes + 1, 0);
+  for (int id = 0; id < num_nodes; ++id) {
+    plan_start_[id + 1] = plan_start_[id] + sizes[id].size();
+  }
+  plan_index_.assign(plan_start_[num_nodes], -1);
+  std::vector<StaticMemoryPlan::Buffer> buffers;
+  int64 total_bytes = 0;
+  for (int id = 0; id < num_nodes; ++id) {
+    for (int k = 0; k < sizes[id].size(); ++k) {
+      if (sizes[id][k] == 0) continue;
+      plan_index_[plan_start_[id] + k] = buffers.size();
+      StaticMemoryPlan::Buffer buffer;
+      buffer.bytes = sizes[id][k];
+      buffer.first_use = first_use_[id];
+      buffer.last_use = last_use_[id];
+      buffers.push_back(buffer);
+      total_bytes += buffer.bytes;
+    }
+  }
+  plan_.reset(new StaticMemoryPlan(buffers, Allocator::kAllocatorAlignment));
+  VLOG(1) << "Planned " << buffers.size() << " buffers totalling "
+          << total_bytes << " bytes into an arena of " << plan_->arena_size()
+          << " bytes";
+}
+
+int StaticMemoryPlanner::PlanIndex(int node_id, int index) const {
+  const int i = plan_start_[node_id] + index;
+  if (i >= plan_start_[node_id + 1]) return -1;
+  return plan_index_[i];
+}
+
+PlannedStepArena::PlannedStepArena(
+    StaticMemoryPlanner* planner, const StaticMemoryPlan* plan,
+    std::unique_ptr<StaticMemoryPlanner::StepBuffers> buffers, bool recording)
+    : planner_(planner),
+      plan_(plan),
+      recording_(recording),
+      buffers_(std::move(buffers)),
+      slab_(plan != nullptr ? buffers_->slab : nullptr),
+      node_allocators_(buffers_->node_allocators.get()),
+      live_(buffers_->live) {
+  planner_->Ref();
+  // The buffers may come from an earlier step; reset their state in place.
+  for (int id = 0; id < planner_->first_use_.size(); ++id) {
+    node_allocators_[id].arena_ = this;
+    node_allocators_[id].node_id_ = id;
+    node_allocators_[id].next_index_.store(0, std::memory_order_relaxed);
+  }
+  mutex_lock l(mu_);
+  if (plan_ != nullptr) {
+    live_.assign(plan_->num_buffers(), false);
+  }
+  if (recording_) {
+    recorded_sizes_.resize(planner_->first_use_.size());
+  }
+}
+
+PlannedStepArena::~PlannedStepArena() {
+  planner_->ReturnStepBuffers(std::move(buffers_));
+  planner_->Unref();
+}
+
+void PlannedStepArena::FinishStep() {
+  if (!recording_) return;
+  std::vector<std::vector<int64>> sizes;
+  {
+    mutex_lock l(mu_);
+    sizes.swap(recorded_sizes_);
+  }
+  planner_->BuildPlan(sizes);
+}
+
+void* PlannedStepArena::Allocate(int node_id, int index, size_t alignment,
+                                 size_t num_bytes) {
+  void* ptr = nullptr;
+  if (slab_ != nullptr) {
+    const int i = planner_->PlanIndex(node_id, index);
+    if (i >= 0 && num_bytes > 0 && num_bytes <= plan_->bytes(i) &&
+        alignment <= Allocator::kAllocatorAlignment) {
+      mutex_lock l(mu_);
+      bool available = !live_[i];
+      for (int j : plan_->overlapping(i)) {
+        if (live_[j]) {
+          available = false;
+          break;
+        }
+      }
+      if (available) {
+        live_[i] = true;
+        live_offsets_[plan_->offset(i)] = i;
+        ptr = slab_ + plan_->offset(i);
+      }
+    }
+  } else if (recording_ && num_bytes > 0) {
+    mutex_lock l(mu_);
+    std::vector<int64>& sizes = recorded_sizes_[node_id];
+    if (sizes.size() <= index) sizes.resize(index + 1, 0);
+    sizes[index] = num_bytes;
+  }
+
+  if (ptr != nullptr) {
+    ++num_planned_;
+  } else {
+    ptr = planner_->fallback_->AllocateRaw(alignment, num_bytes);
+    if (ptr == nullptr) return nullptr;
+    ++num_unplanned_;
+  }
+  // Released by Deallocate().
+  Ref();
+  return ptr;
+}
+
+void PlannedStepArena::Deallocate(void* ptr) {
+  if (ptr == nullptr) return;
+  char* p = static_cast<char*>(ptr);
+  if (slab_ != nullptr && p >= slab_ && p < slab_ + plan_->arena_size()) {
+    mutex_lock l(mu_);
+    auto it = live_offsets_.find(p - slab_);
+    if (it != live_offsets_.end()) {
+      live_[it->second] = false;
+      live_offsets_.erase(it);
+    } else {
+      LOG(ERROR) << "Deallocating unknown pointer into the planned arena";
+    }
+  } else {
+    planner_->fallback_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+void* PlannedStepArena::NodeAllocator::AllocateRaw(size_t alignment,
+                                                   size_t num_bytes) {
+  const int index = next_index_.fetch_add(1, std::memory_order_relaxed);
+  return arena_->Allocate(node_id_, index, alignment, num_bytes);
+}
+
+void PlannedStepArena::NodeAllocator::DeallocateRaw(void* ptr) {
+  arena_->Deallocate(ptr);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,202 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/gtl/flatmap.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Assigns every buffer an offset within a single arena such that buffers
+// whose live ranges overlap never share bytes. Buffers are placed largest
+// first, each at the lowest offset that does not collide with an already
+// placed buffer that is live at the same time, as in TFLite's ArenaPlanner.
+class StaticMemoryPlan {
+ public:
+  struct Buffer {
+    int64 bytes = 0;
+    // The first and last time steps (inclusive) at which the buffer is live.
+    int first_use = 0;
+    int last_use = 0;
+  };
+
+  // Offsets are multiples of `alignment`.
+  StaticMemoryPlan(const std::vector<Buffer>& buffers, int64 alignment);
+
+  int num_buffers() const { return offsets_.size(); }
+  int64 arena_size() const { return arena_size_; }
+  int64 offset(int i) const { return offsets_[i]; }
+  int64 bytes(int i) const { return bytes_[i]; }
+
+  // The buffers that share at least one byte with buffer `i`. They are never
+  // live at the same time as `i` according to the plan.
+  const std::vector<int>& overlapping(int i) const { return overlapping_[i]; }
+
+ private:
+  int64 arena_size_ = 0;
+  std::vector<int64> offsets_;
+  std::vector<int64> bytes_;
+  std::vector<std::vector<int>> overlapping_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryPlan);
+};
+
+class PlannedStepArena;
+
+// Plans the host memory of one executor ahead of time.
+//
+// The first step runs with the fallback allocator and records the size of
+// every allocation each participating node makes. Once it is done, the
+// recorded sizes and the nodes' live ranges are turned into a
+// StaticMemoryPlan, and every later step is handed a preallocated slab from
+// which each allocation receives its planned slice.
+//
+// The plan is advisory: an allocation that is larger than recorded, or whose
+// slice is still occupied (e.g. because a consumer forwarded its input to a
+// longer-lived output), is served by the fallback allocator instead.
+class StaticMemoryPlanner : public core::RefCounted {
+ public:
+  // `first_use[id]` is the time step at which node `id` runs and
+  // `last_use[id]` the last time step at which one of its outputs is
+  // consumed. Nodes with a negative `first_use` do not take part in the plan.
+  // Does not take ownership of `fallback`, which must outlive every tensor
+  // allocated through this planner.
+  StaticMemoryPlanner(Allocator* fallback, std::vector<int> first_use,
+                      std::vector<int> last_use);
+
+  // Returns the allocation state of a new step. The caller owns one reference
+  // and must call PlannedStepArena::FinishStep() when the step is done.
+  PlannedStepArena* NewStep();
+
+  // Returns the plan, or nullptr if it has not been built yet.
+  const StaticMemoryPlan* plan() const {
+    mutex_lock l(mu_);
+    return plan_.get();
+  }
+
+ private:
+  friend class PlannedStepArena;
+
+  ~StaticMemoryPlanner() override;
+
+  // Builds the plan from the allocation sizes recorded by the first step:
+  // `sizes[id][k]` is the size of the k-th allocation of node `id`.
+  void BuildPlan(const std::vector<std::vector<int64>>& sizes);
+
+  // Returns the plan index of the `index`-th allocation of node `node_id`, or
+  // -1 if it is not planned. Must only be called once the plan is built.
+  int PlanIndex(int node_id, int index) const;
+
+  // The per-step buffers that are reused across steps: the slab, the node
+  // allocators and the liveness of each planned buffer. Defined in the .cc.
+  struct StepBuffers;
+
+  // Returns pooled buffers, or new ones if the pool is empty. The slab is
+  // allocated once the plan exists.
+  std::unique_ptr<StepBuffers> TakeStepBuffers() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void ReturnStepBuffers(std::unique_ptr<StepBuffers> buffers);
+
+  Allocator* const fallback_;
+  const std::vector<int> first_use_;
+  const std::vector<int> last_use_;
+
+  mutable mutex mu_;
+  bool recording_started_ GUARDED_BY(mu_) = false;
+  std::unique_ptr<StaticMemoryPlan> plan_ GUARDED_BY(mu_);
+  // The plan_ index of the k-th allocation of node `id` is
+  // plan_index_[plan_start_[id] + k], or -1 if it is not planned. Both are
+  // set together with plan_ and immutable afterwards.
+  std::vector<int> plan_start_;
+  std::vector<int> plan_index_;
+  std::vector<std::unique_ptr<StepBuffers>> free_buffers_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticMemoryPlanner);
+};
+
+// The allocation state of one step. Every live allocation holds a reference,
+// so a tensor that outlives the step keeps its slice of the slab valid.
+class PlannedStepArena : public core::RefCounted {
+ public:
+  // The allocator for the kernel of node `node_id`. Valid as long as this
+  // object is alive.
+  Allocator* ForNode(int node_id) { return &node_allocators_[node_id]; }
+
+  // Marks the end of the step. If this step recorded allocation sizes, the
+  // plan is built from them.
+  void FinishStep();
+
+  // The number of allocations served from the slab and by the fallback
+  // allocator, respectively.
+  int64 num_planned() const { return num_planned_; }
+  int64 num_unplanned() const { return num_unplanned_; }
+
+ private:
+  friend class StaticMemoryPlanner;
+
+  class NodeAllocator : public Allocator {
+   public:
+    string Name() override { return "static_memory_plan"; }
+    void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+    void DeallocateRaw(void* ptr) override;
+
+   private:
+    friend class PlannedStepArena;
+    PlannedStepArena* arena_ = nullptr;
+    int node_id_ = -1;
+    std::atomic<int> next_index_{0};
+  };
+
+  // `plan` is null if the step is recording or runs without a plan. Takes
+  // ownership of `buffers` and returns them to `planner` when destroyed.
+  PlannedStepArena(StaticMemoryPlanner* planner, const StaticMemoryPlan* plan,
+                   std::unique_ptr<StaticMemoryPlanner::StepBuffers> buffers,
+                   bool recording);
+  ~PlannedStepArena() override;
+
+  void* Allocate(int node_id, int index, size_t alignment, size_t num_bytes);
+  void Deallocate(void* ptr);
+
+  StaticMemoryPlanner* const planner_;
+  const StaticMemoryPlan* const plan_;
+  const bool recording_;
+  std::unique_ptr<StaticMemoryPlanner::StepBuffers> buffers_;
+  // Null if the step runs without a plan. Owned by buffers_.
+  char* const slab_;
+  NodeAllocator* const node_allocators_;
+  std::atomic<int64> num_planned_{0};
+  std::atomic<int64> num_unplanned_{0};
+
+  mutex mu_;
+  std::vector<std::vector<int64>> recorded_sizes_ GUARDED_BY(mu_);
+  // Owned by buffers_.
+  std::vector<bool>& live_ GUARDED_BY(mu_);
+  // Maps the offset of each live planned allocation to its plan index.
+  gtl::FlatMap<int64, int> live_offsets_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(PlannedStepArena);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
@@ -0,0 +1,158 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+StaticMemoryPlan::Buffer MakeBuffer(int64 bytes, int first_use, int last_use) {
+  StaticMemoryPlan::Buffer buffer;
+  buffer.bytes = bytes;
+  buffer.first_use = first_use;
+  buffer.last_use = last_use;
+  return buffer;
+}
+
+TEST(StaticMemoryPlanTest, ReusesMemoryOfDeadBuffers) {
+  StaticMemoryPlan plan(
+      {MakeBuffer(100, 0, 1), MakeBuffer(100, 2, 3), MakeBuffer(50, 1, 2)},
+      64);
+  EXPECT_EQ(0, plan.offset(0));
+  EXPECT_EQ(0, plan.offset(1));
+  EXPECT_EQ(128, plan.offset(2));
+  EXPECT_EQ(178, plan.arena_size());
+  EXPECT_EQ(std::vector<int>({1}), plan.overlapping(0));
+  EXPECT_EQ(std::vector<int>({0}), plan.overlapping(1));
+  EXPECT_TRUE(plan.overlapping(2).empty());
+}
+
+TEST(StaticMemoryPlanTest, LiveBuffersNeverOverlap) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rand(&philox);
+  std::vector<StaticMemoryPlan::Buffer> buffers;
+  int64 total_bytes = 0;
+  for (int i = 0; i < 200; ++i) {
+    const int first_use = rand.Uniform(50);
+    buffers.push_back(MakeBuffer(rand.Uniform(4096) + 1, first_use,
+                                 first_use + rand.Uniform(10)));
+    total_bytes += buffers.back().bytes;
+  }
+  StaticMemoryPlan plan(buffers, 64);
+  EXPECT_LT(plan.arena_size(), total_bytes);
+  for (int i = 0; i < buffers.size(); ++i) {
+    EXPECT_EQ(0, plan.offset(i) % 64);
+    EXPECT_LE(plan.offset(i) + buffers[i].bytes, plan.arena_size());
+    for (int j : plan.overlapping(i)) {
+      EXPECT_TRUE(buffers[i].last_use < buffers[j].first_use ||
+                  buffers[j].last_use < buffers[i].first_use)
+          << i << " and " << j << " are live at the same time";
+    }
+  }
+}
+
+class StaticMemoryPlannerTest : public ::testing::Test {
+ protected:
+  // Three nodes in a chain: node 0 is consumed by node 1, which is consumed
+  // by node 2, so the outputs of nodes 0 and 2 may share memory.
+  StaticMemoryPlannerTest()
+      : planner_(new StaticMemoryPlanner(cpu_allocator(), {0, 1, 2},
+                                         {1, 2, 2})) {}
+  ~StaticMemoryPlannerTest() override { planner_->Unref(); }
+
+  // Runs one step in which every node allocates a tensor of `num_elements`
+  // floats, and returns the tensors.
+  std::vector<Tensor> RunStep(int num_elements, PlannedStepArena** arena) {
+    *arena = planner_->NewStep();
+    std::vector<Tensor> tensors;
+    for (int id = 0; id < 3; ++id) {
+      tensors.emplace_back((*arena)->ForNode(id), DT_FLOAT,
+                           TensorShape({num_elements}));
+    }
+    return tensors;
+  }
+
+  StaticMemoryPlanner* planner_;
+};
+
+TEST_F(StaticMemoryPlannerTest, PlansFromFirstStep) {
+  PlannedStepArena* arena;
+  RunStep(16, &arena);
+  EXPECT_EQ(0, arena->num_planned());
+  arena->FinishStep();
+  arena->Unref();
+  ASSERT_NE(nullptr, planner_->plan());
+  EXPECT_EQ(3, planner_->plan()->num_buffers());
+
+  // Nodes 0 and 2 share a slice, so node 2 cannot use it while node 0's
+  // output is alive.
+  std::vector<Tensor> tensors = RunStep(16, &arena);
+  EXPECT_EQ(2, arena->num_planned());
+  EXPECT_EQ(1, arena->num_unplanned());
+  arena->FinishStep();
+  arena->Unref();
+
+  arena = planner_->NewStep();
+  Tensor t0(arena->ForNode(0), DT_FLOAT, TensorShape({16}));
+  Tensor t1(arena->ForNode(1), DT_FLOAT, TensorShape({16}));
+  const char* slice = t0.tensor_data().data();
+  t0 = Tensor();
+  Tensor t2(arena->ForNode(2), DT_FLOAT, TensorShape({16}));
+  EXPECT_EQ(3, arena->num_planned());
+  EXPECT_EQ(slice, t2.tensor_data().data());
+  arena->FinishStep();
+  arena->Unref();
+}
+
+TEST_F(StaticMemoryPlannerTest, LargerAllocationsFallBack) {
+  PlannedStepArena* arena;
+  RunStep(16, &arena);
+  arena->FinishStep();
+  arena->Unref();
+
+  RunStep(32, &arena);
+  EXPECT_EQ(0, arena->num_planned());
+  EXPECT_EQ(3, arena->num_unplanned());
+  arena->FinishStep();
+  arena->Unref();
+}
+
+TEST_F(StaticMemoryPlannerTest, TensorOutlivesStep) {
+  PlannedStepArena* arena;
+  RunStep(4, &arena);
+  arena->FinishStep();
+  arena->Unref();
+
+  std::vector<Tensor> first = RunStep(4, &arena);
+  first[0].flat<float>().setConstant(1.0f);
+  arena->FinishStep();
+  arena->Unref();
+
+  // The first step's slab is still referenced, so the next step must not
+  // reuse it.
+  std::vector<Tensor> second = RunStep(4, &arena);
+  second[0].flat<float>().setConstant(2.0f);
+  EXPECT_NE(first[0].tensor_data().data(), second[0].tensor_data().data());
+  EXPECT_EQ(1.0f, first[0].flat<float>()(0));
+  arena->FinishStep();
+  arena->Unref();
+}
+
+}  // namespace
+}  // namespace tensorflow
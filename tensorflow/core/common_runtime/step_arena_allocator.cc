@@ -0,0 +1,304 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+#include <new>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+
+namespace tensorflow {
+
+namespace {
+size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+}  // namespace
+
+struct StepArenaAllocator::Block {
+  // Bytes carved from the block, header included. Exceeds the block size
+  // once an allocation did not fit.
+  std::atomic<size_t> used{Allocator::kAllocatorAlignment};
+  // Live allocations, plus one held by the step until FinishStep().
+  std::atomic<int64> live{1};
+  std::atomic<int64> num_allocs{0};
+  std::atomic<int64> largest_alloc_size{0};
+};
+
+class StepArenaAllocator::BlockTable {
+ public:
+  // `capacity` must be a power of two.
+  explicit BlockTable(size_t capacity)
+      : mask_(capacity - 1), slots_(new std::atomic<uintptr_t>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+      slots_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+  // The number of insertions, including erased blocks.
+  size_t size() const { return size_; }
+
+  // `block` must not be in the table, which must not be full.
+  void Insert(uintptr_t block) {
+    slots_[FindSlot(block)].store(block, std::memory_order_release);
+    ++size_;
+  }
+
+  // `block` must be in the table.
+  void Erase(uintptr_t block) {
+    slots_[FindSlot(block)].store(kErased, std::memory_order_release);
+  }
+
+  bool Contains(uintptr_t block) const {
+    return slots_[FindSlot(block)].load(std::memory_order_acquire) == block;
+  }
+
+ private:
+  // Never a block address, since blocks are aligned.
+  static constexpr uintptr_t kErased = 1;
+
+  // Returns the slot holding `block`, or else the empty slot that ends its
+  // probe sequence.
+  size_t FindSlot(uintptr_t block) const {
+    size_t i = Hash64(reinterpret_cast<const char*>(&block), sizeof(block));
+    while (true) {
+      const uintptr_t slot = slots_[i & mask_].load(std::memory_order_acquire);
+      if (slot == block || slot == 0) return i & mask_;
+      ++i;
+    }
+  }
+
+  const size_t mask_;
+  std::unique_ptr<std::atomic<uintptr_t>[]> slots_;
+  size_t size_ = 0;
+};
+
+StepArenaBlockPool::StepArenaBlockPool(size_t block_size, int max_free_blocks)
+    : block_size_(RoundUpToPowerOfTwo(
+          std::max<size_t>(block_size, 2 * Allocator::kAllocatorAlignment))),
+      max_free_blocks_(max_free_blocks) {}
+
+StepArenaBlockPool::~StepArenaBlockPool() {
+  for (void* block : free_blocks_) {
+    port::AlignedFree(block);
+  }
+}
+
+void* StepArenaBlockPool::Get() {
+  {
+    mutex_lock l(mu_);
+    if (!free_blocks_.empty()) {
+      void* block = free_blocks_.back();
+      free_blocks_.pop_back();
+      return block;
+    }
+  }
+  return port::AlignedMalloc(block_size_, block_size_);
+}
+
+void StepArenaBlockPool::Put(void* block) {
+  {
+    mutex_lock l(mu_);
+    if (static_cast<int>(free_blocks_.size()) < max_free_blocks_) {
+      free_blocks_.push_back(block);
+      return;
+    }
+  }
+  port::AlignedFree(block);
+}
+
+StepArenaAllocator::StepArenaAllocator(Allocator* large_allocator,
+                                       size_t block_size,
+                                       size_t max_arena_allocation_bytes)
+    : StepArenaAllocator(large_allocator,
+                         new StepArenaBlockPool(block_size,
+                                                /*max_free_blocks=*/0),
+                         max_arena_allocation_bytes) {
+  // Only this object holds a reference to its private pool.
+  block_pool_->Unref();
+}
+
+StepArenaAllocator::StepArenaAllocator(Allocator* large_allocator,
+                                       StepArenaBlockPool* block_pool,
+                                       size_t max_arena_allocation_bytes)
+    : large_allocator_(large_allocator),
+      block_pool_(block_pool),
+      block_size_(block_pool->block_size()),
+      max_arena_allocation_bytes_(std::min(
+          max_arena_allocation_bytes, block_size_ - kAllocatorAlignment)) {
+  static_assert(sizeof(Block) <= kAllocatorAlignment,
+                "The block header must fit in front of the first allocation");
+  block_pool_->Ref();
+}
+
+StepArenaAllocator::~StepArenaAllocator() { block_pool_->Unref(); }
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  if (num_bytes > max_arena_allocation_bytes_ ||
+      alignment > kAllocatorAlignment) {
+    return AllocateLarge(alignment, num_bytes);
+  }
+  // Every arena allocation is a nonempty multiple of the alignment, so that
+  // it starts within its block.
+  const size_t bytes = std::max<size_t>(
+      (num_bytes + kAllocatorAlignment - 1) & ~(kAllocatorAlignment - 1),
+      kAllocatorAlignment);
+  Block* block = current_.load(std::memory_order_acquire);
+  while (true) {
+    if (block != nullptr) {
+      const size_t offset =
+          block->used.fetch_add(bytes, std::memory_order_relaxed);
+      if (offset + bytes <= block_size_) {
+        block->live.fetch_add(1, std::memory_order_relaxed);
+        block->num_allocs.fetch_add(1, std::memory_order_relaxed);
+        int64 largest =
+            block->largest_alloc_size.load(std::memory_order_relaxed);
+        while (largest < num_bytes &&
+               !block->largest_alloc_size.compare_exchange_weak(
+                   largest, num_bytes, std::memory_order_relaxed)) {
+        }
+        return reinterpret_cast<char*>(block) + offset;
+      }
+    }
+    {
+      mutex_lock l(mu_);
+      if (!finished_) {
+        Block* current = current_.load(std::memory_order_relaxed);
+        // Another thread may have replaced the full block already.
+        if (current == block) current = NewBlockLocked();
+        if (current == nullptr) return nullptr;
+        block = current;
+        continue;
+      }
+    }
+    return AllocateLarge(alignment, num_bytes);
+  }
+}
+
+void* StepArenaAllocator::AllocateLarge(size_t alignment, size_t num_bytes) {
+  void* ptr = large_allocator_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) return nullptr;
+  {
+    mutex_lock l(mu_);
+    large_allocations_.insert(ptr);
+  }
+  // Released by DeallocateRaw().
+  Ref();
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (ptr == nullptr) return;
+  const uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(block_size_ - 1);
+  const BlockTable* table = block_table_.load(std::memory_order_acquire);
+  if (table != nullptr && table->Contains(base)) {
+    // Arena memory is reclaimed when the whole block is.
+    Block* block = reinterpret_cast<Block*>(base);
+    if (block->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      FreeBlock(block);
+    }
+    return;
+  }
+  {
+    mutex_lock l(mu_);
+    const bool erased = large_allocations_.erase(ptr) > 0;
+    DCHECK(erased) << "Deallocating a pointer not allocated by this arena";
+  }
+  large_allocator_->DeallocateRaw(ptr);
+  Unref();
+}
+
+StepArenaAllocator::Block* StepArenaAllocator::NewBlockLocked() {
+  void* memory = block_pool_->Get();
+  if (memory == nullptr) return nullptr;
+  Block* block = new (memory) Block;
+  BlockTable* table = block_table_.load(std::memory_order_relaxed);
+  if (table == nullptr || 2 * (table->size() + 1) > table->capacity()) {
+    // Lookups may still be reading the old table, so the grown one is a copy.
+    auto grown = absl::make_unique<BlockTable>(
+        table == nullptr ? 16 : 2 * table->capacity());
+    for (Block* b : blocks_) {
+      grown->Insert(reinterpret_cast<uintptr_t>(b));
+    }
+    table = grown.get();
+    block_tables_.push_back(std::move(grown));
+  }
+  table->Insert(reinterpret_cast<uintptr_t>(block));
+  block_table_.store(table, std::memory_order_release);
+  blocks_.push_back(block);
+  // Released by FreeBlock().
+  Ref();
+  current_.store(block, std::memory_order_release);
+  return block;
+}
+
+void StepArenaAllocator::FreeBlock(Block* block) {
+  {
+    mutex_lock l(mu_);
+    block_table_.load(std::memory_order_relaxed)
+        ->Erase(reinterpret_cast<uintptr_t>(block));
+  }
+  block->~Block();
+  block_pool_->Put(block);
+  Unref();
+}
+
+void StepArenaAllocator::FinishStep() {
+  std::vector<Block*> blocks;
+  {
+    mutex_lock l(mu_);
+    if (finished_) return;
+    finished_ = true;
+    current_.store(nullptr, std::memory_order_relaxed);
+    for (const Block* block : blocks_) {
+      AddBlockStats(*block, &stats_);
+    }
+    blocks.swap(blocks_);
+  }
+  for (Block* block : blocks) {
+    if (block->live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      FreeBlock(block);
+    }
+  }
+}
+
+void StepArenaAllocator::AddBlockStats(const Block& block,
+                                       AllocatorStats* stats) const {
+  const size_t used =
+      std::min(block.used.load(std::memory_order_relaxed), block_size_);
+  stats->num_allocs += block.num_allocs.load(std::memory_order_relaxed);
+  stats->bytes_in_use += used - kAllocatorAlignment;
+  stats->peak_bytes_in_use = stats->bytes_in_use;
+  stats->largest_alloc_size =
+      std::max(stats->largest_alloc_size,
+               block.largest_alloc_size.load(std::memory_order_relaxed));
+}
+
+absl::optional<AllocatorStats> StepArenaAllocator::GetStats() {
+  mutex_lock l(mu_);
+  AllocatorStats stats = stats_;
+  for (const Block* block : blocks_) {
+    AddBlockStats(*block, &stats);
+  }
+  return stats;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,154 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/gtl/flatset.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class StepArenaBlockPool;
+
+// An allocator for the short-lived intermediate tensors of a single step.
+//
+// Small allocations are bump-allocated from fixed-size blocks without taking
+// a lock, and DeallocateRaw() returns nothing to a block; a block goes back to
+// its StepArenaBlockPool once the step is over and every allocation carved
+// from it is deallocated.
+// Larger allocations are forwarded to the device allocator, which can reuse
+// them across nodes within the step.
+//
+// The allocator is reference counted: the step holds one reference, which it
+// drops after calling FinishStep(), and every block and large allocation
+// holds another, so a tensor that outlives its step keeps its block alive
+// instead of dangling.
+//
+// This class is thread safe.
+class StepArenaAllocator : public Allocator, public core::RefCounted {
+ public:
+  static const size_t kDefaultBlockSize = 256 << 10;
+  static const size_t kDefaultMaxArenaAllocationBytes = 64 << 10;
+
+  // Does not take ownership of `large_allocator`, which must outlive every
+  // tensor allocated from this object. `block_size` is rounded up to a power
+  // of two.
+  explicit StepArenaAllocator(
+      Allocator* large_allocator, size_t block_size = kDefaultBlockSize,
+      size_t max_arena_allocation_bytes = kDefaultMaxArenaAllocationBytes);
+
+  // Like above, but takes its blocks from `block_pool`, which it holds a
+  // reference to, and uses the pool's block size.
+  StepArenaAllocator(
+      Allocator* large_allocator, StepArenaBlockPool* block_pool,
+      size_t max_arena_allocation_bytes = kDefaultMaxArenaAllocationBytes);
+
+  string Name() override { return "step_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+
+  void DeallocateRaw(void* ptr) override;
+
+  absl::optional<AllocatorStats> GetStats() override;
+
+  // Marks the end of the step, after which no allocation may be in flight.
+  // Blocks without live allocations are freed right away, the others as soon
+  // as their last allocation is deallocated. Later allocations are forwarded
+  // to the device allocator.
+  void FinishStep();
+
+ private:
+  // The header at the start of each block. Blocks are aligned to their size,
+  // so the block of an arena allocation is found by masking its address.
+  struct Block;
+  // An open-addressing set of the addresses of this allocator's blocks. Only
+  // modified under mu_ and read without it.
+  class BlockTable;
+
+  ~StepArenaAllocator() override;
+
+  void* AllocateLarge(size_t alignment, size_t num_bytes);
+  Block* NewBlockLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void FreeBlock(Block* block);
+  void AddBlockStats(const Block& block, AllocatorStats* stats) const;
+
+  Allocator* const large_allocator_;
+  StepArenaBlockPool* const block_pool_;
+  const size_t block_size_;
+  const size_t max_arena_allocation_bytes_;
+
+  // The block that allocations are carved from, or nullptr.
+  std::atomic<Block*> current_{nullptr};
+  std::atomic<BlockTable*> block_table_{nullptr};
+
+  mutex mu_;
+  bool finished_ GUARDED_BY(mu_) = false;
+  // The blocks allocated during the step.
+  std::vector<Block*> blocks_ GUARDED_BY(mu_);
+  // Every table published in block_table_. Superseded tables are kept, since
+  // a concurrent lookup may still be reading them.
+  std::vector<std::unique_ptr<BlockTable>> block_tables_ GUARDED_BY(mu_);
+  gtl::FlatSet<void*> large_allocations_ GUARDED_BY(mu_);
+  // The stats of the blocks that are no longer in blocks_.
+  AllocatorStats stats_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaAllocator);
+};
+
+// The free arena blocks of the StepArenaAllocators of successive steps, so
+// that a step reuses the blocks of the steps before it instead of allocating
+// its own. Keeps at most `max_free_blocks` blocks and frees the rest.
+//
+// This class is thread safe.
+class StepArenaBlockPool : public core::RefCounted {
+ public:
+  static const int kDefaultMaxFreeBlocks = 16;
+
+  // `block_size` is rounded up to a power of two.
+  explicit StepArenaBlockPool(
+      size_t block_size = StepArenaAllocator::kDefaultBlockSize,
+      int max_free_blocks = kDefaultMaxFreeBlocks);
+
+  size_t block_size() const { return block_size_; }
+
+  // Returns a block of block_size() bytes, aligned to block_size(), or
+  // nullptr if out of memory.
+  void* Get();
+
+  // Takes back a block returned by Get().
+  void Put(void* block);
+
+ private:
+  ~StepArenaBlockPool() override;
+
+  const size_t block_size_;
+  const int max_free_blocks_;
+
+  mutex mu_;
+  std::vector<void*> free_blocks_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StepArenaBlockPool);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,140 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StepArenaAllocatorTest, AlignedAllocations) {
+  StepArenaAllocator* a = new StepArenaAllocator(cpu_allocator(), 4096);
+  core::ScopedUnref unref(a);
+  std::vector<void*> ptrs;
+  for (int i = 1; i < 100; ++i) {
+    void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, i * 7);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) %
+                     Allocator::kAllocatorAlignment);
+    memset(p, i, i * 7);
+    ptrs.push_back(p);
+  }
+  EXPECT_EQ(99, a->GetStats()->num_allocs);
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+  // The blocks are kept until the end of the step.
+  EXPECT_FALSE(a->RefCountIsOne());
+  a->FinishStep();
+  EXPECT_TRUE(a->RefCountIsOne());
+  EXPECT_EQ(99, a->GetStats()->num_allocs);
+}
+
+TEST(StepArenaAllocatorTest, LargeAllocationsBypassArena) {
+  StepArenaAllocator* a = new StepArenaAllocator(
+      cpu_allocator(), 4096, /*max_arena_allocation_bytes=*/1024);
+  core::ScopedUnref unref(a);
+  void* small = a->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+  void* large = a->AllocateRaw(Allocator::kAllocatorAlignment, 1 << 20);
+  ASSERT_NE(nullptr, small);
+  ASSERT_NE(nullptr, large);
+  memset(large, 0, 1 << 20);
+  // Only the small allocation is carved out of the arena.
+  EXPECT_EQ(1, a->GetStats()->num_allocs);
+  a->DeallocateRaw(large);
+  a->DeallocateRaw(small);
+  a->FinishStep();
+  EXPECT_TRUE(a->RefCountIsOne());
+}
+
+TEST(StepArenaAllocatorTest, BlocksAreReusedAcrossSteps) {
+  StepArenaBlockPool* pool =
+      new StepArenaBlockPool(4096, /*max_free_blocks=*/1);
+  core::ScopedUnref unref_pool(pool);
+  uintptr_t previous_block = 0;
+  for (int step = 0; step < 3; ++step) {
+    StepArenaAllocator* a = new StepArenaAllocator(cpu_allocator(), pool);
+    core::ScopedUnref unref(a);
+    void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 64);
+    ASSERT_NE(nullptr, p);
+    const uintptr_t block = reinterpret_cast<uintptr_t>(p) & ~uintptr_t{4095};
+    if (step > 0) {
+      EXPECT_EQ(previous_block, block);
+    }
+    previous_block = block;
+    a->DeallocateRaw(p);
+    a->FinishStep();
+  }
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  StepArenaAllocator* a = new StepArenaAllocator(cpu_allocator(), 4096);
+  core::ScopedUnref unref(a);
+  const int kThreads = 8;
+  const int kAllocations = 1000;
+  std::vector<std::vector<void*>> ptrs(kThreads);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kThreads);
+    BlockingCounter counter(kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+      pool.Schedule([a, t, &ptrs, &counter]() {
+        for (int i = 0; i < kAllocations; ++i) {
+          void* p = a->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+          CHECK(p != nullptr);
+          memset(p, t, 100);
+          ptrs[t].push_back(p);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  EXPECT_EQ(kThreads * kAllocations, a->GetStats()->num_allocs);
+  // No two allocations overlap.
+  for (int t = 0; t < kThreads; ++t) {
+    for (void* p : ptrs[t]) {
+      const char* c = static_cast<const char*>(p);
+      EXPECT_EQ(std::string(100, t), std::string(c, 100));
+    }
+  }
+  a->FinishStep();
+  for (int t = 0; t < kThreads; ++t) {
+    for (void* p : ptrs[t]) {
+      a->DeallocateRaw(p);
+    }
+  }
+  EXPECT_TRUE(a->RefCountIsOne());
+}
+
+TEST(StepArenaAllocatorTest, TensorOutlivesStep) {
+  StepArenaAllocator* a = new StepArenaAllocator(cpu_allocator());
+  Tensor t(a, DT_FLOAT, TensorShape({2, 3}));
+  t.flat<float>().setConstant(1.5f);
+  EXPECT_FALSE(a->RefCountIsOne());
+  // The step drops its reference; the tensor keeps its block alive.
+  a->FinishStep();
+  a->Unref();
+  test::ExpectTensorEqual<float>(
+      t, test::AsTensor<float>({1.5f, 1.5f, 1.5f, 1.5f, 1.5f, 1.5f},
+                               TensorShape({2, 3})));
+}
+
+}  // namespace
+}  // namespace tensorflow
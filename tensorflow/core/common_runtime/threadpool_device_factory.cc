@@ -38,7 +38,14 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
   Status CreateDevices(const SessionOptions& options, const string& name_prefix,
                        std::vector<std::unique_ptr<Device>>* devices) override {
     int num_numa_nodes = port::NUMANumNodes();
-    int n = 1;
+    const bool use_numa_affinity =
+        options.config.experimental().use_numa_affinity();
+    if (use_numa_affinity && port::NUMAEnabled()) {
+      // Make GetCPUAllocator(numa_node) return node-local allocators.
+      ProcessState::singleton()->EnableNUMA();
+    }
+    // In NUMA mode, default to one CPU device per node.
+    int n = use_numa_affinity ? num_numa_nodes : 1;
     auto iter = options.config.device_count().find("CPU");
     if (iter != options.config.device_count().end()) {
       n = iter->second;
@@ -46,7 +53,7 @@ class ThreadPoolDeviceFactory : public DeviceFactory {
     for (int i = 0; i < n; i++) {
       string name = strings::StrCat(name_prefix, "/device:CPU:", i);
       std::unique_ptr<ThreadPoolDevice> tpd;
-      if (options.config.experimental().use_numa_affinity()) {
+      if (use_numa_affinity) {
         int numa_node = i % num_numa_nodes;
         if (numa_node != i) {
           LOG(INFO) << "Only " << num_numa_nodes
@@ -14,6 +14,13 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/distributed_runtime/tensor_coding.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/worker.pb.h"
@@ -60,6 +67,23 @@ CleanupAllRequest MakeProto(int size) {
   }
   return proto;
 }
+
+// A CPU device to decode tensors with.
+class CpuDevice : public DeviceBase {
+ public:
+  explicit CpuDevice(Env* env) : DeviceBase(env) {
+    attr_.set_device_type("CPU");
+  }
+
+  const DeviceAttributes& attributes() const override { return attr_; }
+
+  Allocator* GetAllocator(AllocatorAttributes attr) override {
+    return cpu_allocator();
+  }
+
+ private:
+  DeviceAttributes attr_;
+};
 }  // namespace
 
 TEST(GrpcProto, Unparse) {
@@ -134,6 +158,25 @@ TEST(GrpcProto, ParseFromString) {
   }
 }
 
+TEST(GrpcByteSource, ParseTensorResponse) {
+  // A 1MB tensor, as received in one slice or in 16KB slices, the default
+  // maximum size of an HTTP/2 frame.
+  Tensor src(DT_FLOAT, TensorShape({1 << 18}));
+  test::FillFn<float>(&src, [](int i) -> float { return i; });
+  RecvTensorResponse proto;
+  src.AsProtoTensorContent(proto.mutable_tensor());
+  const string serialized = proto.SerializeAsString();
+  CpuDevice cpu_device(Env::Default());
+  for (int num_slices : {1, static_cast<int>(serialized.size() >> 14) + 1}) {
+    ::grpc::ByteBuffer buf = MakeBuffer(serialized, num_slices);
+    GrpcByteSource source(&buf);
+    TensorResponse response;
+    response.InitAlloc(&cpu_device, AllocatorAttributes());
+    TF_ASSERT_OK(response.ParseFrom(&source)) << num_slices;
+    test::ExpectTensorEqual<float>(src, response.tensor());
+  }
+}
+
 static void BM_UnparseGrpc(int iters, int size) {
   testing::StopTiming();
   auto proto = MakeProto(size);
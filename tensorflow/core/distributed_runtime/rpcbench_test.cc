@@ -237,6 +237,57 @@ static void BM_RPC(int iters, int width, int tensor_size) {
 }
 BENCHMARK(BM_RPC)->ArgPair(30, 2)->ArgPair(30, 1000)->ArgPair(30, 100000);
 
+// Measures the throughput of RecvTensor between two workers over loopback:
+// each step sends one tensor of "tensor_bytes" bytes from the first worker to
+// the second, which only computes its size.
+static void BM_RecvTensorThroughput(int iters, int tensor_bytes) {
+  testing::StopTiming();
+  const Cluster* cluster = GetCluster();
+
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+
+  Scope s = Scope::NewRootScope();
+  // A constant this large would bloat the graph, so the tensor is filled on
+  // every step instead.
+  Output x = Fill(s.WithOpName("x").WithDevice(cluster->devices[0].name()),
+                  {tensor_bytes / static_cast<int>(sizeof(float))}, 1.0f);
+  /* Output y =*/Size(s.WithOpName("y").WithDevice(cluster->devices[1].name()),
+                      x);
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+
+  // Keeps the graph optimizers from folding the size into a constant.
+  SessionOptions options(cluster->options);
+  options.config.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_opt_level(OptimizerOptions::L0);
+  options.config.mutable_graph_options()
+      ->mutable_rewrite_options()
+      ->set_disable_meta_optimizer(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_CHECK_OK(session->Create(def));
+
+  testing::SetLabel(strings::StrCat("tensor bytes/send: ", tensor_bytes));
+  std::vector<Tensor> outputs;
+  // Do a warmup iteration.
+  TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+
+  testing::StartTiming();
+  for (int i = 0; i < iters; i++) {
+    outputs.clear();
+    TF_CHECK_OK(session->Run({}, {"y:0"}, {}, &outputs));
+    CHECK_EQ(size_t{1}, outputs.size());
+  }
+  testing::StopTiming();
+  testing::BytesProcessed(static_cast<int64>(iters) * tensor_bytes);
+  TF_CHECK_OK(session->Close());
+}
+BENCHMARK(BM_RecvTensorThroughput)
+    ->Arg(1 << 20)
+    ->Arg(16 << 20)
+    ->Arg(256 << 20)
+    ->Arg(1 << 30);
+
 static void BM_SingleDevice(int iters, int width, int num_stages) {
   BM_Helper(iters, width, num_stages, 2 /*tensor_size*/,
             false /*not multi-device*/);
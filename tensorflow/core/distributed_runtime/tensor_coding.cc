@@ -199,9 +199,10 @@ bool TensorResponse::ParseTensorSubmessage(
         Tensor t(allocator_, tensor_meta->dtype(), shape);
         StringPiece buf = t.tensor_data();
         if (static_cast<size_t>(num_bytes) != buf.size()) return false;
-        // TODO(jeff,sanjay): Figure out a way to avoid this copy if
-        // the underlying ZeroCopyInputStream data is properly aligned
-        // and compatible with what allocator_ wants.
+        // The contents are copied once, buffer by buffer, from the input
+        // stream into the allocator's aligned buffer.  They are not shared
+        // with the stream: gRPC receives them in slices of at most 16KB, so
+        // a tensor of any size that matters spans many slices.
         if (!input->ReadRaw(const_cast<char*>(buf.data()), num_bytes))
           return false;
         tensor_ = std::move(t);
@@ -329,13 +329,25 @@ class KnownRatio : public Node {
  public:
   KnownRatio(Node::Args args, int64 ratio) : Node(args), ratio_(ratio) {}
 
+  KnownRatio(Node::Args args, int64 ratio,
+             std::vector<std::shared_ptr<Parameter>> parameters)
+      : Node(args), ratio_(ratio) {
+    for (auto& parameter : parameters) {
+      parameters_[parameter->name] = std::move(parameter);
+    }
+  }
+
   virtual ~KnownRatio() {}
 
  protected:
   std::shared_ptr<Node> Clone(std::shared_ptr<Node> output) const override
       SHARED_LOCKS_REQUIRED(mu_) {
+    std::vector<std::shared_ptr<Parameter>> parameters;
+    for (auto& pair : parameters_) {
+      parameters.push_back(pair.second);
+    }
     return std::make_shared<KnownRatio>(Args{id_, name_, std::move(output)},
-                                        ratio_);
+                                        ratio_, parameters);
   }
 
   // The output time is the sum of the self processing time and the product of
@@ -626,6 +638,44 @@ class Unknown : public Node {
   }
 };
 
+// Appends stages for the subtree rooted in `node` to `report`, with the
+// `latency_share` of each stage set to the total time the stage adds to the
+// time its inputs take to produce all of their elements. Returns the total
+// time that the subtree takes to produce all elements of `node`.
+double AddStages(const std::shared_ptr<Node>& node, PipelineReport* report) {
+  const int index = report->stages_size();
+  PipelineReport::Stage* stage = report->add_stages();
+  stage->set_name(node->long_name());
+  if (node->output()) {
+    stage->set_output(node->output()->long_name());
+  }
+  const int64 num_elements = node->num_elements();
+  stage->set_num_elements(num_elements);
+  stage->set_self_processing_time_nsec(node->SelfProcessingTime());
+  stage->set_buffered_bytes(node->buffered_bytes());
+  stage->set_buffered_elements(node->buffered_elements());
+  for (const auto& pair : node->parameter_values()) {
+    (*stage->mutable_parameters())[pair.first] = pair.second;
+  }
+  std::vector<double> input_times(1, 0);
+  const double output_time =
+      node->OutputTime(&input_times, /*gradient=*/nullptr);
+  stage->set_output_time_nsec(output_time);
+
+  // Weighing the output time of each input by the number of elements it has
+  // produced accounts for the number of input elements per output element.
+  double inputs_total_time = 0;
+  for (const auto& input : node->inputs()) {
+    if (input->autotune()) {
+      inputs_total_time += AddStages(input, report);
+    }
+  }
+  const double total_time = output_time * num_elements;
+  report->mutable_stages(index)->set_latency_share(
+      std::max(total_time - inputs_total_time, 0.0));
+  return total_time;
+}
+
 }  // namespace
 
 std::shared_ptr<Parameter> MakeParameter(const string& name,
@@ -648,6 +698,13 @@ std::shared_ptr<Node> MakeKnownRatioNode(Node::Args args, double ratio) {
   return std::make_shared<KnownRatio>(std::move(args), ratio);
 }
 
+std::shared_ptr<Node> MakeKnownRatioNode(
+    Node::Args args, double ratio,
+    std::vector<std::shared_ptr<Parameter>> parameters) {
+  return std::make_shared<KnownRatio>(std::move(args), ratio,
+                                      std::move(parameters));
+}
+
 std::shared_ptr<Node> MakeAsyncKnownRatioNode(
     Node::Args args, double ratio,
     std::vector<std::shared_ptr<Parameter>> parameters) {
@@ -720,6 +777,9 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64 cpu_budget,
     case AutotuneAlgorithm::GRADIENT_DESCENT:
       OptimizeGradientDescent(cpu_budget, ram_budget);
       break;
+    case AutotuneAlgorithm::STEADY_STATE:
+      OptimizeSteadyState(cpu_budget, ram_budget);
+      break;
   }
 }
 
@@ -777,10 +837,82 @@ void Model::RemoveNode(const string& name) {
   lookup_table_.erase(name);
 }
 
+void Model::Report(PipelineReport* report) {
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock lock(mu_);
+    if (!output_) {
+      return;
+    }
+    snapshot = output_->Snapshot(nullptr);
+  }
+  report->set_timestamp_usec(EnvTime::Default()->NowMicros());
+  report->set_output_time_nsec(OutputTime(snapshot, /*gradient=*/nullptr));
+  AddStages(snapshot, report);
+
+  double total_time = 0;
+  for (const auto& stage : report->stages()) {
+    total_time += stage.latency_share();
+  }
+  const PipelineReport::Stage* bottleneck = nullptr;
+  std::map<string, PipelineReport::Stage*> stages;
+  for (auto& stage : *report->mutable_stages()) {
+    stage.set_latency_share(total_time > 0 ? stage.latency_share() / total_time
+                                           : 0);
+    if (!bottleneck || stage.latency_share() > bottleneck->latency_share()) {
+      bottleneck = &stage;
+    }
+    stages[stage.name()] = &stage;
+  }
+  report->set_bottleneck(bottleneck->name());
+
+  // Follow the inputs with the largest total time from the last stage.
+  Node* node = snapshot.get();
+  while (node) {
+    stages[node->long_name()]->set_on_critical_path(true);
+    Node* slowest_input = nullptr;
+    double slowest_total_time = -1;
+    for (const auto& input : node->inputs()) {
+      if (!input->autotune()) {
+        continue;
+      }
+      const PipelineReport::Stage& stage = *stages[input->long_name()];
+      const double input_total_time =
+          stage.output_time_nsec() * stage.num_elements();
+      if (input_total_time > slowest_total_time) {
+        slowest_total_time = input_total_time;
+        slowest_input = input.get();
+      }
+    }
+    node = slowest_input;
+  }
+}
+
 std::map<string, std::shared_ptr<Parameter>> Model::CollectTunableParameters(
     std::shared_ptr<Node> node) {
   std::map<string, std::shared_ptr<Parameter>> parameters;
   node->CollectTunableParameters(&parameters);
+  for (auto it = parameters.begin(); it != parameters.end();) {
+    if (it->second->name == kThreadPoolSize) {
+      it = parameters.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return parameters;
+}
+
+std::map<string, std::shared_ptr<Parameter>> Model::CollectThreadPoolSizes(
+    std::shared_ptr<Node> node) {
+  std::map<string, std::shared_ptr<Parameter>> parameters;
+  node->CollectTunableParameters(&parameters);
+  for (auto it = parameters.begin(); it != parameters.end();) {
+    if (it->second->name != kThreadPoolSize) {
+      it = parameters.erase(it);
+    } else {
+      ++it;
+    }
+  }
   return parameters;
 }
 
@@ -951,6 +1083,127 @@ void Model::OptimizeHillClimb(int64 cpu_budget, int64 ram_budget) {
   }
 }
 
+void Model::OptimizeSteadyState(int64 cpu_budget, int64 ram_budget) {
+  std::shared_ptr<Node> snapshot;
+  {
+    tf_shared_lock lock(mu_);
+    snapshot = output_->Snapshot(nullptr);
+  }
+  VLOG(2) << "Starting optimization of tunable parameters with SteadyState";
+  const double processing_time = TotalProcessingTime(snapshot);
+  const double target_output_time = processing_time / cpu_budget;
+  auto parameters = CollectTunableParameters(snapshot);
+  // We add the number of model's buffered bytes because it is excluded from the
+  // memory budget, but it is included in the maximum number of buffered bytes.
+  const double ram_limit =
+      std::max<double>(ram_budget + TotalBufferedBytes(snapshot), 1.0L);
+  // Thread pool sizes do not affect the modeled output time, so they are not
+  // part of the search.
+  auto thread_pool_sizes = CollectThreadPoolSizes(snapshot);
+  auto total_parallelism = [&parameters]() {
+    double result = 0;
+    for (auto& pair : parameters) {
+      if (pair.second->name == kParallelism) {
+        result += pair.second->value;
+      }
+    }
+    return result;
+  };
+
+  // The new values are only applied if they improve the output time of the
+  // current values by more than this fraction.
+  constexpr double kHysteresis = 0.1L;
+  // Buffer size parameter will only be incremented if the output latency
+  // improvement is greater than this constant.
+  constexpr double kBufferSizeMinDelta = 1.0L;
+  // Lower bound on the budget share of an increment, so that increments
+  // which do not use measurable memory are still ranked by their improvement.
+  constexpr double kMinStepCost = 1e-6L;
+
+  // Evaluate the values that are currently in use.
+  for (auto& pair : parameters) {
+    auto& parameter = pair.second;
+    double value;
+    {
+      mutex_lock l(*parameter->state->mu);
+      value = parameter->state->value;
+    }
+    parameter->value = std::min(std::max(value, parameter->min), parameter->max);
+  }
+  const double current_output_time = OutputTime(snapshot, /*gradient=*/nullptr);
+  const bool current_within_budget =
+      total_parallelism() <= cpu_budget &&
+      TotalMaximumBufferedBytes(snapshot) <= ram_limit;
+
+  for (auto& pair : parameters) {
+    pair.second->value = pair.second->min;
+  }
+  double output_time = OutputTime(snapshot, /*gradient=*/nullptr);
+  double parallelism = total_parallelism();
+  double buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+  while (output_time > target_output_time) {
+    double best_gain = 0;
+    Parameter* best_parameter = nullptr;
+    for (auto& pair : parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value + 1 > parameter->max) {
+        continue;
+      }
+      const bool is_parallelism = parameter->name == kParallelism;
+      if (is_parallelism && parallelism + 1 > cpu_budget) {
+        continue;
+      }
+      parameter->value++;
+      const double new_output_time = OutputTime(snapshot, /*gradient=*/nullptr);
+      const double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      parameter->value--;
+      const double delta = output_time - new_output_time;
+      if (new_buffered_bytes > ram_limit || delta <= 0 ||
+          (!is_parallelism && delta <= kBufferSizeMinDelta)) {
+        continue;
+      }
+      double cost = is_parallelism ? 1.0L / cpu_budget : 0.0L;
+      cost += std::max(new_buffered_bytes - buffered_bytes, 0.0) / ram_limit;
+      const double gain = delta / std::max(cost, kMinStepCost);
+      if (gain > best_gain) {
+        best_gain = gain;
+        best_parameter = parameter;
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value++;
+    output_time = OutputTime(snapshot, /*gradient=*/nullptr);
+    parallelism = total_parallelism();
+    buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+  }
+
+  if (current_within_budget &&
+      current_output_time - output_time <= kHysteresis * current_output_time) {
+    VLOG(2) << "Keeping the current values of tunable parameters; the new "
+               "output time "
+            << output_time << " does not improve on " << current_output_time
+            << " by enough.";
+    return;
+  }
+  for (auto& pair : thread_pool_sizes) {
+    const double limit = std::min<double>(pair.second->max, cpu_budget);
+    pair.second->value =
+        std::max(pair.second->min, std::min(std::round(parallelism), limit));
+    parameters.insert(pair);
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size();
+  for (auto& pair : parameters) {
+    auto& parameter = pair.second;
+    VLOG(2) << "Setting tunable parameter " << pair.first << " to "
+            << parameter->value;
+    mutex_lock l(*parameter->state->mu);
+    parameter->state->value = parameter->value;
+    parameter->state->cond_var->notify_all();
+  }
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node,
                          std::map<string, double>* gradient) {
   std::vector<double> input_times(1, 0);
@@ -23,6 +23,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/framework/model.pb.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
@@ -39,10 +40,12 @@ namespace model {
 constexpr int64 kAutotune = -1;
 constexpr char kParallelism[] = "parallelism";
 constexpr char kBufferSize[] = "buffer_size";
+constexpr char kThreadPoolSize[] = "thread_pool_size";
 
 enum class AutotuneAlgorithm {
   HILL_CLIMB = 0,
   GRADIENT_DESCENT = 1,
+  STEADY_STATE = 2,
 };
 
 // Represents thread-safe state that can be shared between an input pipeline and
@@ -191,6 +194,22 @@ class Node {
   // Returns the node output.
   Node* output() const { return output_; }
 
+  // Returns the current values of the node parameters, keyed by name.
+  std::map<string, double> parameter_values() const LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    std::map<string, double> result;
+    for (const auto& pair : parameters_) {
+      const SharedState& state = *pair.second->state;
+      if (state.mu) {
+        mutex_lock l2(*state.mu);
+        result[pair.first] = state.value;
+      } else {
+        result[pair.first] = state.value;
+      }
+    }
+    return result;
+  }
+
   // Returns the aggregate processing time.
   int64 processing_time() const LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
@@ -529,6 +548,13 @@ std::shared_ptr<Node> MakeAsyncInterleaveManyNode(
 // input element per output element.
 std::shared_ptr<Node> MakeKnownRatioNode(Node::Args args, double ratio);
 
+// Same as above, but the node also holds the given parameters. This is used by
+// datasets whose parameters do not affect the output time of the node itself,
+// such as the size of a private thread pool.
+std::shared_ptr<Node> MakeKnownRatioNode(
+    Node::Args args, double ratio,
+    std::vector<std::shared_ptr<Parameter>> parameters);
+
 // AsyncKnownRatio nodes are the asynchronous version of KnownRate nodes.
 std::shared_ptr<Node> MakeAsyncKnownRatioNode(
     Node::Args args, double ratio,
@@ -605,12 +631,23 @@ class Model {
   // Removes the given node.
   void RemoveNode(const string& name) LOCKS_EXCLUDED(mu_);
 
+  // Fills `report` with a breakdown of the output latency of the input
+  // pipeline across its nodes.
+  void Report(PipelineReport* report) LOCKS_EXCLUDED(mu_);
+
  private:
   // Collects tunable parameters in the tree rooted in the given node, returning
-  // a mapping from a (unique) node name to a tunable parameter.
+  // a mapping from a (unique) node name to a tunable parameter. Thread pool
+  // size parameters are excluded: they do not affect the modeled output time,
+  // so only `OptimizeSteadyState` sets them, from the parallelism it chooses.
   std::map<string, std::shared_ptr<Parameter>> CollectTunableParameters(
       std::shared_ptr<Node> node);
 
+  // Collects the thread pool size parameters in the tree rooted in the given
+  // node, returning a mapping from a (unique) node name to a parameter.
+  std::map<string, std::shared_ptr<Parameter>> CollectThreadPoolSizes(
+      std::shared_ptr<Node> node);
+
   // Collects "essential" parallelism parameters of transformations in the tree
   // rooted in the given node. Which parameters are essential is determined by
   // comparison the processing time spent in the corresponding transformation
@@ -636,6 +673,20 @@ class Model {
   // an element divided by CPU budget.
   void OptimizeGradientDescent(int64 cpu_budget, int64 ram_budget);
 
+  // This optimization algorithm tunes parallelism and buffer size parameters
+  // together. Starting from the minimum values, it repeatedly increments the
+  // parameter with the largest decrease in output time per share of the CPU
+  // and memory budget that the increment consumes, skipping increments that
+  // would exceed either budget. This is repeated until the output time reaches
+  // the steady-state target -- the processing time needed to produce an
+  // element divided by CPU budget -- or no increment helps. Thread pool size
+  // parameters are then set to the total parallelism that was chosen.
+  //
+  // To avoid oscillating between similar configurations, the new values are
+  // only applied if they improve the output time of the current values by a
+  // margin or if the current values exceed a budget.
+  void OptimizeSteadyState(int64 cpu_budget, int64 ram_budget);
+
   // Collects the output time and if `gradient` is not `nullptr`, the output
   // time gradient w.r.t. tunable parameters of the subtree rooted in the given
   // node and the last input time.
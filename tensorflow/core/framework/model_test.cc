@@ -727,6 +727,137 @@ TEST(UnknownGradientTest, Model) {
               (new_output_time - output_time) / kParameterStep,
               kComparisonPrecision);
 }
+
+class SteadyStateTest : public ::testing::Test {
+ protected:
+  // Builds a model of a private thread pool over a map that takes 100 time
+  // units per element, over a source.
+  SteadyStateTest() : model_([](std::shared_ptr<Node>) {}) {
+    thread_pool_size_ = MakeState();
+    parallelism_ = MakeState();
+    model_.AddNode(
+        [this](Node::Args args) {
+          return model::MakeKnownRatioNode(
+              std::move(args), 1,
+              {model::MakeParameter(kThreadPoolSize, thread_pool_size_, 1,
+                                    16)});
+        },
+        "thread_pool", "");
+    std::shared_ptr<Node> map = model_.AddNode(
+        [this](Node::Args args) {
+          return model::MakeAsyncKnownRatioNode(
+              std::move(args), 1,
+              {model::MakeParameter(kParallelism, parallelism_, 1, 16)});
+        },
+        "thread_pool::map", "thread_pool");
+    model_.AddNode(
+        [](Node::Args args) { return model::MakeSourceNode(std::move(args)); },
+        "thread_pool::map::source", "thread_pool::map");
+    for (int i = 0; i < 100; ++i) {
+      map->record_element();
+    }
+    map->add_processing_time(100 * 100);
+  }
+
+  static std::shared_ptr<SharedState> MakeState() {
+    return std::make_shared<SharedState>(kAutotune, std::make_shared<mutex>(),
+                                         std::make_shared<condition_variable>());
+  }
+
+  Model model_;
+  std::shared_ptr<SharedState> thread_pool_size_;
+  std::shared_ptr<SharedState> parallelism_;
+};
+
+TEST_F(SteadyStateTest, StopsAtCpuBudget) {
+  model_.Optimize(AutotuneAlgorithm::STEADY_STATE, /*cpu_budget=*/4,
+                  /*ram_budget=*/1 << 20);
+  EXPECT_EQ(4, parallelism_->value);
+  EXPECT_EQ(4, thread_pool_size_->value);
+}
+
+TEST_F(SteadyStateTest, KeepsValuesThatAreGoodEnough) {
+  parallelism_->value = 4;
+  thread_pool_size_->value = 7;
+  model_.Optimize(AutotuneAlgorithm::STEADY_STATE, /*cpu_budget=*/4,
+                  /*ram_budget=*/1 << 20);
+  EXPECT_EQ(4, parallelism_->value);
+  EXPECT_EQ(7, thread_pool_size_->value);
+}
+
+TEST_F(SteadyStateTest, OtherAlgorithmsKeepThreadPoolSize) {
+  // A thread pool size does not affect the modeled output time, so the other
+  // algorithms would shrink it to the minimum if they tuned it.
+  for (auto algorithm :
+       {AutotuneAlgorithm::HILL_CLIMB, AutotuneAlgorithm::GRADIENT_DESCENT}) {
+    parallelism_->value = 1;
+    thread_pool_size_->value = 16;
+    model_.Optimize(algorithm, /*cpu_budget=*/4, /*ram_budget=*/1 << 20);
+    EXPECT_EQ(16, thread_pool_size_->value);
+  }
+}
+
+TEST_F(SteadyStateTest, ReplacesValuesOverBudget) {
+  parallelism_->value = 16;
+  thread_pool_size_->value = 16;
+  model_.Optimize(AutotuneAlgorithm::STEADY_STATE, /*cpu_budget=*/4,
+                  /*ram_budget=*/1 << 20);
+  EXPECT_EQ(4, parallelism_->value);
+  EXPECT_EQ(4, thread_pool_size_->value);
+}
+
+TEST(ReportTest, Model) {
+  Model model([](std::shared_ptr<Node>) {});
+  auto add_node = [&model](const string& name, const string& output,
+                           double ratio, int64 processing_time) {
+    std::shared_ptr<Node> node = model.AddNode(
+        [ratio](Node::Args args) {
+          return model::MakeKnownRatioNode(std::move(args), ratio);
+        },
+        name, output);
+    for (int i = 0; i < 100; ++i) {
+      node->record_element();
+    }
+    node->add_processing_time(100 * processing_time);
+  };
+  add_node("root", "", 1, 10);
+  add_node("root::map", "root", 1, 100);
+  add_node("root::map::source", "root::map", 0, 30);
+  add_node("root::other", "root", 0, 5);
+
+  PipelineReport report;
+  model.Report(&report);
+  ASSERT_EQ(4, report.stages_size());
+  EXPECT_EQ(145, report.output_time_nsec());
+  EXPECT_EQ("map(id:2)", report.bottleneck());
+
+  std::map<string, const PipelineReport::Stage*> stages;
+  for (const auto& stage : report.stages()) {
+    stages[stage.name()] = &stage;
+  }
+  const PipelineReport::Stage& root = *stages["root(id:1)"];
+  EXPECT_EQ("", root.output());
+  EXPECT_EQ(145, root.output_time_nsec());
+  EXPECT_NEAR(1000.0 / 14500, root.latency_share(), 1e-9);
+  EXPECT_TRUE(root.on_critical_path());
+
+  const PipelineReport::Stage& map = *stages["map(id:2)"];
+  EXPECT_EQ("root(id:1)", map.output());
+  EXPECT_EQ(100, map.num_elements());
+  EXPECT_EQ(100, map.self_processing_time_nsec());
+  EXPECT_EQ(130, map.output_time_nsec());
+  EXPECT_NEAR(10000.0 / 14500, map.latency_share(), 1e-9);
+  EXPECT_TRUE(map.on_critical_path());
+
+  const PipelineReport::Stage& source = *stages["source(id:3)"];
+  EXPECT_NEAR(3000.0 / 14500, source.latency_share(), 1e-9);
+  EXPECT_TRUE(source.on_critical_path());
+
+  const PipelineReport::Stage& other = *stages["other(id:4)"];
+  EXPECT_NEAR(500.0 / 14500, other.latency_share(), 1e-9);
+  EXPECT_FALSE(other.on_critical_path());
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
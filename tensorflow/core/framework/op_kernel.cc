@@ -706,10 +706,20 @@ Status OpKernelContext::allocate_output(StringPiece name,
   return allocate_output(start, shape, tensor, attr);
 }
 
+bool OpKernelContext::can_use_step_arena(DataType type,
+                                         AllocatorAttributes attr) {
+  if (params_->step_arena_allocator == nullptr) return false;
+  if (attr.value != 0 || attr.scope_id > 0) return false;
+  return !track_allocations() && DataTypeCanUseMemcpy(type);
+}
+
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
-    AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+    AllocatorAttributes attr, const AllocationAttributes& allocation_attr,
+    bool allow_step_arena) {
+  Allocator* a = allow_step_arena && can_use_step_arena(type, attr)
+                     ? params_->step_arena_allocator
+                     : get_allocator(attr);
   MEMDEBUG_CACHE_OP(op_kernel().name().c_str());
   MEMDEBUG_CACHE_STEPID(step_id());
   Tensor new_tensor(a, type, shape,
@@ -767,7 +777,9 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
     }
   }
   auto output_tensor = MakeUnique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Status s = allocate_tensor(type, shape, output_tensor.get(), attr,
+                             AllocationAttributes(),
+                             /*allow_step_arena=*/true);
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
@@ -795,8 +807,8 @@ Status OpKernelContext::allocate_temp(
             << ".  Switch to allocate_output to avoid performance penalty.";
     allocator_attr.scope_id = -1;
   }
-  Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+  Status s = allocate_tensor(type, shape, out_temp, allocator_attr,
+                             allocation_attr, /*allow_step_arena=*/true);
   if (track_allocations() && s.ok() && out_temp->TotalBytes() > 0) {
     Allocator* a = get_allocator(allocator_attr);
     if (a->TracksAllocationSizes()) {
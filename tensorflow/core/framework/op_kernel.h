@@ -670,6 +670,12 @@ class OpKernelContext {
     // stored in this container..
     ScopedStepContainer* step_container = nullptr;
 
+    // If non-null, outputs and temporaries with default allocator attributes
+    // are allocated from this per-step arena instead of the device
+    // allocator. The executor only sets it for kernels whose outputs are known
+    // not to escape the step. Not owned.
+    Allocator* step_arena_allocator = nullptr;
+
     // Mechanism used by this op kernel invocation to communicate with
     // computations running on other devices.
     Rendezvous* rendezvous = nullptr;
@@ -1309,7 +1315,12 @@ class OpKernelContext {
 
   Status allocate_tensor(DataType type, const TensorShape& shape,
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
-                         const AllocationAttributes& allocation_attr);
+                         const AllocationAttributes& allocation_attr,
+                         bool allow_step_arena = false);
+
+  // Returns true if a tensor of `type` allocated with `attr` may be served
+  // from params_->step_arena_allocator.
+  bool can_use_step_arena(DataType type, AllocatorAttributes attr);
 
   // Initialize the allocated_scope_ids_ set the first time this method is
   // called.
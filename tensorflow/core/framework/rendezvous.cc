@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <utility>
@@ -45,6 +46,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  slot = b.slot;
   return *this;
 }
 
@@ -152,6 +154,9 @@ class LocalRendezvousImpl : public Rendezvous {
 
   Status Send(const ParsedKey& key, const Args& send_args, const Tensor& val,
               const bool is_dead) override {
+    if (key.slot >= 0 && key.slot < kMaxSlots) {
+      return SendToSlot(key, send_args, val, is_dead);
+    }
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
@@ -204,6 +209,10 @@ class LocalRendezvousImpl : public Rendezvous {
 
   void RecvAsync(const ParsedKey& key, const Args& recv_args,
                  DoneCallback done) override {
+    if (key.slot >= 0 && key.slot < kMaxSlots) {
+      RecvFromSlot(key, recv_args, std::move(done));
+      return;
+    }
     uint64 key_hash = KeyHash(key.FullKey());
     VLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
 
@@ -313,10 +322,29 @@ class LocalRendezvousImpl : public Rendezvous {
   void StartAbort(const Status& status) override {
     CHECK(!status.ok());
     Table table;
+    std::vector<Item*> slot_items;
     {
       mutex_lock l(mu_);
       status_.Update(status);
       table_.swap(table);
+      // New chunks are only created while holding mu_ and status_ is ok, so
+      // every slot that can still be used is marked here.
+      for (auto& chunk_ptr : slot_chunks_) {
+        SlotChunk* chunk = chunk_ptr.load(std::memory_order_acquire);
+        if (chunk == nullptr) continue;
+        for (auto& slot : chunk->slots) {
+          Item* item = slot.exchange(AbortedSlot(), std::memory_order_acq_rel);
+          if (item != nullptr && item != AbortedSlot()) {
+            slot_items.push_back(item);
+          }
+        }
+      }
+    }
+    for (Item* item : slot_items) {
+      if (!item->IsSendValue()) {
+        item->waiter(status, Args(), Args(), Tensor(), false);
+      }
+      delete item;
     }
     for (auto& p : table) {
       for (Item* item : p.second) {
@@ -366,15 +394,165 @@ class LocalRendezvousImpl : public Rendezvous {
   typedef std::deque<Item*> ItemQueue;
   typedef gtl::FlatMap<uint64, ItemQueue> Table;
 
+  // Keys with a preassigned slot bypass table_: each slot holds at most one
+  // pending item, which the counterpart Send or Recv takes out with a single
+  // compare-and-swap. Chunks of slots are created on first use.
+  static constexpr int64 kSlotsPerChunk = 512;
+  static constexpr int64 kMaxSlotChunks = 512;
+  static constexpr int64 kMaxSlots = kSlotsPerChunk * kMaxSlotChunks;
+
+  struct SlotChunk {
+    std::atomic<Item*> slots[kSlotsPerChunk];
+    SlotChunk() {
+      for (auto& slot : slots) slot.store(nullptr, std::memory_order_relaxed);
+    }
+  };
+
+  // Stored in every slot once the rendezvous is aborted.
+  static Item* AbortedSlot() { return reinterpret_cast<Item*>(1); }
+
+  // Returns the slot for "key", creating its chunk if needed, or nullptr if
+  // the rendezvous has been aborted.
+  std::atomic<Item*>* GetSlot(const ParsedKey& key) {
+    std::atomic<SlotChunk*>& chunk_ptr =
+        slot_chunks_[key.slot / kSlotsPerChunk];
+    SlotChunk* chunk = chunk_ptr.load(std::memory_order_acquire);
+    if (TF_PREDICT_FALSE(chunk == nullptr)) {
+      mutex_lock l(mu_);
+      if (!status_.ok()) return nullptr;
+      chunk = chunk_ptr.load(std::memory_order_relaxed);
+      if (chunk == nullptr) {
+        chunk = new SlotChunk;
+        chunk_ptr.store(chunk, std::memory_order_release);
+      }
+    }
+    return &chunk->slots[key.slot % kSlotsPerChunk];
+  }
+
+  Status AbortStatus() {
+    mutex_lock l(mu_);
+    return status_;
+  }
+
+  // Either leaves "item" in "slot" and returns nullptr, or takes the item of
+  // the opposite kind that is waiting there and returns it. Sets "*status"
+  // if the rendezvous was aborted or "slot" already holds an item of the
+  // same kind.
+  Item* ExchangeSlot(const ParsedKey& key, Item* item, Status* status) {
+    std::atomic<Item*>* slot = GetSlot(key);
+    if (slot == nullptr) {
+      *status = AbortStatus();
+      return nullptr;
+    }
+    Item* current = slot->load(std::memory_order_acquire);
+    while (true) {
+      if (current == AbortedSlot()) {
+        *status = AbortStatus();
+        return nullptr;
+      }
+      if (current == nullptr) {
+        if (slot->compare_exchange_weak(current, item,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+          return nullptr;
+        }
+      } else if (current->IsSendValue() == item->IsSendValue()) {
+        *status = errors::Internal(
+            "More than one outstanding ",
+            item->IsSendValue() ? "Send" : "Recv", " for rendezvous slot ",
+            key.slot, " (key: ", key.FullKey(), ")");
+        return nullptr;
+      } else if (slot->compare_exchange_weak(current, nullptr,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+        return current;
+      }
+    }
+  }
+
+  Status SendToSlot(const ParsedKey& key, const Args& send_args,
+                    const Tensor& val, const bool is_dead) {
+    VLOG(2) << "Send " << this << " slot " << key.slot << " "
+            << key.FullKey();
+    Item* item = new Item;
+    item->value = val;
+    item->is_dead = is_dead;
+    item->send_args = send_args;
+    if (item->send_args.device_context) {
+      item->send_args.device_context->Ref();
+    }
+    Status s;
+    Item* waiter = ExchangeSlot(key, item, &s);
+    if (waiter == nullptr) {
+      // Either the item is now waiting in the slot, or it was rejected.
+      if (!s.ok()) delete item;
+      return s;
+    }
+    DCHECK(!waiter->IsSendValue());
+    waiter->waiter(Status::OK(), send_args, waiter->recv_args, val, is_dead);
+    delete waiter;
+    delete item;
+    return Status::OK();
+  }
+
+  // Slots are only assigned to the Send/Recv pairs of partitioned graphs,
+  // whose Recvs are not individually cancellable: pending receivers are
+  // failed by StartAbort() instead.
+  void RecvFromSlot(const ParsedKey& key, const Args& recv_args,
+                    DoneCallback done) {
+    VLOG(2) << "Recv " << this << " slot " << key.slot << " "
+            << key.FullKey();
+    CancellationManager* cm = recv_args.cancellation_manager;
+    if (cm != nullptr && cm->IsCancelled()) {
+      done(StatusGroup::MakeDerived(
+               errors::Cancelled("RecvAsync is cancelled.")),
+           Args(), recv_args, Tensor(), /*is_dead=*/false);
+      return;
+    }
+    Item* item = new Item;
+    item->waiter = std::move(done);
+    item->recv_args = recv_args;
+    if (item->recv_args.device_context) {
+      item->recv_args.device_context->Ref();
+    }
+    Status s;
+    Item* sent = ExchangeSlot(key, item, &s);
+    if (sent == nullptr) {
+      if (!s.ok()) {
+        item->waiter(s, Args(), recv_args, Tensor(), false);
+        delete item;
+      }
+      return;
+    }
+    DCHECK(sent->IsSendValue());
+    item->waiter(Status::OK(), sent->send_args, recv_args, sent->value,
+                 sent->is_dead);
+    delete sent;
+    delete item;
+  }
+
   // TODO(zhifengc): shard table_.
   mutex mu_;
   Table table_ GUARDED_BY(mu_);
   Status status_ GUARDED_BY(mu_);
+  std::atomic<SlotChunk*> slot_chunks_[kMaxSlotChunks] = {};
 
   ~LocalRendezvousImpl() override {
-    if (!table_.empty()) {
+    bool has_pending_items = !table_.empty();
+    for (auto& chunk_ptr : slot_chunks_) {
+      SlotChunk* chunk = chunk_ptr.load(std::memory_order_acquire);
+      if (chunk == nullptr) continue;
+      for (auto& slot : chunk->slots) {
+        Item* item = slot.load(std::memory_order_relaxed);
+        has_pending_items |= (item != nullptr && item != AbortedSlot());
+      }
+    }
+    if (has_pending_items) {
       StartAbort(errors::Cancelled("LocalRendezvousImpl deleted"));
     }
+    for (auto& chunk_ptr : slot_chunks_) {
+      delete chunk_ptr.load(std::memory_order_relaxed);
+    }
   }
 
   TF_DISALLOW_COPY_AND_ASSIGN(LocalRendezvousImpl);
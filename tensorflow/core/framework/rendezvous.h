@@ -69,6 +69,12 @@ class Rendezvous : public core::RefCounted {
     DeviceNameUtils::ParsedName dst;
     StringPiece edge_name;
 
+    // If non-negative, an index assigned to this key when the graph was
+    // partitioned (see PartitionOptions::assign_rendezvous_slots). Keys with
+    // a slot may be matched by index instead of by their string form, in
+    // which case at most one Send or Recv may be outstanding per slot.
+    int64 slot = -1;
+
     ParsedKey() {}
     ParsedKey(const ParsedKey& b) { *this = b; }
 
@@ -116,6 +116,12 @@ const Rendezvous::ParsedKey& KeyBar() {
   return key;
 }
 
+Rendezvous::ParsedKey MakeSlotKey(const string& name, int64 slot) {
+  Rendezvous::ParsedKey k = MakeKey(name);
+  k.slot = slot;
+  return k;
+}
+
 TEST_F(LocalRendezvousTest, SendRecv) {
   Rendezvous::Args args;
   TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V("hello"), false));
@@ -394,6 +400,72 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
       errors::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+TEST_F(LocalRendezvousTest, SlotSendRecv) {
+  const Rendezvous::ParsedKey key = MakeSlotKey("foo", 3);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(key, args, V("hello"), false));
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  TF_ASSERT_OK(rendez_->Recv(key, args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+  // The slot can be reused once it is drained.
+  TF_ASSERT_OK(rendez_->Send(key, args, V("again"), true));
+  TF_ASSERT_OK(rendez_->Recv(key, args, &val, &is_dead));
+  EXPECT_EQ("again", V(val));
+  EXPECT_TRUE(is_dead);
+}
+
+TEST_F(LocalRendezvousTest, SlotRecvSend) {
+  const Rendezvous::ParsedKey key = MakeSlotKey("foo", 100000);
+  SchedClosure([this, key]() {
+    Env::Default()->SleepForMicroseconds(10000);
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(key, args, V("hello"), false));
+  });
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Recv(key, args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+}
+
+TEST_F(LocalRendezvousTest, SlotsAreIndependentOfKeyTable) {
+  // A key sent by slot and by name is two different channels.
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(MakeSlotKey("foo", 0), args, V("slot"), false));
+  TF_ASSERT_OK(rendez_->Send(KeyFoo(), args, V("table"), false));
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  TF_ASSERT_OK(rendez_->Recv(KeyFoo(), args, &val, &is_dead));
+  EXPECT_EQ("table", V(val));
+  TF_ASSERT_OK(rendez_->Recv(MakeSlotKey("foo", 0), args, &val, &is_dead));
+  EXPECT_EQ("slot", V(val));
+}
+
+TEST_F(LocalRendezvousTest, SlotDuplicateSend) {
+  const Rendezvous::ParsedKey key = MakeSlotKey("foo", 7);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(key, args, V("hello"), false));
+  EXPECT_TRUE(errors::IsInternal(rendez_->Send(key, args, V("hello"), false)));
+}
+
+TEST_F(LocalRendezvousTest, SlotRecvAbort) {
+  rendez_->Ref();
+  SchedClosure([this]() {
+    Env::Default()->SleepForMicroseconds(10000);
+    rendez_->StartAbort(errors::Aborted(""));
+    rendez_->Unref();
+  });
+  Tensor val(DT_STRING);
+  bool val_dead = false;
+  Rendezvous::Args args;
+  Status status = rendez_->Recv(MakeSlotKey("foo", 1), args, &val, &val_dead);
+  EXPECT_TRUE(errors::IsAborted(status));
+  // Slots in chunks that did not exist before the abort fail too.
+  EXPECT_TRUE(errors::IsAborted(
+      rendez_->Send(MakeSlotKey("foo", 200000), args, val, val_dead)));
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -434,6 +506,17 @@ TEST_F(LocalRendezvousTest, TransferDummyDeviceContext) {
   args1.device_context->Unref();
 }
 
+TEST_F(LocalRendezvousTest, SlotPendingSendDeleted) {
+  Rendezvous* rendez = NewLocalRendezvous();
+  Rendezvous::Args args;
+  args.device_context = new DummyDeviceContext(1);
+  TF_ASSERT_OK(rendez->Send(MakeSlotKey("foo", 2), args, V("hello"), false));
+  // Releases the pending item and its device context reference.
+  rendez->Unref();
+  EXPECT_TRUE(args.device_context->RefCountIsOne());
+  args.device_context->Unref();
+}
+
 void BM_SendRecv(int iters) {
   Rendezvous* rendez = NewLocalRendezvous();
   Tensor orig = V("val");
@@ -451,6 +534,24 @@ void BM_SendRecv(int iters) {
 }
 BENCHMARK(BM_SendRecv);
 
+void BM_SendRecvSlot(int iters) {
+  Rendezvous* rendez = NewLocalRendezvous();
+  const Rendezvous::ParsedKey key = MakeSlotKey("foo", 0);
+  Tensor orig = V("val");
+  Tensor val(DT_STRING, TensorShape({}));
+  bool is_dead = false;
+  Rendezvous::Args args;
+  if (iters > 0) {
+    while (iters--) {
+      TF_CHECK_OK(rendez->Send(key, args, orig, is_dead));
+      TF_CHECK_OK(rendez->Recv(key, args, &val, &is_dead));
+    }
+    CHECK_EQ(V(val), V(orig));
+  }
+  rendez->Unref();
+}
+BENCHMARK(BM_SendRecvSlot);
+
 void BM_PingPong(int iters) {
   CHECK_GT(iters, 0);
   auto* cm = new CancellationManager();
@@ -23,6 +23,8 @@ limitations under the License.
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/run_handler_util.h"
 #include "tensorflow/core/lib/core/threadpool_interface.h"
+#include "tensorflow/core/lib/monitoring/gauge.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/context.h"
 #include "tensorflow/core/platform/denormal.h"
@@ -37,6 +39,19 @@ namespace tensorflow {
 namespace {
 static constexpr int32 kMaxConcurrentHandlers = 128;
 
+auto* run_handler_queue_depth = monitoring::Gauge<int64, 1>::New(
+    "/tensorflow/core/run_handler/queue_depth",
+    "The number of Session::Run() calls waiting for a RunHandler.",
+    "priority");
+
+auto* run_handler_wait_time_usecs = monitoring::Sampler<1>::New(
+    {"/tensorflow/core/run_handler/wait_time_usecs",
+     "The time Session::Run() calls spent waiting for a RunHandler, in "
+     "microseconds.",
+     "priority"},
+    // Power of 2 with bucket count 24 (> 16 seconds)
+    {monitoring::Buckets::Exponential(1, 2, 24)});
+
 // TODO(azaks): Refactor with thread:ThreadPool
 class RunHandlerEnvironment {
   typedef Thread EnvThread;
@@ -589,10 +604,14 @@ class RunHandler::Impl {
   // requested via RunHandlerPool::Get().
   uint64 start_time_us() const { return start_time_us_; }
   int64 step_id() const { return step_id_; }
+  int64 priority() const { return priority_; }
+  // Soft deadline in microseconds since unix epoch, 0 if none.
+  uint64 deadline_us() const { return deadline_us_; }
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
 
-  void Reset(int64 step_id);
+  void Reset(int64 step_id, uint64 start_time_us, int64 priority,
+             uint64 deadline_us);
 
   RunHandlerPool::Impl* pool_impl() { return pool_impl_; }
 
@@ -615,6 +634,8 @@ class RunHandler::Impl {
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
   int64 step_id_;
+  int64 priority_;
+  uint64 deadline_us_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   ThreadWorkSource tws_;
 };
@@ -627,6 +648,10 @@ class RunHandlerPool::Impl {
   explicit Impl(int num_inter_op_threads, int num_intra_op_threads)
       : max_handlers_(static_cast<int32>(ParamFromEnvWithDefault(
             "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", kMaxConcurrentHandlers))),
+        reserved_handlers_(std::min(
+            max_handlers_ - 1,
+            static_cast<int32>(ParamFromEnvWithDefault(
+                "TF_RUN_HANDLER_RESERVED_HANDLERS", 0)))),
         run_handler_thread_pool_(new RunHandlerThreadPool(
             num_inter_op_threads, num_intra_op_threads, Env::Default(),
             ThreadOptions(), "tf_run_handler_pool")),
@@ -644,6 +669,7 @@ class RunHandlerPool::Impl {
     DCHECK_EQ(handlers_.size(), max_handlers_);
     DCHECK_EQ(free_handlers_.size(), handlers_.size());
     DCHECK_EQ(sorted_active_handlers_.size(), 0);
+    DCHECK(waiters_.empty());
     // Stop the threads in run_handler_thread_pool_ before freeing other
     // pointers. Otherwise a thread may try to access a pointer after the
     // pointer has been freed.
@@ -654,54 +680,162 @@ class RunHandlerPool::Impl {
     return run_handler_thread_pool_.get();
   }
 
-  std::unique_ptr<RunHandler> Get(int64 step_id) LOCKS_EXCLUDED(mu_) {
-    mutex_lock l(mu_);
-    while (free_handlers_.empty()) {
-      one_handler_free_.wait(l);
+  std::unique_ptr<RunHandler> Get(
+      int64 step_id,
+      const RunOptions::Experimental::RunHandlerPoolOptions& options)
+      LOCKS_EXCLUDED(mu_) {
+    const uint64 now = tensorflow::Env::Default()->NowMicros();
+    Request request;
+    request.step_id = step_id;
+    request.priority = options.priority();
+    request.start_time_us = now;
+    request.deadline_us =
+        options.deadline_in_ms() > 0 ? now + options.deadline_in_ms() * 1000
+                                     : 0;
+    const string priority_label = strings::StrCat(request.priority);
+
+    RunHandler::Impl* handler_impl;
+    {
+      mutex_lock l(mu_);
+      request.seq = next_request_seq_++;
+      // A request may pass blocked callers that it would be admitted ahead
+      // of anyway, e.g. a high priority request while low priority callers
+      // wait for handlers held back for it.
+      if ((waiters_.empty() ||
+           !WaiterComparator()(waiters_.front(), &request)) &&
+          CanAdmitLocked(request.priority)) {
+        handler_impl = AdmitLocked(request);
+      } else {
+        // Queue behind (or ahead of) other blocked callers; ReleaseHandler()
+        // hands out handlers in priority order.
+        waiters_.insert(std::upper_bound(waiters_.begin(), waiters_.end(),
+                                         &request, WaiterComparator()),
+                        &request);
+        UpdateQueueDepthLocked(request.priority);
+        while (request.handler == nullptr) {
+          request.admitted.wait(l);
+        }
+        handler_impl = request.handler;
+      }
     }
-    // Remove the last entry from free_handlers_ and add to the end of
-    // sorted_active_handlers_.
-    auto* handler_impl = free_handlers_.back();
-    handler_impl->Reset(step_id);
-    // Sortedness isn't violated if we simply add at the end of the list, since
-    // handlers are expected to be obtained in increasing order of time.
-    sorted_active_handlers_.push_back(handler_impl);
-    DCHECK_LE(sorted_active_handlers_.size(), max_handlers_);
-    free_handlers_.pop_back();
-
-    RecomputePoolStatsLocked();
+    run_handler_wait_time_usecs->GetCell(priority_label)
+        ->Add(tensorflow::Env::Default()->NowMicros() - now);
     return WrapUnique<RunHandler>(new RunHandler(handler_impl));
   }
 
   void ReleaseHandler(RunHandler::Impl* handler) LOCKS_EXCLUDED(mu_) {
-    {
-      mutex_lock l(mu_);
-      DCHECK_GT(sorted_active_handlers_.size(), 0);
+    mutex_lock l(mu_);
+    DCHECK_GT(sorted_active_handlers_.size(), 0);
 
-      CHECK_EQ(handler->tws()->TaskQueueSize(true), 0);
-      CHECK_EQ(handler->tws()->TaskQueueSize(false), 0);
+    CHECK_EQ(handler->tws()->TaskQueueSize(true), 0);
+    CHECK_EQ(handler->tws()->TaskQueueSize(false), 0);
 
-      uint64 now = tensorflow::Env::Default()->NowMicros();
-      double elapsed = (now - handler->start_time_us()) / 1000.0;
-      time_hist_.Add(elapsed);
+    uint64 now = tensorflow::Env::Default()->NowMicros();
+    double elapsed = (now - handler->start_time_us()) / 1000.0;
+    time_hist_.Add(elapsed);
+
+    // Erase from and update sorted_active_handlers_. Add it to the end of
+    // free_handlers_.
+    auto iter = std::find(sorted_active_handlers_.begin(),
+                          sorted_active_handlers_.end(), handler);
+    DCHECK(iter != sorted_active_handlers_.end())
+        << "Unexpected handler: " << handler
+        << " is being requested for release";
+
+    // Remove this handler from this list and add it to the list of free
+    // handlers.
+    sorted_active_handlers_.erase(iter);
+    free_handlers_.push_back(handler);
+    DCHECK_LE(free_handlers_.size(), max_handlers_);
+
+    // Admit the most urgent blocked callers that the free handlers allow.
+    // Since waiters_ is sorted by priority, if the first one cannot be
+    // admitted none of the others can either.
+    bool admitted = false;
+    while (!waiters_.empty() && CanAdmitLocked(waiters_.front()->priority)) {
+      Request* request = waiters_.front();
+      waiters_.erase(waiters_.begin());
+      UpdateQueueDepthLocked(request->priority);
+      request->handler = AdmitLocked(*request);
+      request->admitted.notify_one();
+      admitted = true;
+    }
+    if (!admitted) {
+      RecomputePoolStatsLocked();
+    }
+  }
 
-      // Erase from and update sorted_active_handlers_. Add it to the end of
-      // free_handlers_.
-      auto iter = std::find(sorted_active_handlers_.begin(),
-                            sorted_active_handlers_.end(), handler);
-      DCHECK(iter != sorted_active_handlers_.end())
-          << "Unexpected handler: " << handler
-          << " is being requested for release";
+ private:
+  // A caller of Get(), possibly blocked waiting for a handler.
+  struct Request {
+    int64 step_id = 0;
+    int64 priority = 0;
+    uint64 start_time_us = 0;
+    uint64 deadline_us = 0;
+    uint64 seq = 0;
+    RunHandler::Impl* handler = nullptr;
+    condition_variable admitted;
+  };
 
-      // Remove this handler from this list and add it to the list of free
-      // handlers.
-      sorted_active_handlers_.erase(iter);
-      free_handlers_.push_back(handler);
-      DCHECK_LE(free_handlers_.size(), max_handlers_);
+  // Orders requests by decreasing priority, then by earliest deadline
+  // (requests without a deadline last), then by arrival.
+  static bool ComesBefore(int64 priority_a, uint64 deadline_a, uint64 order_a,
+                          int64 priority_b, uint64 deadline_b,
+                          uint64 order_b) {
+    if (priority_a != priority_b) return priority_a > priority_b;
+    if (deadline_a == 0) deadline_a = kuint64max;
+    if (deadline_b == 0) deadline_b = kuint64max;
+    if (deadline_a != deadline_b) return deadline_a < deadline_b;
+    return order_a < order_b;
+  }
+
+  struct WaiterComparator {
+    bool operator()(const Request* a, const Request* b) const {
+      return ComesBefore(a->priority, a->deadline_us, a->seq, b->priority,
+                         b->deadline_us, b->seq);
+    }
+  };
 
-      RecomputePoolStatsLocked();
+  struct HandlerComparator {
+    bool operator()(const RunHandler::Impl* a,
+                    const RunHandler::Impl* b) const {
+      return ComesBefore(a->priority(), a->deadline_us(), a->start_time_us(),
+                         b->priority(), b->deadline_us(), b->start_time_us());
     }
-    one_handler_free_.notify_one();
+  };
+
+  // Returns true if a request of the given priority may take a free handler
+  // now.  The last reserved_handlers_ free handlers are kept for requests
+  // with a positive priority.
+  bool CanAdmitLocked(int64 priority) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const size_t reserved = priority > 0 ? 0 : reserved_handlers_;
+    return free_handlers_.size() > reserved;
+  }
+
+  // Moves a free handler to sorted_active_handlers_ on behalf of 'request'.
+  RunHandler::Impl* AdmitLocked(const Request& request)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    auto* handler_impl = free_handlers_.back();
+    free_handlers_.pop_back();
+    handler_impl->Reset(request.step_id, request.start_time_us,
+                        request.priority, request.deadline_us);
+    sorted_active_handlers_.insert(
+        std::upper_bound(sorted_active_handlers_.begin(),
+                         sorted_active_handlers_.end(), handler_impl,
+                         HandlerComparator()),
+        handler_impl);
+    DCHECK_LE(sorted_active_handlers_.size(), max_handlers_);
+
+    RecomputePoolStatsLocked();
+    return handler_impl;
+  }
+
+  void UpdateQueueDepthLocked(int64 priority) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    int64 depth = 0;
+    for (const Request* request : waiters_) {
+      if (request->priority == priority) ++depth;
+    }
+    run_handler_queue_depth->GetCell(strings::StrCat(priority))->Set(depth);
   }
 
  private:
@@ -713,18 +847,22 @@ class RunHandlerPool::Impl {
   // inference).
   const int max_handlers_;
 
+  // Number of handlers only available to requests with a positive priority.
+  const int reserved_handlers_;
+
   std::unique_ptr<RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by priority, then soft deadline, then start time.
   std::vector<RunHandler::Impl*> sorted_active_handlers_ GUARDED_BY(mu_);
+  // Blocked callers of Get(), in admission order.
+  std::vector<Request*> waiters_ GUARDED_BY(mu_);
+  uint64 next_request_seq_ GUARDED_BY(mu_) = 0;
   std::vector<RunHandler::Impl*> free_handlers_ GUARDED_BY(mu_);
   std::vector<std::unique_ptr<RunHandler::Impl>> handlers_ GUARDED_BY(mu_);
   // Histogram of elapsed runtime of every handler (in ms).
   histogram::Histogram time_hist_ GUARDED_BY(mu_);
 
   int64 iterations_ GUARDED_BY(mu_);
-  condition_variable one_handler_free_;
   mutex mu_;
 };
 
@@ -803,7 +941,7 @@ void RunHandler::Impl::ThreadPoolInterfaceWrapper::Schedule(
 RunHandler::Impl::Impl(RunHandlerPool::Impl* pool_impl)
     : pool_impl_(pool_impl) {
   thread_pool_interface_.reset(new ThreadPoolInterfaceWrapper(this));
-  Reset(0);
+  Reset(0, tensorflow::Env::Default()->NowMicros(), 0, 0);
 }
 
 void RunHandler::Impl::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -818,9 +956,12 @@ void RunHandler::Impl::ScheduleIntraOpClosure(std::function<void()> fn) {
                                                         std::move(fn));
 }
 
-void RunHandler::Impl::Reset(int64 step_id) {
-  start_time_us_ = tensorflow::Env::Default()->NowMicros();
+void RunHandler::Impl::Reset(int64 step_id, uint64 start_time_us,
+                             int64 priority, uint64 deadline_us) {
+  start_time_us_ = start_time_us;
   step_id_ = step_id;
+  priority_ = priority;
+  deadline_us_ = deadline_us;
   tws_.SetTracemeId(step_id);
 }
 
@@ -833,8 +974,10 @@ RunHandlerPool::RunHandlerPool(int num_inter_op_threads,
 
 RunHandlerPool::~RunHandlerPool() {}
 
-std::unique_ptr<RunHandler> RunHandlerPool::Get(int64 step_id) {
-  return impl_->Get(step_id);
+std::unique_ptr<RunHandler> RunHandlerPool::Get(
+    int64 step_id,
+    const RunOptions::Experimental::RunHandlerPoolOptions& options) {
+  return impl_->Get(step_id, options);
 }
 
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
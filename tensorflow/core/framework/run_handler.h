@@ -61,8 +61,14 @@ class RunHandlerPool {
   // and is being used by a client.  It becomes 'inactive' once more when the
   // unique_ptr is destroyed.
   //
-  // Will block unless there is an inactive handler.
-  std::unique_ptr<RunHandler> Get(int64 step_id = 0);
+  // Will block unless there is an inactive handler.  Blocked callers are
+  // admitted in decreasing order of options.priority(), then by earliest
+  // deadline, then in arrival order.  The handler's inter-op and intra-op
+  // work is served ahead of lower priority requests in the same order.
+  std::unique_ptr<RunHandler> Get(
+      int64 step_id = 0,
+      const RunOptions::Experimental::RunHandlerPoolOptions& options =
+          RunOptions::Experimental::RunHandlerPoolOptions());
 
  private:
   class Impl;
@@ -74,7 +80,7 @@ class RunHandlerPool {
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
 // handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// (priority class, then soft deadline, then time of the Get() call).
 //
 // It can only be created via RunHandlerPool::Get().
 //
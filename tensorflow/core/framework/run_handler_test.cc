@@ -25,6 +25,7 @@ limitations under the License.
 #include "absl/synchronization/barrier.h"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
@@ -72,5 +73,86 @@ TEST(RunHandlerUtilTest, TestBasicScheduling) {
   counter.Wait();
 }
 
+RunOptions::Experimental::RunHandlerPoolOptions PoolOptions(int64 priority) {
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  options.set_priority(priority);
+  return options;
+}
+
+TEST(RunHandlerUtilTest, TestBlockedRequestsAdmittedByPriority) {
+  setenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", "1", true);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2));
+  unsetenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS");
+
+  auto blocker = pool->Get(0);
+  mutex mu;
+  std::vector<int64> admitted;
+  {
+    thread::ThreadPool test_pool(Env::Default(), "test", 2);
+    test_pool.Schedule([&]() {
+      auto handler = pool->Get(1, PoolOptions(0));
+      mutex_lock l(mu);
+      admitted.push_back(0);
+    });
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+    test_pool.Schedule([&]() {
+      auto handler = pool->Get(2, PoolOptions(1));
+      mutex_lock l(mu);
+      admitted.push_back(1);
+    });
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+    blocker.reset();
+  }
+  ASSERT_EQ(2, admitted.size());
+  // The later, higher priority request is admitted first.
+  EXPECT_EQ(1, admitted[0]);
+  EXPECT_EQ(0, admitted[1]);
+}
+
+TEST(RunHandlerUtilTest, TestReservedHandlersServeHighPriority) {
+  setenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", "2", true);
+  setenv("TF_RUN_HANDLER_RESERVED_HANDLERS", "1", true);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2));
+  unsetenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS");
+  unsetenv("TF_RUN_HANDLER_RESERVED_HANDLERS");
+
+  auto low = pool->Get(1, PoolOptions(0));
+  // Does not block: the remaining handler is reserved for this request.
+  auto high = pool->Get(2, PoolOptions(1));
+  BlockingCounter counter(2);
+  high->ScheduleInterOpClosure([&counter]() { counter.DecrementCount(); });
+  low->ScheduleInterOpClosure([&counter]() { counter.DecrementCount(); });
+  counter.Wait();
+}
+
+TEST(RunHandlerUtilTest, TestHighPriorityPassesBlockedLowPriority) {
+  setenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS", "2", true);
+  setenv("TF_RUN_HANDLER_RESERVED_HANDLERS", "1", true);
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(2, 2));
+  unsetenv("TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS");
+  unsetenv("TF_RUN_HANDLER_RESERVED_HANDLERS");
+
+  auto low = pool->Get(1, PoolOptions(0));
+  Notification low_admitted;
+  {
+    thread::ThreadPool test_pool(Env::Default(), "test", 1);
+    // Blocks: the only free handler is reserved.
+    test_pool.Schedule([&]() {
+      auto handler = pool->Get(2, PoolOptions(0));
+      low_admitted.Notify();
+    });
+    Env::Default()->SleepForMicroseconds(100 * 1000);
+    EXPECT_FALSE(low_admitted.HasBeenNotified());
+
+    // Does not block, even though a caller is queued, and does not need a
+    // handler to be released.
+    auto high = pool->Get(3, PoolOptions(1));
+    EXPECT_FALSE(low_admitted.HasBeenNotified());
+    high.reset();
+    low.reset();
+    low_admitted.WaitForNotification();
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -998,6 +998,7 @@ Status Partition(const PartitionOptions& opts, Graph* g,
   string dstp;
   std::vector<const Edge*> inputs;
   DupRecvTable dup_recv(3);
+  int64 next_rendezvous_slot = 0;
   // For a node dst, 'ref_recvs' remembers the recvs introduced by a ref
   // edge to dst. 'ref_control_inputs' remembers the inputs by a non-ref
   // edge to dst. We will add a control edge for every pair in
@@ -1149,6 +1150,12 @@ Status Partition(const PartitionOptions& opts, Graph* g,
           AddRecv(opts, g_info, dst_graph, edge, &real_recv, &status);
       if (!status.ok()) return status;
 
+      if (opts.assign_rendezvous_slots) {
+        AddNodeAttr("_rendezvous_slot", next_rendezvous_slot, send);
+        AddNodeAttr("_rendezvous_slot", next_rendezvous_slot, real_recv);
+        ++next_rendezvous_slot;
+      }
+
       // Fix up the control flow edge.
       // NOTE(yuanbyu): 'real_recv' must be the real recv node.
       if (src_graph == dst_graph) {
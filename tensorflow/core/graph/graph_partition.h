@@ -76,6 +76,13 @@ struct PartitionOptions {
   // in the graph as a node attribute.
   bool need_to_record_start_times = false;
   std::vector<Microseconds> start_times;
+
+  // If true, each Send/Recv pair added by Partition is given a distinct
+  // "_rendezvous_slot" attribute, which lets a rendezvous match the pair by
+  // index rather than by key. Only set this when no other graph with slots
+  // uses the same rendezvous at the same time, e.g. in DirectSession, where
+  // every step gets a fresh rendezvous.
+  bool assign_rendezvous_slots = false;
 };
 
 // Partition "input" graph into a set of graphs, one per location.
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/graph/graph_partition.h"
 
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <utility>
 
@@ -74,7 +76,8 @@ string DeviceName(const Node* node) {
 }
 
 void Partition(const GraphDef& graph_def,
-               std::unordered_map<string, GraphDef>* partitions) {
+               std::unordered_map<string, GraphDef>* partitions,
+               bool assign_rendezvous_slots = false) {
   Graph g(OpRegistry::Global());
   GraphConstructorOptions opts;
   TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &g));
@@ -94,6 +97,7 @@ void Partition(const GraphDef& graph_def,
   popts.get_incarnation = [](const string& name) {
     return (name[0] - 'A') + 100;
   };
+  popts.assign_rendezvous_slots = assign_rendezvous_slots;
   Status s = Partition(popts, &g, partitions);
   CHECK(s.ok()) << s;
 
@@ -316,6 +320,38 @@ TEST_F(GraphPartitionTest, CrossDeviceData_MultiUse) {
   ExpectMatchB();
 }
 
+TEST_F(GraphPartitionTest, AssignRendezvousSlots) {
+  auto a1 = FloatInput(in_.WithOpName("A1"));
+  auto b1 = FloatInput(in_.WithOpName("B1"));
+  Combine(in_.WithOpName("B2"), a1, b1);
+  Combine(in_.WithOpName("B3"), a1, a1);
+  Combine(in_.WithOpName("A2"), b1, a1);
+
+  Partition(ToGraphDef(), &partitions_, /*assign_rendezvous_slots=*/true);
+  EXPECT_EQ(2, partitions_.size());
+
+  // One Send/Recv pair per transferred tensor, each with its own slot.
+  std::map<string, std::vector<int64>> slots_by_tensor;
+  for (const auto& kv : partitions_) {
+    for (const NodeDef& ndef : kv.second.node()) {
+      if (ndef.op() != "_Send" && ndef.op() != "_Recv") continue;
+      string tensor_name;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "tensor_name", &tensor_name));
+      int64 slot;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "_rendezvous_slot", &slot));
+      slots_by_tensor[tensor_name].push_back(slot);
+    }
+  }
+  ASSERT_EQ(2, slots_by_tensor.size());
+  std::set<int64> distinct_slots;
+  for (const auto& kv : slots_by_tensor) {
+    ASSERT_EQ(2, kv.second.size()) << kv.first;
+    EXPECT_EQ(kv.second[0], kv.second[1]) << kv.first;
+    distinct_slots.insert(kv.second[0]);
+  }
+  EXPECT_EQ(2, distinct_slots.size());
+}
+
 TEST_F(GraphPartitionTest, CrossDeviceControl_MultiUse) {
   auto a1 = FloatInput(in_.WithOpName("A1"));
   auto b1 = FloatInput(in_.WithOpName("B1"));
@@ -17,9 +17,15 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
@@ -35,6 +41,8 @@ namespace data {
 /* static */ constexpr const char* const CacheDatasetOp::kFileName;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputTypes;
 /* static */ constexpr const char* const CacheDatasetOp::kOutputShapes;
+/* static */ constexpr const char* const
+    CacheDatasetOp::kPersistentChunkSizeBytes;
 
 constexpr char kKeyStrFormat[] = "%%%zuzu_%%%zuzu";
 constexpr char kPaddingSizeStrFormat[] = "%zu";
@@ -56,6 +64,14 @@ constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kPersistentFileDatasetPrefix[] = "PersistentFile";
+constexpr char kChunk[] = "chunk";
+constexpr char kChunkIndex[] = "chunk_index";
+constexpr char kElementIndex[] = "element_index";
+constexpr char kFirstElement[] = "first_element";
+constexpr char kNumElements[] = "num_elements";
+constexpr char kFinal[] = "final";
+constexpr char kInputState[] = "input_state";
 
 class CacheDatasetOp::FileDataset : public DatasetBase {
  public:
@@ -630,6 +646,503 @@ class CacheDatasetOp::FileDatasetV2 : public CacheDatasetOp::FileDataset {
   const Tensor resource_handle_;
 };
 
+// PersistentFileDataset caches the elements of its input in a directory keyed
+// by a fingerprint of the input's graph, so the cache stays valid across jobs
+// as long as the input pipeline does not change.
+//
+// The elements are written in chunks of about `chunk_size_bytes_` bytes, each
+// a separate tensor bundle named `chunk_<index>_<writer id>`. A chunk is
+// sealed, and becomes visible to readers, once `BundleWriter::Finish()`
+// renames its metadata file into place. Iterators read the sealed chunks in
+// order and only start writing at the first chunk that is not sealed yet, so a
+// restarted job reuses a partial cache instead of recomputing it. Each sealed
+// chunk also stores the state of the input iterator after its last element,
+// which lets a writer resume the input without recomputing the elements that
+// precede it.
+// Concurrent writers of the same chunk do not coordinate, so their copies of
+// a chunk may hold different ranges of elements. Iterators only use a copy
+// that starts where the chunk they read before it ends.
+class CacheDatasetOp::PersistentFileDataset : public DatasetBase {
+ public:
+  explicit PersistentFileDataset(OpKernelContext* ctx, const DatasetBase* input,
+                                 string filename, string fingerprint,
+                                 int64 chunk_size_bytes, Env* env)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        filename_(std::move(filename)),
+        directory_(io::JoinPath(filename_, fingerprint)),
+        chunk_size_bytes_(chunk_size_bytes),
+        env_(env),
+        num_tensors_(input->output_dtypes().size()) {
+    input_->Ref();
+  }
+
+  ~PersistentFileDataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    name_utils::IteratorPrefixParams params;
+    params.dataset_prefix = kPersistentFileDatasetPrefix;
+    return absl::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix, params)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.dataset_prefix = kPersistentFileDatasetPrefix;
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64 Cardinality() const override { return input_->Cardinality(); }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph));
+    Node* filename = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename));
+    AttrValue chunk_size_bytes;
+    b->BuildAttrValue(chunk_size_bytes_, &chunk_size_bytes);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {input_graph, filename},
+                      {{kPersistentChunkSizeBytes, chunk_size_bytes}}, output));
+    return Status::OK();
+  }
+
+  const DatasetBase* const input_;
+  const tstring filename_;
+  const string directory_;
+  const int64 chunk_size_bytes_;
+
+ private:
+  class Iterator : public DatasetIterator<PersistentFileDataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<PersistentFileDataset>(params),
+          writer_id_(strings::StrCat(
+              strings::Hex(random::New64(), strings::kZeroPad16))) {}
+
+    ~Iterator() override {
+      mutex_lock l(mu_);
+      if (writer_) {
+        // Remove the temporary files of the unsealed chunk.
+        AbandonChunk();
+      }
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      return dataset()->env_->RecursivelyCreateDir(dataset()->directory_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      *end_of_sequence = false;
+      while (!end_of_sequence_) {
+        if (writer_) {
+          return WriteNext(ctx, out_tensors, end_of_sequence);
+        }
+        if (reader_ && element_index_ < reader_num_elements_) {
+          return ReadNext(out_tensors);
+        }
+        if (reader_) {
+          // The current chunk is exhausted.
+          reader_.reset();
+          if (reader_final_) {
+            end_of_sequence_ = true;
+            break;
+          }
+          first_element_ += reader_num_elements_;
+          chunk_index_++;
+          element_index_ = 0;
+        }
+        TF_RETURN_IF_ERROR(OpenChunk(ctx));
+      }
+      *end_of_sequence = true;
+      return Status::OK();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    Status SaveInternal(IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      // A chunk that is being written is not saved. After a restore, its
+      // elements are recomputed unless another writer has sealed it.
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kChunkIndex), chunk_index_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kElementIndex), element_index_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kFirstElement), first_element_));
+      if (end_of_sequence_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kIterationCompleted), ""));
+      }
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      if (writer_) {
+        AbandonChunk();
+      }
+      reader_.reset();
+      input_impl_.reset();
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kChunkIndex), &chunk_index_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kElementIndex), &element_index_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(full_name(kFirstElement), &first_element_));
+      end_of_sequence_ = reader->Contains(full_name(kIterationCompleted));
+      return Status::OK();
+    }
+
+   private:
+    string ChunkPrefix(int64 chunk_index, const string& writer_id) const {
+      return io::JoinPath(
+          dataset()->directory_,
+          strings::StrCat(kChunk, "_", strings::Hex(chunk_index,
+                                                    strings::kZeroPad8),
+                          "_", writer_id));
+    }
+
+    // Opens a sealed copy of chunk `chunk_index` for which
+    // `matches(first_element, num_elements, is_final)` holds, or sets `reader`
+    // to nullptr if there is none.
+    Status OpenSealedChunk(
+        int64 chunk_index,
+        const std::function<bool(int64, int64, bool)>& matches,
+        std::unique_ptr<BundleReader>* reader, int64* num_elements,
+        bool* is_final) const {
+      std::vector<string> metadata_files;
+      TF_RETURN_IF_ERROR(dataset()->env_->GetMatchingPaths(
+          MetaFilename(ChunkPrefix(chunk_index, "*")), &metadata_files));
+      const string suffix = MetaFilename("");
+      reader->reset();
+      for (const string& metadata_file : metadata_files) {
+        auto candidate = absl::make_unique<BundleReader>(
+            dataset()->env_,
+            metadata_file.substr(0, metadata_file.size() - suffix.size()));
+        TF_RETURN_IF_ERROR(candidate->status());
+        int64 first_element, final_flag;
+        TF_RETURN_IF_ERROR(
+            ReadInt64(candidate.get(), kFirstElement, &first_element));
+        TF_RETURN_IF_ERROR(
+            ReadInt64(candidate.get(), kNumElements, num_elements));
+        TF_RETURN_IF_ERROR(ReadInt64(candidate.get(), kFinal, &final_flag));
+        *is_final = final_flag != 0;
+        if (matches(first_element, *num_elements, *is_final)) {
+          *reader = std::move(candidate);
+          return Status::OK();
+        }
+      }
+      return Status::OK();
+    }
+
+    static Status ReadInt64(BundleReader* reader, StringPiece key,
+                            int64* value) {
+      Tensor t;
+      TF_RETURN_IF_ERROR(reader->Lookup(key, &t));
+      *value = t.scalar<int64>()();
+      return Status::OK();
+    }
+
+    // Starts reading chunk `chunk_index_` if a copy of it that continues the
+    // elements read so far is sealed, or writing it otherwise.
+    Status OpenChunk(IteratorContext* ctx) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 first_element = first_element_;
+      const int64 element_index = element_index_;
+      // After a restore, the copy must also hold the elements read already.
+      TF_RETURN_IF_ERROR(OpenSealedChunk(
+          chunk_index_,
+          [first_element, element_index](int64 first, int64 num,
+                                         bool is_final) {
+            return first == first_element &&
+                   (num > element_index || (num == element_index && is_final));
+          },
+          &reader_, &reader_num_elements_, &reader_final_));
+      if (!reader_) {
+        return StartChunk(ctx);
+      }
+      // Whoever sealed this chunk has moved the input past it.
+      input_impl_.reset();
+      return Status::OK();
+    }
+
+    Status ReadNext(std::vector<Tensor>* out_tensors)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      out_tensors->clear();
+      out_tensors->resize(dataset()->num_tensors_);
+      for (size_t i = 0; i < dataset()->num_tensors_; ++i) {
+        TF_RETURN_IF_ERROR(
+            reader_->Lookup(ElementKey(element_index_, i), &(*out_tensors)[i]));
+      }
+      element_index_++;
+      return Status::OK();
+    }
+
+    // Starts writing chunk `chunk_index_`. If the iterator was restored in
+    // the middle of the chunk, the elements it produced already are
+    // recomputed and written again.
+    Status StartChunk(IteratorContext* ctx) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 num_produced = element_index_;
+      if (!input_impl_ || num_produced > 0) {
+        TF_RETURN_IF_ERROR(PositionInput(ctx));
+      }
+      writer_prefix_ = ChunkPrefix(chunk_index_, writer_id_);
+      writer_ = absl::make_unique<BundleWriter>(dataset()->env_,
+                                                writer_prefix_);
+      TF_RETURN_IF_ERROR(writer_->status());
+      writer_bytes_ = 0;
+      element_index_ = 0;
+      std::vector<Tensor> element;
+      while (element_index_ < num_produced) {
+        bool end_of_input;
+        element.clear();
+        TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &element, &end_of_input));
+        if (end_of_input) {
+          return errors::FailedPrecondition(
+              "The input produced fewer elements than the cache in ",
+              dataset()->directory_, " holds.");
+        }
+        TF_RETURN_IF_ERROR(AddElement(element));
+      }
+      return Status::OK();
+    }
+
+    Status AddElement(const std::vector<Tensor>& element)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (element.size() != dataset()->num_tensors_) {
+        return errors::Internal(
+            "Upstream iterator returned invalid number of tensors. Expected ",
+            dataset()->num_tensors_, " got: ", element.size());
+      }
+      for (size_t i = 0; i < element.size(); ++i) {
+        TF_RETURN_IF_ERROR(
+            writer_->Add(ElementKey(element_index_, i), element[i]));
+        writer_bytes_ += element[i].TotalBytes();
+      }
+      element_index_++;
+      return Status::OK();
+    }
+
+    // Creates an input iterator positioned after the last element of chunk
+    // `chunk_index_ - 1`.
+    Status PositionInput(IteratorContext* ctx) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+      if (chunk_index_ == 0) {
+        return Status::OK();
+      }
+      // The input state is only valid for a copy of the previous chunk that
+      // ends where this one starts.
+      const int64 first_element = first_element_;
+      std::unique_ptr<BundleReader> previous;
+      int64 num_elements;
+      bool is_final;
+      TF_RETURN_IF_ERROR(OpenSealedChunk(
+          chunk_index_ - 1,
+          [first_element](int64 first, int64 num, bool is_final) {
+            return !is_final && first + num == first_element;
+          },
+          &previous, &num_elements, &is_final));
+      if (!previous) {
+        return errors::DataLoss("No copy of cache chunk ", chunk_index_ - 1,
+                                " in ", dataset()->directory_,
+                                " ends at element ", first_element_, ".");
+      }
+      if (previous->Contains(kInputState)) {
+        Tensor state;
+        TF_RETURN_IF_ERROR(previous->Lookup(kInputState, &state));
+        VariantTensorDataProto proto;
+        Status s = Status::OK();
+        if (!proto.ParseFromString(string(state.scalar<tstring>()()))) {
+          s = errors::DataLoss("Could not parse input iterator state.");
+        }
+        if (s.ok()) {
+          VariantTensorData data(std::move(proto));
+          VariantTensorDataReader reader(&data);
+          s = RestoreInput(ctx, &reader, input_impl_);
+        }
+        if (s.ok()) {
+          return Status::OK();
+        }
+        LOG(WARNING) << "Failed to restore the input of cache chunk "
+                     << chunk_index_ - 1 << " in " << dataset()->directory_
+                     << ": " << s
+                     << ". Recomputing the cached elements instead.";
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+      }
+      // Skip the elements that are already cached.
+      std::vector<Tensor> skipped;
+      for (int64 i = 0; i < first_element_; ++i) {
+        bool end_of_input;
+        skipped.clear();
+        TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &skipped, &end_of_input));
+        if (end_of_input) {
+          return errors::FailedPrecondition(
+              "The input produced fewer elements than the cache in ",
+              dataset()->directory_, " holds.");
+        }
+      }
+      return Status::OK();
+    }
+
+    Status WriteNext(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
+                     bool* end_of_sequence) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+      if (*end_of_sequence) {
+        end_of_sequence_ = true;
+        return SealChunk(/*is_final=*/true);
+      }
+      TF_RETURN_IF_ERROR(AddElement(*out_tensors));
+      if (writer_bytes_ >= dataset()->chunk_size_bytes_) {
+        TF_RETURN_IF_ERROR(SealChunk(/*is_final=*/false));
+      }
+      return Status::OK();
+    }
+
+    // Writes the metadata of the current chunk and makes it visible to
+    // readers.
+    Status SealChunk(bool is_final) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      Tensor num_elements(DT_INT64, TensorShape({}));
+      num_elements.scalar<int64>()() = element_index_;
+      TF_RETURN_IF_ERROR(writer_->Add(kNumElements, num_elements));
+      Tensor first_element(DT_INT64, TensorShape({}));
+      first_element.scalar<int64>()() = first_element_;
+      TF_RETURN_IF_ERROR(writer_->Add(kFirstElement, first_element));
+      Tensor final_tensor(DT_INT64, TensorShape({}));
+      final_tensor.scalar<int64>()() = is_final ? 1 : 0;
+      TF_RETURN_IF_ERROR(writer_->Add(kFinal, final_tensor));
+      if (!is_final) {
+        VariantTensorData data;
+        VariantTensorDataWriter state_writer(&data);
+        Status s = SaveInput(&state_writer, input_impl_);
+        if (s.ok()) {
+          s = state_writer.Flush();
+        }
+        if (s.ok()) {
+          VariantTensorDataProto proto;
+          data.ToProto(&proto);
+          Tensor state(DT_STRING, TensorShape({}));
+          state.scalar<tstring>()() = proto.SerializeAsString();
+          TF_RETURN_IF_ERROR(writer_->Add(kInputState, state));
+        } else {
+          VLOG(1) << "Not storing the input state in " << writer_prefix_
+                  << ": " << s;
+        }
+      }
+      TF_RETURN_IF_ERROR(writer_->Finish());
+      writer_.reset();
+      if (!is_final) {
+        first_element_ += element_index_;
+        chunk_index_++;
+        element_index_ = 0;
+      }
+      return Status::OK();
+    }
+
+    void AbandonChunk() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      writer_.reset();
+      element_index_ = 0;
+      std::vector<string> files;
+      Status s = dataset()->env_->GetMatchingPaths(
+          strings::StrCat(writer_prefix_, "*"), &files);
+      for (const string& file : files) {
+        s.Update(dataset()->env_->DeleteFile(file));
+      }
+      if (!s.ok()) {
+        LOG(WARNING) << "Failed to remove unsealed cache chunk "
+                     << writer_prefix_ << ": " << s;
+      }
+    }
+
+    static string ElementKey(int64 element_index, size_t tensor_index) {
+      return strings::StrCat(strings::Hex(element_index, strings::kZeroPad10),
+                             "_", tensor_index);
+    }
+
+    // Identifies the chunks written by this iterator.
+    const string writer_id_;
+    mutex mu_;
+    // The index of the chunk being read or written.
+    int64 chunk_index_ GUARDED_BY(mu_) = 0;
+    // The index of the next element within the current chunk.
+    int64 element_index_ GUARDED_BY(mu_) = 0;
+    // The index of the first element of the current chunk in the input.
+    int64 first_element_ GUARDED_BY(mu_) = 0;
+    bool end_of_sequence_ GUARDED_BY(mu_) = false;
+    std::unique_ptr<BundleReader> reader_ GUARDED_BY(mu_);
+    int64 reader_num_elements_ GUARDED_BY(mu_) = 0;
+    bool reader_final_ GUARDED_BY(mu_) = false;
+    // Only set while writing.
+    std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+    std::unique_ptr<BundleWriter> writer_ GUARDED_BY(mu_);
+    string writer_prefix_ GUARDED_BY(mu_);
+    int64 writer_bytes_ GUARDED_BY(mu_) = 0;
+  };  // Iterator
+
+  Env* const env_;
+  const size_t num_tensors_;
+};  // PersistentFileDataset
+
+class CacheDatasetOp::PersistentFileDatasetV2
+    : public CacheDatasetOp::PersistentFileDataset {
+ public:
+  explicit PersistentFileDatasetV2(OpKernelContext* ctx,
+                                   const DatasetBase* input, string filename,
+                                   string fingerprint, int64 chunk_size_bytes,
+                                   Env* env, const Tensor& resource_handle)
+      : PersistentFileDataset(ctx, input, std::move(filename),
+                              std::move(fingerprint), chunk_size_bytes, env),
+        resource_handle_(resource_handle) {}
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+    Node* filename_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename_node));
+    Node* resource_handle_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddTensor(resource_handle_, &resource_handle_node));
+    AttrValue chunk_size_bytes;
+    b->BuildAttrValue(chunk_size_bytes_, &chunk_size_bytes);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_node, filename_node, resource_handle_node},
+        {{kPersistentChunkSizeBytes, chunk_size_bytes}}, output));
+    return Status::OK();
+  }
+
+ private:
+  const Tensor resource_handle_;
+};
+
 namespace {
 template <typename T, typename FullNameFn>
 Status SaveCache(IteratorStateWriter* writer, T* cache, FullNameFn full_name) {
@@ -1009,7 +1522,15 @@ class CacheDatasetOp::MemoryDatasetV2 : public CacheDatasetOp::MemoryDataset {
 
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {
+  if (ctx->HasAttr(kPersistentChunkSizeBytes)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kPersistentChunkSizeBytes,
+                                     &persistent_chunk_size_bytes_));
+    OP_REQUIRES(ctx, persistent_chunk_size_bytes_ >= 0,
+                errors::InvalidArgument(
+                    "persistent_chunk_size_bytes must be non-negative."));
+  }
+}
 
 void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                                  DatasetBase** output) {
@@ -1033,6 +1554,30 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     } else {
       *output = new MemoryDataset(ctx, input, /*cache=*/nullptr);
     }
+  } else if (persistent_chunk_size_bytes_ > 0) {
+    // Key the cache by the input's graph so that a changed input pipeline does
+    // not reuse stale elements.
+    SerializationContext::Params params;
+    std::vector<std::pair<string, Tensor>> input_list;
+    params.input_list = &input_list;
+    params.check_external_state = false;
+    GraphDef graph_def;
+    OP_REQUIRES_OK(
+        ctx, AsGraphDef(ctx, input, SerializationContext(params), &graph_def));
+    uint64 hash;
+    OP_REQUIRES_OK(ctx, HashGraph(graph_def, &hash));
+    string fingerprint =
+        strings::StrCat(strings::Hex(hash, strings::kZeroPad16));
+    if (op_version_ == 2) {
+      *output = new PersistentFileDatasetV2(
+          ctx, input, filename, std::move(fingerprint),
+          persistent_chunk_size_bytes_, ctx->env(), ctx->input(2));
+    } else {
+      *output = new PersistentFileDataset(ctx, input, filename,
+                                          std::move(fingerprint),
+                                          persistent_chunk_size_bytes_,
+                                          ctx->env());
+    }
   } else {
     if (op_version_ == 2) {
       *output =
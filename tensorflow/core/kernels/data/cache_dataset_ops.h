@@ -24,12 +24,15 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
  public:
   class FileDataset;
   class MemoryDataset;
+  class PersistentFileDataset;
 
   static constexpr const char* const kDatasetType = "Cache";
   static constexpr const char* const kInputDataset = "input_dataset";
   static constexpr const char* const kFileName = "filename";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kPersistentChunkSizeBytes =
+      "persistent_chunk_size_bytes";
 
   explicit CacheDatasetOp(OpKernelConstruction* ctx);
 
@@ -40,8 +43,12 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
  private:
   class FileDatasetV2;
   class MemoryDatasetV2;
+  class PersistentFileDatasetV2;
 
   int op_version_;
+  // If positive, file caches are persistent and written in chunks of about
+  // this many bytes.
+  int64 persistent_chunk_size_bytes_ = 0;
 };
 
 }  // namespace data
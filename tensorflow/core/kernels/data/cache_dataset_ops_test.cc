@@ -12,6 +12,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
 #include "tensorflow/core/kernels/data/dataset_test_base.h"
+#include "tensorflow/core/lib/io/path.h"
 
 namespace tensorflow {
 namespace data {
@@ -27,10 +28,11 @@ class CacheDatasetParams : public DatasetParams {
   CacheDatasetParams(T input_dataset_params, string filename,
                      DataTypeVector output_dtypes,
                      std::vector<PartialTensorShape> output_shapes,
-                     string node_name)
+                     string node_name, int64 persistent_chunk_size_bytes = 0)
       : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
                       std::move(node_name)),
-        filename_(filename) {
+        filename_(filename),
+        persistent_chunk_size_bytes_(persistent_chunk_size_bytes) {
     input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
     iterator_prefix_ =
         name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
@@ -51,6 +53,10 @@ class CacheDatasetParams : public DatasetParams {
   Status GetAttributes(AttributeVector* attr_vector) const override {
     *attr_vector = {{CacheDatasetOp::kOutputTypes, output_dtypes_},
                     {CacheDatasetOp::kOutputShapes, output_shapes_}};
+    if (persistent_chunk_size_bytes_ > 0) {
+      attr_vector->emplace_back(CacheDatasetOp::kPersistentChunkSizeBytes,
+                                persistent_chunk_size_bytes_);
+    }
     return Status::OK();
   }
 
@@ -60,6 +66,7 @@ class CacheDatasetParams : public DatasetParams {
 
  private:
   string filename_;
+  int64 persistent_chunk_size_bytes_;
 };
 
 class CacheDatasetOpTest : public DatasetOpsTestBaseV2 {
@@ -81,7 +88,13 @@ class CacheDatasetOpTest : public DatasetOpsTestBaseV2 {
                      << "* : " << s.ToString();
       }
       for (const string& path : cache_files) {
-        s = device_->env()->DeleteFile(path);
+        if (device_->env()->IsDirectory(path).ok()) {
+          int64 undeleted_files, undeleted_dirs;
+          s = device_->env()->DeleteRecursively(path, &undeleted_files,
+                                                &undeleted_dirs);
+        } else {
+          s = device_->env()->DeleteFile(path);
+        }
         if (!s.ok()) {
           LOG(WARNING) << "Failed to delete " << path << " : " << s.ToString();
         }
@@ -143,6 +156,48 @@ CacheDatasetParams CacheDatasetParams4() {
                             kNodeName);
 }
 
+// Test case 5: cache data in a persistent file cache, one element per chunk.
+CacheDatasetParams CacheDatasetParams5() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64>(TensorShape{3, 3, 1},
+                                          {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/absl::StrCat(testing::TmpDir(), "/cache_data_persistent"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({3, 1})}, kNodeName,
+      /*persistent_chunk_size_bytes=*/1);
+}
+
+// Test case 6: cache empty data in a persistent file cache.
+CacheDatasetParams CacheDatasetParams6() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64>(TensorShape{0}, {})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/absl::StrCat(testing::TmpDir(), "/cache_data_persistent"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})}, kNodeName,
+      /*persistent_chunk_size_bytes=*/1);
+}
+
+// Test case 7: cache data in a persistent file cache, two elements per chunk.
+CacheDatasetParams CacheDatasetParams7() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64>(TensorShape{3, 3, 1},
+                                          {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+      /*node_name=*/"tensor_slice");
+  return CacheDatasetParams(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/
+      absl::StrCat(testing::TmpDir(), "/cache_data_persistent_chunks"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({3, 1})}, kNodeName,
+      /*persistent_chunk_size_bytes=*/48);
+}
+
 std::vector<GetNextTestCase<CacheDatasetParams>> GetNextTestCases() {
   return {{/*dataset_params=*/CacheDatasetParams1(),
            /*expected_outputs=*/
@@ -155,7 +210,17 @@ std::vector<GetNextTestCase<CacheDatasetParams>> GetNextTestCases() {
            CreateTensors<int64>(TensorShape({3, 1}),
                                 {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
           {/*dataset_params=*/CacheDatasetParams4(),
-           /*expected_outputs=*/{}}};
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams5(),
+           /*expected_outputs=*/
+           CreateTensors<int64>(TensorShape({3, 1}),
+                                {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
+          {/*dataset_params=*/CacheDatasetParams6(),
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams7(),
+           /*expected_outputs=*/
+           CreateTensors<int64>(TensorShape({3, 1}),
+                                {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})}};
 }
 
 class ParameterizedGetNextTest : public CacheDatasetOpTest,
@@ -197,6 +262,138 @@ TEST_P(ParameterizedGetNextTest, GetNext) {
 INSTANTIATE_TEST_SUITE_P(CacheDatasetOpTest, ParameterizedGetNextTest,
                          ::testing::ValuesIn(GetNextTestCases()));
 
+TEST_F(CacheDatasetOpTest, PersistentCacheResumesPartialWrite) {
+  auto dataset_params = CacheDatasetParams5();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> expected_outputs = CreateTensors<int64>(
+      TensorShape({3, 1}), {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+
+  // Write the first chunk only, then abandon the iterator.
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  TF_EXPECT_OK(ExpectEqual(out_tensors.back(), expected_outputs[0]));
+  TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                  &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  iterator_.reset();
+
+  // A new iterator reads the sealed chunk and writes the rest.
+  TF_ASSERT_OK(dataset_->MakeIterator(
+      iterator_ctx_.get(), dataset_params.iterator_prefix(), &iterator_));
+  out_tensors.clear();
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
+TEST_F(CacheDatasetOpTest, PersistentCacheCheckpointDoesNotSealChunk) {
+  auto dataset_params = CacheDatasetParams7();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorData data;
+  VariantTensorDataWriter writer(&data);
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  TF_ASSERT_OK(writer.Flush());
+  std::vector<string> sealed;
+  TF_ASSERT_OK(device_->env()->GetMatchingPaths(
+      io::JoinPath(cache_filename_, "*", "*.index"), &sealed));
+  EXPECT_TRUE(sealed.empty());
+
+  // The restored iterator recomputes the first element of the chunk.
+  VariantTensorDataReader reader(&data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  out_tensors.clear();
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      out_tensors,
+      CreateTensors<int64>(TensorShape({3, 1}), {{3, 4, 5}, {6, 7, 8}}),
+      /*compare_order=*/true));
+
+  // A reader sees the chunk in full.
+  TF_ASSERT_OK(dataset_->MakeIterator(
+      iterator_ctx_.get(), dataset_params.iterator_prefix(), &iterator_));
+  end_of_sequence = false;
+  out_tensors.clear();
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      out_tensors,
+      CreateTensors<int64>(TensorShape({3, 1}),
+                           {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}}),
+      /*compare_order=*/true));
+}
+
+TEST_F(CacheDatasetOpTest, PersistentCacheCopiesWithDifferentBoundaries) {
+  // Writer `a` seals one element per chunk and writer `b` two, in the same
+  // cache directory.
+  auto a_params = CacheDatasetParams5();
+  auto b_params = CacheDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64>(TensorShape{3, 3, 1},
+                                              {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+          /*node_name=*/"tensor_slice"),
+      a_params.filename(), /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({3, 1})}, kNodeName,
+      /*persistent_chunk_size_bytes=*/48);
+  TF_ASSERT_OK(Initialize(a_params));
+  std::unique_ptr<TestDataset> b_dataset;
+  TF_ASSERT_OK(MakeDataset(b_params, &b_dataset));
+  std::unique_ptr<TestIterator> b;
+  TF_ASSERT_OK(MakeIterator(b_params, *b_dataset, &b));
+  std::vector<Tensor> expected_outputs = CreateTensors<int64>(
+      TensorShape({3, 1}), {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+
+  // `b` starts chunk 0, then `a` seals its copy of chunk 0 holding element 0
+  // and of chunk 1 holding element 1, then `b` seals its copy of chunk 0
+  // holding elements 0 and 1.
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(b->GetNext(&out_tensors, &end_of_sequence));
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  TF_ASSERT_OK(b->GetNext(&out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+
+  // Whichever copy of chunk 0 a reader picks, it reads every element once.
+  std::unique_ptr<TestIterator> reader;
+  TF_ASSERT_OK(MakeIterator(b_params, *b_dataset, &reader));
+  out_tensors.clear();
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(reader->GetNext(&next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
 TEST_F(CacheDatasetOpTest, DatasetNodeName) {
   auto dataset_params = CacheDatasetParams1();
   TF_ASSERT_OK(Initialize(dataset_params));
@@ -296,7 +493,20 @@ IteratorSaveAndRestoreTestCases() {
                                 {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
           {/*dataset_params=*/CacheDatasetParams4(),
            /*breakpoints=*/{0, 2, 4, 11},
-           /*expected_outputs=*/{}}};
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams5(),
+           /*breakpoints=*/{0, 2, 4, 11},
+           /*expected_outputs=*/
+           CreateTensors<int64>(TensorShape({3, 1}),
+                                {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})},
+          {/*dataset_params=*/CacheDatasetParams6(),
+           /*breakpoints=*/{0, 2, 4, 11},
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/CacheDatasetParams7(),
+           /*breakpoints=*/{0, 2, 4, 11},
+           /*expected_outputs=*/
+           CreateTensors<int64>(TensorShape({3, 1}),
+                                {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}})}};
 }
 
 class ParameterizedIteratorSaveAndRestoreTest
@@ -17,6 +17,7 @@ limitations under the License.
 #include <atomic>
 #include <utility>
 
+#include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/common_runtime/input_colocation_exemption_registry.h"
 #include "tensorflow/core/common_runtime/metrics.h"
@@ -55,6 +56,10 @@ namespace experimental {
 
 // Maximum number of batch results to buffer.
 constexpr int64 kMaxBatchResults = 16;
+// Maximum number of batches handed to the consumer whose buffers are kept for
+// reuse. This covers a consumer that holds on to a few batches (e.g. a
+// downstream prefetch) while bounding the memory held by idle buffers.
+constexpr int64 kMaxRecycledBatches = 4;
 constexpr char kParallelism[] = "parallelism";
 constexpr char kCallCounter[] = "call_counter";
 constexpr char kBatchResultsSize[] = "batch_results_size";
@@ -447,6 +452,10 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
       if (result->output_allocated) {
         return Status::OK();
       }
+      if (TakeRecycledOutput(*return_values, &result->output)) {
+        result->output_allocated = true;
+        return Status::OK();
+      }
       const size_t num_components = return_values->size();
       for (size_t i = 0; i < num_components; ++i) {
         TensorShape component_shape({dataset()->batch_size_});
@@ -480,15 +489,13 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
         }
       }
       if (!result->status.ok() && !errors::IsOutOfRange(result->status)) {
-        // Deallocate tensors allocated for the output.
-        result->output.clear();
+        RecycleOutput(std::move(result->output));
         *end_of_sequence = false;
         return result->status;
       }
       if (result->num_elements < dataset()->batch_size_) {
         if (dataset()->drop_remainder_) {
-          // Deallocate tensors allocated for the output.
-          result->output.clear();
+          RecycleOutput(std::move(result->output));
           *end_of_sequence = true;
           return Status::OK();
         }
@@ -503,15 +510,84 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
           TF_RETURN_IF_ERROR(CopyPartialBatch(&out_tensors->back(), output[i],
                                               result->num_elements));
         }
-        // Deallocate tensors allocated for the output.
-        result->output.clear();
+        RecycleOutput(std::move(result->output));
       } else {
         *out_tensors = std::move(result->output);
+        // Keep a reference to the buffers handed to the consumer so that they
+        // can be reused once the consumer releases them.
+        RecycleOutput(*out_tensors);
       }
       *end_of_sequence = false;
       return Status::OK();
     }
 
+    // Adds the batch buffers in `output` to the pool of buffers to reuse,
+    // evicting the oldest batch if the pool is full.
+    void RecycleOutput(std::vector<Tensor> output) {
+      if (output.empty()) {
+        return;
+      }
+      for (const Tensor& t : output) {
+        if (!DataTypeCanUseMemcpy(t.dtype())) {
+          return;
+        }
+      }
+      mutex_lock l(recycle_mu_);
+      if (recycled_outputs_.size() >= kMaxRecycledBatches) {
+        recycled_outputs_.pop_front();
+      }
+      recycled_outputs_.push_back(std::move(output));
+    }
+
+    // Moves into `output` a batch from the pool whose buffers are no longer
+    // referenced outside of the pool and whose shapes fit `return_values`.
+    // Returns false if there is no such batch.
+    bool TakeRecycledOutput(const std::vector<Tensor>& return_values,
+                            std::vector<Tensor>* output) {
+      mutex_lock l(recycle_mu_);
+      for (auto it = recycled_outputs_.begin(); it != recycled_outputs_.end();
+           ++it) {
+        bool released = true;
+        for (Tensor& t : *it) {
+          // The pool holds the only reference once the consumer, and any
+          // slice or alias it took, has dropped the batch.
+          if (!DMAHelper::buffer(&t)->RefCountIsOne()) {
+            released = false;
+            break;
+          }
+        }
+        if (!released) {
+          continue;
+        }
+        if (!OutputFits(*it, return_values)) {
+          // The element shapes have changed, so the buffers are unlikely to be
+          // reused.
+          recycled_outputs_.erase(it);
+          return false;
+        }
+        *output = std::move(*it);
+        recycled_outputs_.erase(it);
+        return true;
+      }
+      return false;
+    }
+
+    bool OutputFits(const std::vector<Tensor>& output,
+                    const std::vector<Tensor>& return_values) {
+      if (output.size() != return_values.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < output.size(); ++i) {
+        TensorShape component_shape({dataset()->batch_size_});
+        component_shape.AppendShape(return_values[i].shape());
+        if (output[i].dtype() != return_values[i].dtype() ||
+            output[i].shape() != component_shape) {
+          return false;
+        }
+      }
+      return true;
+    }
+
     void RunnerThread(const std::shared_ptr<IteratorContext>& ctx)
         LOCKS_EXCLUDED(*mu_) {
       std::vector<std::pair<std::shared_ptr<BatchResult>, int64>> new_calls;
@@ -723,6 +799,10 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
     // Identifies the maximum number of batch results to store.
     int64 max_batch_results_ GUARDED_BY(*mu_);
     std::unique_ptr<InstantiatedCapturedFunction> instantiated_captured_func_;
+    mutex recycle_mu_;
+    // Batch buffers that were handed to the consumer or discarded, and can be
+    // reused for a new batch once nothing outside of the pool references them.
+    std::deque<std::vector<Tensor>> recycled_outputs_ GUARDED_BY(recycle_mu_);
   };
 
   const DatasetBase* const input_;
@@ -419,6 +419,45 @@ TEST_F(MapAndBatchDatasetOpTest, InvalidNumParallel) {
             tensorflow::error::INVALID_ARGUMENT);
 }
 
+TEST_F(MapAndBatchDatasetOpTest, RecycledBatchesDoNotOverwriteHeldBatches) {
+  auto dataset_params = MapAndBatchDatasetParams(
+      RangeDatasetParams(0, 40, 1),
+      /*other_arguments=*/{},
+      /*batch_size=*/2,
+      /*num_parallel_calls=*/2,
+      /*drop_remainder=*/true,
+      /*func=*/MapFunc("XTimesTwo", DT_INT64),
+      /*func_lib=*/{test::function::XTimesTwo()},
+      /*type_arguments*/ {},
+      /*preserve_cardinality=*/false,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({2})},
+      /*node_name=*/kNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+
+  // Hold on to every other batch, so that the iterator can only reuse the
+  // buffers of the batches that were released.
+  std::vector<Tensor> held_batches;
+  bool end_of_sequence = false;
+  for (int i = 0; !end_of_sequence; ++i) {
+    std::vector<Tensor> batch;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &batch, &end_of_sequence));
+    if (end_of_sequence) break;
+    ASSERT_EQ(1, batch.size());
+    test::ExpectTensorEqual<int64>(
+        batch[0], test::AsTensor<int64>({4 * i, 4 * i + 2}));
+    if (i % 2 == 0) {
+      held_batches.push_back(batch[0]);
+    }
+  }
+  ASSERT_EQ(10, held_batches.size());
+  for (int i = 0; i < held_batches.size(); ++i) {
+    test::ExpectTensorEqual<int64>(
+        held_batches[i], test::AsTensor<int64>({8 * i, 8 * i + 2}));
+  }
+}
+
 }  // namespace
 }  // namespace experimental
 }  // namespace data
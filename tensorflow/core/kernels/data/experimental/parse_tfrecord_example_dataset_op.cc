@@ -0,0 +1,559 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <map>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/metrics.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/stats_aggregator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/stats_utils.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/util/example_proto_fast_parsing.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kDatasetType[] = "ParseTFRecordExample";
+constexpr char kCurrentFileIndex[] = "current_file_index";
+constexpr char kOffset[] = "offset";
+constexpr char kNumRecords[] = "num_records";
+constexpr char kRecord[] = "record";
+
+// Reads batches of serialized `Example` protos from TFRecord files and parses
+// each batch with a single call to `FastParseExample`. This is equivalent to
+// `TFRecordDataset(...).batch(...).apply(parse_example_dataset(...))`, but the
+// records of a batch are never materialized as individual string tensors and
+// only one `GetNext` call is made per batch.
+class ParseTFRecordExampleDatasetOp : public DatasetOpKernel {
+ public:
+  explicit ParseTFRecordExampleDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("sparse_keys", &sparse_keys_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("dense_keys", &dense_keys_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("sparse_types", &sparse_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("Tdense", &dense_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("dense_shapes", &dense_shapes_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("ragged_keys", &ragged_keys_));
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr("ragged_value_types", &ragged_value_types_));
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr("ragged_split_types", &ragged_split_types_));
+    for (int i = 0; i < dense_shapes_.size(); ++i) {
+      bool shape_ok = true;
+      if (dense_shapes_[i].dims() == -1) {
+        shape_ok = false;
+      } else {
+        for (int d = 1; d < dense_shapes_[i].dims(); ++d) {
+          if (dense_shapes_[i].dim_size(d) == -1) {
+            shape_ok = false;
+          }
+        }
+      }
+      OP_REQUIRES(ctx, shape_ok,
+                  errors::InvalidArgument(
+                      "dense_shapes[", i,
+                      "] has unknown rank or unknown inner dimensions: ",
+                      dense_shapes_[i].DebugString()));
+      TensorShape dense_shape;
+      if (dense_shapes_[i].dims() > 0 && dense_shapes_[i].dim_size(0) == -1) {
+        variable_length_.push_back(true);
+        for (int d = 1; d < dense_shapes_[i].dims(); ++d) {
+          dense_shape.AddDim(dense_shapes_[i].dim_size(d));
+        }
+      } else {
+        variable_length_.push_back(false);
+        dense_shapes_[i].AsTensorShape(&dense_shape);
+      }
+      elements_per_stride_.push_back(dense_shape.num_elements());
+    }
+    metrics::RecordParseDenseFeature(dense_keys_.size());
+    metrics::RecordParseSparseFeature(sparse_keys_.size());
+  }
+
+ protected:
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    const Tensor* filenames_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("filenames", &filenames_tensor));
+    OP_REQUIRES(
+        ctx, filenames_tensor->dims() <= 1,
+        errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+    std::vector<string> filenames;
+    filenames.reserve(filenames_tensor->NumElements());
+    for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+      filenames.push_back(filenames_tensor->flat<tstring>()(i));
+    }
+
+    tstring compression_type;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, "compression_type",
+                                                     &compression_type));
+
+    int64 buffer_size = -1;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, "buffer_size", &buffer_size));
+    OP_REQUIRES(ctx, buffer_size >= 0,
+                errors::InvalidArgument(
+                    "`buffer_size` must be >= 0 (0 == no buffering)"));
+
+    int64 batch_size = 0;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<int64>(ctx, "batch_size", &batch_size));
+    OP_REQUIRES(ctx, batch_size > 0,
+                errors::InvalidArgument("`batch_size` must be > 0"));
+
+    bool drop_remainder = false;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<bool>(ctx, "drop_remainder",
+                                                  &drop_remainder));
+
+    OpInputList dense_default_tensors;
+    OP_REQUIRES_OK(ctx,
+                   ctx->input_list("dense_defaults", &dense_default_tensors));
+    OP_REQUIRES(ctx, dense_default_tensors.size() == dense_keys_.size(),
+                errors::InvalidArgument(
+                    "Expected len(dense_defaults) == len(dense_keys) but got: ",
+                    dense_default_tensors.size(), " vs. ", dense_keys_.size()));
+    std::vector<Tensor> dense_defaults(dense_default_tensors.begin(),
+                                       dense_default_tensors.end());
+    for (int d = 0; d < dense_keys_.size(); ++d) {
+      const Tensor& def_value = dense_defaults[d];
+      if (variable_length_[d]) {
+        OP_REQUIRES(ctx, def_value.NumElements() == 1,
+                    errors::InvalidArgument(
+                        "dense_shape[", d, "] is a variable length shape: ",
+                        dense_shapes_[d].DebugString(),
+                        ", therefore def_value[", d,
+                        "] must contain a single element (the padding "
+                        "element).  But its shape is: ",
+                        def_value.shape().DebugString()));
+      } else if (def_value.NumElements() > 0) {
+        OP_REQUIRES(ctx, dense_shapes_[d].IsCompatibleWith(def_value.shape()),
+                    errors::InvalidArgument(
+                        "def_value[", d,
+                        "].shape() == ", def_value.shape().DebugString(),
+                        " is not compatible with dense_shapes_[", d,
+                        "] == ", dense_shapes_[d].DebugString()));
+      }
+      OP_REQUIRES(ctx, def_value.dtype() == dense_types_[d],
+                  errors::InvalidArgument(
+                      "dense_defaults[", d, "].dtype() == ",
+                      DataTypeString(def_value.dtype()), " != dense_types_[", d,
+                      "] == ", DataTypeString(dense_types_[d])));
+    }
+
+    example::FastParseExampleConfig config;
+    std::map<string, int> key_to_output_index;
+    for (int d = 0; d < dense_keys_.size(); ++d) {
+      config.dense.push_back({dense_keys_[d], dense_types_[d], dense_shapes_[d],
+                              dense_defaults[d], variable_length_[d],
+                              elements_per_stride_[d]});
+      auto result = key_to_output_index.insert({dense_keys_[d], 0});
+      OP_REQUIRES(ctx, result.second,
+                  errors::InvalidArgument("Duplicate key not allowed: ",
+                                          dense_keys_[d]));
+    }
+    for (int d = 0; d < sparse_keys_.size(); ++d) {
+      config.sparse.push_back({sparse_keys_[d], sparse_types_[d]});
+      auto result = key_to_output_index.insert({sparse_keys_[d], 0});
+      OP_REQUIRES(ctx, result.second,
+                  errors::InvalidArgument("Duplicate key not allowed: ",
+                                          sparse_keys_[d]));
+    }
+    for (int d = 0; d < ragged_keys_.size(); ++d) {
+      config.ragged.push_back(
+          {ragged_keys_[d], ragged_value_types_[d], ragged_split_types_[d]});
+      auto result = key_to_output_index.insert({ragged_keys_[d], 0});
+      OP_REQUIRES(ctx, result.second,
+                  errors::InvalidArgument("Duplicate key not allowed: ",
+                                          ragged_keys_[d]));
+    }
+    int i = 0;
+    for (auto it = key_to_output_index.begin(); it != key_to_output_index.end();
+         it++) {
+      it->second = i++;
+    }
+
+    *output = new Dataset(
+        ctx, std::move(filenames), compression_type, buffer_size, batch_size,
+        drop_remainder, std::move(dense_defaults), std::move(key_to_output_index),
+        std::move(config), this);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, std::vector<string> filenames,
+            const string& compression_type, int64 buffer_size,
+            int64 batch_size, bool drop_remainder,
+            std::vector<Tensor> dense_defaults,
+            std::map<string, int> key_to_output_index,
+            example::FastParseExampleConfig config,
+            const ParseTFRecordExampleDatasetOp* op)
+        : DatasetBase(DatasetContext(ctx)),
+          filenames_(std::move(filenames)),
+          compression_type_(compression_type),
+          options_(io::RecordReaderOptions::CreateRecordReaderOptions(
+              compression_type)),
+          batch_size_(batch_size),
+          drop_remainder_(drop_remainder),
+          dense_defaults_(std::move(dense_defaults)),
+          key_to_output_index_(std::move(key_to_output_index)),
+          config_(std::move(config)),
+          sparse_keys_(op->sparse_keys_),
+          dense_keys_(op->dense_keys_),
+          ragged_keys_(op->ragged_keys_),
+          sparse_types_(op->sparse_types_),
+          dense_types_(op->dense_types_),
+          ragged_value_types_(op->ragged_value_types_),
+          ragged_split_types_(op->ragged_split_types_),
+          dense_shapes_(op->dense_shapes_),
+          output_types_(op->output_types_),
+          output_shapes_(op->output_shapes_) {
+      if (buffer_size > 0) {
+        options_.buffer_size = buffer_size;
+      }
+    }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::", kDatasetType)});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_types_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override {
+      return "ParseTFRecordExampleDatasetOp::Dataset";
+    }
+
+    Status CheckExternalState() const override { return Status::OK(); }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* filenames = nullptr;
+      TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+      Node* compression_type = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
+      Node* buffer_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
+      Node* batch_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+      Node* drop_remainder = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(drop_remainder_, &drop_remainder));
+      std::vector<Node*> dense_defaults_nodes;
+      dense_defaults_nodes.reserve(dense_defaults_.size());
+      for (const Tensor& dense_default : dense_defaults_) {
+        Node* node;
+        TF_RETURN_IF_ERROR(b->AddTensor(dense_default, &node));
+        dense_defaults_nodes.emplace_back(node);
+      }
+
+      AttrValue sparse_keys_attr;
+      AttrValue dense_keys_attr;
+      AttrValue sparse_types_attr;
+      AttrValue dense_attr;
+      AttrValue dense_shapes_attr;
+      AttrValue ragged_keys_attr;
+      AttrValue ragged_value_types_attr;
+      AttrValue ragged_split_types_attr;
+      b->BuildAttrValue(sparse_keys_, &sparse_keys_attr);
+      b->BuildAttrValue(dense_keys_, &dense_keys_attr);
+      b->BuildAttrValue(sparse_types_, &sparse_types_attr);
+      b->BuildAttrValue(dense_types_, &dense_attr);
+      b->BuildAttrValue(dense_shapes_, &dense_shapes_attr);
+      b->BuildAttrValue(ragged_keys_, &ragged_keys_attr);
+      b->BuildAttrValue(ragged_value_types_, &ragged_value_types_attr);
+      b->BuildAttrValue(ragged_split_types_, &ragged_split_types_attr);
+
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this,
+                        {{0, filenames},
+                         {1, compression_type},
+                         {2, buffer_size},
+                         {3, batch_size},
+                         {4, drop_remainder}},
+                        {{5, dense_defaults_nodes}},
+                        {{"sparse_keys", sparse_keys_attr},
+                         {"dense_keys", dense_keys_attr},
+                         {"sparse_types", sparse_types_attr},
+                         {"Tdense", dense_attr},
+                         {"dense_shapes", dense_shapes_attr},
+                         {"ragged_keys", ragged_keys_attr},
+                         {"ragged_value_types", ragged_value_types_attr},
+                         {"ragged_split_types", ragged_split_types_attr}},
+                        output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        std::vector<tstring> records;
+        {
+          mutex_lock l(mu_);
+          TF_RETURN_IF_ERROR(ReadRecordsLocked(ctx));
+          records.swap(records_);
+        }
+        if (records.empty() || (dataset()->drop_remainder_ &&
+                                records.size() < dataset()->batch_size_)) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        *end_of_sequence = false;
+
+        example::FastParseExampleConfig config = dataset()->config_;
+        auto stats_aggregator = ctx->stats_aggregator();
+        if (stats_aggregator) {
+          config.collect_feature_stats = true;
+        }
+        thread::ThreadPool* device_threadpool =
+            ctx->flr()->device()->tensorflow_cpu_worker_threads()->workers;
+        example::Result example_result;
+        TF_RETURN_IF_ERROR(FastParseExample(config, records, {},
+                                            device_threadpool,
+                                            &example_result));
+        BuildOutputs(ctx, &example_result, out_tensors);
+        if (stats_aggregator) {
+          stats_aggregator->IncrementCounter(
+              stats_utils::kExamplesCount, "trainer",
+              example_result.feature_stats.size());
+          for (const example::PerExampleFeatureStats& feature_stats :
+               example_result.feature_stats) {
+            stats_aggregator->IncrementCounter(stats_utils::kFeaturesCount,
+                                               "trainer",
+                                               feature_stats.features_count);
+            stats_aggregator->IncrementCounter(
+                stats_utils::kFeatureValuesCount, "trainer",
+                feature_stats.feature_values_count);
+          }
+        }
+        return Status::OK();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeSourceNode(std::move(args));
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCurrentFileIndex),
+                                               current_file_index_));
+        if (reader_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
+        }
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(kNumRecords), static_cast<int64>(records_.size())));
+        for (size_t i = 0; i < records_.size(); ++i) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat(kRecord, "[", i, "]")), records_[i]));
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        ResetStreamsLocked();
+        int64 current_file_index;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kCurrentFileIndex),
+                                              &current_file_index));
+        current_file_index_ = size_t(current_file_index);
+        if (reader->Contains(full_name(kOffset))) {
+          int64 offset;
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
+          TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
+        int64 num_records;
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name(kNumRecords), &num_records));
+        records_.resize(num_records);
+        for (int64 i = 0; i < num_records; ++i) {
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat(kRecord, "[", i, "]")), &records_[i]));
+        }
+        return Status::OK();
+      }
+
+     private:
+      // Reads records into `records_` until it holds `batch_size` of them,
+      // moving on to the next file whenever the current one is exhausted.
+      Status ReadRecordsLocked(IteratorContext* ctx)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        records_.reserve(dataset()->batch_size_);
+        int64 num_bytes = 0;
+        Status s;
+        while (records_.size() < dataset()->batch_size_) {
+          if (reader_) {
+            records_.emplace_back();
+            s = reader_->ReadRecord(&records_.back());
+            if (s.ok()) {
+              num_bytes += records_.back().size();
+              continue;
+            }
+            records_.pop_back();
+            ResetStreamsLocked();
+            ++current_file_index_;
+            if (!errors::IsOutOfRange(s)) {
+              // As in `TFRecordDataset`, move on to the next file so that
+              // the error can be ignored without repeating the same file.
+              // The records read so far stay in `records_` and start the
+              // batch of the next call.
+              break;
+            }
+            s = Status::OK();
+          }
+          if (current_file_index_ == dataset()->filenames_.size()) {
+            break;
+          }
+          s = SetupStreamsLocked(ctx->env());
+          if (!s.ok()) {
+            break;
+          }
+        }
+        metrics::RecordTFDataBytesRead(kDatasetType, num_bytes);
+        return s;
+      }
+
+      // Moves the parsed values of `example_result` into `out_tensors`, in
+      // the order of `key_to_output_index`.
+      void BuildOutputs(IteratorContext* ctx, example::Result* example_result,
+                        std::vector<Tensor>* out_tensors) {
+        const Dataset* dataset = this->dataset();
+        out_tensors->resize(dataset->key_to_output_index_.size());
+        for (int d = 0; d < dataset->dense_keys_.size(); ++d) {
+          int output_index =
+              dataset->key_to_output_index_.at(dataset->dense_keys_[d]);
+          (*out_tensors)[output_index] =
+              std::move(example_result->dense_values[d]);
+        }
+        for (int d = 0; d < dataset->sparse_keys_.size(); ++d) {
+          int output_index =
+              dataset->key_to_output_index_.at(dataset->sparse_keys_[d]);
+          Tensor serialized_sparse(ctx->allocator({}), DT_VARIANT, {3});
+          auto serialized_sparse_t = serialized_sparse.vec<Variant>();
+          serialized_sparse_t(0) = example_result->sparse_indices[d];
+          serialized_sparse_t(1) = example_result->sparse_values[d];
+          serialized_sparse_t(2) = example_result->sparse_shapes[d];
+          (*out_tensors)[output_index] = std::move(serialized_sparse);
+        }
+        for (int d = 0; d < dataset->ragged_keys_.size(); ++d) {
+          int output_index =
+              dataset->key_to_output_index_.at(dataset->ragged_keys_[d]);
+          Tensor serialized_ragged(ctx->allocator({}), DT_VARIANT, {2});
+          auto serialized_ragged_t = serialized_ragged.vec<Variant>();
+          serialized_ragged_t(0) = example_result->ragged_splits[d];
+          serialized_ragged_t(1) = example_result->ragged_values[d];
+          Tensor ragged_wrapper(ctx->allocator({}), DT_VARIANT, {});
+          ragged_wrapper.scalar<Variant>()() = serialized_ragged;
+          (*out_tensors)[output_index] = std::move(ragged_wrapper);
+        }
+      }
+
+      // Sets up reader streams to read from the file at
+      // `current_file_index_`.
+      Status SetupStreamsLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (current_file_index_ >= dataset()->filenames_.size()) {
+          return errors::InvalidArgument(
+              "current_file_index_:", current_file_index_,
+              " >= filenames_.size():", dataset()->filenames_.size());
+        }
+        TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
+            dataset()->filenames_[current_file_index_], &file_));
+        reader_ = absl::make_unique<io::SequentialRecordReader>(
+            file_.get(), dataset()->options_);
+        return Status::OK();
+      }
+
+      // Resets all reader streams.
+      void ResetStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        reader_.reset();
+        file_.reset();
+      }
+
+      mutex mu_;
+      size_t current_file_index_ GUARDED_BY(mu_) = 0;
+
+      // `reader_` will borrow the object that `file_` points to, so
+      // we must destroy `reader_` before `file_`.
+      std::unique_ptr<RandomAccessFile> file_ GUARDED_BY(mu_);
+      std::unique_ptr<io::SequentialRecordReader> reader_ GUARDED_BY(mu_);
+      // Records of the batch being read.
+      std::vector<tstring> records_ GUARDED_BY(mu_);
+    };
+
+    const std::vector<string> filenames_;
+    const tstring compression_type_;
+    io::RecordReaderOptions options_;
+    const int64 batch_size_;
+    const bool drop_remainder_;
+    const std::vector<Tensor> dense_defaults_;
+    const std::map<string, int> key_to_output_index_;
+    const example::FastParseExampleConfig config_;
+    const std::vector<string> sparse_keys_;
+    const std::vector<string> dense_keys_;
+    const std::vector<string> ragged_keys_;
+    const DataTypeVector sparse_types_;
+    const DataTypeVector dense_types_;
+    const DataTypeVector ragged_value_types_;
+    const DataTypeVector ragged_split_types_;
+    const std::vector<PartialTensorShape> dense_shapes_;
+    const DataTypeVector output_types_;
+    const std::vector<PartialTensorShape> output_shapes_;
+  };
+
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+  std::vector<string> sparse_keys_;
+  std::vector<string> dense_keys_;
+  std::vector<string> ragged_keys_;
+  DataTypeVector sparse_types_;
+  DataTypeVector dense_types_;
+  DataTypeVector ragged_value_types_;
+  DataTypeVector ragged_split_types_;
+  std::vector<PartialTensorShape> dense_shapes_;
+  std::vector<bool> variable_length_;
+  std::vector<std::size_t> elements_per_stride_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("ParseTFRecordExampleDataset").Device(DEVICE_CPU),
+                        ParseTFRecordExampleDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,397 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/function_handle_cache.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/kernels/data/experimental/shared_memory_ring_buffer.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// See documentation in ../../ops/experimental_dataset_ops.cc for a high-level
+// description of the following ops.
+
+constexpr char kRoundRobin[] = "round_robin";
+constexpr char kShard[] = "shard";
+constexpr int64 kAttachRetryMicros = 1000;
+
+// Returns the name of the ring buffer that feeds consumer `consumer_index` of
+// the service `service_name`.
+string BufferName(const string& service_name, int64 consumer_index) {
+  return strings::StrCat("tf_data_", service_name, "_", consumer_index);
+}
+
+// Serializes `components` as a sequence of length-prefixed `TensorProto`s.
+void EncodeElement(const std::vector<Tensor>& components, string* record) {
+  record->clear();
+  TensorProto proto;
+  string serialized;
+  for (const Tensor& component : components) {
+    proto.Clear();
+    component.AsProtoTensorContent(&proto);
+    proto.SerializeToString(&serialized);
+    core::PutVarint64(record, serialized.size());
+    record->append(serialized);
+  }
+}
+
+Status DecodeElement(StringPiece record, const DataTypeVector& dtypes,
+                     std::vector<Tensor>* components) {
+  TensorProto proto;
+  while (!record.empty()) {
+    uint64 size;
+    if (!core::GetVarint64(&record, &size) || size > record.size()) {
+      return errors::DataLoss("Malformed element in shared memory buffer.");
+    }
+    if (!proto.ParseFromArray(record.data(), size)) {
+      return errors::DataLoss("Malformed tensor in shared memory buffer.");
+    }
+    record.remove_prefix(size);
+    components->emplace_back();
+    if (!components->back().FromProto(proto)) {
+      return errors::DataLoss("Malformed tensor in shared memory buffer.");
+    }
+  }
+  if (components->size() != dtypes.size()) {
+    return errors::InvalidArgument("Expected elements with ", dtypes.size(),
+                                   " components but got ", components->size(),
+                                   ".");
+  }
+  for (size_t i = 0; i < dtypes.size(); ++i) {
+    if ((*components)[i].dtype() != dtypes[i]) {
+      return errors::InvalidArgument(
+          "Expected component ", i, " to have type ",
+          DataTypeString(dtypes[i]), " but got ",
+          DataTypeString((*components)[i].dtype()), ".");
+    }
+  }
+  return Status::OK();
+}
+
+class DatasetToSharedMemoryOp : public AsyncOpKernel {
+ public:
+  explicit DatasetToSharedMemoryOp(OpKernelConstruction* ctx)
+      : AsyncOpKernel(ctx),
+        background_worker_(ctx->env(), "tf_data_to_shared_memory") {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("sharding_policy", &sharding_policy_));
+    OP_REQUIRES(ctx,
+                sharding_policy_ == kRoundRobin || sharding_policy_ == kShard,
+                errors::InvalidArgument("Unsupported sharding policy: ",
+                                        sharding_policy_));
+  }
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    // The call to `iterator->GetNext()` may block and depend on an inter-op
+    // thread pool thread, so we issue the call using a background thread.
+    background_worker_.Schedule(std::bind(
+        [this, ctx](std::function<void()>& done) {
+          tstring service_name;
+          OP_REQUIRES_OK_ASYNC(ctx,
+                               ParseScalarArgument<tstring>(ctx, "service_name",
+                                                            &service_name),
+                               done);
+          int64 num_consumers;
+          OP_REQUIRES_OK_ASYNC(ctx,
+                               ParseScalarArgument<int64>(ctx, "num_consumers",
+                                                          &num_consumers),
+                               done);
+          OP_REQUIRES_ASYNC(
+              ctx, num_consumers > 0,
+              errors::InvalidArgument("num_consumers must be positive."), done);
+          int64 buffer_size;
+          OP_REQUIRES_OK_ASYNC(
+              ctx,
+              ParseScalarArgument<int64>(ctx, "buffer_size", &buffer_size),
+              done);
+
+          DatasetBase* dataset;
+          OP_REQUIRES_OK_ASYNC(
+              ctx, GetDatasetFromVariantTensor(ctx->input(0), &dataset), done);
+
+          IteratorContext::Params params(ctx);
+          FunctionHandleCache function_handle_cache(params.flr);
+          params.function_handle_cache = &function_handle_cache;
+          ResourceMgr resource_mgr;
+          params.resource_mgr = &resource_mgr;
+          CancellationManager cancellation_manager;
+          params.cancellation_manager = &cancellation_manager;
+          std::function<void()> deregister_fn;
+          OP_REQUIRES_OK_ASYNC(ctx,
+                               ConnectCancellationManagers(
+                                   ctx->cancellation_manager(),
+                                   params.cancellation_manager, &deregister_fn),
+                               done);
+
+          // Update the `done` callback to deregister the cancellation callback.
+          done = std::bind(
+              [](const std::function<void()>& done,
+                 const std::function<void()>& deregister_fn) {
+                deregister_fn();
+                done();
+              },
+              std::move(done), std::move(deregister_fn));
+
+          IteratorContext iter_ctx(std::move(params));
+          std::unique_ptr<IteratorBase> iterator;
+          OP_REQUIRES_OK_ASYNC(
+              ctx,
+              dataset->MakeIterator(&iter_ctx, "DatasetToSharedMemoryIterator",
+                                    &iterator),
+              done);
+
+          // Update the `done` callback to destroy the iterator before calling
+          // the actual callback to avoid destruction races.
+          IteratorBase* raw_iterator = iterator.release();
+          done = std::bind(
+              [raw_iterator](const std::function<void()>& done) {
+                delete raw_iterator;
+                done();
+              },
+              std::move(done));
+
+          std::vector<std::unique_ptr<SharedMemoryRingBuffer>> buffers(
+              num_consumers);
+          for (int64 i = 0; i < num_consumers; ++i) {
+            OP_REQUIRES_OK_ASYNC(
+                ctx,
+                SharedMemoryRingBuffer::Create(BufferName(service_name, i),
+                                               buffer_size, &buffers[i]),
+                done);
+          }
+          auto cancelled = [&cancellation_manager]() {
+            return cancellation_manager.IsCancelled();
+          };
+          Status s = Serve(&iter_ctx, raw_iterator, buffers, cancelled);
+          for (auto& buffer : buffers) {
+            if (s.ok()) {
+              buffer->Close();
+            } else {
+              buffer->Abort();
+            }
+          }
+          // Destroying the buffers removes their names, so wait for the
+          // consumers to read the remaining elements first.
+          for (auto& buffer : buffers) {
+            if (s.ok()) {
+              s = buffer->WaitUntilDrained(cancelled);
+            }
+          }
+          OP_REQUIRES_OK_ASYNC(ctx, s, done);
+          done();
+        },
+        std::move(done)));
+  }
+
+ private:
+  Status Serve(IteratorContext* ctx, IteratorBase* iterator,
+               const std::vector<std::unique_ptr<SharedMemoryRingBuffer>>&
+                   buffers,
+               const SharedMemoryRingBuffer::CancelledFn& cancelled) {
+    std::vector<SharedMemoryRingBuffer*> raw_buffers;
+    for (const auto& buffer : buffers) {
+      raw_buffers.push_back(buffer.get());
+    }
+    std::vector<Tensor> components;
+    string record;
+    size_t next_consumer = 0;
+    while (true) {
+      bool end_of_sequence;
+      components.clear();
+      TF_RETURN_IF_ERROR(iterator->GetNext(ctx, &components, &end_of_sequence));
+      if (end_of_sequence) {
+        return Status::OK();
+      }
+      EncodeElement(components, &record);
+      if (sharding_policy_ == kShard) {
+        // Element `i` always goes to consumer `i % num_consumers`.
+        TF_RETURN_IF_ERROR(
+            raw_buffers[next_consumer]->Write(record, cancelled));
+      } else {
+        // The element goes to the next consumer in turn that has room for it,
+        // so a slow consumer does not hold up the others.
+        TF_RETURN_IF_ERROR(SharedMemoryRingBuffer::WriteToAny(
+            raw_buffers, next_consumer, record, cancelled, &next_consumer));
+      }
+      next_consumer = (next_consumer + 1) % raw_buffers.size();
+    }
+  }
+
+  BackgroundWorker background_worker_;
+  string sharding_policy_;
+};
+
+class SharedMemoryDatasetOp : public DatasetOpKernel {
+ public:
+  explicit SharedMemoryDatasetOp(OpKernelConstruction* ctx)
+      : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_types", &output_types_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("output_shapes", &output_shapes_));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    tstring service_name;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, "service_name",
+                                                     &service_name));
+    int64 consumer_index;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, "consumer_index",
+                                                   &consumer_index));
+    OP_REQUIRES(ctx, consumer_index >= 0,
+                errors::InvalidArgument("consumer_index must be >= 0."));
+    *output = new Dataset(ctx, service_name, consumer_index, output_types_,
+                          output_shapes_);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const string& service_name,
+            int64 consumer_index,
+            const DataTypeVector& output_types,
+            const std::vector<PartialTensorShape>& output_shapes)
+        : DatasetBase(DatasetContext(ctx)),
+          service_name_(service_name),
+          consumer_index_(consumer_index),
+          output_types_(output_types),
+          output_shapes_(output_shapes) {}
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::SharedMemory")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return output_types_;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return output_shapes_;
+    }
+
+    string DebugString() const override {
+      return strings::StrCat("SharedMemoryDatasetOp(", service_name_, ", ",
+                             consumer_index_, ")::Dataset");
+    }
+
+    Status CheckExternalState() const override {
+      return errors::FailedPrecondition(
+          DebugString(), " depends on the shared memory buffer ",
+          BufferName(service_name_, consumer_index_), ".");
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* service_name = nullptr;
+      Node* consumer_index = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(service_name_, &service_name));
+      TF_RETURN_IF_ERROR(b->AddScalar(consumer_index_, &consumer_index));
+      TF_RETURN_IF_ERROR(
+          b->AddDataset(this, {service_name, consumer_index}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        auto cancelled = [ctx]() {
+          return ctx->cancellation_manager() != nullptr &&
+                 ctx->cancellation_manager()->IsCancelled();
+        };
+        // The consumer may start before the producer, so wait for the
+        // producer to create the buffer.
+        while (!buffer_) {
+          Status s = SharedMemoryRingBuffer::Attach(
+              BufferName(dataset()->service_name_, dataset()->consumer_index_),
+              &buffer_);
+          if (!errors::IsNotFound(s)) {
+            TF_RETURN_IF_ERROR(s);
+            break;
+          }
+          if (cancelled()) {
+            return errors::Cancelled("Waiting for shared memory buffer ",
+                                     dataset()->service_name_, " cancelled.");
+          }
+          ctx->env()->SleepForMicroseconds(kAttachRetryMicros);
+        }
+        TF_RETURN_IF_ERROR(buffer_->Read(&record_, end_of_sequence, cancelled));
+        if (*end_of_sequence) {
+          return Status::OK();
+        }
+        return DecodeElement(record_, dataset()->output_types_, out_tensors);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeSourceNode(std::move(args));
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        return errors::Unimplemented(
+            "Checkpointing is not supported for SharedMemoryDataset, whose "
+            "elements are owned by the producer process.");
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        return errors::Unimplemented(
+            "Checkpointing is not supported for SharedMemoryDataset, whose "
+            "elements are owned by the producer process.");
+      }
+
+     private:
+      mutex mu_;
+      std::unique_ptr<SharedMemoryRingBuffer> buffer_ GUARDED_BY(mu_);
+      string record_ GUARDED_BY(mu_);
+    };
+
+    const tstring service_name_;
+    const int64 consumer_index_;
+    const DataTypeVector output_types_;
+    const std::vector<PartialTensorShape> output_shapes_;
+  };
+
+  DataTypeVector output_types_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("DatasetToSharedMemory").Device(DEVICE_CPU),
+                        DatasetToSharedMemoryOp);
+REGISTER_KERNEL_BUILDER(Name("SharedMemoryDataset").Device(DEVICE_CPU),
+                        SharedMemoryDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,396 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/shared_memory_ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/platform.h"
+
+#if !defined(PLATFORM_WINDOWS)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !PLATFORM_WINDOWS
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr uint64 kMagic = 0x7466646174617368;  // "tfdatash"
+constexpr int64 kAlignment = 8;
+// A record length that tells the reader to continue at the start of the data
+// region because the next record did not fit before its end.
+constexpr uint64 kWrapMarker = ~uint64{0};
+// Values of `Header::closed`.
+constexpr uint32 kOpen = 0;
+constexpr uint32 kClosed = 1;
+constexpr uint32 kAborted = 2;
+constexpr int64 kInitialBackoffMicros = 10;
+constexpr int64 kMaxBackoffMicros = 1000;
+
+int64 RoundUp(int64 size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Polls `ready` with an exponential backoff until it sets its argument to true
+// or returns an error.
+Status WaitFor(const std::function<Status(bool*)>& ready,
+               const SharedMemoryRingBuffer::CancelledFn& cancelled) {
+  int64 backoff_micros = kInitialBackoffMicros;
+  while (true) {
+    bool done = false;
+    TF_RETURN_IF_ERROR(ready(&done));
+    if (done) {
+      return Status::OK();
+    }
+    if (cancelled && cancelled()) {
+      return errors::Cancelled("Shared memory ring buffer wait cancelled.");
+    }
+    Env::Default()->SleepForMicroseconds(backoff_micros);
+    backoff_micros = std::min(2 * backoff_micros, kMaxBackoffMicros);
+  }
+}
+
+}  // namespace
+
+// The layout of the start of the shared memory object. Positions are byte
+// offsets that only ever grow; the producer owns `write_pos` and the consumer
+// owns `read_pos`. `creator_pid` identifies the producer process, so that a
+// consumer does not attach to a buffer left behind by one that crashed.
+struct SharedMemoryRingBuffer::Header {
+  uint64 magic;
+  int64 capacity;
+  int64 creator_pid;
+  std::atomic<uint64> write_pos;
+  std::atomic<uint64> read_pos;
+  std::atomic<uint32> closed;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "Shared memory positions must be lock free.");
+
+#if !defined(PLATFORM_WINDOWS)
+
+namespace {
+
+Status ShmName(const string& name, string* shm_name) {
+  if (name.empty() || name.find('/') != string::npos) {
+    return errors::InvalidArgument(
+        "Shared memory buffer names must be non-empty and must not contain "
+        "'/', got: \"",
+        name, "\".");
+  }
+  *shm_name = strings::StrCat("/", name);
+  return Status::OK();
+}
+
+}  // namespace
+
+Status SharedMemoryRingBuffer::Create(
+    const string& name, int64 capacity,
+    std::unique_ptr<SharedMemoryRingBuffer>* out) {
+  string shm_name;
+  TF_RETURN_IF_ERROR(ShmName(name, &shm_name));
+  if (capacity < 2 * kAlignment) {
+    return errors::InvalidArgument(
+        "Shared memory buffer capacity must be at least ", 2 * kAlignment,
+        " bytes, got: ", capacity);
+  }
+  capacity = RoundUp(capacity);
+  const size_t mapping_size = RoundUp(sizeof(Header)) + capacity;
+  // Remove any buffer left behind by a producer that did not exit cleanly.
+  shm_unlink(shm_name.c_str());
+  int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::Internal("Failed to create shared memory buffer ", name,
+                            ": ", strerror(errno));
+  }
+  if (ftruncate(fd, mapping_size) != 0) {
+    Status s = errors::Internal("Failed to size shared memory buffer ", name,
+                                ": ", strerror(errno));
+    close(fd);
+    shm_unlink(shm_name.c_str());
+    return s;
+  }
+  void* mapping =
+      mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    Status s = errors::Internal("Failed to map shared memory buffer ", name,
+                                ": ", strerror(errno));
+    shm_unlink(shm_name.c_str());
+    return s;
+  }
+  Header* header = new (mapping) Header;
+  header->capacity = capacity;
+  header->creator_pid = getpid();
+  header->write_pos.store(0, std::memory_order_relaxed);
+  header->read_pos.store(0, std::memory_order_relaxed);
+  header->closed.store(kOpen, std::memory_order_relaxed);
+  // Publishing the magic number last tells consumers the header is valid.
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+  out->reset(new SharedMemoryRingBuffer(shm_name, /*owner=*/true, mapping,
+                                        mapping_size));
+  return Status::OK();
+}
+
+Status SharedMemoryRingBuffer::Attach(
+    const string& name, std::unique_ptr<SharedMemoryRingBuffer>* out) {
+  string shm_name;
+  TF_RETURN_IF_ERROR(ShmName(name, &shm_name));
+  int fd = shm_open(shm_name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return errors::NotFound("Shared memory buffer ", name, " not found.");
+    }
+    return errors::Internal("Failed to open shared memory buffer ", name,
+                            ": ", strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    Status s = errors::Internal("Failed to stat shared memory buffer ", name,
+                                ": ", strerror(errno));
+    close(fd);
+    return s;
+  }
+  const size_t mapping_size = st.st_size;
+  if (mapping_size < RoundUp(sizeof(Header))) {
+    // The producer has created the object but not sized it yet.
+    close(fd);
+    return errors::NotFound("Shared memory buffer ", name, " not ready.");
+  }
+  void* mapping =
+      mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return errors::Internal("Failed to map shared memory buffer ", name, ": ",
+                            strerror(errno));
+  }
+  Header* header = static_cast<Header*>(mapping);
+  const bool ready = header->magic == kMagic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!ready || mapping_size != RoundUp(sizeof(Header)) + header->capacity) {
+    munmap(mapping, mapping_size);
+    return errors::NotFound("Shared memory buffer ", name, " not ready.");
+  }
+  // A producer that exits cleanly removes its buffer, so one whose creator
+  // is gone is stale and will be replaced by the next producer's `Create()`.
+  // EPERM means the creator exists but belongs to another user.
+  if (kill(static_cast<pid_t>(header->creator_pid), 0) != 0 &&
+      errno == ESRCH) {
+    munmap(mapping, mapping_size);
+    return errors::NotFound("Shared memory buffer ", name,
+                            " was left behind by producer process ",
+                            header->creator_pid, ", which has exited.");
+  }
+  out->reset(new SharedMemoryRingBuffer(shm_name, /*owner=*/false, mapping,
+                                        mapping_size));
+  return Status::OK();
+}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {
+  munmap(mapping_, mapping_size_);
+  if (owner_) {
+    shm_unlink(shm_name_.c_str());
+  }
+}
+
+#else  // PLATFORM_WINDOWS
+
+Status SharedMemoryRingBuffer::Create(
+    const string& name, int64 capacity,
+    std::unique_ptr<SharedMemoryRingBuffer>* out) {
+  return errors::Unimplemented(
+      "Shared memory ring buffers are not supported on this platform.");
+}
+
+Status SharedMemoryRingBuffer::Attach(
+    const string& name, std::unique_ptr<SharedMemoryRingBuffer>* out) {
+  return errors::Unimplemented(
+      "Shared memory ring buffers are not supported on this platform.");
+}
+
+SharedMemoryRingBuffer::~SharedMemoryRingBuffer() {}
+
+#endif  // PLATFORM_WINDOWS
+
+SharedMemoryRingBuffer::SharedMemoryRingBuffer(const string& shm_name,
+                                               bool owner, void* mapping,
+                                               size_t mapping_size)
+    : shm_name_(shm_name),
+      owner_(owner),
+      mapping_(mapping),
+      mapping_size_(mapping_size),
+      header_(static_cast<Header*>(mapping)),
+      data_(static_cast<char*>(mapping) + RoundUp(sizeof(Header))) {}
+
+int64 SharedMemoryRingBuffer::capacity() const { return header_->capacity; }
+
+Status SharedMemoryRingBuffer::CheckRecordSize(size_t size) const {
+  if (kAlignment + RoundUp(size) > header_->capacity) {
+    return errors::InvalidArgument("Record of ", size,
+                                   " bytes does not fit in a shared memory "
+                                   "buffer of ",
+                                   header_->capacity, " bytes.");
+  }
+  return Status::OK();
+}
+
+bool SharedMemoryRingBuffer::HasRoom(int64 required) const {
+  const uint64 write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  const uint64 read_pos = header_->read_pos.load(std::memory_order_acquire);
+  return header_->capacity - static_cast<int64>(write_pos - read_pos) >=
+         required;
+}
+
+bool SharedMemoryRingBuffer::TryWriteRecord(StringPiece record) {
+  const int64 record_bytes = kAlignment + RoundUp(record.size());
+  uint64 write_pos = header_->write_pos.load(std::memory_order_relaxed);
+  int64 offset = write_pos % header_->capacity;
+  if (header_->capacity - offset < record_bytes) {
+    // Records never straddle the end of the data region. The space before it
+    // is skipped, and published on its own: together with the record it may
+    // exceed the capacity, but each of them fits once the consumer catches up.
+    const int64 skipped = header_->capacity - offset;
+    if (!HasRoom(skipped)) {
+      return false;
+    }
+    std::memcpy(data_ + offset, &kWrapMarker, sizeof(kWrapMarker));
+    write_pos += skipped;
+    header_->write_pos.store(write_pos, std::memory_order_release);
+    offset = 0;
+  }
+  if (!HasRoom(record_bytes)) {
+    return false;
+  }
+  const uint64 size = record.size();
+  std::memcpy(data_ + offset, &size, sizeof(size));
+  std::memcpy(data_ + offset + kAlignment, record.data(), record.size());
+  header_->write_pos.store(write_pos + record_bytes, std::memory_order_release);
+  return true;
+}
+
+Status SharedMemoryRingBuffer::Write(StringPiece record,
+                                     const CancelledFn& cancelled) {
+  TF_RETURN_IF_ERROR(CheckRecordSize(record.size()));
+  return WaitFor(
+      [this, record](bool* done) {
+        *done = TryWriteRecord(record);
+        return Status::OK();
+      },
+      cancelled);
+}
+
+Status SharedMemoryRingBuffer::TryWrite(StringPiece record, bool* written) {
+  TF_RETURN_IF_ERROR(CheckRecordSize(record.size()));
+  *written = TryWriteRecord(record);
+  return Status::OK();
+}
+
+Status SharedMemoryRingBuffer::WriteToAny(
+    const std::vector<SharedMemoryRingBuffer*>& buffers, size_t start,
+    StringPiece record, const CancelledFn& cancelled, size_t* index) {
+  if (buffers.empty()) {
+    return errors::InvalidArgument("No shared memory buffers to write to.");
+  }
+  return WaitFor(
+      [&](bool* done) {
+        for (size_t i = 0; i < buffers.size() && !*done; ++i) {
+          *index = (start + i) % buffers.size();
+          TF_RETURN_IF_ERROR(buffers[*index]->TryWrite(record, done));
+        }
+        return Status::OK();
+      },
+      cancelled);
+}
+
+Status SharedMemoryRingBuffer::Read(string* record, bool* end_of_stream,
+                                    const CancelledFn& cancelled) {
+  *end_of_stream = false;
+  uint64 read_pos = header_->read_pos.load(std::memory_order_relaxed);
+  while (true) {
+    uint32 closed = kOpen;
+    TF_RETURN_IF_ERROR(WaitFor(
+        [this, read_pos, &closed](bool* done) {
+          // `closed` must be observed before `write_pos` so that a record
+          // written just before `Close()` is not missed.
+          closed = header_->closed.load(std::memory_order_acquire);
+          *done = header_->write_pos.load(std::memory_order_acquire) !=
+                      read_pos ||
+                  closed != kOpen;
+          return Status::OK();
+        },
+        cancelled));
+    if (header_->write_pos.load(std::memory_order_acquire) == read_pos) {
+      if (closed == kAborted) {
+        return errors::Aborted(
+            "The producer of the shared memory buffer failed.");
+      }
+      *end_of_stream = true;
+      return Status::OK();
+    }
+    const int64 offset = read_pos % header_->capacity;
+    uint64 size;
+    std::memcpy(&size, data_ + offset, sizeof(size));
+    if (size == kWrapMarker) {
+      read_pos += header_->capacity - offset;
+      // The producer may be waiting for the skipped space to write the next
+      // record at the start of the data region.
+      header_->read_pos.store(read_pos, std::memory_order_release);
+      continue;
+    }
+    if (kAlignment + RoundUp(size) > header_->capacity - offset) {
+      return errors::DataLoss("Corrupted record of ", size,
+                              " bytes in shared memory buffer.");
+    }
+    record->assign(data_ + offset + kAlignment, size);
+    header_->read_pos.store(read_pos + kAlignment + RoundUp(size),
+                            std::memory_order_release);
+    return Status::OK();
+  }
+}
+
+void SharedMemoryRingBuffer::Close() {
+  header_->closed.store(kClosed, std::memory_order_release);
+}
+
+void SharedMemoryRingBuffer::Abort() {
+  header_->closed.store(kAborted, std::memory_order_release);
+}
+
+Status SharedMemoryRingBuffer::WaitUntilDrained(const CancelledFn& cancelled) {
+  return WaitFor(
+      [this](bool* done) {
+        *done = header_->read_pos.load(std::memory_order_acquire) ==
+                header_->write_pos.load(std::memory_order_relaxed);
+        return Status::OK();
+      },
+      cancelled);
+}
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
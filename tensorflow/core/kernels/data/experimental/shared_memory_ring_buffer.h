@@ -0,0 +1,116 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SHARED_MEMORY_RING_BUFFER_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// A single-producer, single-consumer queue of variable-length records backed
+// by a named POSIX shared memory object, so that the producer and the consumer
+// can live in different processes on the same host.
+//
+// The producer creates the buffer with `Create()` and removes its name when it
+// is destroyed; the consumer opens it with `Attach()`. Blocking calls poll the
+// shared state and give up with a `Cancelled` error as soon as `cancelled`
+// returns true.
+class SharedMemoryRingBuffer {
+ public:
+  using CancelledFn = std::function<bool()>;
+
+  // Creates a buffer named `name` (which must not contain '/') holding up to
+  // `capacity` bytes of records. A stale buffer left behind by a producer
+  // that did not exit cleanly is replaced.
+  static Status Create(const string& name, int64 capacity,
+                       std::unique_ptr<SharedMemoryRingBuffer>* out);
+
+  // Opens the buffer named `name`. Returns `NotFound` if no producer has
+  // created it yet, or if it was left behind by a producer process that has
+  // exited. The producer and the consumer must share a PID namespace.
+  static Status Attach(const string& name,
+                       std::unique_ptr<SharedMemoryRingBuffer>* out);
+
+  ~SharedMemoryRingBuffer();
+
+  // Appends `record`, waiting for the consumer to make room if necessary.
+  Status Write(StringPiece record, const CancelledFn& cancelled);
+
+  // Appends `record` if there is room for it, returning whether it did.
+  Status TryWrite(StringPiece record, bool* written);
+
+  // Appends `record` to the first of `buffers`, starting from `start` and
+  // wrapping around, that has room for it, waiting if none of them do. Stores
+  // the index of the chosen buffer in `index`.
+  static Status WriteToAny(const std::vector<SharedMemoryRingBuffer*>& buffers,
+                           size_t start, StringPiece record,
+                           const CancelledFn& cancelled, size_t* index);
+
+  // Removes the oldest record and stores it in `record`, waiting for the
+  // producer if the buffer is empty. Sets `end_of_stream` once the buffer is
+  // empty and the producer has called `Close()`, or returns `Aborted` if the
+  // producer called `Abort()` instead.
+  Status Read(string* record, bool* end_of_stream,
+              const CancelledFn& cancelled);
+
+  // Marks the end of the stream of records.
+  void Close();
+
+  // Marks the end of the stream of records, telling the consumer that the
+  // stream was cut short by an error.
+  void Abort();
+
+  // Waits until the consumer has read every record.
+  Status WaitUntilDrained(const CancelledFn& cancelled);
+
+  // The number of bytes of records the buffer can hold.
+  int64 capacity() const;
+
+ private:
+  struct Header;
+
+  SharedMemoryRingBuffer(const string& shm_name, bool owner, void* mapping,
+                         size_t mapping_size);
+
+  // Returns `InvalidArgument` if a record of `size` bytes can never fit.
+  Status CheckRecordSize(size_t size) const;
+  bool HasRoom(int64 required) const;
+  // Appends `record` if there is room for it, returning whether it did.
+  bool TryWriteRecord(StringPiece record);
+
+  const string shm_name_;
+  const bool owner_;
+  void* const mapping_;
+  const size_t mapping_size_;
+  Header* const header_;
+  char* const data_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SharedMemoryRingBuffer);
+};
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_SHARED_MEMORY_RING_BUFFER_H_
@@ -0,0 +1,164 @@
+/* Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/shared_memory_ring_buffer.h"
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+string BufferName(const string& test_name) {
+  return strings::StrCat("tf_data_shm_test_", Env::Default()->NowMicros(), "_",
+                         test_name);
+}
+
+string Record(int i) { return strings::StrCat(string(i % 37, 'x'), i); }
+
+TEST(SharedMemoryRingBufferTest, AttachBeforeCreate) {
+  std::unique_ptr<SharedMemoryRingBuffer> consumer;
+  EXPECT_TRUE(errors::IsNotFound(SharedMemoryRingBuffer::Attach(
+      BufferName("AttachBeforeCreate"), &consumer)));
+}
+
+TEST(SharedMemoryRingBufferTest, InvalidArguments) {
+  std::unique_ptr<SharedMemoryRingBuffer> producer;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      SharedMemoryRingBuffer::Create("a/b", 1024, &producer)));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      SharedMemoryRingBuffer::Create(BufferName("InvalidArguments"), 0,
+                                     &producer)));
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Create(BufferName("InvalidArguments"),
+                                              64, &producer));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      producer->Write(string(64, 'x'), /*cancelled=*/nullptr)));
+}
+
+TEST(SharedMemoryRingBufferTest, ConcurrentProducerAndConsumer) {
+  const string name = BufferName("ConcurrentProducerAndConsumer");
+  const int kNumRecords = 10000;
+  std::unique_ptr<SharedMemoryRingBuffer> producer;
+  // A small capacity exercises waiting and wrapping around the buffer.
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Create(name, 256, &producer));
+  std::unique_ptr<SharedMemoryRingBuffer> consumer;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Attach(name, &consumer));
+
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      {}, "producer", [&producer, kNumRecords]() {
+        for (int i = 0; i < kNumRecords; ++i) {
+          TF_EXPECT_OK(producer->Write(Record(i), /*cancelled=*/nullptr));
+        }
+        producer->Close();
+      }));
+
+  string record;
+  bool end_of_stream = false;
+  for (int i = 0; i < kNumRecords; ++i) {
+    TF_ASSERT_OK(consumer->Read(&record, &end_of_stream,
+                                /*cancelled=*/nullptr));
+    ASSERT_FALSE(end_of_stream);
+    EXPECT_EQ(Record(i), record);
+  }
+  TF_ASSERT_OK(consumer->Read(&record, &end_of_stream, /*cancelled=*/nullptr));
+  EXPECT_TRUE(end_of_stream);
+  TF_EXPECT_OK(producer->WaitUntilDrained(/*cancelled=*/nullptr));
+}
+
+TEST(SharedMemoryRingBufferTest, RecordsNearHalfCapacity) {
+  const string name = BufferName("RecordsNearHalfCapacity");
+  const int kCapacity = 256;
+  const int kNumRecords = 1000;
+  std::unique_ptr<SharedMemoryRingBuffer> producer;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Create(name, kCapacity, &producer));
+  std::unique_ptr<SharedMemoryRingBuffer> consumer;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Attach(name, &consumer));
+  // Records that do not fit before the end of the buffer, together with the
+  // space skipped to wrap around, can exceed the capacity. Sizes range up to
+  // the largest record the buffer can hold.
+  auto record = [kCapacity](int i) {
+    return string(kCapacity / 2 - 64 + (i * 13) % (kCapacity / 2 + 57),
+                  'a' + i % 26);
+  };
+
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      {}, "producer", [&producer, &record, kNumRecords]() {
+        for (int i = 0; i < kNumRecords; ++i) {
+          TF_EXPECT_OK(producer->Write(record(i), /*cancelled=*/nullptr));
+        }
+        producer->Close();
+      }));
+
+  string value;
+  bool end_of_stream = false;
+  for (int i = 0; i < kNumRecords; ++i) {
+    TF_ASSERT_OK(consumer->Read(&value, &end_of_stream,
+                                /*cancelled=*/nullptr));
+    ASSERT_FALSE(end_of_stream);
+    EXPECT_EQ(record(i), value);
+  }
+  TF_ASSERT_OK(consumer->Read(&value, &end_of_stream, /*cancelled=*/nullptr));
+  EXPECT_TRUE(end_of_stream);
+}
+
+TEST(SharedMemoryRingBufferTest, WriteToAny) {
+  std::unique_ptr<SharedMemoryRingBuffer> first;
+  TF_ASSERT_OK(
+      SharedMemoryRingBuffer::Create(BufferName("WriteToAny0"), 16, &first));
+  std::unique_ptr<SharedMemoryRingBuffer> second;
+  TF_ASSERT_OK(
+      SharedMemoryRingBuffer::Create(BufferName("WriteToAny1"), 16, &second));
+  std::vector<SharedMemoryRingBuffer*> buffers = {first.get(), second.get()};
+
+  size_t index;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::WriteToAny(buffers, 1, "a",
+                                                  /*cancelled=*/nullptr,
+                                                  &index));
+  EXPECT_EQ(1, index);
+  TF_ASSERT_OK(SharedMemoryRingBuffer::WriteToAny(buffers, 1, "b",
+                                                  /*cancelled=*/nullptr,
+                                                  &index));
+  EXPECT_EQ(0, index);
+  // Both buffers are now full.
+  EXPECT_TRUE(errors::IsCancelled(SharedMemoryRingBuffer::WriteToAny(
+      buffers, 0, "c", []() { return true; }, &index)));
+}
+
+TEST(SharedMemoryRingBufferTest, Abort) {
+  const string name = BufferName("Abort");
+  std::unique_ptr<SharedMemoryRingBuffer> producer;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Create(name, 64, &producer));
+  std::unique_ptr<SharedMemoryRingBuffer> consumer;
+  TF_ASSERT_OK(SharedMemoryRingBuffer::Attach(name, &consumer));
+  TF_ASSERT_OK(producer->Write("record", /*cancelled=*/nullptr));
+  producer->Abort();
+
+  // Records written before the producer failed are still delivered.
+  string record;
+  bool end_of_stream;
+  TF_ASSERT_OK(consumer->Read(&record, &end_of_stream, /*cancelled=*/nullptr));
+  EXPECT_EQ("record", record);
+  EXPECT_TRUE(errors::IsAborted(
+      consumer->Read(&record, &end_of_stream, /*cancelled=*/nullptr)));
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
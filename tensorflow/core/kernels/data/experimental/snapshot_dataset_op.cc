@@ -12,6 +12,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <algorithm>
 #include <random>
 
 #include "absl/time/clock.h"
@@ -62,6 +63,10 @@ const int64 kSnappyBufferSizeBytes = 256 << 10;  // 256 KB
 
 const size_t kHeaderSize = sizeof(uint64);
 
+// Version of the data file format written by SnapshotWriter::WriteTensors. See
+// SnapshotMetadataRecord.version.
+const int64 kSnapshotFormatVersion = 2;
+
 constexpr char kSnapshotFilename[] = "snapshot.metadata";
 constexpr char kSnapshotReaderWorkerPool[] = "snapshot_reader_worker_pool";
 constexpr char kSnapshotWriterWorkerPool[] = "snapshot_writer_worker_pool";
@@ -73,6 +78,7 @@ class SnapshotWriter {
   static constexpr const char* const kClassName = "SnapshotWriter";
   static constexpr const char* const kWriteStringPiece = "WriteStringPiece";
   static constexpr const char* const kWriteCord = "WriteCord";
+  static constexpr const char* const kWriteTensors = "WriteTensors";
 
   explicit SnapshotWriter(WritableFile* dest, const string& compression_type =
                                                   io::compression::kNone)
@@ -126,6 +132,39 @@ class SnapshotWriter {
   }
 #endif  // PLATFORM_GOOGLE
 
+  // Writes one batch of tensors in the raw tensor format.
+  Status WriteTensors(const std::vector<Tensor>& tensors) {
+    profiler::TraceMe activity(
+        absl::StrCat(kClassName, kSeparator, kWriteTensors),
+        profiler::TraceMeLevel::kInfo);
+    experimental::SnapshotTensorMetadata metadata;
+    std::vector<string> serialized_protos(tensors.size());
+    for (int i = 0; i < tensors.size(); ++i) {
+      const Tensor& tensor = tensors[i];
+      experimental::TensorMetadata* tensor_metadata =
+          metadata.add_tensor_metadata();
+      tensor_metadata->set_dtype(tensor.dtype());
+      tensor.shape().AsProto(tensor_metadata->mutable_tensor_shape());
+      if (DataTypeCanUseMemcpy(tensor.dtype())) {
+        tensor_metadata->set_tensor_size_bytes(tensor.tensor_data().size());
+      } else {
+        TensorProto proto;
+        tensor.AsProtoTensorContent(&proto);
+        serialized_protos[i] = proto.SerializeAsString();
+        tensor_metadata->set_tensor_size_bytes(serialized_protos[i].size());
+      }
+    }
+    TF_RETURN_IF_ERROR(WriteRecord(metadata.SerializeAsString()));
+    for (int i = 0; i < tensors.size(); ++i) {
+      if (DataTypeCanUseMemcpy(tensors[i].dtype())) {
+        TF_RETURN_IF_ERROR(WriteRecord(tensors[i].tensor_data()));
+      } else {
+        TF_RETURN_IF_ERROR(WriteRecord(StringPiece(serialized_protos[i])));
+      }
+    }
+    return Status::OK();
+  }
+
   Status Close() {
     if (dest_is_owned_) {
       Status s = dest_->Close();
@@ -156,13 +195,17 @@ class SnapshotReader {
   static constexpr const char* const kClassName = "SnapshotReader";
   static constexpr const char* const kReadString = "ReadString";
   static constexpr const char* const kReadCord = "ReadCord";
+  static constexpr const char* const kReadTensors = "ReadTensors";
 
+  // `version` is the format of the file, see SnapshotMetadataRecord.version.
   explicit SnapshotReader(
       RandomAccessFile* file,
-      const string& compression_type = io::compression::kNone)
+      const string& compression_type = io::compression::kNone,
+      int64 version = kSnapshotFormatVersion)
       : file_(file),
         input_stream_(new io::RandomAccessInputStream(file)),
-        compression_type_(compression_type) {
+        compression_type_(compression_type),
+        version_(version) {
 #if defined(IS_SLIM_BUILD)
     if (compression_type_ != io::compression::kNone) {
       LOG(ERROR) << "Compression is unsupported on mobile platforms. Turning "
@@ -213,10 +256,93 @@ class SnapshotReader {
   }
 #endif
 
+  // Reads one batch of tensors. Returns OUT_OF_RANGE at the end of the file.
+  Status ReadTensors(std::vector<Tensor>* read_tensors) {
+    profiler::TraceMe activity(
+        absl::StrCat(kClassName, kSeparator, kReadTensors),
+        profiler::TraceMeLevel::kInfo);
+    if (version_ < 2) {
+      return ReadTensorProtos(read_tensors);
+    }
+    tstring metadata_bytes;
+    TF_RETURN_IF_ERROR(ReadRecord(&metadata_bytes));
+    experimental::SnapshotTensorMetadata metadata;
+    if (!metadata.ParseFromArray(metadata_bytes.data(),
+                                 metadata_bytes.size())) {
+      return errors::DataLoss("Unable to parse snapshot tensor metadata.");
+    }
+    read_tensors->clear();
+    read_tensors->reserve(metadata.tensor_metadata_size());
+    for (const auto& tensor_metadata : metadata.tensor_metadata()) {
+      tstring tensor_bytes;
+      Status s = ReadRecord(&tensor_bytes);
+      if (errors::IsOutOfRange(s)) {
+        return errors::DataLoss("Snapshot file ends in the middle of a batch.");
+      }
+      TF_RETURN_IF_ERROR(s);
+      if (tensor_bytes.size() != tensor_metadata.tensor_size_bytes()) {
+        return errors::DataLoss("Expected a tensor of ",
+                                tensor_metadata.tensor_size_bytes(),
+                                " bytes but read ", tensor_bytes.size());
+      }
+      if (DataTypeCanUseMemcpy(tensor_metadata.dtype())) {
+        TF_RETURN_IF_ERROR(
+            TensorShape::IsValidShape(tensor_metadata.tensor_shape()));
+        const TensorShape shape(tensor_metadata.tensor_shape());
+        Tensor t(tensor_metadata.dtype(), shape);
+        if (t.TotalBytes() != tensor_bytes.size()) {
+          return errors::DataLoss("Tensor of shape ", shape.DebugString(),
+                                  " does not match its ", tensor_bytes.size(),
+                                  " bytes of data.");
+        }
+        memcpy(const_cast<char*>(t.tensor_data().data()), tensor_bytes.data(),
+               tensor_bytes.size());
+        read_tensors->push_back(std::move(t));
+      } else {
+        TensorProto proto;
+        Tensor t;
+        if (!proto.ParseFromArray(tensor_bytes.data(), tensor_bytes.size()) ||
+            !t.FromProto(proto)) {
+          return errors::DataLoss("Unable to parse tensor from proto.");
+        }
+        read_tensors->push_back(std::move(t));
+      }
+    }
+    return Status::OK();
+  }
+
  private:
+  // Reads one batch stored as a SnapshotRecord.
+  Status ReadTensorProtos(std::vector<Tensor>* read_tensors) {
+#if !defined(PLATFORM_GOOGLE)
+    tstring record_bytes;
+    TF_RETURN_IF_ERROR(ReadRecord(&record_bytes));
+#else
+    absl::Cord record_cord;
+    TF_RETURN_IF_ERROR(ReadRecord(&record_cord));
+#endif
+    experimental::SnapshotRecord record;
+#if !defined(PLATFORM_GOOGLE)
+    record.ParseFromArray(record_bytes.data(), record_bytes.size());
+#else
+    record.ParseFromCord(record_cord);
+#endif
+    read_tensors->clear();
+    read_tensors->reserve(record.tensor_size());
+    for (int i = 0; i < record.tensor_size(); ++i) {
+      Tensor t;
+      if (!t.FromProto(record.tensor(i))) {
+        return errors::DataLoss("Unable to parse tensor from proto.");
+      }
+      read_tensors->push_back(std::move(t));
+    }
+    return Status::OK();
+  }
+
   RandomAccessFile* file_;
   std::unique_ptr<io::InputStreamInterface> input_stream_;
   const string compression_type_;
+  const int64 version_;
 };
 
 Status WriteMetadataFile(const string& hash_dir,
@@ -564,8 +690,6 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
      private:
       class SnapshotReaderIterator : public DatasetIterator<Dataset> {
        public:
-        static constexpr const char* const kParse = "Parse";
-
         explicit SnapshotReaderIterator(
             const Params& params, const string& hash_dir,
             const experimental::SnapshotMetadataRecord& metadata)
@@ -679,8 +803,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
         Status ReadFile(const string& filename) {
           std::unique_ptr<RandomAccessFile> file;
           TF_CHECK_OK(Env::Default()->NewRandomAccessFile(filename, &file));
-          std::unique_ptr<SnapshotReader> reader(
-              new SnapshotReader(file.get(), dataset()->compression_));
+          std::unique_ptr<SnapshotReader> reader(new SnapshotReader(
+              file.get(), dataset()->compression_, metadata_.version()));
 
           while (true) {
             // Wait for a slot in the buffer.
@@ -697,31 +821,9 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
                     "ReadFile");
               }
             }
-#if !defined(PLATFORM_GOOGLE)
-            string record_bytes;
-            Status s = reader->ReadRecord(&record_bytes);
-#else
-            absl::Cord record_cord;
-            Status s = reader->ReadRecord(&record_cord);
-#endif
+            std::vector<Tensor> out_tensors;
+            Status s = reader->ReadTensors(&out_tensors);
             if (s.ok()) {
-              profiler::TraceMe activity(
-                  absl::StrCat(prefix(), kSeparator, kParse),
-                  profiler::TraceMeLevel::kInfo);
-              experimental::SnapshotRecord record;
-#if !defined(PLATFORM_GOOGLE)
-              record.ParseFromString(record_bytes);
-#else
-              record.ParseFromCord(record_cord);
-#endif
-              std::vector<Tensor> out_tensors;
-              for (int i = 0; i < record.tensor_size(); ++i) {
-                Tensor t;
-                if (!t.FromProto(record.tensor(i))) {
-                  return errors::DataLoss("Unable to parse tensor from proto.");
-                }
-                out_tensors.push_back(t);
-              }
               BufferElement elem;
               std::swap(elem.value, out_tensors);
               elem.status = Status::OK();
@@ -843,6 +945,7 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
           metadata.set_creation_timestamp(Env::Default()->NowMicros());
           metadata.set_graph_hash(dataset()->graph_hash_);
           metadata.set_run_id(run_id_);
+          metadata.set_version(kSnapshotFormatVersion);
           metadata.set_finalized(false);
           TF_RETURN_IF_ERROR(WriteMetadataFile(hash_dir_, metadata));
 
@@ -1016,11 +1119,8 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
           }
 
           if (produced_elem) {
-            experimental::SnapshotRecord record;
-            for (auto out_tensor : elem.value) {
+            for (const auto& out_tensor : elem.value) {
               *bytes_written += out_tensor.TotalBytes();
-              TensorProto* t = record.add_tensor();
-              out_tensor.AsProtoTensorContent(t);
             }
 
             if (*bytes_written > dataset()->shard_size_bytes_) {
@@ -1035,13 +1135,7 @@ class SnapshotDatasetOp : public UnaryDatasetOpKernel {
                   file->get(), dataset()->compression_);
               *bytes_written = 0;
             }
-#if defined(PLATFORM_GOOGLE)
-            TF_RETURN_IF_ERROR(
-                (*writer)->WriteRecord(record.SerializeAsCord()));
-#else   // PLATFORM_GOOGLE
-            TF_RETURN_IF_ERROR(
-                (*writer)->WriteRecord(record.SerializeAsString()));
-#endif  // PLATFORM_GOOGLE
+            TF_RETURN_IF_ERROR((*writer)->WriteTensors(elem.value));
             return Status::OK();
           }
 
@@ -12,14 +12,17 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <deque>
 #include <memory>
 
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
@@ -348,20 +351,74 @@ class PrivateThreadPoolDatasetOp : public UnaryDatasetOpKernel {
     int64 num_threads = 0;
     OP_REQUIRES_OK(
         ctx, ParseScalarArgument<int64>(ctx, "num_threads", &num_threads));
-    OP_REQUIRES(ctx, num_threads >= 1,
-                errors::InvalidArgument("`num_threads` must be >= 1"));
+    OP_REQUIRES(ctx, num_threads >= 1 || num_threads == model::kAutotune,
+                errors::InvalidArgument("`num_threads` must be >= 1 or ",
+                                        model::kAutotune, " for autotuning"));
     *output = new Dataset(ctx, input, num_threads);
   }
 
  private:
+  // Runs closures on a thread pool, with at most `limit->value` of them
+  // running at a time. The remaining closures wait in a queue. This makes it
+  // possible to change the effective size of a thread pool while it is in use.
+  //
+  // Each scheduled closure holds a reference to the runner, so the runner
+  // outlives the iterator that created it until its closures have finished.
+  class LimitedRunner : public std::enable_shared_from_this<LimitedRunner> {
+   public:
+    LimitedRunner(thread::ThreadPool* pool,
+                  std::shared_ptr<model::SharedState> limit)
+        : pool_(pool), limit_(std::move(limit)) {}
+
+    void Schedule(std::function<void()> fn) {
+      {
+        mutex_lock l(*limit_->mu);
+        if (active_ >= limit_->value) {
+          pending_.push_back(std::move(fn));
+          return;
+        }
+        ++active_;
+      }
+      Run(std::move(fn));
+    }
+
+   private:
+    void Run(std::function<void()> fn) {
+      pool_->Schedule([self = shared_from_this(), fn = std::move(fn)]() {
+        fn();
+        std::deque<std::function<void()>> ready;
+        {
+          mutex_lock l(*self->limit_->mu);
+          --self->active_;
+          while (!self->pending_.empty() &&
+                 self->active_ < self->limit_->value) {
+            ready.push_back(std::move(self->pending_.front()));
+            self->pending_.pop_front();
+            ++self->active_;
+          }
+        }
+        for (auto& next : ready) {
+          self->Run(std::move(next));
+        }
+      });
+    }
+
+    thread::ThreadPool* const pool_;
+    const std::shared_ptr<model::SharedState> limit_;
+    int64 active_ GUARDED_BY(*limit_->mu) = 0;
+    std::deque<std::function<void()>> pending_ GUARDED_BY(*limit_->mu);
+  };
+
   class Dataset : public DatasetBase {
    public:
     Dataset(OpKernelContext* ctx, const DatasetBase* input, int num_threads)
         : DatasetBase(DatasetContext(ctx)),
           input_(input),
-          num_threads_(num_threads) {
+          num_threads_(num_threads),
+          max_threads_(num_threads == model::kAutotune ? port::MaxParallelism()
+                                                       : num_threads) {
       thread_pool_ = absl::make_unique<thread::ThreadPool>(
-          ctx->env(), ThreadOptions{}, "data_private_threadpool", num_threads,
+          ctx->env(), ThreadOptions{}, "data_private_threadpool", max_threads_,
           /*low_latency_hint=*/false);
       input_->Ref();
     }
@@ -408,7 +465,16 @@ class PrivateThreadPoolDatasetOp : public UnaryDatasetOpKernel {
     class Iterator : public DatasetIterator<Dataset> {
      public:
       explicit Iterator(const Params& params)
-          : DatasetIterator<Dataset>(params) {}
+          : DatasetIterator<Dataset>(params),
+            num_threads_(std::make_shared<model::SharedState>(
+                params.dataset->num_threads_, std::make_shared<mutex>(),
+                std::make_shared<condition_variable>())) {
+        if (num_threads_->tunable) {
+          num_threads_->value = params.dataset->max_threads_;
+          runner_ = std::make_shared<LimitedRunner>(
+              params.dataset->thread_pool_.get(), num_threads_);
+        }
+      }
 
       Status Initialize(IteratorContext* ctx) override {
         return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
@@ -417,12 +483,19 @@ class PrivateThreadPoolDatasetOp : public UnaryDatasetOpKernel {
       Status GetNextInternal(IteratorContext* ctx,
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
-        thread::ThreadPool* pool = dataset()->thread_pool_.get();
         IteratorContext::Params params(ctx);
-        params.runner = [pool](std::function<void()> c) {
-          pool->Schedule(std::move(c));
-        };
-        params.runner_threadpool_size = dataset()->num_threads_;
+        if (runner_) {
+          std::shared_ptr<LimitedRunner> runner = runner_;
+          params.runner = [runner](std::function<void()> c) {
+            runner->Schedule(std::move(c));
+          };
+        } else {
+          thread::ThreadPool* pool = dataset()->thread_pool_.get();
+          params.runner = [pool](std::function<void()> c) {
+            pool->Schedule(std::move(c));
+          };
+        }
+        params.runner_threadpool_size = dataset()->max_threads_;
         return input_impl_->GetNext(IteratorContext{std::move(params)},
                                     out_tensors, end_of_sequence);
       }
@@ -430,16 +503,25 @@ class PrivateThreadPoolDatasetOp : public UnaryDatasetOpKernel {
      protected:
       std::shared_ptr<model::Node> CreateNode(
           IteratorContext* ctx, model::Node::Args args) const override {
-        return model::MakeKnownRatioNode(std::move(args),
-                                         /*ratio=*/1);
+        return model::MakeKnownRatioNode(
+            std::move(args),
+            /*ratio=*/1,
+            {model::MakeParameter(model::kThreadPoolSize, num_threads_,
+                                  /*min=*/1,
+                                  /*max=*/dataset()->max_threads_)});
       }
 
      private:
+      // If autotuned, the number of threads of the thread pool that may be
+      // used at a time.
+      const std::shared_ptr<model::SharedState> num_threads_;
+      std::shared_ptr<LimitedRunner> runner_;
       std::unique_ptr<IteratorBase> input_impl_;
     };
 
     const DatasetBase* const input_;
     const int64 num_threads_;
+    const int64 max_threads_;
     std::unique_ptr<thread::ThreadPool> thread_pool_;
   };
 };
@@ -18,7 +18,9 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/stats_utils.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/util/ptr_util.h"
@@ -51,11 +53,15 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
                 errors::InvalidArgument("CPU budget must be positive but is ",
                                         cpu_budget_, "."));
     ram_budget_ = kRamBudgetShare * port::AvailableRam();
+    if (ctx->HasAttr("report_path")) {
+      OP_REQUIRES_OK(ctx, ctx->GetAttr("report_path", &report_path_));
+    }
   }
 
   void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
                    DatasetBase** output) override {
-    *output = new Dataset(ctx, input, algorithm_, cpu_budget_, ram_budget_);
+    *output = new Dataset(ctx, input, algorithm_, cpu_budget_, ram_budget_,
+                          report_path_);
   }
 
  private:
@@ -63,12 +69,13 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
    public:
     Dataset(OpKernelContext* ctx, const DatasetBase* input,
             model::AutotuneAlgorithm algorithm, int64 cpu_budget,
-            int64 ram_budget)
+            int64 ram_budget, const string& report_path)
         : DatasetBase(DatasetContext(ctx)),
           input_(input),
           algorithm_(algorithm),
           cpu_budget_(cpu_budget),
-          ram_budget_(ram_budget) {
+          ram_budget_(ram_budget),
+          report_path_(report_path) {
       input_->Ref();
     }
 
@@ -198,6 +205,7 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
           }
           model_->Optimize(dataset()->algorithm_, dataset()->cpu_budget_,
                            dataset()->ram_budget_);
+          ExportReport(ctx.get());
           // Exponentially increase the period of running the optimization
           // until a threshold is reached.
           if (optimization_period_ms != kOptimizationPeriodThresholdMs) {
@@ -209,6 +217,31 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
         }
       }
 
+      // Exports a report on the input pipeline to the stats aggregator and to
+      // the report file, if any.
+      void ExportReport(IteratorContext* ctx) {
+        const auto& stats_aggregator = ctx->stats_aggregator();
+        if (!stats_aggregator && dataset()->report_path_.empty()) {
+          return;
+        }
+        model::PipelineReport report;
+        model_->Report(&report);
+        if (stats_aggregator) {
+          for (const auto& stage : report.stages()) {
+            stats_aggregator->AddScalar(
+                stats_utils::LatencyShareScalarName(stage.name()),
+                static_cast<float>(stage.latency_share()), num_elements());
+          }
+        }
+        if (!dataset()->report_path_.empty()) {
+          Status s = WriteTextProto(ctx->env(), dataset()->report_path_, report);
+          if (!s.ok()) {
+            LOG(WARNING) << "Failed to write the input pipeline report to "
+                         << dataset()->report_path_ << ": " << s;
+          }
+        }
+      }
+
       mutex mu_;
       condition_variable cond_var_;
       std::shared_ptr<model::Model> model_;
@@ -221,11 +254,13 @@ class ModelDatasetOp : public UnaryDatasetOpKernel {
     const model::AutotuneAlgorithm algorithm_;
     const int64 cpu_budget_;
     const int64 ram_budget_;
+    const string report_path_;
   };
 
   model::AutotuneAlgorithm algorithm_;
   int64 cpu_budget_;
   int64 ram_budget_;
+  string report_path_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("ModelDataset").Device(DEVICE_CPU),
@@ -30,12 +30,14 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/kernels/data/stats_utils.h"
+#include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace data {
@@ -63,6 +65,12 @@ namespace data {
 /* static */ constexpr const char* const
     ParallelInterleaveDatasetOp::kOutputShapes;
 /* static */ constexpr const char* const ParallelInterleaveDatasetOp::kSloppy;
+/* static */ constexpr const char* const
+    ParallelInterleaveDatasetOp::kOutOfOrderWindow;
+/* static */ constexpr const char* const
+    ParallelInterleaveDatasetOp::kPermutationLog;
+/* static */ constexpr const char* const
+    ParallelInterleaveDatasetOp::kReplayPermutation;
 
 constexpr char kDataParallelInterleaveWorkerPool[] =
     "data_parallel_interleave_worker_pool";
@@ -83,6 +91,8 @@ constexpr char kIdSuffix[] = ".id";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kInputsSuffix[] = ".inputs";
 constexpr char kIsReadySuffix[] = ".is_ready";
+constexpr char kNumBorrowedSuffix[] = ".num_borrowed";
+constexpr char kPermutationIndex[] = "permutation_index";
 constexpr char kTFDataParallelInterleaveCurrent[] =
     "tf_data_parallel_interleave_current";
 constexpr char kTFDataParallelInterleaveFuture[] =
@@ -113,7 +123,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
   Dataset(OpKernelContext* ctx, const DatasetBase* input,
           std::unique_ptr<CapturedFunction> captured_func, int64 cycle_length,
           int64 block_length, int64 num_parallel_calls, bool sloppy,
-          const DataTypeVector& output_types,
+          int64 out_of_order_window, const string& permutation_log,
+          bool replay_permutation, const DataTypeVector& output_types,
           const std::vector<PartialTensorShape>& output_shapes)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
@@ -122,6 +133,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         block_length_(block_length),
         num_parallel_calls_(num_parallel_calls),
         sloppy_(sloppy),
+        out_of_order_window_(out_of_order_window),
+        permutation_log_(permutation_log),
+        replay_permutation_(replay_permutation),
         output_types_(output_types),
         output_shapes_(output_shapes) {
     input_->Ref();
@@ -182,6 +196,12 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(other_arguments_types, &other_arguments_types_attr);
     AttrValue sloppy_attr;
     b->BuildAttrValue(sloppy_, &sloppy_attr);
+    AttrValue out_of_order_window_attr;
+    b->BuildAttrValue(out_of_order_window_, &out_of_order_window_attr);
+    AttrValue permutation_log_attr;
+    b->BuildAttrValue(permutation_log_, &permutation_log_attr);
+    AttrValue replay_permutation_attr;
+    b->BuildAttrValue(replay_permutation_, &replay_permutation_attr);
 
     TF_RETURN_IF_ERROR(b->AddDataset(this,
                                      {{0, input_node},
@@ -191,7 +211,12 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
                                      {{1, other_arguments}},
                                      {{kFunc, f},
                                       {kTarguments, other_arguments_types_attr},
-                                      {kSloppy, sloppy_attr}},
+                                      {kSloppy, sloppy_attr},
+                                      {kOutOfOrderWindow,
+                                       out_of_order_window_attr},
+                                      {kPermutationLog, permutation_log_attr},
+                                      {kReplayPermutation,
+                                       replay_permutation_attr}},
                                      output));
     return Status::OK();
   }
@@ -228,7 +253,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           ",cycle_length=", dataset()->cycle_length_,
           ",block_length=", dataset()->block_length_,
           ",autotune=", dataset()->num_parallel_calls_ == model::kAutotune,
-          ",deterministic=", !sloppy_, "#");
+          ",deterministic=", !sloppy_,
+          ",out_of_order_window=", dataset()->out_of_order_window_, "#");
     }
 
     Status Initialize(IteratorContext* ctx) override {
@@ -254,6 +280,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       if (num_parallel_calls_->value == model::kAutotune) {
         num_parallel_calls_->value = dataset()->cycle_length_;
       }
+      if (!sloppy_ && dataset()->replay_permutation_) {
+        TF_RETURN_IF_ERROR(ReadPermutationLogLocked(ctx));
+      }
       TF_RETURN_IF_ERROR(
           dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
       return dataset()->captured_func_->Instantiate(
@@ -272,6 +301,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           cond_var_->wait(l);
           RecordStart(ctx);
         }
+        if (result) {
+          TF_RETURN_IF_ERROR(WritePermutationLogLocked(ctx));
+        }
       }
       if (!result) {
         *end_of_sequence = true;
@@ -313,6 +345,14 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kElementIdCounter),
                                              element_id_counter_));
       TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kNumOpen), num_open_));
+      if (recording_permutation() ||
+          (!sloppy_ && dataset()->replay_permutation_)) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kPermutationIndex),
+                                               permutation_index_));
+      }
+      if (permutation_file_) {
+        TF_RETURN_IF_ERROR(permutation_file_->Flush());
+      }
       TF_RETURN_IF_ERROR(WriteCurrentElements(writer));
       TF_RETURN_IF_ERROR(WriteFutureElements(writer));
       return Status::OK();
@@ -330,6 +370,13 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
                                             &element_id_counter_));
       if (reader->Contains(full_name(kEndOfInput))) end_of_input_ = true;
       TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kNumOpen), &num_open_));
+      if (reader->Contains(full_name(kPermutationIndex))) {
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kPermutationIndex),
+                                              &permutation_index_));
+        if (recording_permutation()) {
+          TF_RETURN_IF_ERROR(RestorePermutationLogLocked(ctx));
+        }
+      }
       TF_RETURN_IF_ERROR(ReadCurrentElements(ctx, reader));
       TF_RETURN_IF_ERROR(ReadFutureElements(ctx, reader));
       return Status::OK();
@@ -360,6 +407,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       std::deque<std::shared_ptr<Result>> results;
       // Indicates whether the element is used by a worker thread.
       bool in_use = false;
+      // Number of results of the element's next block that were consumed
+      // ahead of their turn in the cycle. Guarded by `*mu_`.
+      int64 num_borrowed = 0;
     };
 
     // Advances the position in the interleave cycle to the next cycle
@@ -383,6 +433,12 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
     bool Consume(std::shared_ptr<Result>* result)
         EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       if (!sloppy_) {
+        if (dataset()->replay_permutation_) {
+          return ReplayConsume(result);
+        }
+        if (dataset()->out_of_order_window_ > 1 || recording_permutation()) {
+          return WindowConsume(result);
+        }
         return ConsumeHelper(result);
       }
       // If we are allowed to be sloppy (i.e. return results out of order),
@@ -396,16 +452,193 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       return false;
     }
 
-    bool ConsumeHelper(std::shared_ptr<Result>* result)
+    // Consumes the in-order result if it is available and otherwise the first
+    // available result of the next `out_of_order_window - 1` cycle elements.
+    // The id of the element each result is taken from is recorded in the
+    // permutation log.
+    bool WindowConsume(std::shared_ptr<Result>* result)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      int64 element_id = -1;
+      bool found = ConsumeHelper(result, &element_id);
+      for (int64 offset = 1;
+           !found && offset < dataset()->out_of_order_window_; ++offset) {
+        found = Borrow(offset, result, &element_id);
+      }
+      if (!found) {
+        return false;
+      }
+      if (*result && recording_permutation()) {
+        core::PutVarint64(&permutation_, element_id);
+        ++permutation_index_;
+      }
+      return true;
+    }
+
+    // Consumes the next result of the element named by the permutation log,
+    // waiting for it if necessary. Because every element produces its results
+    // in order and elements are created in the order of the input, this
+    // reproduces the recorded output order regardless of timing. Once the log
+    // is exhausted, the remaining results are produced as they become ready.
+    bool ReplayConsume(std::shared_ptr<Result>* result)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      bool has_elements = false;
+      for (auto& element : current_elements_) {
+        if (element && element->results.empty() && !element->iterator) {
+          // Release exhausted elements so that they can be replaced.
+          element.reset();
+          cond_var_->notify_all();
+        }
+        has_elements |= element != nullptr;
+      }
+      if (!has_elements && future_elements_.empty() && end_of_input_) {
+        // End of input has been reached.
+        return true;
+      }
+      if (permutation_index_ < replay_ids_.size()) {
+        std::shared_ptr<Element> element =
+            FindElement(replay_ids_[permutation_index_]);
+        if (!element || element->results.empty() ||
+            !element->results.front()->is_ready) {
+          return false;
+        }
+        std::swap(*result, element->results.front());
+        element->results.pop_front();
+        ++permutation_index_;
+        cond_var_->notify_all();
+        return true;
+      }
+      for (auto& element : current_elements_) {
+        if (element && !element->results.empty() &&
+            element->results.front()->is_ready) {
+          std::swap(*result, element->results.front());
+          element->results.pop_front();
+          cond_var_->notify_all();
+          return true;
+        }
+      }
+      return false;
+    }
+
+    std::shared_ptr<Element> FindElement(int64 id)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      for (const auto& element : current_elements_) {
+        if (element && element->id == id) {
+          return element;
+        }
+      }
+      for (const auto& element : future_elements_) {
+        if (element && element->id == id) {
+          return element;
+        }
+      }
+      return nullptr;
+    }
+
+    // Consumes the next result of the cycle element `offset` positions after
+    // the current one, if it is ready and belongs to the element's next block.
+    bool Borrow(int64 offset, std::shared_ptr<Result>* result,
+                int64* element_id) EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      const int64 idx = (cycle_index_ + offset) % dataset()->cycle_length_;
+      std::shared_ptr<Element> element = current_elements_[idx];
+      if (!element || element->num_borrowed >= dataset()->block_length_ ||
+          element->results.empty() || !element->results.front()->is_ready) {
+        return false;
+      }
+      std::swap(*result, element->results.front());
+      element->results.pop_front();
+      ++element->num_borrowed;
+      *element_id = element->id;
+      cond_var_->notify_all();
+      return true;
+    }
+
+    bool recording_permutation() const {
+      return !sloppy_ && !dataset()->replay_permutation_ &&
+             !dataset()->permutation_log_.empty();
+    }
+
+    // Appends the element ids recorded since the last call to the permutation
+    // log, (re)creating the log file if it has not been opened yet, and drops
+    // them from memory.
+    Status WritePermutationLogLocked(IteratorContext* ctx)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      if (!recording_permutation() || permutation_.empty()) {
+        return Status::OK();
+      }
+      if (!permutation_file_) {
+        TF_RETURN_IF_ERROR(ctx->env()->NewWritableFile(
+            dataset()->permutation_log_, &permutation_file_));
+      }
+      TF_RETURN_IF_ERROR(permutation_file_->Append(permutation_));
+      permutation_.clear();
+      return Status::OK();
+    }
+
+    Status ReadPermutationLogLocked(IteratorContext* ctx)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      string contents;
+      TF_RETURN_IF_ERROR(
+          ReadFileToString(ctx->env(), dataset()->permutation_log_, &contents));
+      StringPiece input(contents);
+      uint64 id;
+      while (!input.empty()) {
+        if (!core::GetVarint64(&input, &id)) {
+          return errors::DataLoss("Corrupted permutation log ",
+                                  dataset()->permutation_log_);
+        }
+        replay_ids_.push_back(id);
+      }
+      return Status::OK();
+    }
+
+    // Drops the entries recorded after the checkpoint being restored, so that
+    // the log keeps describing the order in which elements were produced.
+    Status RestorePermutationLogLocked(IteratorContext* ctx)
+        EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      string contents;
+      if (permutation_index_ > 0) {
+        TF_RETURN_IF_ERROR(ReadFileToString(
+            ctx->env(), dataset()->permutation_log_, &contents));
+      }
+      StringPiece input(contents);
+      uint64 id;
+      for (int64 i = 0; i < permutation_index_; ++i) {
+        if (!core::GetVarint64(&input, &id)) {
+          return errors::DataLoss("Permutation log ",
+                                  dataset()->permutation_log_,
+                                  " has fewer than ", permutation_index_,
+                                  " entries");
+        }
+      }
+      // The log is rewritten from scratch, starting with the retained prefix.
+      permutation_ = contents.substr(0, contents.size() - input.size());
+      permutation_file_.reset();
+      return Status::OK();
+    }
+
+    bool ConsumeHelper(std::shared_ptr<Result>* result,
+                       int64* element_id = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       while (true) {
         std::shared_ptr<Element> element = current_elements_[cycle_index_];
+        if (element && element->num_borrowed > 0) {
+          // Results of this block were consumed ahead of their turn.
+          block_index_ += element->num_borrowed;
+          element->num_borrowed = 0;
+          if (block_index_ >= dataset()->block_length_) {
+            AdvanceToNextInCycle();
+            continue;
+          }
+        }
         if (element) {
           if (!element->results.empty()) {
             if (element->results.front()->is_ready) {
               // We found a result.
               std::swap(*result, element->results.front());
               element->results.pop_front();
+              if (element_id) {
+                *element_id = element->id;
+              }
               AdvancePosition();
               cond_var_->notify_all();
               return true;
@@ -742,6 +975,12 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
               element->inputs[i]));
         }
       }
+      if (element->num_borrowed > 0) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(
+                strings::StrCat(key_prefix, "[", idx, "]", kNumBorrowedSuffix)),
+            element->num_borrowed));
+      }
       TF_RETURN_IF_ERROR(writer->WriteScalar(
           full_name(strings::StrCat(key_prefix, "[", idx, "]", kResultsSuffix,
                                     kSizeSuffix)),
@@ -807,6 +1046,12 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
         return Status::OK();
       }
       auto element = std::make_shared<Element>();
+      const string num_borrowed_key = full_name(
+          strings::StrCat(key_prefix, "[", idx, "]", kNumBorrowedSuffix));
+      if (reader->Contains(num_borrowed_key)) {
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(num_borrowed_key, &element->num_borrowed));
+      }
       int64 results_size;
       TF_RETURN_IF_ERROR(reader->ReadScalar(
           full_name(strings::StrCat(key_prefix, "[", idx, "]", kResultsSuffix,
@@ -912,6 +1157,16 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
     // Iterator for input elements.
     std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(*mu_);
 
+    // Varint-encoded ids of the elements that outputs were taken from, in
+    // output order, when recording a permutation log. Only holds the ids that
+    // have not been written to `permutation_file_` yet.
+    string permutation_ GUARDED_BY(*mu_);
+    // Element ids read from the permutation log when replaying it.
+    std::vector<int64> replay_ids_ GUARDED_BY(*mu_);
+    // Number of outputs recorded to or replayed from the permutation log.
+    int64 permutation_index_ GUARDED_BY(*mu_) = 0;
+    std::unique_ptr<WritableFile> permutation_file_ GUARDED_BY(*mu_);
+
     // Identifies position in the interleave cycle.
     int64 block_index_ GUARDED_BY(*mu_) = 0;
     int64 cycle_index_ GUARDED_BY(*mu_) = 0;
@@ -950,6 +1205,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
   const int64 num_parallel_calls_;
   const int op_version_ = 2;
   const bool sloppy_;
+  const int64 out_of_order_window_;
+  const string permutation_log_;
+  const bool replay_permutation_;
   const DataTypeVector output_types_;
   const std::vector<PartialTensorShape> output_shapes_;
 };
@@ -964,6 +1222,21 @@ ParallelInterleaveDatasetOp::ParallelInterleaveDatasetOp(
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr(kSloppy, &sloppy_));
+  if (ctx->HasAttr(kOutOfOrderWindow)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutOfOrderWindow, &out_of_order_window_));
+  }
+  if (ctx->HasAttr(kPermutationLog)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kPermutationLog, &permutation_log_));
+  }
+  if (ctx->HasAttr(kReplayPermutation)) {
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr(kReplayPermutation, &replay_permutation_));
+  }
+  OP_REQUIRES(ctx, out_of_order_window_ >= 0,
+              errors::InvalidArgument("`out_of_order_window` must be >= 0"));
+  OP_REQUIRES(ctx, !replay_permutation_ || !permutation_log_.empty(),
+              errors::InvalidArgument(
+                  "`replay_permutation` requires a `permutation_log`."));
 }
 
 void ParallelInterleaveDatasetOp::MakeDataset(OpKernelContext* ctx,
@@ -992,6 +1265,10 @@ void ParallelInterleaveDatasetOp::MakeDataset(OpKernelContext* ctx,
       ctx, num_parallel_calls <= cycle_length,
       errors::InvalidArgument(
           "num_parallel_calls must less than or equal to cycle_length."));
+  OP_REQUIRES(ctx, out_of_order_window_ <= cycle_length,
+              errors::InvalidArgument(
+                  "out_of_order_window must be less than or equal to "
+                  "cycle_length."));
 
   std::unique_ptr<CapturedFunction> captured_func;
   OP_REQUIRES_OK(ctx,
@@ -1004,7 +1281,8 @@ void ParallelInterleaveDatasetOp::MakeDataset(OpKernelContext* ctx,
 
   *output = new Dataset(ctx, input, std::move(captured_func), cycle_length,
                         block_length, num_parallel_calls, sloppy_,
-                        output_types_, output_shapes_);
+                        out_of_order_window_, permutation_log_,
+                        replay_permutation_, output_types_, output_shapes_);
 }
 
 namespace {
@@ -34,6 +34,10 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
   static constexpr const char* const kSloppy = "sloppy";
+  static constexpr const char* const kOutOfOrderWindow = "out_of_order_window";
+  static constexpr const char* const kPermutationLog = "permutation_log";
+  static constexpr const char* const kReplayPermutation =
+      "replay_permutation";
 
   explicit ParallelInterleaveDatasetOp(OpKernelConstruction* ctx);
 
@@ -47,6 +51,9 @@ class ParallelInterleaveDatasetOp : public UnaryDatasetOpKernel {
   DataTypeVector output_types_;
   std::vector<PartialTensorShape> output_shapes_;
   bool sloppy_;
+  int64 out_of_order_window_ = 0;
+  string permutation_log_;
+  bool replay_permutation_ = false;
 };
 
 }  // namespace data
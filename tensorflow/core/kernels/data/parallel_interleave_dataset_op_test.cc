@@ -39,7 +39,8 @@ class ParallelInterleaveDatasetOpTest : public DatasetOpsTestBase {
       const FunctionDefHelper::AttrValueWrapper &func,
       const DataTypeVector &output_types,
       const std::vector<PartialTensorShape> &output_shapes, bool sloppy,
-      std::unique_ptr<OpKernel> *op_kernel) {
+      std::unique_ptr<OpKernel> *op_kernel, int64 out_of_order_window = 0,
+      const string &permutation_log = "", bool replay_permutation = false) {
     name_utils::OpNameParams params;
     params.op_version = kOpVersion;
     NodeDef node_def = test::function::NDef(
@@ -53,7 +54,11 @@ class ParallelInterleaveDatasetOpTest : public DatasetOpsTestBase {
          {ParallelInterleaveDatasetOp::kTarguments, {}},
          {ParallelInterleaveDatasetOp::kOutputTypes, output_types},
          {ParallelInterleaveDatasetOp::kOutputShapes, output_shapes},
-         {ParallelInterleaveDatasetOp::kSloppy, sloppy}});
+         {ParallelInterleaveDatasetOp::kSloppy, sloppy},
+         {ParallelInterleaveDatasetOp::kOutOfOrderWindow, out_of_order_window},
+         {ParallelInterleaveDatasetOp::kPermutationLog, permutation_log},
+         {ParallelInterleaveDatasetOp::kReplayPermutation,
+          replay_permutation}});
     TF_RETURN_IF_ERROR(CreateOpKernel(node_def, op_kernel));
     return Status::OK();
   }
@@ -541,6 +546,74 @@ TEST_F(ParallelInterleaveDatasetOpTest, InvalidArguments) {
   }
 }
 
+TEST_F(ParallelInterleaveDatasetOpTest, ReplayOutOfOrderWindow) {
+  int thread_num = 2, cpu_num = 2;
+  TestCase test_case = TestCase3();
+  TF_ASSERT_OK(InitThreadPool(thread_num));
+  TF_ASSERT_OK(InitFunctionLibraryRuntime(test_case.func_lib, cpu_num));
+  const string permutation_log =
+      absl::StrCat(testing::TmpDir(), "/parallel_interleave_permutation");
+
+  // Records the order produced with an out-of-order window of 2 and then
+  // replays it.
+  std::vector<Tensor> recorded_tensors;
+  for (bool replay_permutation : {false, true}) {
+    std::unique_ptr<OpKernel> parallel_interleave_dataset_kernel;
+    TF_ASSERT_OK(CreateParallelInterleaveDatasetKernel(
+        test_case.func, test_case.expected_output_dtypes,
+        test_case.expected_output_shapes, /*sloppy=*/false,
+        &parallel_interleave_dataset_kernel, /*out_of_order_window=*/2,
+        permutation_log, replay_permutation));
+
+    Tensor tensor_slice_dataset_tensor(DT_VARIANT, TensorShape({}));
+    std::vector<Tensor> inputs_for_tensor_slice_dataset =
+        test_case.input_tensors;
+    TF_ASSERT_OK(CreateTensorSliceDatasetTensor(
+        &inputs_for_tensor_slice_dataset, &tensor_slice_dataset_tensor));
+    Tensor cycle_length = test_case.cycle_length;
+    Tensor block_length = test_case.block_length;
+    Tensor num_parallel_calls = test_case.num_parallel_calls;
+    gtl::InlinedVector<TensorValue, 4> inputs(
+        {TensorValue(&tensor_slice_dataset_tensor), TensorValue(&cycle_length),
+         TensorValue(&block_length), TensorValue(&num_parallel_calls)});
+    std::unique_ptr<OpKernelContext> parallel_interleave_dataset_context;
+    TF_ASSERT_OK(CreateInterleaveDatasetContext(
+        parallel_interleave_dataset_kernel.get(), &inputs,
+        &parallel_interleave_dataset_context));
+    DatasetBase *parallel_interleave_dataset;
+    TF_ASSERT_OK(CreateDataset(parallel_interleave_dataset_kernel.get(),
+                               parallel_interleave_dataset_context.get(),
+                               &parallel_interleave_dataset));
+    core::ScopedUnref scoped_unref(parallel_interleave_dataset);
+
+    std::unique_ptr<IteratorContext> iterator_ctx;
+    TF_ASSERT_OK(CreateIteratorContext(
+        parallel_interleave_dataset_context.get(), &iterator_ctx));
+    std::unique_ptr<IteratorBase> iterator;
+    TF_ASSERT_OK(parallel_interleave_dataset->MakeIterator(
+        iterator_ctx.get(), "Iterator", &iterator));
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator->GetNext(iterator_ctx.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    // Destroy the iterator to close the permutation log.
+    iterator.reset();
+
+    if (!replay_permutation) {
+      TF_EXPECT_OK(ExpectEqual(out_tensors, test_case.expected_outputs,
+                               /*compare_order*/ false));
+      recorded_tensors = out_tensors;
+    } else {
+      TF_EXPECT_OK(ExpectEqual(out_tensors, recorded_tensors,
+                               /*compare_order*/ true));
+    }
+  }
+}
+
 TEST_F(ParallelInterleaveDatasetOpTest, DatasetNodeName) {
   int thread_num = 2, cpu_num = 2;
   const TestCase &test_case = TestCase1();
@@ -14,17 +14,23 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
 #include <deque>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
@@ -41,6 +47,7 @@ namespace data {
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kSeed2;
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputTypes;
 /* static */ constexpr const char* const ShuffleDatasetOpBase::kOutputShapes;
+/* static */ constexpr const char* const ShuffleDatasetOpBase::kMaxBufferBytes;
 
 /* static */ constexpr const char* const ShuffleDatasetOp::kDatasetType;
 /* static */ constexpr const char* const
@@ -52,6 +59,7 @@ namespace data {
 
 const int64 kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64 kMaxEpochsInBuffer = 3;
+const int64 kSpillReadBufferBytes = 256 << 10;  // 256 KB
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kEndOfInputSequence[] = "end_of_input_sequence";
@@ -62,6 +70,13 @@ constexpr char kSlicesStart[] = "slices_start";
 constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kBuffer[] = "buffer";
 constexpr char kSize[] = "size";
+constexpr char kRun[] = "run";
+constexpr char kSpillRunsSize[] = "spill_runs_size";
+constexpr char kSpillRun[] = "spill_run";
+constexpr char kId[] = "id";
+constexpr char kRemaining[] = "remaining";
+constexpr char kFilename[] = "filename";
+constexpr char kOffset[] = "offset";
 constexpr char kRandomSeedGenerator[] = "RandomSeedGenerator";
 constexpr char kTFData[] = "tf_data";
 constexpr char kDSNumRandomSamples[] = "ds_num_random_samples";
@@ -70,17 +85,22 @@ constexpr char kReshufflingDatasetPrefix[] = "Reshuffling";
 constexpr char kShuffleDataset[] = "ShuffleDataset";
 
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
-    : UnaryDatasetOpKernel(ctx) {}
+    : UnaryDatasetOpKernel(ctx) {
+  if (ctx->HasAttr(kMaxBufferBytes)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kMaxBufferBytes, &max_buffer_bytes_));
+  }
+}
 
 // Abstract base dataset that implements a shuffling iterator.
 class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
  public:
   ShuffleDatasetBase(OpKernelContext* ctx, const DatasetBase* input,
-                     int64 buffer_size, int64 count)
+                     int64 buffer_size, int64 count, int64 max_buffer_bytes)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
-        count_(count) {
+        count_(count),
+        max_buffer_bytes_(max_buffer_bytes) {
     input_->Ref();
   }
 
@@ -124,9 +144,17 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           generator_(&parent_generator_) {
       buffer_ = absl::make_unique<std::vector<Tensor>[]>(
           params.dataset->buffer_size_);
+      if (params.dataset->max_buffer_bytes_ > 0) {
+        AllocateSpillRunIdsLocked();
+      }
       slices_.push_back(absl::make_unique<Slice>(0, 0));
     }
 
+    ~Iterator() override {
+      mutex_lock l(mu_);
+      DeleteSpillRunsLocked();
+    }
+
     string BuildTraceMeName() override {
       return strings::StrCat(
           this->prefix(), "#buffer_size=", this->dataset()->buffer_size_, "#");
@@ -181,10 +209,17 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                     << this->dataset()->buffer_size_;
           }
           this->RecordBufferEnqueue(ctx, input_element);
-          buffer_[slices_.back()->end % this->dataset()->buffer_size_] =
-              std::move(input_element);
+          const int64 index =
+              slices_.back()->end % this->dataset()->buffer_size_;
+          buffer_bytes_ += ElementBytes(input_element);
+          buffer_[index] = std::move(input_element);
+          if (spill_run_ids_) spill_run_ids_[index] = -1;
           num_elements_++;
           slices_.back()->end++;
+          if (this->dataset()->max_buffer_bytes_ > 0 &&
+              buffer_bytes_ > this->dataset()->max_buffer_bytes_) {
+            TF_RETURN_IF_ERROR(SpillLocked(ctx->env()));
+          }
         } else {
           input_impl_.reset();
         }
@@ -215,11 +250,24 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
             Random() % (slices_.front()->end - slices_.front()->start);
         int64 index =
             (slices_.front()->start + offset) % this->dataset()->buffer_size_;
-        *out_tensors = std::move(buffer_[index]);
+        const int64 front_index =
+            slices_.front()->start % this->dataset()->buffer_size_;
+        if (IsSpilledLocked(index)) {
+          // All elements of a run are in random order, so the next element of
+          // the run is as good a sample as the one that was spilled from
+          // `index`.
+          TF_RETURN_IF_ERROR(ReadSpilledLocked(spill_run_ids_[index],
+                                               out_tensors));
+          std::swap(spill_run_ids_[index], spill_run_ids_[front_index]);
+        } else {
+          *out_tensors = std::move(buffer_[index]);
+          buffer_bytes_ -= ElementBytes(*out_tensors);
+          if (spill_run_ids_) {
+            std::swap(spill_run_ids_[index], spill_run_ids_[front_index]);
+          }
+        }
         this->RecordBufferDequeue(ctx, *out_tensors);
-        std::swap(
-            buffer_[index],
-            buffer_[slices_.front()->start % this->dataset()->buffer_size_]);
+        std::swap(buffer_[index], buffer_[front_index]);
         slices_.front()->start++;
         num_elements_--;
       } else {
@@ -281,6 +329,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
               this->full_name(
                   absl::StrJoin(std::make_tuple(kBuffer, index, kSize), "_")),
               buffer_[index].size()));
+          if (IsSpilledLocked(index)) {
+            // Spilled elements are saved with their run below; elements are
+            // never empty, so a size of zero marks a spilled slot.
+            TF_RETURN_IF_ERROR(writer->WriteScalar(
+                this->full_name(
+                    absl::StrJoin(std::make_tuple(kBuffer, index, kRun), "_")),
+                spill_run_ids_[index]));
+            continue;
+          }
           for (size_t k = 0; k < buffer_[index].size(); ++k) {
             TF_RETURN_IF_ERROR(writer->WriteTensor(
                 this->full_name(
@@ -289,6 +346,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           }
         }
       }
+      TF_RETURN_IF_ERROR(SaveSpillRunsLocked(writer));
 
       return Status::OK();
     }
@@ -325,6 +383,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
       buffer_ = absl::make_unique<std::vector<Tensor>[]>(
           this->dataset()->buffer_size_);
+      DeleteSpillRunsLocked();
+      spill_run_ids_.reset();
+      if (this->dataset()->max_buffer_bytes_ > 0) {
+        AllocateSpillRunIdsLocked();
+      }
+      buffer_bytes_ = 0;
       for (size_t i = 0; i < slices_size; ++i) {
         int64 start;
         TF_RETURN_IF_ERROR(
@@ -343,6 +407,15 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
               this->full_name(
                   absl::StrJoin(std::make_tuple(kBuffer, index, kSize), "_")),
               &list_size));
+          if (list_size == 0) {
+            if (!spill_run_ids_) AllocateSpillRunIdsLocked();
+            TF_RETURN_IF_ERROR(reader->ReadScalar(
+                this->full_name(
+                    absl::StrJoin(std::make_tuple(kBuffer, index, kRun), "_")),
+                &spill_run_ids_[index]));
+            continue;
+          }
+          if (spill_run_ids_) spill_run_ids_[index] = -1;
           buffer_[index] = std::vector<Tensor>(list_size);
           for (int k = 0; k < list_size; ++k) {
             TF_RETURN_IF_ERROR(reader->ReadTensor(
@@ -350,8 +423,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                     absl::StrJoin(std::make_tuple(kBuffer, index, k), "_")),
                 &buffer_[index][k]));
           }
+          buffer_bytes_ += ElementBytes(buffer_[index]);
         }
       }
+      TF_RETURN_IF_ERROR(RestoreSpillRunsLocked(ctx->env(), reader));
 
       return Status::OK();
     }
@@ -373,6 +448,21 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       int64 end;
     };
 
+    // A file holding elements spilled from the buffer, in random order. Each
+    // element is stored as one record per component, holding a serialized
+    // `TensorProto`.
+    struct SpillRun {
+      string filename;
+      std::unique_ptr<RandomAccessFile> file;
+      std::unique_ptr<io::SequentialRecordReader> reader;
+      // The number of elements that have not been read yet.
+      int64 remaining = 0;
+      // Set once a checkpoint refers to the file. The file is then left on
+      // disk when the run is done, since the checkpoint may still be
+      // restored, until a newer checkpoint no longer refers to it.
+      bool pinned = false;
+    };
+
     random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
         EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       num_random_samples_++;
@@ -380,6 +470,245 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return out;
     }
 
+    static int64 ElementBytes(const std::vector<Tensor>& element) {
+      int64 bytes = 0;
+      for (const Tensor& t : element) {
+        bytes += t.TotalBytes();
+      }
+      return bytes;
+    }
+
+    void AllocateSpillRunIdsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 size = this->dataset()->buffer_size_;
+      spill_run_ids_ = absl::make_unique<int64[]>(size);
+      std::fill(spill_run_ids_.get(), spill_run_ids_.get() + size, -1);
+    }
+
+    bool IsSpilledLocked(int64 index) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return spill_run_ids_ && spill_run_ids_[index] >= 0;
+    }
+
+    static void CloseSpillRun(SpillRun* run) {
+      run->reader.reset();
+      run->file.reset();
+      if (!run->pinned) {
+        Env::Default()->DeleteFile(run->filename).IgnoreError();
+      }
+    }
+
+    void DeleteSpillRunsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      for (auto& it : spill_runs_) {
+        CloseSpillRun(it.second.get());
+      }
+      spill_runs_.clear();
+    }
+
+    // Opens `run` for reading, starting at byte `offset` of its file.
+    static Status OpenSpillRun(Env* env, uint64 offset, SpillRun* run) {
+      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(run->filename, &run->file));
+      io::RecordReaderOptions options =
+          io::RecordReaderOptions::CreateRecordReaderOptions("");
+      options.buffer_size = kSpillReadBufferBytes;
+      run->reader = absl::make_unique<io::SequentialRecordReader>(
+          run->file.get(), options);
+      return run->reader->SeekOffset(offset);
+    }
+
+    // Writes the given elements, in order, to a new spill run with id
+    // `run_id`, and opens the run for reading.
+    Status WriteSpillRunLocked(Env* env, int64 run_id,
+                               const std::vector<const std::vector<Tensor>*>&
+                                   elements) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (spill_prefix_.empty()) {
+        // Only the unique name is needed; the runs get their own files.
+        spill_prefix_ = io::GetTempFilename("shuffle_spill");
+        env->DeleteFile(spill_prefix_).IgnoreError();
+      }
+      auto run = absl::make_unique<SpillRun>();
+      run->filename = strings::StrCat(spill_prefix_, "_", run_id);
+      {
+        std::unique_ptr<WritableFile> file;
+        TF_RETURN_IF_ERROR(env->NewWritableFile(run->filename, &file));
+        io::RecordWriter writer(file.get());
+        for (const std::vector<Tensor>* element : elements) {
+          for (const Tensor& t : *element) {
+            TensorProto proto;
+            t.AsProtoTensorContent(&proto);
+            TF_RETURN_IF_ERROR(writer.WriteRecord(proto.SerializeAsString()));
+          }
+        }
+        TF_RETURN_IF_ERROR(writer.Close());
+        TF_RETURN_IF_ERROR(file->Close());
+      }
+      TF_RETURN_IF_ERROR(OpenSpillRun(env, /*offset=*/0, run.get()));
+      run->remaining = elements.size();
+      spill_runs_[run_id] = std::move(run);
+      next_spill_run_id_ = std::max(next_spill_run_id_, run_id + 1);
+      return Status::OK();
+    }
+
+    // Moves the newest in-memory elements to disk, until at most half of
+    // `max_buffer_bytes_` remains in memory. The elements taken from each
+    // slice form one run, written in random order so that it can be read back
+    // sequentially.
+    Status SpillLocked(Env* env) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const int64 buffer_size = this->dataset()->buffer_size_;
+      const int64 target_bytes = this->dataset()->max_buffer_bytes_ / 2;
+      for (auto it = slices_.rbegin();
+           it != slices_.rend() && buffer_bytes_ > target_bytes; ++it) {
+        std::vector<int64> indices;
+        int64 spilled_bytes = 0;
+        for (int64 j = (*it)->end - 1;
+             j >= (*it)->start && buffer_bytes_ - spilled_bytes > target_bytes;
+             --j) {
+          if (!IsSpilledLocked(j % buffer_size)) {
+            indices.push_back(j % buffer_size);
+            spilled_bytes += ElementBytes(buffer_[j % buffer_size]);
+          }
+        }
+        if (indices.empty()) continue;
+        for (int64 i = indices.size() - 1; i > 0; --i) {
+          std::swap(indices[i], indices[Random() % (i + 1)]);
+        }
+        std::vector<const std::vector<Tensor>*> elements;
+        elements.reserve(indices.size());
+        for (int64 index : indices) {
+          elements.push_back(&buffer_[index]);
+        }
+        const int64 run_id = next_spill_run_id_;
+        TF_RETURN_IF_ERROR(WriteSpillRunLocked(env, run_id, elements));
+        VLOG(2) << "Spilled " << indices.size() << " shuffle buffer elements"
+                << " to " << spill_runs_[run_id]->filename;
+        for (int64 index : indices) {
+          buffer_bytes_ -= ElementBytes(buffer_[index]);
+          buffer_[index].clear();
+          spill_run_ids_[index] = run_id;
+        }
+      }
+      return Status::OK();
+    }
+
+    // Reads the next element of spill run `run_id`.
+    Status ReadSpilledLocked(int64 run_id, std::vector<Tensor>* element)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      auto it = spill_runs_.find(run_id);
+      if (it == spill_runs_.end() || it->second->remaining == 0) {
+        return errors::Internal("No elements left in shuffle spill run ",
+                                run_id);
+      }
+      SpillRun* run = it->second.get();
+      const size_t num_components = this->dataset()->output_dtypes().size();
+      element->clear();
+      element->reserve(num_components);
+      for (size_t i = 0; i < num_components; ++i) {
+        tstring record;
+        TF_RETURN_IF_ERROR(run->reader->ReadRecord(&record));
+        TensorProto proto;
+        Tensor t;
+        if (!proto.ParseFromArray(record.data(), record.size()) ||
+            !t.FromProto(proto)) {
+          return errors::DataLoss("Unable to parse tensor from ",
+                                  run->filename);
+        }
+        element->push_back(std::move(t));
+      }
+      if (--run->remaining == 0) {
+        CloseSpillRun(run);
+        spill_runs_.erase(it);
+      }
+      return Status::OK();
+    }
+
+    // Saves where each spill run is to be read from. The elements themselves
+    // stay in the run files, which are pinned so that they outlive the run.
+    // The files that only the previous checkpoint referred to are deleted.
+    Status SaveSpillRunsLocked(IteratorStateWriter* writer)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSpillRunsSize),
+                                             spill_runs_.size()));
+      std::vector<string> saved_files;
+      int64 i = 0;
+      for (const auto& it : spill_runs_) {
+        SpillRun* run = it.second.get();
+        run->pinned = true;
+        saved_files.push_back(run->filename);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            this->full_name(absl::StrJoin(std::make_tuple(kSpillRun, i, kId),
+                                          "_")),
+            it.first));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            this->full_name(absl::StrJoin(
+                std::make_tuple(kSpillRun, i, kRemaining), "_")),
+            run->remaining));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            this->full_name(absl::StrJoin(
+                std::make_tuple(kSpillRun, i, kFilename), "_")),
+            run->filename));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            this->full_name(
+                absl::StrJoin(std::make_tuple(kSpillRun, i, kOffset), "_")),
+            static_cast<int64>(run->reader->TellOffset())));
+        ++i;
+      }
+      // Every run that is still open is in `saved_files`, so the others are
+      // done and their files are no longer needed by the iterator.
+      for (const string& filename : saved_spill_files_) {
+        if (std::find(saved_files.begin(), saved_files.end(), filename) ==
+            saved_files.end()) {
+          Env::Default()->DeleteFile(filename).IgnoreError();
+        }
+      }
+      saved_spill_files_.swap(saved_files);
+      return Status::OK();
+    }
+
+    // Reopens the spill runs saved by `SaveSpillRunsLocked`, each at the
+    // position it had when it was saved.
+    Status RestoreSpillRunsLocked(Env* env, IteratorStateReader* reader)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!reader->Contains(this->full_name(kSpillRunsSize))) {
+        return Status::OK();
+      }
+      int64 num_runs;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(this->full_name(kSpillRunsSize), &num_runs));
+      saved_spill_files_.clear();
+      for (int64 i = 0; i < num_runs; ++i) {
+        int64 run_id;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(absl::StrJoin(std::make_tuple(kSpillRun, i, kId),
+                                          "_")),
+            &run_id));
+        auto run = absl::make_unique<SpillRun>();
+        // The file belongs to the checkpoint, which may be restored again.
+        run->pinned = true;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(absl::StrJoin(
+                std::make_tuple(kSpillRun, i, kRemaining), "_")),
+            &run->remaining));
+        tstring filename;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(absl::StrJoin(
+                std::make_tuple(kSpillRun, i, kFilename), "_")),
+            &filename));
+        run->filename = filename;
+        int64 offset;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(
+                absl::StrJoin(std::make_tuple(kSpillRun, i, kOffset), "_")),
+            &offset));
+        Status s = OpenSpillRun(env, offset, run.get());
+        if (!s.ok()) {
+          return errors::DataLoss("Unable to reopen shuffle spill run ",
+                                  run->filename, ": ", s.error_message());
+        }
+        saved_spill_files_.push_back(run->filename);
+        spill_runs_[run_id] = std::move(run);
+        next_spill_run_id_ = std::max(next_spill_run_id_, run_id + 1);
+      }
+      return Status::OK();
+    }
+
     std::unique_ptr<std::vector<Tensor>[]> buffer_ GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
     int64 epoch_ GUARDED_BY(mu_);
@@ -389,11 +718,33 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     random::SingleSampleAdapter<random::PhiloxRandom> generator_
         GUARDED_BY(mu_);
     int64 num_random_samples_ GUARDED_BY(mu_) = 0;
+
+    // Bytes of the elements in `buffer_` that are held in memory.
+    int64 buffer_bytes_ GUARDED_BY(mu_) = 0;
+    // For each slot of `buffer_`, the id of the spill run holding its element,
+    // or -1 if the element is in memory. Only allocated once elements may be
+    // spilled.
+    std::unique_ptr<int64[]> spill_run_ids_ GUARDED_BY(mu_);
+    std::unordered_map<int64, std::unique_ptr<SpillRun>> spill_runs_
+        GUARDED_BY(mu_);
+    int64 next_spill_run_id_ GUARDED_BY(mu_) = 0;
+    string spill_prefix_ GUARDED_BY(mu_);
+    // The spill files referred to by the checkpoint this iterator last saved
+    // or was restored from.
+    std::vector<string> saved_spill_files_ GUARDED_BY(mu_);
   };
 
+  // Returns the `max_buffer_bytes` attr of this dataset's op.
+  AttrValue MaxBufferBytesAttr(DatasetGraphDefBuilder* b) const {
+    AttrValue max_buffer_bytes;
+    b->BuildAttrValue(max_buffer_bytes_, &max_buffer_bytes);
+    return max_buffer_bytes;
+  }
+
   const DatasetBase* const input_;
   const int64 buffer_size_;
   const int64 count_;
+  const int64 max_buffer_bytes_;
 };
 
 // A dataset that uses a pseudorandom sequence of seeds for the iterators
@@ -401,8 +752,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 class ShuffleDatasetOp::ReshufflingDataset : public ShuffleDatasetBase {
  public:
   ReshufflingDataset(OpKernelContext* ctx, const DatasetBase* input,
-                     int64 buffer_size, int64 seed, int64 seed2, int64 count)
-      : ShuffleDatasetBase(ctx, input, buffer_size, count),
+                     int64 buffer_size, int64 seed, int64 seed2, int64 count,
+                     int64 max_buffer_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, count, max_buffer_bytes),
         seed_(seed),
         seed2_(seed2) {}
 
@@ -516,8 +868,8 @@ class ShuffleDatasetOp::ReshufflingDataset : public ShuffleDatasetBase {
     b->BuildAttrValue(true, &reshuffle_each_iteration);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this, {input_graph_node, buffer_size, seed, seed2},  // Inputs
-        {std::make_pair(kReshuffleEachIteration,
-                        reshuffle_each_iteration)},  // Attrs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMaxBufferBytes, MaxBufferBytesAttr(b))},  // Attrs
         output));
     return Status::OK();
   }
@@ -534,8 +886,9 @@ class ShuffleDatasetOp::ReshufflingDatasetV2 : public ShuffleDatasetBase {
   ReshufflingDatasetV2(OpKernelContext* ctx, const DatasetBase* input,
                        int64 buffer_size, int64 count,
                        RandomSeedGenerator* seed_generator,
-                       std::unique_ptr<OwnedResourceHandle> handle)
-      : ShuffleDatasetBase(ctx, input, buffer_size, count),
+                       std::unique_ptr<OwnedResourceHandle> handle,
+                       int64 max_buffer_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, count, max_buffer_bytes),
         seed_generator_(seed_generator),
         handle_(std::move(handle)) {}
 
@@ -624,7 +977,7 @@ class ShuffleDatasetOp::ReshufflingDatasetV2 : public ShuffleDatasetBase {
     TF_RETURN_IF_ERROR(b->AddDataset(
         this,
         {input_graph_node, buffer_size_node, resource_handle_node},  // Inputs
-        {},                                                          // Attrs
+        {std::make_pair(kMaxBufferBytes, MaxBufferBytesAttr(b))},    // Attrs
         output));
     return Status::OK();
   }
@@ -639,8 +992,9 @@ class ShuffleDatasetOp::ReshufflingDatasetV2 : public ShuffleDatasetBase {
 class ShuffleDatasetOp::FixedSeedDataset : public ShuffleDatasetBase {
  public:
   FixedSeedDataset(OpKernelContext* ctx, const DatasetBase* input,
-                   int64 buffer_size, int64 seed, int64 seed2, int64 count)
-      : ShuffleDatasetBase(ctx, input, buffer_size, count),
+                   int64 buffer_size, int64 seed, int64 seed2, int64 count,
+                   int64 max_buffer_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, count, max_buffer_bytes),
         seed_(seed),
         seed2_(seed2) {}
 
@@ -676,8 +1030,8 @@ class ShuffleDatasetOp::FixedSeedDataset : public ShuffleDatasetBase {
     b->BuildAttrValue(false, &reshuffle_each_iteration);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this, {input_graph_node, buffer_size, seed, seed2},  // Inputs
-        {std::make_pair(kReshuffleEachIteration,
-                        reshuffle_each_iteration)},  // Attrs
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration),
+         std::make_pair(kMaxBufferBytes, MaxBufferBytesAttr(b))},  // Attrs
         output));
     return Status::OK();
   }
@@ -720,7 +1074,8 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
 
     // Ownership of seed generator is transferred onto `ReshufflingDatasetV2`.
     *output = new ReshufflingDatasetV2(ctx, input, buffer_size, count,
-                                       seed_generator, std::move(handle));
+                                       seed_generator, std::move(handle),
+                                       max_buffer_bytes_);
     return;
   }
 
@@ -738,18 +1093,19 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   }
 
   if (reshuffle_each_iteration_) {
-    *output =
-        new ReshufflingDataset(ctx, input, buffer_size, seed, seed2, count);
+    *output = new ReshufflingDataset(ctx, input, buffer_size, seed, seed2,
+                                     count, max_buffer_bytes_);
   } else {
-    *output = new FixedSeedDataset(ctx, input, buffer_size, seed, seed2, count);
+    *output = new FixedSeedDataset(ctx, input, buffer_size, seed, seed2, count,
+                                   max_buffer_bytes_);
   }
 }
 
 class ShuffleAndRepeatDatasetOp::Dataset : public ShuffleDatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-          int64 seed, int64 seed2, int64 count)
-      : ShuffleDatasetBase(ctx, input, buffer_size, count),
+          int64 seed, int64 seed2, int64 count, int64 max_buffer_bytes)
+      : ShuffleDatasetBase(ctx, input, buffer_size, count, max_buffer_bytes),
         seed_(seed),
         seed2_(seed2) {}
 
@@ -784,7 +1140,7 @@ class ShuffleAndRepeatDatasetOp::Dataset : public ShuffleDatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(count_, &count));
     TF_RETURN_IF_ERROR(b->AddDataset(
         this, {input_graph_node, buffer_size, seed, seed2, count},  // Inputs
-        {},                                                         // Attrs
+        {std::make_pair(kMaxBufferBytes, MaxBufferBytesAttr(b))},   // Attrs
         output));
     return Status::OK();
   }
@@ -827,7 +1183,8 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
     seed2 = random::New64();
   }
 
-  *output = new Dataset(ctx, input, buffer_size, seed, seed2, count);
+  *output = new Dataset(ctx, input, buffer_size, seed, seed2, count,
+                        max_buffer_bytes_);
 }
 
 namespace {
@@ -28,11 +28,16 @@ class ShuffleDatasetOpBase : public UnaryDatasetOpKernel {
   static constexpr const char* const kSeed2 = "seed2";
   static constexpr const char* const kOutputTypes = "output_types";
   static constexpr const char* const kOutputShapes = "output_shapes";
+  static constexpr const char* const kMaxBufferBytes = "max_buffer_bytes";
 
   explicit ShuffleDatasetOpBase(OpKernelConstruction* ctx);
 
  protected:
   class ShuffleDatasetBase;
+
+  // If positive, the shuffle buffer keeps at most this many bytes of elements
+  // in memory and spills the rest to local disk.
+  int64 max_buffer_bytes_ = 0;
 };
 
 class ShuffleDatasetOp : public ShuffleDatasetOpBase {
@@ -12,6 +12,8 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
 #include "tensorflow/core/kernels/data/dataset_test_base.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/io/path.h"
 
 namespace tensorflow {
 namespace data {
@@ -27,7 +29,8 @@ class ShuffleDatasetOpTest : public DatasetOpsTestBase {
       int64 count, bool reshuffle_each_iteration,
       const DataTypeVector& output_types,
       const std::vector<PartialTensorShape>& output_shapes,
-      std::unique_ptr<OpKernel>* shuffle_dataset_kernel) {
+      std::unique_ptr<OpKernel>* shuffle_dataset_kernel,
+      int64 max_buffer_bytes = 0) {
     NodeDef node_def;
     if (count == 1) {
       node_def = test::function::NDef(
@@ -37,7 +40,8 @@ class ShuffleDatasetOpTest : public DatasetOpsTestBase {
           {{ShuffleDatasetOp::kReshuffleEachIteration,
             reshuffle_each_iteration},
            {ShuffleDatasetOp::kOutputTypes, output_types},
-           {ShuffleDatasetOp::kOutputShapes, output_shapes}});
+           {ShuffleDatasetOp::kOutputShapes, output_shapes},
+           {ShuffleDatasetOp::kMaxBufferBytes, max_buffer_bytes}});
     } else {
       node_def = test::function::NDef(
           kShuffleAndRepeatNodeName,
@@ -47,7 +51,8 @@ class ShuffleDatasetOpTest : public DatasetOpsTestBase {
            ShuffleAndRepeatDatasetOp::kSeed, ShuffleAndRepeatDatasetOp::kSeed2,
            ShuffleAndRepeatDatasetOp::kCount},
           {{ShuffleAndRepeatDatasetOp::kOutputTypes, output_types},
-           {ShuffleAndRepeatDatasetOp::kOutputShapes, output_shapes}});
+           {ShuffleAndRepeatDatasetOp::kOutputShapes, output_shapes},
+           {ShuffleAndRepeatDatasetOp::kMaxBufferBytes, max_buffer_bytes}});
     }
     TF_RETURN_IF_ERROR(CreateOpKernel(node_def, shuffle_dataset_kernel));
     return Status::OK();
@@ -877,6 +882,130 @@ TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   }
 }
 
+TEST_F(ShuffleDatasetOpTest, SpillToDisk) {
+  int thread_num = 2, cpu_num = 2;
+  TF_ASSERT_OK(InitThreadPool(thread_num));
+  TF_ASSERT_OK(InitFunctionLibraryRuntime({}, cpu_num));
+
+  // Spill runs are written to the first temporary directory, which the test
+  // points at a directory of its own.
+  const string spill_dir = io::JoinPath(testing::TmpDir(), "shuffle_spill");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(spill_dir));
+  const char* old_tmpdir = getenv("TEST_TMPDIR");
+  const string saved_tmpdir = old_tmpdir != nullptr ? old_tmpdir : "";
+  setenv("TEST_TMPDIR", spill_dir.c_str(), true);
+  auto cleanup = gtl::MakeCleanup([&spill_dir, old_tmpdir, &saved_tmpdir]() {
+    if (old_tmpdir != nullptr) {
+      setenv("TEST_TMPDIR", saved_tmpdir.c_str(), true);
+    } else {
+      unsetenv("TEST_TMPDIR");
+    }
+    int64 undeleted_files, undeleted_dirs;
+    Env::Default()
+        ->DeleteRecursively(spill_dir, &undeleted_files, &undeleted_dirs)
+        .IgnoreError();
+  });
+  auto num_spill_files = [&spill_dir]() {
+    std::vector<string> children;
+    TF_CHECK_OK(Env::Default()->GetChildren(spill_dir, &children));
+    return children.size();
+  };
+
+  // Each element is an 8-byte scalar, so a 64-byte budget holds at most 8 of
+  // the 50 buffered elements in memory.
+  std::unique_ptr<OpKernel> dataset_kernel;
+  TF_ASSERT_OK(CreateDatasetOpKernel(
+      /*count=*/2, /*reshuffle_each_iteration=*/false, {DT_INT64},
+      {PartialTensorShape({})}, &dataset_kernel, /*max_buffer_bytes=*/64));
+
+  DatasetBase* range_dataset;
+  TF_ASSERT_OK(CreateRangeDataset<int64>(0, 100, 1, "range", &range_dataset));
+  Tensor range_dataset_tensor(DT_VARIANT, TensorShape({}));
+  TF_ASSERT_OK(
+      StoreDatasetInVariantTensor(range_dataset, &range_dataset_tensor));
+  Tensor buffer_size = CreateTensor<int64>(TensorShape({}), {50});
+  Tensor seed = CreateTensor<int64>(TensorShape({}), {1});
+  Tensor seed2 = CreateTensor<int64>(TensorShape({}), {2});
+  Tensor count = CreateTensor<int64>(TensorShape({}), {2});
+  gtl::InlinedVector<TensorValue, 4> inputs(
+      {TensorValue(&range_dataset_tensor), TensorValue(&buffer_size),
+       TensorValue(&seed), TensorValue(&seed2), TensorValue(&count)});
+
+  std::unique_ptr<OpKernelContext> dataset_context;
+  TF_ASSERT_OK(
+      CreateDatasetContext(dataset_kernel.get(), &inputs, &dataset_context));
+  DatasetBase* dataset;
+  TF_ASSERT_OK(
+      CreateDataset(dataset_kernel.get(), dataset_context.get(), &dataset));
+  core::ScopedUnref scoped_unref_dataset(dataset);
+
+  std::unique_ptr<IteratorContext> iterator_ctx;
+  TF_ASSERT_OK(CreateIteratorContext(dataset_context.get(), &iterator_ctx));
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(
+      dataset->MakeIterator(iterator_ctx.get(), "Iterator", &iterator));
+
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(
+        iterator->GetNext(iterator_ctx.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    if (out_tensors.size() == 1) {
+      // Filling the buffer went over the budget.
+      EXPECT_GT(num_spill_files(), 0);
+    }
+  }
+  // Without a checkpoint, each run is deleted once it has been read.
+  EXPECT_EQ(0, num_spill_files());
+  std::vector<int64> expected;
+  for (int64 i = 0; i < 100; ++i) {
+    expected.push_back(i);
+    expected.push_back(i);
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors,
+                           ConvertToTensorVec<int64>(expected),
+                           /*compare_order*/ false));
+
+  // Saving and restoring the iterator, including the elements it has spilled,
+  // must not change the output.
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  TF_ASSERT_OK(
+      dataset->MakeIterator(iterator_ctx.get(), "Iterator", &iterator));
+  end_of_sequence = false;
+  std::vector<Tensor> restored_out_tensors;
+  int cur_iteration = 0;
+  for (int breakpoint : {0, 30, 75, 150, 250}) {
+    VariantTensorData data;
+    VariantTensorDataWriter writer(&data);
+    TF_EXPECT_OK(iterator->Save(serialization_ctx.get(), &writer));
+    TF_EXPECT_OK(writer.Flush());
+    VariantTensorDataReader reader(&data);
+    TF_EXPECT_OK(RestoreIterator(iterator_ctx.get(), &reader, "Iterator",
+                                 *dataset, &iterator));
+
+    while (cur_iteration <= breakpoint && !end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator->GetNext(iterator_ctx.get(), &next, &end_of_sequence));
+      restored_out_tensors.insert(restored_out_tensors.end(), next.begin(),
+                                  next.end());
+      cur_iteration++;
+    }
+  }
+  TF_EXPECT_OK(ExpectEqual(restored_out_tensors, out_tensors,
+                           /*compare_order*/ true));
+
+  // Once a checkpoint no longer refers to any run, the files of the runs that
+  // earlier checkpoints referred to are deleted.
+  VariantTensorData data;
+  VariantTensorDataWriter writer(&data);
+  TF_EXPECT_OK(iterator->Save(serialization_ctx.get(), &writer));
+  EXPECT_EQ(0, num_spill_files());
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -32,6 +32,7 @@ ABSL_CONST_INIT const char kDroppedElements[] = "dropped_elements";
 ABSL_CONST_INIT const char kFeaturesCount[] = "features_count";
 ABSL_CONST_INIT const char kFeatureValuesCount[] = "feature_values_count";
 ABSL_CONST_INIT const char kExamplesCount[] = "examples_count";
+ABSL_CONST_INIT const char kLatencyShare[] = "latency_share";
 
 string ExecutionTimeHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kExecutionTime);
@@ -69,6 +70,10 @@ string FeatureValueHistogramName(const string& prefix) {
   return strings::StrCat(prefix, kDelimiter, kFeatureValuesCount);
 }
 
+string LatencyShareScalarName(const string& prefix) {
+  return strings::StrCat(prefix, kDelimiter, kLatencyShare);
+}
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
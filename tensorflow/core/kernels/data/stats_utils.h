@@ -31,6 +31,7 @@ extern const char kDroppedElements[];
 extern const char kFeaturesCount[];
 extern const char kFeatureValuesCount[];
 extern const char kExamplesCount[];
+extern const char kLatencyShare[];
 
 // Name for tf.data function execution time (in ns) histogram metrics.
 string ExecutionTimeHistogramName(const string& prefix);
@@ -61,6 +62,10 @@ string FeatureHistogramName(const string& prefix);
 // Name for feature-values count histogram metrics.
 string FeatureValueHistogramName(const string& prefix);
 
+// Name for latency share (share of the output latency of the input pipeline
+// spent in a transformation) scalar metrics.
+string LatencyShareScalarName(const string& prefix);
+
 }  // namespace stats_utils
 }  // namespace data
 }  // namespace tensorflow
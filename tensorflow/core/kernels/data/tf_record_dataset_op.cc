@@ -35,6 +35,7 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kFileNames;
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
+/* static */ constexpr const char* const TFRecordDatasetOp::kUseMmap;
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
@@ -42,10 +43,12 @@ constexpr char kOffset[] = "offset";
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64 buffer_size)
+                   const string& compression_type, int64 buffer_size,
+                   bool use_mmap)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
+        use_mmap_(use_mmap),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
             compression_type)) {
     if (buffer_size > 0) {
@@ -86,8 +89,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+    AttrValue use_mmap;
+    b->BuildAttrValue(use_mmap_, &use_mmap);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {filenames, compression_type, buffer_size},
+                      {std::make_pair(kUseMmap, use_mmap)}, output));
     return Status::OK();
   }
 
@@ -103,11 +109,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(mu_);
       do {
         // We are currently processing a file, so try to read the next record.
-        if (reader_) {
+        if (reader_ || mapped_reader_) {
           out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
                                     TensorShape({}));
           Status s =
-              reader_->ReadRecord(&out_tensors->back().scalar<tstring>()());
+              ReadRecordLocked(&out_tensors->back().scalar<tstring>()());
           if (s.ok()) {
             metrics::RecordTFDataBytesRead(
                 kDatasetType, out_tensors->back().scalar<tstring>()().size());
@@ -151,7 +157,10 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCurrentFileIndex),
                                              current_file_index_));
 
-      if (reader_) {
+      if (mapped_reader_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kOffset),
+                                               static_cast<int64>(offset_)));
+      } else if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
       }
@@ -170,7 +179,11 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
         int64 offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        if (mapped_reader_) {
+          offset_ = offset;
+        } else {
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
       }
       return Status::OK();
     }
@@ -186,16 +199,48 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
       // Actually move on to next file.
       const string& next_filename = dataset()->filenames_[current_file_index_];
+      if (dataset()->use_mmap_) {
+        // Empty files cannot be mapped, and some file systems do not
+        // support mapping at all; both are read with the sequential reader.
+        uint64 file_size;
+        TF_RETURN_IF_ERROR(env->GetFileSize(next_filename, &file_size));
+        if (file_size > 0) {
+          Status s =
+              env->NewReadOnlyMemoryRegionFromFile(next_filename, &region_);
+          if (s.ok()) {
+            mapped_reader_ =
+                absl::make_unique<io::MappedRecordReader>(region_.get());
+            offset_ = 0;
+            return Status::OK();
+          }
+          if (!errors::IsUnimplemented(s)) return s;
+        }
+      }
       TF_RETURN_IF_ERROR(env->NewRandomAccessFile(next_filename, &file_));
       reader_ = absl::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
       return Status::OK();
     }
 
+    // Reads the next record of the current file into `record`. Records read
+    // from a mapped file are copied straight out of the mapping.
+    Status ReadRecordLocked(tstring* record) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (mapped_reader_) {
+        StringPiece mapped_record;
+        TF_RETURN_IF_ERROR(
+            mapped_reader_->ReadRecord(&offset_, &mapped_record));
+        record->assign(mapped_record.data(), mapped_record.size());
+        return Status::OK();
+      }
+      return reader_->ReadRecord(record);
+    }
+
     // Resets all reader streams.
     void ResetStreamsLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
       file_.reset();
+      mapped_reader_.reset();
+      region_.reset();
     }
 
     mutex mu_;
@@ -205,15 +250,25 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ GUARDED_BY(mu_);
+
+    // Set instead of `reader_` when the current file is memory-mapped.
+    // `mapped_reader_` borrows `region_`, and `offset_` is the offset of the
+    // next record in it.
+    std::unique_ptr<ReadOnlyMemoryRegion> region_ GUARDED_BY(mu_);
+    std::unique_ptr<io::MappedRecordReader> mapped_reader_ GUARDED_BY(mu_);
+    uint64 offset_ GUARDED_BY(mu_) = 0;
   };
 
   const std::vector<string> filenames_;
   const tstring compression_type_;
+  const bool use_mmap_;
   io::RecordReaderOptions options_;
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
-    : DatasetOpKernel(ctx) {}
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseMmap, &use_mmap_));
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -240,9 +295,13 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
   OP_REQUIRES(ctx, buffer_size >= 0,
               errors::InvalidArgument(
                   "`buffer_size` must be >= 0 (0 == no buffering)"));
+  OP_REQUIRES(ctx, !use_mmap_ || compression_type.empty(),
+              errors::InvalidArgument(
+                  "`use_mmap` is only supported for uncompressed files, got "
+                  "`compression_type` \"", compression_type, "\""));
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, use_mmap_);
 }
 
 namespace {
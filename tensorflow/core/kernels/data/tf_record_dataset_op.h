@@ -26,6 +26,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kFileNames = "filenames";
   static constexpr const char* const kCompressionType = "compression_type";
   static constexpr const char* const kBufferSize = "buffer_size";
+  static constexpr const char* const kUseMmap = "use_mmap";
 
   explicit TFRecordDatasetOp(OpKernelConstruction* ctx);
 
@@ -34,6 +35,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
 
  private:
   class Dataset;
+
+  bool use_mmap_;
 };
 
 }  // namespace data
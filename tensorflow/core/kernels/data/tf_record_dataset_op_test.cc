@@ -24,12 +24,12 @@ class TFRecordDatasetOpTest : public DatasetOpsTestBase {
  protected:
   // Create a new `TFRecordDataset` op kernel.
   Status CreateTFRecordDatasetOpKernel(
-      std::unique_ptr<OpKernel>* tf_record_dataset_op_kernel) {
+      bool use_mmap, std::unique_ptr<OpKernel>* tf_record_dataset_op_kernel) {
     NodeDef node_def = test::function::NDef(
         kNodeName, name_utils::OpName(TFRecordDatasetOp::kDatasetType),
         {TFRecordDatasetOp::kFileNames, TFRecordDatasetOp::kCompressionType,
          TFRecordDatasetOp::kBufferSize},
-        {});
+        {{TFRecordDatasetOp::kUseMmap, use_mmap}});
     TF_RETURN_IF_ERROR(CreateOpKernel(node_def, tf_record_dataset_op_kernel));
     return Status::OK();
   }
@@ -50,6 +50,7 @@ struct TestCase {
   std::vector<std::vector<string>> contents;
   CompressionType compression_type;
   int64 buffer_size;
+  bool use_mmap;
   std::vector<Tensor> expected_outputs;
   DataTypeVector expected_output_dtypes;
   std::vector<PartialTensorShape> expected_output_shapes;
@@ -83,6 +84,7 @@ TestCase TestCase1() {
           {{"1", "22", "333"}, {"a", "bb", "ccc"}},
           /*compression_type*/ CompressionType::ZLIB,
           /*buffer_size*/ 10,
+          /*use_mmap*/ false,
           /*expected_outputs*/
           {CreateTensor<tstring>(TensorShape({}), {"1"}),
            CreateTensor<tstring>(TensorShape({}), {"22"}),
@@ -104,6 +106,7 @@ TestCase TestCase2() {
           {{"1", "22", "333"}, {"a", "bb", "ccc"}},
           /*compression_type*/ CompressionType::GZIP,
           /*buffer_size*/ 10,
+          /*use_mmap*/ false,
           /*expected_outputs*/
           {CreateTensor<tstring>(TensorShape({}), {"1"}),
            CreateTensor<tstring>(TensorShape({}), {"22"}),
@@ -126,6 +129,30 @@ TestCase TestCase3() {
           {{"1", "22", "333"}, {"a", "bb", "ccc"}},
           /*compression_type*/ CompressionType::UNCOMPRESSED,
           /*buffer_size*/ 10,
+          /*use_mmap*/ false,
+          /*expected_outputs*/
+          {CreateTensor<tstring>(TensorShape({}), {"1"}),
+           CreateTensor<tstring>(TensorShape({}), {"22"}),
+           CreateTensor<tstring>(TensorShape({}), {"333"}),
+           CreateTensor<tstring>(TensorShape({}), {"a"}),
+           CreateTensor<tstring>(TensorShape({}), {"bb"}),
+           CreateTensor<tstring>(TensorShape({}), {"ccc"})},
+          /*expected_output_dtypes*/ {DT_STRING},
+          /*expected_output_shapes*/ {PartialTensorShape({})},
+          /*expected_cardinality*/ kUnknownCardinality,
+          /*breakpoints*/ {0, 2, 7}};
+}
+
+// Test case 4: multiple memory-mapped files, one of them empty.
+TestCase TestCase4() {
+  return {/*filenames*/ {absl::StrCat(testing::TmpDir(), "/tf_record_MMAP_1"),
+                         absl::StrCat(testing::TmpDir(), "/tf_record_MMAP_2"),
+                         absl::StrCat(testing::TmpDir(), "/tf_record_MMAP_3")},
+          /*contents*/
+          {{"1", "22", "333"}, {}, {"a", "bb", "ccc"}},
+          /*compression_type*/ CompressionType::UNCOMPRESSED,
+          /*buffer_size*/ 10,
+          /*use_mmap*/ true,
           /*expected_outputs*/
           {CreateTensor<tstring>(TensorShape({}), {"1"}),
            CreateTensor<tstring>(TensorShape({}), {"22"}),
@@ -152,7 +179,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, GetNext) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -202,7 +230,8 @@ TEST_F(TFRecordDatasetOpTest, DatasetNodeName) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -235,7 +264,8 @@ TEST_F(TFRecordDatasetOpTest, DatasetTypeString) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -269,7 +299,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, DatasetOutputDtypes) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -303,7 +334,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, DatasetOutputShapes) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -337,7 +369,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, Cardinality) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -370,7 +403,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, IteratorOutputDtypes) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -412,7 +446,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, IteratorOutputShapes) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -454,7 +489,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, IteratorOutputPrefix) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -497,7 +533,8 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, Roundtrip) {
   TF_ASSERT_OK(CreateTestFiles(test_case));
 
   std::unique_ptr<OpKernel> tf_record_dataset_kernel;
-  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(&tf_record_dataset_kernel));
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(test_case.use_mmap,
+                                             &tf_record_dataset_kernel));
 
   int64 num_files = test_case.filenames.size();
   Tensor filenames =
@@ -555,10 +592,39 @@ TEST_P(ParameterizedTFRecordDatasetOpTest, Roundtrip) {
                            /*compare_order*/ true));
 }
 
+TEST_F(TFRecordDatasetOpTest, InvalidMmapCompression) {
+  int thread_num = 2, cpu_num = 2;
+  TF_ASSERT_OK(InitThreadPool(thread_num));
+  TF_ASSERT_OK(InitFunctionLibraryRuntime({}, cpu_num));
+
+  std::unique_ptr<OpKernel> tf_record_dataset_kernel;
+  TF_ASSERT_OK(CreateTFRecordDatasetOpKernel(/*use_mmap=*/true,
+                                             &tf_record_dataset_kernel));
+
+  Tensor filenames = CreateTensor<tstring>(
+      TensorShape({1}), {absl::StrCat(testing::TmpDir(), "/tf_record_ZLIB_1")});
+  Tensor compression_type = CreateTensor<tstring>(
+      TensorShape({}), {ToString(CompressionType::ZLIB)});
+  Tensor buffer_size = CreateTensor<int64>(TensorShape({}), {10});
+  gtl::InlinedVector<TensorValue, 4> inputs{TensorValue(&filenames),
+                                            TensorValue(&compression_type),
+                                            TensorValue(&buffer_size)};
+  std::unique_ptr<OpKernelContext> tf_record_dataset_context;
+  TF_ASSERT_OK(CreateTFRecordDatasetContext(
+      tf_record_dataset_kernel.get(), &inputs, &tf_record_dataset_context));
+
+  DatasetBase* tf_record_dataset;
+  EXPECT_EQ(CreateDataset(tf_record_dataset_kernel.get(),
+                          tf_record_dataset_context.get(), &tf_record_dataset)
+                .code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
 INSTANTIATE_TEST_SUITE_P(TFRecordDatasetOpTest,
                          ParameterizedTFRecordDatasetOpTest,
                          ::testing::ValuesIn(std::vector<TestCase>(
-                             {TestCase1(), TestCase2(), TestCase3()})));
+                             {TestCase1(), TestCase2(), TestCase3(),
+                              TestCase4()})));
 
 }  // namespace
 }  // namespace data
@@ -26,11 +26,15 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
 namespace {
@@ -353,5 +357,39 @@ TEST_F(RestoreV2OpTest, RestoreAfterSaveV2) { RunTest("SaveV2"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveSlicesV1) { RunTest("SaveSlices"); }
 TEST_F(RestoreV2OpTest, RestoreAfterSaveV1) { RunTest("Save"); }
 
+TEST_F(RestoreV2OpTest, LazyRestoreAliasesAlignedData) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "lazy_restore");
+  const Tensor value = MakeInput<float>(
+      TensorShape({1024}), [](int x) -> float { return x; });
+  {
+    // As written by SaveV2 with TF_CHECKPOINT_SAVE_DATA_ALIGNMENT=64.
+    BundleWriter::Options options;
+    options.data_alignment = Allocator::kAllocatorAlignment;
+    BundleWriter writer(Env::Default(), prefix, options);
+    TF_ASSERT_OK(writer.Add("variable", value));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  MakeRestoreOp(DT_FLOAT);
+  AddInput<tstring>(TensorShape({}),
+                    [&prefix](int x) -> tstring { return prefix; });
+  AddInput<tstring>(TensorShape({1}),
+                    [](int x) -> tstring { return "variable"; });
+  AddInput<tstring>(TensorShape({1}), [](int x) -> tstring { return ""; });
+  setenv("TF_CHECKPOINT_RESTORE_LAZY", "1", 1 /* overwrite */);
+  const Status status = RunOpKernel();
+  unsetenv("TF_CHECKPOINT_RESTORE_LAZY");
+  TF_ASSERT_OK(status);
+
+  Tensor* output = GetOutput(0);
+  test::ExpectTensorEqual<float>(value, *output);
+  // A resource variable assigned this tensor holds on to it, so the variable
+  // stays backed by the memory-mapped data file.
+  TensorDescription description;
+  output->FillDescription(&description);
+  EXPECT_EQ("BundleReaderMappedFile",
+            description.allocation_description().allocator_name());
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
+#include <atomic>
 #include <numeric>
 #include <unordered_map>
 #include <utility>
@@ -30,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -237,6 +239,9 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64 kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Number of threads used to restore tensors in parallel.
+const int kNumRestoreThreads = 8;
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -274,7 +279,13 @@ struct RestoreOp {
     VLOG(1) << "Restoring tensor " << idx << " : " << tensor_name << " : "
             << restored_full_shape.num_elements();
     Tensor* restored_tensor;
-    if (shape_and_slice.empty()) {
+    if (shape_and_slice.empty() && alias_mapped_tensors) {
+      // Lookup the full tensor into a new tensor, which may alias the
+      // reader's memory-mapped data file.
+      Tensor restored_full_tensor;
+      TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, &restored_full_tensor));
+      context->set_output(idx, restored_full_tensor);
+    } else if (shape_and_slice.empty()) {
       // Lookup the full tensor.
       TF_RETURN_IF_ERROR(
           context->allocate_output(idx, restored_full_shape, &restored_tensor));
@@ -309,10 +320,51 @@ struct RestoreOp {
   string tensor_name;
   string shape_and_slice;
   string reader_prefix;
+  // Whether "reader" aliases tensors in its memory-mapped data files.
+  bool alias_mapped_tensors;
 
   ::tensorflow::Status status;
 };
 
+// Runs all of "ops" on a thread pool.  Each thread opens its own BundleReader
+// with memory-mapped data files, so that the threads share the mappings
+// through the page cache, and claims the next op in order until none are left.
+// The status of each op is left in "op->status".
+//
+// With "lazy" set, the restored tensors alias the mappings without verifying
+// their checksums, so their pages are only read when first accessed.
+Status RunRestoreOpsWithMappedReaders(
+    const string& prefix, bool lazy,
+    std::vector<std::unique_ptr<RestoreOp>>* ops) {
+  if (ops->empty()) return Status::OK();
+  const int num_threads = std::min<int64>(kNumRestoreThreads, ops->size());
+  std::vector<Status> reader_statuses(num_threads);
+  std::atomic<size_t> next_op(0);
+  {
+    thread::ThreadPool reader_pool(Env::Default(), "restore_tensors",
+                                   num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      reader_pool.Schedule([&prefix, lazy, ops, &reader_statuses, &next_op,
+                            i]() {
+        BundleReader::Options options;
+        options.use_mmap = true;
+        options.alias_mapped_tensors = lazy;
+        options.verify_aliased_checksums = !lazy;
+        BundleReader reader(Env::Default(), prefix, options);
+        reader_statuses[i] = reader.status();
+        if (!reader.status().ok()) return;
+        for (size_t j = next_op++; j < ops->size(); j = next_op++) {
+          (*ops)[j]->status = (*ops)[j]->run(&reader);
+        }
+      });
+    }
+  }
+  for (const Status& s : reader_statuses) {
+    TF_RETURN_IF_ERROR(s);
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
@@ -358,25 +410,46 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  // Restoring from memory-mapped data files lets every tensor, small or
+  // large, be restored in parallel without re-reading the data through a
+  // separate buffered file for each reader.
+  bool use_mmap;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_USE_MMAP",
+                                        /*default_val=*/false, &use_mmap));
+  // A lazy restore goes further and outputs tensors that alias the mapped
+  // data files wherever the stored data is aligned (see
+  // TF_CHECKPOINT_SAVE_DATA_ALIGNMENT), deferring reading them until they are
+  // accessed.  This only helps resource variables, which hold on to such a
+  // tensor and copy it before updating it.  Assigning it to a reference
+  // variable copies it right away, as the mapping is read-only.
+  bool lazy;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_LAZY",
+                                        /*default_val=*/false, &lazy));
+  use_mmap = use_mmap || lazy;
+
   for (auto i : sorted_name_idx) {
     const string& tensor_name = tensor_names_flat(i);
     const string& shape_and_slice = shape_and_slices_flat(i);
-    auto op =
-        new RestoreOp{context, i, tensor_name, shape_and_slice, prefix_string};
-    if (op->should_run_in_pool(&default_reader)) {
+    auto op = new RestoreOp{context, i, tensor_name, shape_and_slice,
+                            prefix_string, lazy};
+    if (use_mmap || op->should_run_in_pool(&default_reader)) {
       pool_restore_ops.emplace_back(op);
     } else {
       direct_restore_ops.emplace_back(op);
     }
   }
 
-  {
+  if (use_mmap) {
+    TF_RETURN_IF_ERROR(
+        RunRestoreOpsWithMappedReaders(prefix_string, lazy,
+                                       &pool_restore_ops));
+  } else {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
     if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
+      reader_pool.reset(new thread::ThreadPool(
+          Env::Default(), "restore_tensors", kNumRestoreThreads));
       for (auto& op : pool_restore_ops) {
         reader_pool->Schedule([&op]() { op->run_with_new_reader(); });
       }
@@ -15,6 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
@@ -37,6 +39,34 @@ namespace tensorflow {
 
 namespace {
 
+// Number of data files written in parallel by an asynchronous save.
+constexpr int kNumAsyncSaveShards = 8;
+
+// Whether SaveV2 and MergeV2Checkpoints write in the background. SaveV2 then
+// returns before the checkpoint is on disk, and the Saver may write the
+// checkpoint state file before it is. Pending writes are waited for when the
+// process exits normally, but a crash in the meantime loses the checkpoint
+// that the state file names (see WriteBundleAsync()).
+Status ReadAsyncSaveFromEnv(bool* async_save) {
+  return ReadBoolFromEnvVar("TF_CHECKPOINT_ASYNC_SAVE", /*default_val=*/false,
+                            async_save);
+}
+
+// Deletes the directories of "input_prefixes" other than the one of
+// "merged_prefix", ignoring errors.
+void DeleteOldDirs(Env* env, gtl::ArraySlice<tstring> input_prefixes,
+                   const string& merged_prefix) {
+  const string merged_dir(io::Dirname(merged_prefix));
+  for (const string& input_prefix : input_prefixes) {
+    const string dirname(io::Dirname(input_prefix));
+    if (dirname == merged_dir) continue;
+    Status status = env->DeleteDir(dirname);
+    // For sharded save, only the first delete will go through and all
+    // others will hit NotFound.  Use vlog to be less verbose.
+    if (!status.ok()) VLOG(1) << status;
+  }
+}
+
 // Shared validations of the inputs to the SaveV2 and RestoreV2 ops.
 void ValidateInputs(bool is_save_op, OpKernelContext* context,
                     const Tensor& prefix, const Tensor& tensor_names,
@@ -105,9 +135,36 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
-    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
+    // An asynchronous save only snapshots references to the tensors, and
+    // writes them in the background.
+    bool async_save;
+    OP_REQUIRES_OK(context, ReadAsyncSaveFromEnv(&async_save));
+    // Aligning the tensor data lets a lazy restore alias the tensors in the
+    // memory-mapped data files (see TF_CHECKPOINT_RESTORE_LAZY).
+    int64 data_alignment;
+    OP_REQUIRES_OK(context,
+                   ReadInt64FromEnvVar("TF_CHECKPOINT_SAVE_DATA_ALIGNMENT",
+                                       /*default_val=*/1, &data_alignment));
+    OP_REQUIRES(context, data_alignment >= 1,
+                errors::InvalidArgument(
+                    "TF_CHECKPOINT_SAVE_DATA_ALIGNMENT must be >= 1, got ",
+                    data_alignment));
+    BundleWriter::Options writer_options;
+    writer_options.data_alignment = data_alignment;
+    std::unique_ptr<BundleWriter> writer;
+    std::vector<BundleWriteItem> items;
+    if (async_save) {
+      // Holds at most one checkpoint in memory, and reports the failure of
+      // the previous save, if any.
+      OP_REQUIRES_OK(context, WaitForAllBundleWrites());
+      items.reserve(num_tensors);
+    } else {
+      OP_REQUIRES_OK(context, WaitForBundleWrite(prefix_string));
+      writer.reset(
+          new BundleWriter(Env::Default(), prefix_string, writer_options));
+      OP_REQUIRES_OK(context, writer->status());
+      VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
+    }
 
     for (int i = 0; i < num_tensors; ++i) {
       const string& tensor_name = tensor_names_flat(i);
@@ -128,13 +185,33 @@ class SaveV2 : public OpKernel {
                                             shape_spec, ", tensor: ",
                                             tensor.shape().DebugString()));
 
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
+        if (async_save) {
+          items.emplace_back();
+          items.back().key = tensor_name;
+          items.back().tensor = tensor;
+          items.back().is_slice = true;
+          items.back().full_tensor_shape = shape;
+          items.back().slice_spec = slice;
+        } else {
+          OP_REQUIRES_OK(context,
+                         writer->AddSlice(tensor_name, shape, slice, tensor));
+        }
+      } else if (async_save) {
+        items.emplace_back();
+        items.back().key = tensor_name;
+        items.back().tensor = tensor;
       } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        OP_REQUIRES_OK(context, writer->Add(tensor_name, tensor));
       }
     }
-    OP_REQUIRES_OK(context, writer.Finish());
+    if (async_save) {
+      OP_REQUIRES_OK(context,
+                     WriteBundleAsync(Env::Default(), prefix_string,
+                                      std::move(items), kNumAsyncSaveShards,
+                                      writer_options));
+    } else {
+      OP_REQUIRES_OK(context, writer->Finish());
+    }
   }
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
@@ -158,6 +235,7 @@ class RestoreV2 : public OpKernel {
                    shape_and_slices);
 
     const string& prefix_string = prefix.scalar<tstring>()();
+    OP_REQUIRES_OK(context, WaitForBundleWrite(prefix_string));
 
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
@@ -216,19 +294,32 @@ class MergeV2Checkpoints : public OpKernel {
         gtl::ArraySlice<tstring>(checkpoint_prefixes.flat<tstring>());
     Env* env = Env::Default();
     const string& merged_prefix = destination_prefix.scalar<tstring>()();
+    bool async_save;
+    OP_REQUIRES_OK(context, ReadAsyncSaveFromEnv(&async_save));
+    if (async_save) {
+      // Merges once the background writes of the shards are done, so that
+      // sharded saves do not wait for them here.
+      std::vector<tstring> prefixes(input_prefixes.begin(),
+                                    input_prefixes.end());
+      std::function<void()> on_merged;
+      if (delete_old_dirs_) {
+        on_merged = [env, prefixes, merged_prefix]() {
+          DeleteOldDirs(env, prefixes, merged_prefix);
+        };
+      }
+      OP_REQUIRES_OK(context,
+                     MergeBundlesAsync(env, std::move(prefixes), merged_prefix,
+                                       std::move(on_merged)));
+      return;
+    }
+    for (const tstring& input_prefix : input_prefixes) {
+      OP_REQUIRES_OK(context, WaitForBundleWrite(input_prefix));
+    }
     OP_REQUIRES_OK(
         context, tensorflow::MergeBundles(env, input_prefixes, merged_prefix));
 
     if (delete_old_dirs_) {
-      const string merged_dir(io::Dirname(merged_prefix));
-      for (const string& input_prefix : input_prefixes) {
-        const string dirname(io::Dirname(input_prefix));
-        if (dirname == merged_dir) continue;
-        Status status = env->DeleteDir(dirname);
-        // For sharded save, only the first delete will go through and all
-        // others will hit NotFound.  Use vlog to be less verbose.
-        if (!status.ok()) VLOG(1) << status;
-      }
+      DeleteOldDirs(env, input_prefixes, merged_prefix);
     }
   }
 
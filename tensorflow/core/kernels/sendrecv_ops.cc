@@ -69,6 +69,11 @@ SendOp::SendOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
   // proactively cache the rendezvous key for the top-level.
   GetRendezvousKey(key_prefix_, {0, 0}, &parsed_key_.buf_);
   OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(parsed_key_.buf_, &parsed_key_));
+  // Only the cached top-level key carries the slot assigned by graph
+  // partitioning; in-loop keys are always matched by name.
+  if (!ctx->GetAttr("_rendezvous_slot", &parsed_key_.slot).ok()) {
+    parsed_key_.slot = -1;
+  }
   if (!ctx->GetAttr("_hostmem_sendrecv", &hostmem_sendrecv_).ok()) {
     hostmem_sendrecv_ = false;
   }
@@ -134,6 +139,11 @@ RecvOp::RecvOp(OpKernelConstruction* ctx) : AsyncOpKernel(ctx) {
   // proactively cache the rendezvous key for the top-level.
   GetRendezvousKey(key_prefix_, {0, 0}, &parsed_key_.buf_);
   OP_REQUIRES_OK(ctx, Rendezvous::ParseKey(parsed_key_.buf_, &parsed_key_));
+  // Only the cached top-level key carries the slot assigned by graph
+  // partitioning; in-loop keys are always matched by name.
+  if (!ctx->GetAttr("_rendezvous_slot", &parsed_key_.slot).ok()) {
+    parsed_key_.slot = -1;
+  }
   if (!ctx->GetAttr("_hostmem_sendrecv", &hostmem_sendrecv_).ok()) {
     hostmem_sendrecv_ = false;
   }
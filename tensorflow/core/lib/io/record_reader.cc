@@ -198,6 +198,43 @@ Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   return Status::OK();
 }
 
+MappedRecordReader::MappedRecordReader(ReadOnlyMemoryRegion* region)
+    : data_(static_cast<const char*>(region->data())),
+      size_(region->length()) {}
+
+Status MappedRecordReader::VerifyChecksummed(uint64 offset, size_t n,
+                                             uint64 record_offset) const {
+  const uint32 masked_crc = core::DecodeFixed32(data_ + offset + n);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(data_ + offset, n)) {
+    return errors::DataLoss("corrupted record at ", record_offset);
+  }
+  return Status::OK();
+}
+
+Status MappedRecordReader::ReadRecord(uint64* offset,
+                                      StringPiece* record) const {
+  const uint64 start = *offset;
+  if (start >= size_) {
+    return errors::OutOfRange("eof");
+  }
+  if (size_ - start < RecordReader::kHeaderSize) {
+    return errors::DataLoss("truncated record at ", start);
+  }
+  TF_RETURN_IF_ERROR(VerifyChecksummed(start, sizeof(uint64), start));
+  const uint64 length = core::DecodeFixed64(data_ + start);
+
+  const uint64 data_start = start + RecordReader::kHeaderSize;
+  if (length > size_ - data_start ||
+      size_ - data_start - length < RecordReader::kFooterSize) {
+    return errors::DataLoss("truncated record at ", start);
+  }
+  TF_RETURN_IF_ERROR(VerifyChecksummed(data_start, length, start));
+
+  *record = StringPiece(data_ + data_start, length);
+  *offset = data_start + length + RecordReader::kFooterSize;
+  return Status::OK();
+}
+
 SequentialRecordReader::SequentialRecordReader(
     RandomAccessFile* file, const RecordReaderOptions& options)
     : underlying_(file, options), offset_(0) {}
@@ -29,6 +29,7 @@ limitations under the License.
 namespace tensorflow {
 
 class RandomAccessFile;
+class ReadOnlyMemoryRegion;
 
 namespace io {
 
@@ -114,6 +115,37 @@ class RecordReader {
   TF_DISALLOW_COPY_AND_ASSIGN(RecordReader);
 };
 
+// Reads uncompressed TFRecord files through a memory mapping of the whole
+// file, e.g. one returned by Env::NewReadOnlyMemoryRegionFromFile(). Records
+// are returned as views into the mapping, so reading a record involves
+// neither a read system call nor a copy, and records can be read at any
+// offset in any order.
+//
+// Note: this class is not thread safe; external synchronization required.
+class MappedRecordReader {
+ public:
+  // "*region" must remain live while this reader and the records it returned
+  // are in use.
+  explicit MappedRecordReader(ReadOnlyMemoryRegion* region);
+
+  // Sets *record to the record at "*offset" and updates *offset to point to
+  // the offset of the next record. *record points into the mapping. Returns
+  // OK on success, OUT_OF_RANGE for end of file, or something else for an
+  // error.
+  Status ReadRecord(uint64* offset, StringPiece* record) const;
+
+ private:
+  // Verifies that the checksum of the "n" bytes at "offset" is stored in the
+  // 4 bytes that follow them.
+  Status VerifyChecksummed(uint64 offset, size_t n,
+                           uint64 record_offset) const;
+
+  const char* const data_;
+  const uint64 size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MappedRecordReader);
+};
+
 // High-level interface to read TFRecord files.
 //
 // Note: this class is not thread safe; external synchronization required.
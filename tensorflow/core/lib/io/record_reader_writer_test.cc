@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <zlib.h>
 #include <vector>
+
+#include "absl/strings/match.h"
 #include "tensorflow/core/platform/env.h"
 
 #include "tensorflow/core/lib/core/errors.h"
@@ -26,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -219,4 +222,138 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestMapped) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_mapped_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord(""));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Close());
+  }
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  io::MappedRecordReader reader(region.get());
+  uint64 offset = 0;
+  StringPiece record;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("abc", record);
+  EXPECT_EQ(region->data(), record.data() - io::RecordReader::kHeaderSize);
+  const uint64 second_offset = offset;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("", record);
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("defg", record);
+  EXPECT_EQ(region->length(), offset);
+  EXPECT_EQ(error::OUT_OF_RANGE, reader.ReadRecord(&offset, &record).code());
+
+  // Records can be re-read from any record boundary.
+  offset = second_offset;
+  TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("", record);
+}
+
+// A memory region over a string, used to feed corrupted files to the
+// MappedRecordReader.
+class StringMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  explicit StringMemoryRegion(string data) : data_(std::move(data)) {}
+  const void* data() override { return data_.data(); }
+  uint64 length() override { return data_.size(); }
+
+ private:
+  const string data_;
+};
+
+TEST(RecordReaderWriterTest, TestMappedCorruption) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_corruption_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abcdefg"));
+    TF_CHECK_OK(writer.Close());
+  }
+  string contents;
+  TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+
+  for (size_t len = 1; len < contents.size(); ++len) {
+    StringMemoryRegion region(contents.substr(0, len));
+    io::MappedRecordReader reader(&region);
+    uint64 offset = 0;
+    StringPiece record;
+    Status s = reader.ReadRecord(&offset, &record);
+    EXPECT_EQ(error::DATA_LOSS, s.code()) << len;
+    EXPECT_TRUE(absl::StrContains(s.error_message(), "truncated")) << s;
+    EXPECT_EQ(0, offset);
+  }
+
+  for (size_t pos = 0; pos < contents.size(); ++pos) {
+    string corrupted = contents;
+    corrupted[pos] ^= 0x10;
+    StringMemoryRegion region(corrupted);
+    io::MappedRecordReader reader(&region);
+    uint64 offset = 0;
+    StringPiece record;
+    EXPECT_EQ(error::DATA_LOSS, reader.ReadRecord(&offset, &record).code())
+        << pos;
+  }
+}
+
+void BM_ReadRecords(int iters, int record_size, bool mapped) {
+  testing::StopTiming();
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_benchmark";
+  const int kNumRecords = (64 << 20) / record_size;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    const string record(record_size, 'x');
+    for (int i = 0; i < kNumRecords; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+  testing::BytesProcessed(static_cast<int64>(iters) * kNumRecords *
+                          record_size);
+  testing::StartTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    int num_records = 0;
+    if (mapped) {
+      std::unique_ptr<ReadOnlyMemoryRegion> region;
+      TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+      io::MappedRecordReader reader(region.get());
+      uint64 offset = 0;
+      StringPiece record;
+      while (reader.ReadRecord(&offset, &record).ok()) ++num_records;
+    } else {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+      io::SequentialRecordReader reader(
+          file.get(), io::RecordReaderOptions::CreateRecordReaderOptions(""));
+      tstring record;
+      while (reader.ReadRecord(&record).ok()) ++num_records;
+    }
+    CHECK_EQ(kNumRecords, num_records);
+  }
+}
+
+void BM_SequentialRecordReader(int iters, int record_size) {
+  BM_ReadRecords(iters, record_size, /*mapped=*/false);
+}
+BENCHMARK(BM_SequentialRecordReader)->Arg(100)->Arg(10000)->Arg(1000000);
+
+void BM_MappedRecordReader(int iters, int record_size) {
+  BM_ReadRecords(iters, record_size, /*mapped=*/true);
+}
+BENCHMARK(BM_MappedRecordReader)->Arg(100)->Arg(10000)->Arg(1000000);
+
 }  // namespace tensorflow
@@ -16,11 +16,14 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -34,6 +37,8 @@ limitations under the License.
 #include "tensorflow/core/lib/bfloat16/bfloat16.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/gtl/stl_util.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
@@ -41,6 +46,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/byte_swap.h"
 #include "tensorflow/core/util/tensor_slice_util.h"
@@ -379,6 +385,29 @@ table::Options TableBuilderOptions() {
   return o;
 }
 
+// A read-only TensorBuffer aliasing part of a memory-mapped data file.  Keeps
+// the mapping alive for as long as a tensor refers to it.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("BundleReaderMappedFile");
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 // Writes zeros to output buffer to align the next write to the requested
 // alignment. "size" is the current size of the buffer and is updated to the
 // new size.
@@ -723,11 +752,243 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
   return status;
 }
 
+// Writing tensor bundles in the background.
+
+namespace {
+
+// Number of threads writing the data files of background writes.
+constexpr int kNumBundleWriteThreads = 8;
+
+thread::ThreadPool* BundleWritePool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "bundle_writer", kNumBundleWriteThreads);
+  return pool;
+}
+
+// The state of a write started by WriteBundleAsync().
+struct PendingBundleWrite {
+  explicit PendingBundleWrite(int num_shards) : num_pending_shards(num_shards) {}
+
+  void UpdateStatus(const Status& s) {
+    mutex_lock l(mu);
+    status.Update(s);
+  }
+
+  Status GetStatus() {
+    mutex_lock l(mu);
+    return status;
+  }
+
+  std::atomic<int> num_pending_shards;
+  Notification done;
+  mutex mu;
+  Status status GUARDED_BY(mu);
+};
+
+// The background writes that are in flight, or that failed and whose error
+// has not been reported yet, keyed by prefix.
+struct PendingBundleWrites {
+  mutex mu;
+  std::unordered_map<string, std::shared_ptr<PendingBundleWrite>> writes
+      GUARDED_BY(mu);
+};
+
+PendingBundleWrites* GetPendingBundleWrites() {
+  static PendingBundleWrites* pending = new PendingBundleWrites;
+  return pending;
+}
+
+void ErasePendingBundleWrite(const string& prefix,
+                             const PendingBundleWrite* write) {
+  PendingBundleWrites* pending = GetPendingBundleWrites();
+  mutex_lock l(pending->mu);
+  auto it = pending->writes.find(prefix);
+  if (it != pending->writes.end() && it->second.get() == write) {
+    pending->writes.erase(it);
+  }
+}
+
+// Marks "write" to "prefix" as done. A failed write stays registered until
+// its error is reported.
+void FinishPendingBundleWrite(const string& prefix,
+                              const std::shared_ptr<PendingBundleWrite>& write) {
+  const Status status = write->GetStatus();
+  if (status.ok()) {
+    ErasePendingBundleWrite(prefix, write.get());
+  } else {
+    LOG(ERROR) << "Failed to write bundle " << prefix << ": " << status;
+  }
+  write->done.Notify();
+}
+
+void WaitForBundleWritesAtExit() {
+  const Status status = WaitForAllBundleWrites();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to finish writing bundles at exit: " << status;
+  }
+}
+
+// Registers a pending write to "prefix". The first call also makes the
+// process wait for pending writes when it exits normally.
+std::shared_ptr<PendingBundleWrite> AddPendingBundleWrite(const string& prefix,
+                                                          int num_shards) {
+  static const bool registered_at_exit =
+      std::atexit(&WaitForBundleWritesAtExit) == 0;
+  if (!registered_at_exit) {
+    LOG(WARNING) << "Pending bundle writes will not be waited for at exit.";
+  }
+  auto write = std::make_shared<PendingBundleWrite>(num_shards);
+  PendingBundleWrites* pending = GetPendingBundleWrites();
+  mutex_lock l(pending->mu);
+  pending->writes[prefix] = write;
+  return write;
+}
+
+Status WriteBundleShard(Env* env, const string& prefix,
+                        const std::vector<BundleWriteItem>& items,
+                        const BundleWriter::Options& options) {
+  BundleWriter writer(env, prefix, options);
+  TF_RETURN_IF_ERROR(writer.status());
+  for (const BundleWriteItem& item : items) {
+    if (item.is_slice) {
+      TF_RETURN_IF_ERROR(writer.AddSlice(item.key, item.full_tensor_shape,
+                                         item.slice_spec, item.tensor));
+    } else {
+      TF_RETURN_IF_ERROR(writer.Add(item.key, item.tensor));
+    }
+  }
+  return writer.Finish();
+}
+
+}  // namespace
+
+Status WriteBundleAsync(Env* env, const string& prefix,
+                        std::vector<BundleWriteItem> items, int num_shards,
+                        const BundleWriter::Options& options) {
+  TF_RETURN_IF_ERROR(WaitForBundleWrite(prefix));
+  num_shards = std::max<int64>(
+      1, std::min<int64>(num_shards, static_cast<int64>(items.size())));
+
+  // Balances the bytes written per shard by assigning the largest remaining
+  // item to the least loaded shard.
+  std::vector<size_t> order(items.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&items](size_t a, size_t b) {
+    return items[a].tensor.TotalBytes() > items[b].tensor.TotalBytes();
+  });
+  auto shards =
+      std::make_shared<std::vector<std::vector<BundleWriteItem>>>(num_shards);
+  std::vector<size_t> shard_bytes(num_shards, 0);
+  for (size_t i : order) {
+    const int shard = std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+                      shard_bytes.begin();
+    shard_bytes[shard] += items[i].tensor.TotalBytes();
+    (*shards)[shard].push_back(std::move(items[i]));
+  }
+
+  // A single shard is written in place.  Several shards are written to a
+  // temporary directory next to "prefix" and merged into it.
+  string tmp_dir;
+  auto shard_prefixes = std::make_shared<std::vector<tstring>>();
+  if (num_shards == 1) {
+    shard_prefixes->push_back(prefix);
+  } else {
+    tmp_dir = strings::StrCat(prefix, "_temp_", random::New64());
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(tmp_dir));
+    for (int i = 0; i < num_shards; ++i) {
+      shard_prefixes->push_back(
+          io::JoinPath(tmp_dir, strings::StrCat("part-", i)));
+    }
+  }
+
+  auto write = AddPendingBundleWrite(prefix, num_shards);
+  auto finish = [env, prefix, tmp_dir, shard_prefixes, write]() {
+    if (!tmp_dir.empty()) {
+      if (write->GetStatus().ok()) {
+        write->UpdateStatus(MergeBundles(env, *shard_prefixes, prefix));
+      }
+      int64 undeleted_files, undeleted_dirs;
+      env->DeleteRecursively(tmp_dir, &undeleted_files, &undeleted_dirs)
+          .IgnoreError();
+    }
+    FinishPendingBundleWrite(prefix, write);
+  };
+  for (int i = 0; i < num_shards; ++i) {
+    BundleWritePool()->Schedule(
+        [env, shards, shard_prefixes, write, finish, options, i]() {
+          write->UpdateStatus(WriteBundleShard(env, (*shard_prefixes)[i],
+                                               (*shards)[i], options));
+          // Releases the references to the written tensors early.
+          (*shards)[i].clear();
+          if (--write->num_pending_shards == 0) {
+            finish();
+          }
+        });
+  }
+  return Status::OK();
+}
+
+Status MergeBundlesAsync(Env* env, std::vector<tstring> prefixes,
+                         const string& merged_prefix,
+                         std::function<void()> on_merged) {
+  TF_RETURN_IF_ERROR(WaitForBundleWrite(merged_prefix));
+  auto write = AddPendingBundleWrite(merged_prefix, /*num_shards=*/1);
+  // Waits on its own thread rather than on the write pool, whose threads may
+  // be writing the bundles to merge.
+  env->SchedClosure([env, prefixes = std::move(prefixes), merged_prefix,
+                     on_merged = std::move(on_merged), write]() {
+    Status status;
+    for (const tstring& prefix : prefixes) {
+      status.Update(WaitForBundleWrite(prefix));
+    }
+    if (status.ok()) {
+      status = MergeBundles(env, prefixes, merged_prefix);
+    }
+    if (status.ok() && on_merged) {
+      on_merged();
+    }
+    write->UpdateStatus(status);
+    FinishPendingBundleWrite(merged_prefix, write);
+  });
+  return Status::OK();
+}
+
+Status WaitForBundleWrite(const string& prefix) {
+  std::shared_ptr<PendingBundleWrite> write;
+  {
+    PendingBundleWrites* pending = GetPendingBundleWrites();
+    mutex_lock l(pending->mu);
+    auto it = pending->writes.find(prefix);
+    if (it == pending->writes.end()) return Status::OK();
+    write = it->second;
+  }
+  write->done.WaitForNotification();
+  ErasePendingBundleWrite(prefix, write.get());
+  return write->GetStatus();
+}
+
+Status WaitForAllBundleWrites() {
+  std::vector<string> prefixes;
+  {
+    PendingBundleWrites* pending = GetPendingBundleWrites();
+    mutex_lock l(pending->mu);
+    for (const auto& p : pending->writes) {
+      prefixes.push_back(p.first);
+    }
+  }
+  Status status;
+  for (const string& prefix : prefixes) {
+    status.Update(WaitForBundleWrite(prefix));
+  }
+  return status;
+}
+
 // Interface for reading a tensor bundle.
 
-BundleReader::BundleReader(Env* env, StringPiece prefix)
+BundleReader::BundleReader(Env* env, StringPiece prefix, const Options& options)
     : env_(env),
       prefix_(prefix),
+      options_(options),
       metadata_(nullptr),
       table_(nullptr),
       iter_(nullptr),
@@ -804,7 +1065,90 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
+Status BundleReader::GetMappedDataFile(
+    int32 shard_id, std::shared_ptr<ReadOnlyMemoryRegion>* region) {
+  auto it = mapped_data_.find(shard_id);
+  if (it == mapped_data_.end()) {
+    const string filename = DataFilename(prefix_, shard_id, num_shards_);
+    std::unique_ptr<ReadOnlyMemoryRegion> mapped;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &mapped);
+    if (!s.ok()) {
+      // Not every file system supports mapping files (and empty files cannot
+      // be mapped), so fall back to buffered reads of this shard.
+      VLOG(1) << "Reading " << filename << " without mmap: " << s;
+    }
+    it = mapped_data_.emplace(shard_id, std::move(mapped)).first;
+  }
+  *region = it->second;
+  return Status::OK();
+}
+
+Status BundleReader::GetBufferedDataFile(int32 shard_id,
+                                         io::InputBuffer** buffered_file) {
+  *buffered_file = data_[shard_id];
+  if (*buffered_file == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    *buffered_file = new io::InputBuffer(file.release(), kBufferSize);
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+    data_[shard_id] = *buffered_file;
+  }
+  return Status::OK();
+}
+
+bool BundleReader::MayAlias(const BundleEntryProto& entry) const {
+  return options_.use_mmap && options_.alias_mapped_tensors &&
+         entry.slices().empty() && DataTypeCanUseMemcpy(entry.dtype()) &&
+         !need_to_swap_bytes_;
+}
+
+Status BundleReader::GetAliasedValue(const BundleEntryProto& entry,
+                                     Tensor* val, bool* aliased) {
+  *aliased = false;
+  std::shared_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(GetMappedDataFile(entry.shard_id(), &region));
+  if (region == nullptr) return Status::OK();
+
+  const TensorShape stored_shape(entry.shape());
+  const size_t size = stored_shape.num_elements() * DataTypeSize(entry.dtype());
+  if (entry.size() != size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(),
+                            "; expected size ", size);
+  }
+  if (entry.offset() < 0 || entry.offset() + size > region->length()) {
+    return errors::DataLoss("Bundle entry for key ", key(),
+                            " is out of the bounds of its data file");
+  }
+  const char* data =
+      static_cast<const char*>(region->data()) + entry.offset();
+  MappedTensorBuffer* buffer = new MappedTensorBuffer(region, data, size);
+  Tensor aliased_val(entry.dtype(), stored_shape, buffer);
+  buffer->Unref();
+  if (!aliased_val.IsAligned()) return Status::OK();
+
+  if (options_.verify_aliased_checksums) {
+    const uint32 actual_crc32c = crc32c::Value(data, size);
+    if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+      return errors::DataLoss(
+          "Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+          " vs. calculated on the restored bytes ", actual_crc32c);
+    }
+  }
+  *val = std::move(aliased_val);
+  *aliased = true;
+  return Status::OK();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (val->NumElements() == 0 && MayAlias(entry)) {
+    bool aliased;
+    TF_RETURN_IF_ERROR(GetAliasedValue(entry, val, &aliased));
+    if (aliased) return Status::OK();
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -833,25 +1177,30 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
   }
 
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
+  std::shared_ptr<ReadOnlyMemoryRegion> region;
+  if (options_.use_mmap && DataTypeCanUseMemcpy(entry.dtype())) {
+    TF_RETURN_IF_ERROR(GetMappedDataFile(entry.shard_id(), &region));
+  }
+  io::InputBuffer* buffered_file = nullptr;
+  if (region == nullptr) {
+    TF_RETURN_IF_ERROR(GetBufferedDataFile(entry.shard_id(), &buffered_file));
+    TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   }
-  CHECK(buffered_file != nullptr);
-
-  TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
 
   if (DataTypeCanUseMemcpy(entry.dtype())) {
     char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
     size_t unused_bytes_read;
-    if (entry.size() > kBufferSize) {
+    if (region != nullptr) {
+      if (entry.offset() < 0 ||
+          entry.offset() + entry.size() > region->length()) {
+        return errors::DataLoss("Bundle entry for key ", key(),
+                                " is out of the bounds of its data file");
+      }
+      memcpy(backing_buffer,
+             static_cast<const char*>(region->data()) + entry.offset(),
+             entry.size());
+    } else if (entry.size() > kBufferSize) {
       StringPiece sp;
       TF_RETURN_IF_ERROR(buffered_file->file()->Read(
           entry.offset(), entry.size(), &sp, backing_buffer));
@@ -907,12 +1256,26 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   if (entry.slices().empty()) {
     return GetValue(entry, val);
   } else {
+    // Like GetValue(), allocates the full tensor if "val" is empty.
+    if (val->NumElements() == 0) {
+      *val = Tensor(entry.dtype(), TensorShape(entry.shape()));
+    }
     return GetSliceValue(
         key, entry,
         /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()), val);
   }
 }
 
+Status BundleReader::LookupAliased(StringPiece key, Tensor* val,
+                                   bool* aliased) {
+  CHECK(val != nullptr);
+  *aliased = false;
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  if (!MayAlias(entry)) return Status::OK();
+  return GetAliasedValue(entry, val, aliased);
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -63,9 +63,12 @@ limitations under the License.
 
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -175,13 +178,85 @@ class BundleWriter {
 Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
                     StringPiece merged_prefix);
 
+// A tensor, or a slice of a partitioned tensor, to be written by
+// WriteBundleAsync().
+struct BundleWriteItem {
+  string key;
+  Tensor tensor;
+  // Whether "tensor" is the slice "slice_spec" of a partitioned tensor of shape
+  // "full_tensor_shape", as added by BundleWriter::AddSlice().
+  bool is_slice = false;
+  TensorShape full_tensor_shape;
+  TensorSlice slice_spec;
+};
+
+// Writes "items" to the bundle "prefix" in the background, and returns as soon
+// as the write is scheduled.  The items are spread over up to "num_shards"
+// data files, which are written and checksummed in parallel on a shared thread
+// pool and then merged with MergeBundles().
+//
+// The tensors are not copied: the items keep references to their buffers until
+// they are written, so the caller must not modify those buffers in place in
+// the meantime.  Resource variables guarantee this, as they copy their buffer
+// before updating it while another reference to it is held.
+//
+// Waits for a pending write to "prefix" first, and returns its error, if any.
+//
+// A process that exits normally waits for its pending writes first.  One that
+// crashes, or is killed, before a write finishes may leave a missing, partial
+// or stale bundle at "prefix", which a checkpoint state file written in the
+// meantime may already name.
+Status WriteBundleAsync(
+    Env* env, const string& prefix, std::vector<BundleWriteItem> items,
+    int num_shards,
+    const BundleWriter::Options& options = BundleWriter::Options());
+
+// Merges the bundles "prefixes" into "merged_prefix" with MergeBundles() in the
+// background, once the pending writes to all of them have finished, and
+// returns as soon as the merge is scheduled.  Then calls "on_merged", if set
+// and the merge succeeded.
+//
+// The merge is a pending write to "merged_prefix": waiting for it returns the
+// first error of the merge or of the writes it waited for.  Waits for a pending
+// write to "merged_prefix" first, and returns its error, if any.
+Status MergeBundlesAsync(Env* env, std::vector<tstring> prefixes,
+                         const string& merged_prefix,
+                         std::function<void()> on_merged);
+
+// Waits until the pending background write to "prefix", if any, finishes, and
+// returns its status.  A failed write is reported to the callers waiting for
+// it when it finishes, or else to the next caller.
+Status WaitForBundleWrite(const string& prefix);
+
+// Waits until all pending background writes finish, and returns the first
+// error among them.
+Status WaitForAllBundleWrites();
+
 // On construction, silently attempts to read the metadata associated with
 // "prefix".  If caller intends to call any function afterwards, "status()"
 // must be checked.
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
-  BundleReader(Env* const env, StringPiece prefix);
+  struct Options {
+    Options() {}
+    // If true, the data files are memory-mapped, where the file system
+    // supports it, and numeric tensors are copied straight out of the mapping
+    // instead of being read through a buffered file.
+    bool use_mmap = false;
+    // If true, and "use_mmap" is set, looking up a numeric tensor into an
+    // empty "val" returns a tensor that aliases the read-only mapping instead
+    // of a copy, provided the stored bytes are suitably aligned (see
+    // BundleWriter::Options::data_alignment) and need no byte swapping. Such
+    // tensors keep the mapping alive and must never be modified.
+    bool alias_mapped_tensors = false;
+    // If false, the checksums of aliased tensors are not verified, so that
+    // their bytes are only read from the data files when first accessed.
+    bool verify_aliased_checksums = true;
+  };
+
+  BundleReader(Env* const env, StringPiece prefix,
+               const Options& options = Options());
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -210,6 +285,8 @@ class BundleReader {
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
   // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // Alternatively, if "val" is empty, the tensor is allocated (or aliased, see
+  // Options::alias_mapped_tensors) by the lookup.
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -218,6 +295,14 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensor keyed by "key" into an empty "val" and sets "aliased"
+  // to true if it can be served as an alias of the mapped data files (see
+  // Options::alias_mapped_tensors).  Otherwise sets "aliased" to false and
+  // reads nothing.
+  // REQUIRES: status().ok()
+  Status LookupAliased(StringPiece key, Tensor* val,
+                       bool* aliased) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -274,6 +359,26 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Returns true if the tensor described by "entry" may be aliased, provided
+  // its bytes are mapped and aligned.
+  bool MayAlias(const BundleEntryProto& entry) const;
+
+  // Stores in "val" a tensor aliasing the mapped bytes described by "entry",
+  // and sets "aliased" to true, if the bytes can be aliased.  Otherwise
+  // leaves "val" untouched.
+  Status GetAliasedValue(const BundleEntryProto& entry, Tensor* val,
+                         bool* aliased) TF_MUST_USE_RESULT;
+
+  // Maps the data file of shard "shard_id" into memory on first use.  Sets
+  // "region" to nullptr if the file system cannot map it.
+  Status GetMappedDataFile(int32 shard_id,
+                           std::shared_ptr<ReadOnlyMemoryRegion>* region)
+      TF_MUST_USE_RESULT;
+
+  // Opens the data file of shard "shard_id" for buffered reads on first use.
+  Status GetBufferedDataFile(int32 shard_id,
+                             io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -284,6 +389,7 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
@@ -291,6 +397,10 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // The memory-mapped data files, or nullptr for those the file system could
+  // not map.  Shared with the tensors that alias them.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
@@ -993,6 +994,157 @@ TEST(TensorBundleTest, TruncatedTensorContents) {
   EXPECT_TRUE(errors::IsOutOfRange(reader.Lookup("key", &val)));
 }
 
+TEST(TensorBundleTest, MemoryMappedDataFiles) {
+  Env* env = Env::Default();
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(env, Prefix("mmap"), opts);
+    TF_EXPECT_OK(writer.Add("big", Constant(1.5f, TensorShape({1024}))));
+    TF_EXPECT_OK(writer.Add("small", Constant_2x3<int32>(7)));
+    TF_EXPECT_OK(
+        writer.Add("strings", test::AsTensor<tstring>({"hello", "world"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "big", Constant(1.5f, TensorShape({1024})));
+    Expect<int32>(&reader, "small", Constant_2x3<int32>(7));
+    Expect<tstring>(&reader, "strings",
+                    test::AsTensor<tstring>({"hello", "world"}));
+  }
+
+  // Aliased tensors stay valid after the reader is destroyed.
+  options.alias_mapped_tensors = true;
+  Tensor big;
+  Tensor strings;
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    TF_ASSERT_OK(reader.Lookup("big", &big));
+    TF_ASSERT_OK(reader.Lookup("strings", &strings));
+
+    // Only the tensors that can be aliased are looked up by LookupAliased().
+    bool aliased;
+    Tensor val;
+    TF_ASSERT_OK(reader.LookupAliased("strings", &val, &aliased));
+    EXPECT_FALSE(aliased);
+    EXPECT_EQ(val.NumElements(), 0);
+    TF_ASSERT_OK(reader.LookupAliased("big", &val, &aliased));
+    EXPECT_TRUE(aliased);
+    EXPECT_EQ(val.tensor_data().data(), big.tensor_data().data());
+  }
+  test::ExpectTensorEqual<float>(big, Constant(1.5f, TensorShape({1024})));
+  test::ExpectTensorEqual<tstring>(strings,
+                                   test::AsTensor<tstring>({"hello", "world"}));
+
+  // Corrupted and truncated data files are detected.
+  const string datafile = DataFilename(Prefix("mmap"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(env, datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(env, datafile, data));
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    Tensor val;
+    EXPECT_TRUE(errors::IsDataLoss(reader.Lookup("big", &val)));
+  }
+  // Unless their checksums are not verified, so that they are read lazily.
+  options.verify_aliased_checksums = false;
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    Tensor val;
+    TF_EXPECT_OK(reader.Lookup("big", &val));
+  }
+  TF_ASSERT_OK(WriteStringToFile(env, datafile, StringPiece(data.data(), 64)));
+  {
+    BundleReader reader(env, Prefix("mmap"), options);
+    Tensor val;
+    EXPECT_TRUE(errors::IsDataLoss(reader.Lookup("big", &val)));
+  }
+}
+
+TEST(TensorBundleTest, WriteBundleAsync) {
+  Env* env = Env::Default();
+  std::vector<BundleWriteItem> items(4);
+  items[0].key = "big";
+  items[0].tensor = Constant(2.f, TensorShape({1 << 16}));
+  items[1].key = "small";
+  items[1].tensor = Constant_2x3<int32>(3);
+  items[2].key = "strings";
+  items[2].tensor = test::AsTensor<tstring>({"hello", "world"});
+  // A partitioned tensor of shape [2, 3], saved as two slices.
+  items[3].key = "part";
+  items[3].tensor = Constant(4.f, TensorShape({1, 3}));
+  items[3].is_slice = true;
+  items[3].full_tensor_shape = TensorShape({2, 3});
+  TF_ASSERT_OK(TensorSlice::Parse("0,1:-", &items[3].slice_spec));
+  items.emplace_back(items[3]);
+  TF_ASSERT_OK(TensorSlice::Parse("1,1:-", &items[4].slice_spec));
+
+  TF_ASSERT_OK(
+      WriteBundleAsync(env, Prefix("async/ckpt"), std::move(items), 3));
+  TF_ASSERT_OK(WaitForBundleWrite(Prefix("async/ckpt")));
+  // The write is reported once.
+  TF_ASSERT_OK(WaitForBundleWrite(Prefix("async/ckpt")));
+
+  BundleReader reader(env, Prefix("async/ckpt"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "big", Constant(2.f, TensorShape({1 << 16})));
+  Expect<int32>(&reader, "small", Constant_2x3<int32>(3));
+  Expect<tstring>(&reader, "strings",
+                  test::AsTensor<tstring>({"hello", "world"}));
+  Expect<float>(&reader, "part", Constant_2x3(4.f));
+  // A partitioned tensor can also be looked up without preallocating it.
+  Tensor part;
+  TF_ASSERT_OK(reader.Lookup("part", &part));
+  test::ExpectTensorEqual<float>(part, Constant_2x3(4.f));
+
+  // The temporary shards are cleaned up.
+  std::vector<string> paths;
+  TF_ASSERT_OK(env->GetMatchingPaths(Prefix("async/ckpt_temp_*"), &paths));
+  EXPECT_TRUE(paths.empty());
+}
+
+TEST(TensorBundleTest, WriteBundleAsyncReportsErrors) {
+  Env* env = Env::Default();
+  // A regular file stands in the way of the bundle's directory.
+  TF_ASSERT_OK(WriteStringToFile(env, Prefix("async_error"), ""));
+  std::vector<BundleWriteItem> items(1);
+  items[0].key = "foo";
+  items[0].tensor = Constant_2x3(1.f);
+  TF_ASSERT_OK(WriteBundleAsync(env, Prefix("async_error/ckpt"),
+                                std::move(items), 1));
+  EXPECT_FALSE(WaitForAllBundleWrites().ok());
+  TF_EXPECT_OK(WaitForAllBundleWrites());
+}
+
+TEST(TensorBundleTest, MergeBundlesAsync) {
+  Env* env = Env::Default();
+  std::vector<tstring> prefixes;
+  for (int i = 0; i < 2; ++i) {
+    std::vector<BundleWriteItem> items(1);
+    items[0].key = strings::StrCat("foo", i);
+    items[0].tensor = Constant_2x3(static_cast<float>(i));
+    prefixes.push_back(Prefix(strings::StrCat("merge_async/shard", i)));
+    TF_ASSERT_OK(WriteBundleAsync(env, prefixes.back(), std::move(items), 1));
+  }
+  Notification merged;
+  TF_ASSERT_OK(MergeBundlesAsync(env, prefixes, Prefix("merge_async/ckpt"),
+                                 [&merged]() { merged.Notify(); }));
+  // Waiting for the merge also reports the writes of the merged bundles.
+  TF_ASSERT_OK(WaitForAllBundleWrites());
+  EXPECT_TRUE(merged.HasBeenNotified());
+
+  BundleReader reader(env, Prefix("merge_async/ckpt"));
+  TF_ASSERT_OK(reader.status());
+  Expect<float>(&reader, "foo0", Constant_2x3(0.f));
+  Expect<float>(&reader, "foo1", Constant_2x3(1.f));
+}
+
 TEST(TensorBundleTest, HeaderEntry) {
   {
     BundleWriter writer(Env::Default(), Prefix("b"));
@@ -1140,6 +1292,58 @@ static void BM_BundleAlignmentByteOff(int iters, int alignment,
   }                                                            \
   BENCHMARK(BM_BundleAlignment_##ALIGN##_##SIZE)
 
+// Looks up every tensor of a bundle of "num_tensors" float tensors of
+// "tensor_size" elements each, reading through buffered files, copying out of
+// memory-mapped files, or aliasing memory-mapped files.
+static void BM_BundleRestore(int iters, int num_tensors, int tensor_size,
+                             bool use_mmap, bool alias_mapped_tensors) {
+  testing::StopTiming();
+  const string prefix = Prefix(
+      strings::StrCat("restore_", num_tensors, "_", tensor_size));
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = 64;
+    BundleWriter writer(Env::Default(), prefix, opts);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("tensor_", i),
+                             Constant(1.0f, TensorShape({tensor_size}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  options.alias_mapped_tensors = alias_mapped_tensors;
+  testing::BytesProcessed(static_cast<int64>(iters) * num_tensors *
+                          tensor_size * sizeof(float));
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    BundleReader reader(Env::Default(), prefix, options);
+    TF_CHECK_OK(reader.status());
+    for (int j = 0; j < num_tensors; ++j) {
+      Tensor t;
+      TF_CHECK_OK(reader.Lookup(strings::StrCat("tensor_", j), &t));
+    }
+  }
+  testing::StopTiming();
+}
+
+#define BM_BundleRestoreModes(NAME, NUM_TENSORS, TENSOR_SIZE)                \
+  static void BM_BundleRestore_##NAME##_Buffered(int iters) {                \
+    BM_BundleRestore(iters, NUM_TENSORS, TENSOR_SIZE, false, false);         \
+  }                                                                          \
+  BENCHMARK(BM_BundleRestore_##NAME##_Buffered);                             \
+  static void BM_BundleRestore_##NAME##_Mmap(int iters) {                    \
+    BM_BundleRestore(iters, NUM_TENSORS, TENSOR_SIZE, true, false);          \
+  }                                                                          \
+  BENCHMARK(BM_BundleRestore_##NAME##_Mmap);                                 \
+  static void BM_BundleRestore_##NAME##_MmapAliased(int iters) {             \
+    BM_BundleRestore(iters, NUM_TENSORS, TENSOR_SIZE, true, true);           \
+  }                                                                          \
+  BENCHMARK(BM_BundleRestore_##NAME##_MmapAliased)
+
+BM_BundleRestoreModes(ManySmall, 10000, 256);
+BM_BundleRestoreModes(FewHuge, 4, 8 << 20);
+
 BM_BundleAlignment(1, 512);
 BM_BundleAlignment(1, 4096);
 BM_BundleAlignment(1, 1048576);
@@ -67,6 +67,7 @@ See [Importing Data](https://tensorflow.org/guide/datasets) for an overview.
 @@map_and_batch_with_legacy_function
 @@parallel_interleave
 @@parse_example_dataset
+@@parse_tfrecord_example_dataset
 @@prefetch_to_device
 @@rejection_resample
 @@sample_from_datasets
@@ -112,6 +113,7 @@ from tensorflow.python.data.experimental.ops.iterator_ops import make_saveable_f
 from tensorflow.python.data.experimental.ops.optimization_options import MapVectorizationOptions
 from tensorflow.python.data.experimental.ops.optimization_options import OptimizationOptions
 from tensorflow.python.data.experimental.ops.parsing_ops import parse_example_dataset
+from tensorflow.python.data.experimental.ops.parsing_ops import parse_tfrecord_example_dataset
 from tensorflow.python.data.experimental.ops.prefetching_ops import copy_to_device
 from tensorflow.python.data.experimental.ops.prefetching_ops import prefetch_to_device
 from tensorflow.python.data.experimental.ops.random_ops import RandomDataset
@@ -35,8 +35,11 @@ class AutotuneBenchmark(test.Benchmark):
     b = self._benchmark_map(autotune=True)
     c = self._benchmark_map(
         autotune=True, algorithm=dataset_ops.AutotuneAlgorithm.GRADIENT_DESCENT)
+    d = self._benchmark_map(
+        autotune=True, algorithm=dataset_ops.AutotuneAlgorithm.STEADY_STATE)
     print("HillClimb vs Default speedup: %f" % (a / b))
     print("GradientDescent vs Default speedup: %f" % (a / c))
+    print("SteadyState vs Default speedup: %f" % (a / d))
 
   def _benchmark_map(self,
                      autotune,
@@ -0,0 +1,119 @@
+# Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `tf.data.experimental.parse_tfrecord_example_dataset()`."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+import struct
+
+from absl.testing import parameterized
+
+from tensorflow.core.example import example_pb2
+from tensorflow.core.example import feature_pb2
+from tensorflow.python.data.experimental.ops import error_ops
+from tensorflow.python.data.experimental.ops import parsing_ops as contrib_parsing_ops
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import readers
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import test_util
+from tensorflow.python.lib.io import python_io
+from tensorflow.python.ops import parsing_ops
+from tensorflow.python.platform import test
+
+
+@test_util.run_all_in_graph_and_eager_modes
+class ParseTFRecordExampleDatasetTest(test_base.DatasetTestBase,
+                                      parameterized.TestCase):
+
+  def _writeFiles(self, num_files, num_records):
+    filenames = []
+    for i in range(num_files):
+      fn = os.path.join(self.get_temp_dir(), "tf_record.%d.txt" % i)
+      filenames.append(fn)
+      writer = python_io.TFRecordWriter(fn)
+      for j in range(num_records):
+        value = i * num_records + j
+        # Every other record omits "label" to exercise the dense default.
+        feature = {
+            "id": feature_pb2.Feature(
+                int64_list=feature_pb2.Int64List(value=[value])),
+            "tokens": feature_pb2.Feature(
+                bytes_list=feature_pb2.BytesList(
+                    value=[b"token"] * (value % 3))),
+        }
+        if value % 2:
+          feature["label"] = feature_pb2.Feature(
+              float_list=feature_pb2.FloatList(value=[float(value)]))
+        example = example_pb2.Example(
+            features=feature_pb2.Features(feature=feature))
+        writer.write(example.SerializeToString())
+      writer.close()
+    return filenames
+
+  @parameterized.named_parameters(
+      ("Remainder", 4, False),
+      ("DropRemainder", 4, True),
+      ("SpanningFiles", 7, False),
+  )
+  def testMatchesUnfusedPipeline(self, batch_size, drop_remainder):
+    filenames = self._writeFiles(num_files=2, num_records=5)
+    features = {
+        "id": parsing_ops.FixedLenFeature([], dtypes.int64),
+        "label": parsing_ops.FixedLenFeature([], dtypes.float32, -1.0),
+        "tokens": parsing_ops.VarLenFeature(dtypes.string),
+    }
+    fused = contrib_parsing_ops.parse_tfrecord_example_dataset(
+        filenames, features, batch_size, drop_remainder=drop_remainder)
+    unfused = readers.TFRecordDataset(filenames).batch(
+        batch_size, drop_remainder=drop_remainder).apply(
+            contrib_parsing_ops.parse_example_dataset(features))
+    self.assertDatasetsEqual(fused, unfused)
+
+  def testIgnoreErrorsKeepsPartialBatch(self):
+    filenames = self._writeFiles(num_files=2, num_records=5)
+    # Corrupt the payload of the third record of the first file. Each record
+    # is framed by an 8-byte length, a 4-byte length CRC and a 4-byte data
+    # CRC.
+    with open(filenames[0], "rb") as f:
+      contents = bytearray(f.read())
+    offset = 0
+    for _ in range(2):
+      length, = struct.unpack("<Q", bytes(contents[offset:offset + 8]))
+      offset += 8 + 4 + length + 4
+    contents[offset + 12] ^= 0xff
+    with open(filenames[0], "wb") as f:
+      f.write(contents)
+
+    features = {
+        "id": parsing_ops.FixedLenFeature([], dtypes.int64),
+        "label": parsing_ops.FixedLenFeature([], dtypes.float32, -1.0),
+        "tokens": parsing_ops.VarLenFeature(dtypes.string),
+    }
+    fused = contrib_parsing_ops.parse_tfrecord_example_dataset(
+        filenames, features, 4).apply(error_ops.ignore_errors())
+    unfused = readers.TFRecordDataset(filenames).apply(
+        error_ops.ignore_errors()).batch(4).apply(
+            contrib_parsing_ops.parse_example_dataset(features))
+    self.assertDatasetsEqual(fused, unfused)
+
+  def testMissingFeatures(self):
+    with self.assertRaises(ValueError):
+      contrib_parsing_ops.parse_tfrecord_example_dataset(["f"], None, 1)
+
+
+if __name__ == "__main__":
+  test.main()
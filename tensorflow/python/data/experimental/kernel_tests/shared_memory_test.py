@@ -0,0 +1,85 @@
+# Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for serving datasets over shared memory."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+import threading
+
+from absl.testing import parameterized
+
+from tensorflow.python.data.experimental.ops import shared_memory_ops
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import combinations
+from tensorflow.python.platform import test
+
+
+class SharedMemoryTest(test_base.DatasetTestBase, parameterized.TestCase):
+
+  def _serve(self, dataset, num_consumers, sharding_policy, buffer_size=None):
+    """Serves `dataset` and returns the elements read by each consumer."""
+    service_name = "%s_%d" % (self.id().split(".")[-1], os.getpid())
+    server = threading.Thread(
+        target=shared_memory_ops.serve_to_shared_memory,
+        args=(dataset, service_name, num_consumers, buffer_size,
+              sharding_policy))
+    server.start()
+    results = [[] for _ in range(num_consumers)]
+
+    def consume(consumer_index):
+      consumer = shared_memory_ops.SharedMemoryDataset(
+          service_name, consumer_index, dataset.element_spec)
+      for element in consumer:
+        results[consumer_index].append(self.evaluate(element))
+
+    consumers = [
+        threading.Thread(target=consume, args=(i,))
+        for i in range(num_consumers)
+    ]
+    for consumer in consumers:
+      consumer.start()
+    for consumer in consumers:
+      consumer.join()
+    server.join()
+    return results
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testShard(self):
+    dataset = dataset_ops.Dataset.range(100).batch(10)
+    results = self._serve(dataset, num_consumers=3, sharding_policy="shard")
+    expected = [self.evaluate(x) for x in dataset]
+    for i in range(3):
+      self.assertAllEqual(expected[i::3], results[i])
+
+  @combinations.generate(test_base.eager_only_combinations())
+  def testRoundRobin(self):
+    dataset = dataset_ops.Dataset.range(1000).map(lambda x: (x, [x, x]))
+    # A small buffer makes the server move on to other consumers when one of
+    # them falls behind.
+    results = self._serve(
+        dataset, num_consumers=4, sharding_policy="round_robin",
+        buffer_size=1024)
+    served = sorted(x for result in results for x, _ in result)
+    self.assertAllEqual(list(range(1000)), served)
+    for result in results:
+      for x, y in result:
+        self.assertAllEqual([x, x], y)
+
+
+if __name__ == "__main__":
+  test.main()
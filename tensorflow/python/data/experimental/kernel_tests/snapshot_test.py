@@ -27,7 +27,10 @@ from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import readers as core_readers
 from tensorflow.python.framework import combinations
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import gen_array_ops
+from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import string_ops
 from tensorflow.python.platform import test
 
@@ -187,6 +190,30 @@ class SnapshotDatasetTest(reader_dataset_ops_test_base.TFRecordDatasetTestBase,
         tmpdir, compression=compression))
     self.assertDatasetProduces(dataset2, expected)
 
+  @combinations.generate(
+      combinations.times(
+          test_base.default_test_combinations(),
+          combinations.combine(compression=[
+              snapshot.COMPRESSION_NONE, snapshot.COMPRESSION_GZIP,
+              snapshot.COMPRESSION_SNAPPY
+          ])))
+  def testReadSnapshotBackAfterWriteMixedTypes(self, compression):
+    tmpdir = self.makeSnapshotDirectory()
+
+    def make_dataset():
+      dataset = dataset_ops.Dataset.range(20)
+      dataset = dataset.map(lambda x: (  # pylint:disable=g-long-lambda
+          x,
+          array_ops.fill([x % 3 + 1, 2], math_ops.cast(x, dtypes.float32)),
+          string_ops.as_string(x)))
+      return dataset.apply(snapshot.snapshot(tmpdir, compression=compression))
+
+    expected = [(x, [[float(x)] * 2] * (x % 3 + 1), b"%d" % x)
+                for x in range(20)]
+    self.assertDatasetProduces(make_dataset(), expected)
+    # The second pass reads the elements back from the snapshot.
+    self.assertDatasetProduces(make_dataset(), expected)
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadShuffledSnapshotAfterWrite(self):
     self.setUpTFRecord(num_files=10, num_records=50)
@@ -96,7 +96,7 @@ class OptimizationOptions(options.OptionsBase):
       docstring=
       "When autotuning is enabled (through `autotune`), determines whether to "
       "also autotune buffer sizes for datasets with parallelism. If None,"
-      " defaults to False.")
+      " defaults to False, unless `autotune_algorithm` is `STEADY_STATE`.")
 
   autotune_cpu_budget = options.create_option(
       name="autotune_cpu_budget",
@@ -107,6 +107,15 @@ class OptimizationOptions(options.OptionsBase):
       "are allowed but may result in CPU contention. If None, defaults to the "
       "number of schedulable CPU cores.")
 
+  autotune_report_path = options.create_option(
+      name="autotune_report_path",
+      ty=str,
+      docstring=
+      "When autotuning is enabled (through `autotune`), identifies a file to "
+      "which a text `PipelineReport` proto, breaking down the output latency "
+      "of the input pipeline across its transformations, is periodically "
+      "written. If None, no report is written.")
+
   filter_fusion = options.create_option(
       name="filter_fusion",
       ty=bool,
@@ -214,7 +223,12 @@ class OptimizationOptions(options.OptionsBase):
     if self.map_vectorization is not None:
       result.update(self.map_vectorization._static_optimizations())  # pylint: disable=protected-access
 
-    if self.autotune is not False and self.autotune_buffers:  # pylint: disable=g-bool-id-comparison
+    # The `STEADY_STATE` autotuning algorithm (2) tunes buffer sizes together
+    # with parallelism, so it autotunes buffers unless the user disables it.
+    autotune_buffers = self.autotune_buffers
+    if autotune_buffers is None:
+      autotune_buffers = self.autotune_algorithm == 2
+    if self.autotune is not False and autotune_buffers:  # pylint: disable=g-bool-id-comparison
       result.add("inject_prefetch")
     return sorted(list(result))
 
@@ -18,15 +18,21 @@ from __future__ import division
 from __future__ import print_function
 
 from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.util import convert
 from tensorflow.python.data.util import structure
 from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
+from tensorflow.python.framework import tensor_shape
 from tensorflow.python.framework import tensor_spec
+from tensorflow.python.framework import tensor_util
 from tensorflow.python.ops import gen_experimental_dataset_ops
 from tensorflow.python.ops import parsing_ops
 from tensorflow.python.ops.ragged import ragged_tensor
 from tensorflow.python.util.tf_export import tf_export
 
+_DEFAULT_READER_BUFFER_SIZE_BYTES = 256 * 1024  # 256 KB
+
 
 class _ParseExampleDataset(dataset_ops.UnaryDataset):
   """A `Dataset` that parses `example` dataset into a `dict` dataset."""
@@ -146,3 +152,157 @@ def parse_example_dataset(features, num_parallel_calls=1):
     return out_dataset
 
   return _apply_fn
+
+
+class _ParseTFRecordExampleDataset(dataset_ops.DatasetSource):
+  """A `Dataset` that reads and parses batches of `Example` records."""
+
+  def __init__(self, filenames, features, batch_size, drop_remainder,
+               compression_type, buffer_size):
+    self._filenames = ops.convert_to_tensor(
+        filenames, dtype=dtypes.string, name="filenames")
+    self._compression_type = convert.optional_param_to_tensor(
+        "compression_type",
+        compression_type,
+        argument_default="",
+        argument_dtype=dtypes.string)
+    self._buffer_size = convert.optional_param_to_tensor(
+        "buffer_size",
+        buffer_size,
+        argument_default=_DEFAULT_READER_BUFFER_SIZE_BYTES)
+    self._batch_size = ops.convert_to_tensor(
+        batch_size, dtype=dtypes.int64, name="batch_size")
+    self._drop_remainder = ops.convert_to_tensor(
+        drop_remainder, dtype=dtypes.bool, name="drop_remainder")
+    # pylint: disable=protected-access
+    self._features = parsing_ops._prepend_none_dimension(features)
+    params = parsing_ops._ParseOpParams.from_features(self._features, [
+        parsing_ops.VarLenFeature, parsing_ops.SparseFeature,
+        parsing_ops.FixedLenFeature, parsing_ops.FixedLenSequenceFeature,
+        parsing_ops.RaggedFeature
+    ])
+    # pylint: enable=protected-access
+
+    constant_drop_remainder = tensor_util.constant_value(self._drop_remainder)
+    if constant_drop_remainder:
+      batch_shape = tensor_shape.TensorShape(
+          [tensor_util.constant_value(self._batch_size)])
+    else:
+      batch_shape = tensor_shape.TensorShape([None])
+
+    self._element_spec = {}
+    for (key, value_type) in zip(params.sparse_keys, params.sparse_types):
+      self._element_spec[key] = sparse_tensor.SparseTensorSpec(
+          batch_shape.concatenate([None]), value_type)
+    for (key, value_type, dense_shape) in zip(params.dense_keys,
+                                              params.dense_types,
+                                              params.dense_shapes):
+      self._element_spec[key] = tensor_spec.TensorSpec(
+          batch_shape.concatenate(dense_shape), value_type)
+    for (key, value_type, splits_type) in zip(params.ragged_keys,
+                                              params.ragged_value_types,
+                                              params.ragged_split_types):
+      self._element_spec[key] = ragged_tensor.RaggedTensorSpec(
+          batch_shape.concatenate([None]), value_type, 1, splits_type)
+
+    variant_tensor = (
+        gen_experimental_dataset_ops.parse_tf_record_example_dataset(
+            self._filenames,
+            self._compression_type,
+            self._buffer_size,
+            self._batch_size,
+            self._drop_remainder,
+            params.dense_defaults_vec,
+            params.sparse_keys,
+            params.dense_keys,
+            params.sparse_types,
+            params.dense_shapes_as_proto,
+            ragged_keys=params.ragged_keys,
+            ragged_value_types=params.ragged_value_types,
+            ragged_split_types=params.ragged_split_types,
+            **self._flat_structure))
+    super(_ParseTFRecordExampleDataset, self).__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return self._element_spec
+
+
+@tf_export("data.experimental.parse_tfrecord_example_dataset", v1=[])
+def parse_tfrecord_example_dataset_v2(filenames,
+                                      features,
+                                      batch_size,
+                                      drop_remainder=False,
+                                      compression_type=None,
+                                      buffer_size=None):
+  """Reads batches of `Example` protos from TFRecord files and parses them.
+
+  The resulting dataset produces the same elements as
+
+  ```python
+  tf.data.TFRecordDataset(filenames, compression_type, buffer_size).batch(
+      batch_size, drop_remainder).apply(
+          tf.data.experimental.parse_example_dataset(features))
+  ```
+
+  but reads and parses each batch in a single step: the records of a batch
+  are parsed together by the fast `Example` parser, using the intra-op thread
+  pool, without materializing a string tensor per record.
+
+  Args:
+    filenames: A `tf.string` tensor containing one or more filenames.
+    features: A `dict` mapping feature keys to `FixedLenFeature`,
+      `VarLenFeature`, `RaggedFeature`, and `SparseFeature` values.
+    batch_size: A `tf.int64` scalar `tf.Tensor`, representing the number of
+      records to parse into each element.
+    drop_remainder: (Optional.) A `tf.bool` scalar `tf.Tensor`, representing
+      whether the last batch should be dropped in case it has fewer than
+      `batch_size` elements; the default behavior is not to drop the smaller
+      batch.
+    compression_type: (Optional.) A `tf.string` scalar evaluating to one of
+      `""` (no compression), `"ZLIB"`, or `"GZIP"`.
+    buffer_size: (Optional.) A `tf.int64` scalar representing the number of
+      bytes in the read buffer. 0 means no buffering.
+
+  Returns:
+    A `Dataset` of `dict`s mapping feature keys to batched `Tensor`,
+    `SparseTensor`, and `RaggedTensor` objects.
+
+  Raises:
+    ValueError: if features argument is None.
+  """
+  if features is None:
+    raise ValueError("Missing: features was %s." % features)
+  dataset = _ParseTFRecordExampleDataset(filenames, features, batch_size,
+                                         drop_remainder, compression_type,
+                                         buffer_size)
+  if any(
+      isinstance(feature, parsing_ops.SparseFeature) or
+      (isinstance(feature, parsing_ops.RaggedFeature) and feature.partitions)
+      for feature in features.values()):
+    # pylint: disable=protected-access
+    # pylint: disable=g-long-lambda
+    dataset = dataset.map(
+        lambda x: parsing_ops._construct_tensors_for_composite_features(
+            features, x))
+  return dataset
+
+
+@tf_export(v1=["data.experimental.parse_tfrecord_example_dataset"])
+def parse_tfrecord_example_dataset_v1(filenames,
+                                      features,
+                                      batch_size,
+                                      drop_remainder=False,
+                                      compression_type=None,
+                                      buffer_size=None):
+  return dataset_ops.DatasetV1Adapter(
+      parse_tfrecord_example_dataset_v2(filenames, features, batch_size,
+                                        drop_remainder, compression_type,
+                                        buffer_size))
+parse_tfrecord_example_dataset_v1.__doc__ = (
+    parse_tfrecord_example_dataset_v2.__doc__)
+
+
+# TODO(b/119044825): Until all `tf.data` unit tests are converted to V2, keep
+# this alias in place.
+parse_tfrecord_example_dataset = parse_tfrecord_example_dataset_v1
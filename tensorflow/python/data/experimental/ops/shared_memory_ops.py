@@ -0,0 +1,113 @@
+# Copyright 2019 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Serving a dataset to other processes on the same host over shared memory.
+
+One process runs the input pipeline and serves its elements:
+
+```python
+dataset = ...  # The input pipeline, including batching.
+serve_to_shared_memory(dataset, "train", num_consumers=8)
+```
+
+Each trainer process on the host then reads its share of the elements:
+
+```python
+dataset = SharedMemoryDataset("train", consumer_index=task_index,
+                              element_spec=element_spec)
+```
+"""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.util import convert
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import gen_experimental_dataset_ops
+
+# The default size of the shared memory buffer of each consumer.
+_DEFAULT_BUFFER_SIZE_BYTES = 16 * 1024 * 1024
+
+
+def serve_to_shared_memory(dataset,
+                           service_name,
+                           num_consumers,
+                           buffer_size=None,
+                           sharding_policy="round_robin"):
+  """Serves the elements of `dataset` to consumers on this host.
+
+  Each consumer reads from its own ring buffer in POSIX shared memory, using a
+  `SharedMemoryDataset` with the same `service_name`. Serving returns once
+  `dataset` is exhausted and every consumer has read its remaining elements.
+
+  Args:
+    dataset: A `tf.data.Dataset` whose elements are to be served.
+    service_name: A `tf.string` scalar naming the service.
+    num_consumers: A `tf.int64` scalar representing the number of consumers.
+    buffer_size: (Optional.) A `tf.int64` scalar representing the size, in
+      bytes, of the buffer of each consumer. It must be large enough to hold
+      one serialized element.
+    sharding_policy: (Optional.) Either "round_robin", which hands each element
+      to the next consumer in turn that has room for it, or "shard", which
+      hands element `i` to consumer `i % num_consumers`.
+
+  Returns:
+    In graph mode, an operation that serves the dataset when run. In eager
+    mode, the dataset is served by the function itself, which returns `None`.
+
+  Raises:
+    TypeError: If `dataset` is not a `tf.data.Dataset`.
+  """
+  if not isinstance(dataset, dataset_ops.DatasetV2):
+    raise TypeError("`dataset` must be a `tf.data.Dataset` object.")
+  service_name = ops.convert_to_tensor(
+      service_name, dtype=dtypes.string, name="service_name")
+  num_consumers = ops.convert_to_tensor(
+      num_consumers, dtype=dtypes.int64, name="num_consumers")
+  buffer_size = convert.optional_param_to_tensor(
+      "buffer_size", buffer_size, argument_default=_DEFAULT_BUFFER_SIZE_BYTES)
+  return gen_experimental_dataset_ops.dataset_to_shared_memory(
+      dataset._variant_tensor,  # pylint: disable=protected-access
+      service_name,
+      num_consumers,
+      buffer_size,
+      sharding_policy=sharding_policy)
+
+
+class SharedMemoryDataset(dataset_ops.DatasetSource):
+  """A `Dataset` of the elements served by `serve_to_shared_memory`."""
+
+  def __init__(self, service_name, consumer_index, element_spec):
+    """Creates a `SharedMemoryDataset`.
+
+    Args:
+      service_name: A `tf.string` scalar naming the service.
+      consumer_index: A `tf.int64` scalar representing the index of this
+        consumer, in `[0, num_consumers)`.
+      element_spec: The `element_spec` of the served dataset.
+    """
+    self._element_spec = element_spec
+    variant_tensor = gen_experimental_dataset_ops.shared_memory_dataset(
+        ops.convert_to_tensor(
+            service_name, dtype=dtypes.string, name="service_name"),
+        ops.convert_to_tensor(
+            consumer_index, dtype=dtypes.int64, name="consumer_index"),
+        **self._flat_structure)
+    super(SharedMemoryDataset, self).__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return self._element_spec
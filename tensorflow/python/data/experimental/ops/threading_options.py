@@ -47,4 +47,7 @@ class ThreadingOptions(options.OptionsBase):
       name="private_threadpool_size",
       ty=int,
       docstring=
-      "If set, the dataset will use a private threadpool of the given size.")
+      "If set, the dataset will use a private threadpool of the given size. "
+      "If set to `tf.data.experimental.AUTOTUNE`, the number of threads of "
+      "the threadpool that are used at a time is tuned by the "
+      "`STEADY_STATE` autotuning algorithm.")
@@ -171,6 +171,33 @@ class FileCacheTest(test_base.DatasetTestBase, parameterized.TestCase):
     self.assertAllEqual(elements, elements_itr1)
     self.assertAllEqual(elements, elements_itr2)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testPersistentCacheConcurrentWriters(self):
+
+    def dataset_fn():
+      return dataset_ops.CacheDataset(
+          dataset_ops.Dataset.range(10), self.cache_prefix,
+          persistent_chunk_size_bytes=16)
+
+    # Unlike the single-file cache, writers of a persistent cache do not lock
+    # it, so both iterators make progress.
+    get_next1 = self.getNext(dataset_fn())
+    get_next2 = self.getNext(dataset_fn())
+    elements1 = []
+    elements2 = []
+    for _ in range(10):
+      elements1.append(self.evaluate(get_next1()))
+      elements2.append(self.evaluate(get_next2()))
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next1())
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next2())
+    self.assertEqual(list(range(10)), elements1)
+    self.assertEqual(list(range(10)), elements2)
+
+    # A later run of the same input pipeline reads the sealed chunks.
+    self.assertDatasetProduces(dataset_fn(), list(range(10)))
+
   @combinations.generate(test_base.default_test_combinations())
   def testReadingPastEndOfSequence(self):
     dataset = dataset_ops.Dataset.range(10).cache(self.cache_prefix)
@@ -100,6 +100,7 @@ tf_export("data.experimental.AUTOTUNE").export_constant(__name__, "AUTOTUNE")
 class AutotuneAlgorithm(enum.Enum):
   HILL_CLIMB = 0
   GRADIENT_DESCENT = 1
+  STEADY_STATE = 2
 
 
 @tf_export("data.Dataset", v1=[])
@@ -320,6 +321,7 @@ class DatasetV2(tracking_base.Trackable, composite_tensor.CompositeTensor):
     autotune = True
     algorithm = AutotuneAlgorithm.HILL_CLIMB
     cpu_budget = 0  # Indicates that all CPU cores should be used.
+    report_path = None
     if options.experimental_optimization is not None:
       if options.experimental_optimization.autotune is False:  # pylint: disable=g-bool-id-comparison
         autotune = False
@@ -327,9 +329,10 @@ class DatasetV2(tracking_base.Trackable, composite_tensor.CompositeTensor):
         algorithm = options.experimental_optimization.autotune_algorithm
       if options.experimental_optimization.autotune_cpu_budget is not None:
         cpu_budget = options.experimental_optimization.autotune_cpu_budget
+      report_path = options.experimental_optimization.autotune_report_path
 
     if autotune:
-      dataset = _ModelDataset(dataset, algorithm, cpu_budget)
+      dataset = _ModelDataset(dataset, algorithm, cpu_budget, report_path)
 
     if options.experimental_stats and options.experimental_stats.aggregator:  # pylint: disable=line-too-long
       dataset = _SetStatsAggregatorDataset(  # pylint: disable=protected-access
@@ -3184,8 +3187,18 @@ class _MemoryCache(object):
 class CacheDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that caches elements of its input."""
 
-  def __init__(self, input_dataset, filename):
-    """See `Dataset.cache()` for details."""
+  def __init__(self, input_dataset, filename, persistent_chunk_size_bytes=0):
+    """See `Dataset.cache()` for details.
+
+    Args:
+      input_dataset: The input dataset.
+      filename: A `tf.string` scalar `tf.Tensor`, representing the name of a
+        directory on the filesystem to use for caching elements.
+      persistent_chunk_size_bytes: (Optional.) If positive, the elements are
+        cached under a subdirectory of `filename` named after a fingerprint of
+        `input_dataset`, in chunks of about this many bytes that are reused by
+        later runs of the same input pipeline.
+    """
     self._input_dataset = input_dataset
     self._filename = ops.convert_to_tensor(
         filename, dtype=dtypes.string, name="filename")
@@ -3196,11 +3209,13 @@ class CacheDataset(UnaryUnchangedStructureDataset):
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
           cache=self._cache.handle,
+          persistent_chunk_size_bytes=persistent_chunk_size_bytes,
           **self._flat_structure)
     else:
       variant_tensor = gen_dataset_ops.cache_dataset(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           filename=self._filename,
+          persistent_chunk_size_bytes=persistent_chunk_size_bytes,
           **self._flat_structure)
     super(CacheDataset, self).__init__(input_dataset, variant_tensor)
 
@@ -3936,12 +3951,21 @@ class _OptionsDataset(UnaryUnchangedStructureDataset):
 class _ModelDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that acts as an identity, and models performance."""
 
-  def __init__(self, input_dataset, algorithm, cpu_budget):
+  def __init__(self, input_dataset, algorithm, cpu_budget, report_path=None):
     self._input_dataset = input_dataset
+    # The `report_path` attribute is only passed when it is set, so that graphs
+    # that do not use it remain readable by older servers.
+    if report_path:
+      variant_tensor = gen_dataset_ops.model_dataset(
+          input_dataset._variant_tensor,  # pylint: disable=protected-access
+          algorithm=algorithm,
+          cpu_budget=cpu_budget,
+          report_path=report_path,
+          **self._flat_structure)
     # TODO(jsimsa): This check is introduced for forward compatibility and can
     # be removed after 7/24/2019. At that point, all servers are expected to
     # recognize the `algorithm` attribute.
-    if algorithm != AutotuneAlgorithm.HILL_CLIMB:
+    elif algorithm != AutotuneAlgorithm.HILL_CLIMB:
       variant_tensor = gen_dataset_ops.model_dataset(
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           algorithm=algorithm,